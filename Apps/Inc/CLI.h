@@ -33,6 +33,11 @@
 #define CLI_CRITICAL_HASH       0x15F38A6F
 #define CLI_ABORT_HASH          0x69825B0
 #define CLI_ALL_HASH            0x1A2E1
+#define CLI_TASKS_HASH          0x686EE8E
+#define CLI_PERF_HASH           0x301677
+#define CLI_IDLE_HASH           0x2F8B6C
+#define CLI_TRACE_HASH          0x5BDC105
+#define CLI_COUNTERS_HASH       0x38CD100E
 
 #define CLI_MODULE_HASH         0x3B4C81C2
 #define CLI_TOTAL_HASH          0x61FC3C4
@@ -66,9 +71,6 @@
 #define CLI_PARTYTIME_HASH      0x391FEB33
 #define CLI_PING_HASH           0x307C4E
 
-// Useful values
-#define NUM_TEMP_SENSORS_LAST_MINION    14
-
 /** CLI_Init
  * Initializes the CLI with the values it needs
  * @param minions is a cell_asic struct describing the LTC6811
@@ -191,6 +193,35 @@ void CLI_EEPROM(int* hashTokens);
  */
 void CLI_ADC(void);
 
+/** CLI_Tasks
+ * Prints the deadline misses, jitter and run time of every scheduled task and the worst case
+ * fault response they add up to
+ */
+void CLI_Tasks(void);
+
+/** CLI_Perf
+ * Prints how long the stages under a profiler probe took, or resets the probes
+ * @param hashTokens is the array of hashed tokenized inputs
+ */
+void CLI_Perf(int* hashTokens);
+
+/** CLI_Idle
+ * Prints the share of time the CPU slept since boot and since the last time it was asked
+ */
+void CLI_Idle(void);
+
+/** CLI_Trace
+ * Dumps the event trace for Tools/trace2json.py and empties it, or just empties it
+ * @param hashTokens is the array of hashed tokenized inputs
+ */
+void CLI_Trace(int* hashTokens);
+
+/** CLI_Counters
+ * Lists the error counters and gauges, or resets them
+ * @param hashTokens is the array of hashed tokenized inputs
+ */
+void CLI_Counters(int* hashTokens);
+
 /** CLI_Critical
  * Shuts off contactor manually
  */  
@@ -10,16 +10,17 @@
 #include "EEPROM.h"
 
 /** Charge_Init
- * Initializes necessary timer and values to begin state of charge
- * calculation algorithm.
+ * Initializes the values to begin state of charge calculation algorithm, starting from the
+ * newest checkpoint in EEPROM. Call after EEPROM_Init.
  */
 void Charge_Init(void);
 
 /** Charge_Calculate
- * Calculates new Charge depending on the current reading
- * @param current reading from hall effect sensors. Fixed point of 0.0001 (1.500 Amps = 15000)
+ * Takes the charge that flowed since the last call off the charge left in the pack, then
+ * corrects it with the average module voltage.
+ * No matter how often this is called, every current sample is counted exactly once.
  */
-void Charge_Calculate(int32_t milliamps);
+void Charge_Calculate(void);
 
 /** Charge_Calibrate
  * Calibrates the Charge. Whenever the BPS trips, the Charge should recalibrate. If an undervoltage
@@ -37,8 +38,27 @@ uint32_t Charge_GetPercent(void);
 
 /** Charge_SetAccum 
  * Sets the accumulator of the coloumb counting algorithm
- * @param accumulator new value. Resolution = 0.0001.
+ * @param accumulator value in percent of total charge,
+ *                    with a resolution = 0.01%
  */
 void Charge_SetAccum(int32_t accum);
 
+/** Charge_GetChargeMoved
+ * Gets Current_GetChargeMoved as of the last Charge_Calculate. Safe to call from any task.
+ * @return microamp seconds out of the pack since Current_Init, negative if more flowed in than out
+ */
+int64_t Charge_GetChargeMoved(void);
+
+/** Charge_GetCycles
+ * Gets how long the last Charge_Calculate took
+ * @return CPU cycles (nanoseconds on the simulator)
+ */
+uint32_t Charge_GetCycles(void);
+
+/** Charge_GetMaxCycles
+ * Gets the longest any Charge_Calculate took since Charge_Init
+ * @return CPU cycles (nanoseconds on the simulator)
+ */
+uint32_t Charge_GetMaxCycles(void);
+
 #endif
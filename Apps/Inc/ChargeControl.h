@@ -0,0 +1,65 @@
+/** ChargeControl.h
+ * Charge controller. Runs the charge profile and sends the charger its voltage and current
+ * setpoints, so the end of charge is reached on the highest module instead of tripping on
+ * OVERVOLTAGE. See CHARGE_CONTROL_* in config.h.
+ */
+
+#ifndef CHARGE_CONTROL_H__
+#define CHARGE_CONTROL_H__
+
+#include "common.h"
+#include "config.h"
+
+typedef enum {
+	CHARGE_IDLE = 0,		// Not charging, charger off
+	CHARGE_PRECHARGE,		// Small current until the lowest module is out of deep discharge
+	CHARGE_CC,				// Constant current
+	CHARGE_CV,				// Highest module held at CHARGE_CONTROL_CV_VOLTAGE
+	CHARGE_BALANCE,			// Top-off current while the high modules bleed down
+	CHARGE_DONE,			// Full, charger off
+	CHARGE_FAULT,			// Charger did not follow its setpoint, charger off
+	NUM_CHARGE_STATES
+} ChargeState;
+
+/** ChargeControl_Init
+ * Starts out idle with the charger off. Call after Voltage_Init and PowerLimit_Init.
+ */
+void ChargeControl_Init(void);
+
+/** ChargeControl_Start
+ * Starts a charge, the charger has to be plugged in
+ */
+void ChargeControl_Start(void);
+
+/** ChargeControl_Stop
+ * Stops the charge and turns the charger and balancing off
+ */
+void ChargeControl_Stop(void);
+
+/** ChargeControl_Update
+ * Runs the state machine once every CHARGE_CONTROL_PERIOD_MS. A new charge limit or a
+ * charger that pushes too much current shows in the setpoint of the same period.
+ * Call right after PowerLimit_Update.
+ * @return true if a new setpoint is due on CAN
+ */
+bool ChargeControl_Update(void);
+
+/** ChargeControl_GetState
+ * Gets where the charge is at
+ * @return state of the charge profile
+ */
+ChargeState ChargeControl_GetState(void);
+
+/** ChargeControl_GetCurrent
+ * Gets the current setpoint of the charger
+ * @return milliamperes, 0 when the charger is off
+ */
+int32_t ChargeControl_GetCurrent(void);
+
+/** ChargeControl_GetVoltage
+ * Gets the pack voltage setpoint of the charger
+ * @return millivolts, 0 when the charger is off
+ */
+uint32_t ChargeControl_GetVoltage(void);
+
+#endif
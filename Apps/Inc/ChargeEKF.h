@@ -0,0 +1,53 @@
+/** ChargeEKF.h
+ * Extended Kalman filter for the state of charge. The coulomb count predicts, the voltage
+ * corrects through the open circuit voltage curve and a one RC pair model. Every filter keeps
+ * its own state so a pack or each module can have one. See CHARGE_EKF_* in config.h.
+ */
+
+#ifndef CHARGE_EKF_H__
+#define CHARGE_EKF_H__
+
+#include "common.h"
+#include "config.h"
+
+typedef struct {
+	int64_t charge;			// Charge left (microamp seconds)
+	int64_t capacity;		// Charge when full (microamp seconds)
+	float rcVoltage;		// Voltage over the RC pair (V)
+	float covariance[4];	// Row major, state of charge (0 to 1) and RC pair voltage
+} ChargeEKF;
+
+/** ChargeEKF_Init
+ * Starts a filter at a state of charge with the RC pair at rest
+ * @param ekf filter to start
+ * @param capacity charge when full, microamp seconds
+ * @param percent state of charge, resolution 0.01% (45.55% = 4555)
+ * @param errorPercent how far percent may be off, whole percent
+ */
+void ChargeEKF_Init(ChargeEKF *ekf, int64_t capacity, uint32_t percent, uint32_t errorPercent);
+
+/** ChargeEKF_Predict
+ * Takes the charge that flowed off the state of charge and moves the RC pair along
+ * @param ekf filter to update
+ * @param microAmpSeconds charge out of the pack since the last prediction
+ * @param milliSeconds time since the last prediction
+ */
+void ChargeEKF_Predict(ChargeEKF *ekf, int64_t microAmpSeconds, uint32_t milliSeconds);
+
+/** ChargeEKF_Correct
+ * Corrects the state of charge and RC pair voltage with a voltage measurement. Readings far
+ * outside CHARGE_OCV_TABLE are left to the voltage checks.
+ * @param ekf filter to update
+ * @param milliVolts module voltage
+ * @param milliAmps current at the time of the measurement
+ */
+void ChargeEKF_Correct(ChargeEKF *ekf, uint16_t milliVolts, int32_t milliAmps);
+
+/** ChargeEKF_GetPercent
+ * Gets the state of charge of a filter
+ * @param ekf filter
+ * @return fixed point percentage. Resolution = 0.01 (45.55% = 4555)
+ */
+uint32_t ChargeEKF_GetPercent(const ChargeEKF *ekf);
+
+#endif
@@ -0,0 +1,57 @@
+/** ChargeJournal.h
+ * Keeps the state of charge across resets. Checkpoints rotate through CHARGE_JOURNAL_SLOTS
+ * EEPROM slots so no slot wears out, each one carries a sequence number and a CRC so a
+ * checkpoint torn by a power loss is never taken for a good one. On a supply drop a thread
+ * waiting in ChargeJournal_WaitPowerFail writes the final checkpoint with ChargeJournal_WriteFinal.
+ */
+
+#ifndef CHARGE_JOURNAL_H__
+#define CHARGE_JOURNAL_H__
+
+#include "common.h"
+#include "config.h"
+
+/** ChargeJournal_Init
+ * Finds the newest good checkpoint and arms the final checkpoint on a supply drop.
+ * Call after EEPROM_Init.
+ * @param charge where to store the charge of the newest checkpoint, microamp seconds
+ * @return true if there was a good checkpoint
+ */
+bool ChargeJournal_Init(int64_t *charge);
+
+/** ChargeJournal_Update
+ * Writes a checkpoint when CHARGE_JOURNAL_PERIOD_S has passed since the last one or the
+ * charge moved by CHARGE_JOURNAL_DELTA. A checkpoint is a single EEPROM page write, the
+ * EEPROM finishes it on its own while the loop goes on.
+ * @param charge charge left, microamp seconds
+ * @param milliSeconds current time
+ */
+void ChargeJournal_Update(int64_t charge, uint32_t milliSeconds);
+
+/** ChargeJournal_PowerFail
+ * Stops the regular checkpoints and wakes the thread in ChargeJournal_WaitPowerFail.
+ * Called from the supply drop interrupt, it does not touch the EEPROM.
+ */
+void ChargeJournal_PowerFail(void);
+
+/** ChargeJournal_WaitPowerFail
+ * Waits for the supply to drop
+ * @param millisec how long to wait, osWaitForever for no limit
+ * @return true if the supply dropped
+ */
+bool ChargeJournal_WaitPowerFail(uint32_t millisec);
+
+/** ChargeJournal_WriteFinal
+ * Writes the final checkpoint with the charge of the last ChargeJournal_Update, unless the
+ * last checkpoint already has it. Only the first call writes. The caller has to hold the
+ * EEPROM like for ChargeJournal_Update.
+ */
+void ChargeJournal_WriteFinal(void);
+
+/** ChargeJournal_GetWrites
+ * Gets how many checkpoints have been written since ChargeJournal_Init
+ * @return number of writes
+ */
+uint32_t ChargeJournal_GetWrites(void);
+
+#endif
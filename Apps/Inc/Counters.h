@@ -0,0 +1,75 @@
+/** Counters.h
+ * Error counters and gauges of the whole BPS in one table. A counter only goes up, a gauge
+ * holds the last value set. Every entry is a 32-bit word of a static array, so COUNTER_INC
+ * compiles to one read-modify-write with no call or lookup. It is not atomic, an increment
+ * racing another one of the same counter from a higher priority context can get lost.
+ * Counters_Export walks the table for the CLI listing, the CAN dump and the simulator CSV.
+ * To add an entry, add a line to COUNTERS.
+ */
+
+#ifndef COUNTERS_H__
+#define COUNTERS_H__
+
+#include "common.h"
+
+// X(id, gauge, name)
+#define COUNTERS(X) \
+	X(COUNTER_PEC_ERRORS,		false,	"pec errors")		/* LTC6811 registers read with a bad PEC */ \
+	X(COUNTER_SPI_SCAN_ERRORS,	false,	"scan errors")		/* Voltage or temperature scans that failed */ \
+	X(COUNTER_I2C_TIMEOUTS,		false,	"i2c timeouts")		/* EEPROM transfers given up on */ \
+	X(COUNTER_UART_RX_DROPS,	false,	"uart rx drops")	/* Bytes lost to a full fifo or an overrun */ \
+	X(COUNTER_UART_TX_DROPS,	false,	"uart tx drops")	/* Bytes lost to a full fifo */ \
+	X(COUNTER_CAN_TX_FAILURES,	false,	"can tx failures")	/* Messages without a free mailbox */ \
+	X(COUNTER_TASK_OVERRUNS,	false,	"task overruns")	/* Scheduler task runs past their deadline */ \
+	X(COUNTER_TASK_SKIPS,		false,	"task skips")		/* Scheduler releases skipped after an overrun */ \
+	X(GAUGE_IDLE_PERCENT,		true,	"idle percent")		/* CPU idle over the last comms period */ \
+	X(GAUGE_SAFETY_JITTER_MS,	true,	"safety jitter")	/* Longest delay of a safety task release */
+
+#define COUNTERS_ID(id, gauge, name)	id,
+typedef enum {
+	COUNTERS(COUNTERS_ID)
+	NUM_COUNTERS
+} CounterId;
+#undef COUNTERS_ID
+
+extern volatile uint32_t Counters[NUM_COUNTERS];
+
+#define COUNTER_INC(id)				(Counters[id]++)
+#define COUNTER_ADD(id, amount)		(Counters[id] += (amount))
+#define GAUGE_SET(id, value)		(Counters[id] = (value))
+
+/** CountersEmit
+ * Takes one entry from Counters_Export
+ * @param id of the entry
+ * @param name for reports
+ * @param gauge true for a gauge, false for a counter
+ * @param value of the entry
+ * @param context passed to Counters_Export
+ */
+typedef void (*CountersEmit)(CounterId id, const char *name, bool gauge, uint32_t value, void *context);
+
+/** Counters_Export
+ * Hands entries to an exporter, starting at first and wrapping around the end of the table
+ * @param first entry
+ * @param count of entries, at most NUM_COUNTERS
+ * @param emit called for every entry
+ * @param context passed on to emit
+ * @return the entry after the last one handed over, where the next call can carry on
+ */
+CounterId Counters_Export(CounterId first, uint8_t count, CountersEmit emit, void *context);
+
+/** Counters_Reset
+ * Sets every counter and gauge back to 0
+ */
+void Counters_Reset(void);
+
+#ifdef SIMULATION
+/** Counters_DumpCSV
+ * Appends a row of every entry to a CSV file, with a header row if the file is new
+ * @param path of the file
+ * @param time of the row in ms
+ */
+void Counters_DumpCSV(const char *path, uint32_t time);
+#endif
+
+#endif
@@ -13,17 +13,20 @@
  
 /** Current_Init
  * Initializes two ADCs to begin current monitoring.
+ * The analog watchdog guards the instantaneous limits of Current_CheckStatus between main loop passes.
  */
 void Current_Init(void);
 
 /** Current_UpdateMeasurements
- * Stores and updates the new measurements received
+ * Stores and updates the new measurements received. Goes through every averaged
+ * ADC reading since the last call, the newest one becomes the current measurement.
  * @return SUCCESS or ERROR
  */
 ErrorStatus Current_UpdateMeasurements(void);
 
 /** Current_CheckStatus
- * Checks if pack does not have a short circuit
+ * Checks if pack does not have a short circuit or an overload past the fuse curves.
+ * Stays DANGER once the analog watchdog or a fuse curve tripped.
  * @return SAFE or DANGER
  */
 SafetyStatus Current_CheckStatus(bool override);
@@ -47,4 +50,19 @@ int32_t Current_GetHighPrecReading(void);
  */
 int32_t Current_GetLowPrecReading(void);
 
+/** Current_GetSampleTime
+ * Gets when the newest reading was taken
+ * @return milliseconds since Current_Init
+ */
+uint32_t Current_GetSampleTime(void);
+
+/** Current_GetChargeMoved
+ * Gets the charge that has flowed out of the pack since Current_Init. Every sample of the
+ * low precision sensor counts, however long the main loop takes between two calls.
+ * Call at least once an hour, and from one task only: Charge_Calculate calls it, everyone
+ * else reads Charge_GetChargeMoved.
+ * @return microamp seconds, negative if more flowed in than out
+ */
+int64_t Current_GetChargeMoved(void);
+
 #endif
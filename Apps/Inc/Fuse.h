@@ -0,0 +1,44 @@
+/** Fuse.h
+ * Time-current protection of the battery pack. Every current reading fills a charge and a
+ * discharge counter at the rate the fuse curves in config.h give for it. The pack trips when
+ * a counter is full. Below the rating the counters cool down again.
+ */
+
+#ifndef FUSE_H__
+#define FUSE_H__
+
+#include "common.h"
+#include "config.h"
+
+typedef enum {
+	FUSE_DISCHARGE = 0,
+	FUSE_CHARGE,
+	NUM_FUSE_CURVES
+} FuseCurve;
+
+/** Fuse_Init
+ * Builds the lookup tables of both curves and starts them cold
+ */
+void Fuse_Init(void);
+
+/** Fuse_Update
+ * Adds one current reading. Takes the same time no matter the current.
+ * Call for every ADC reading, they are ADC_BLOCK_SIZE samples apart.
+ * @param current pack current in milliamperes, negative while charging
+ */
+void Fuse_Update(int32_t current);
+
+/** Fuse_CheckStatus
+ * Checks if either curve has run out. A trip stays until Fuse_Init.
+ * @return SAFE or DANGER
+ */
+SafetyStatus Fuse_CheckStatus(void);
+
+/** Fuse_GetMargin
+ * Gets how much of a curve is left
+ * @param curve FUSE_DISCHARGE or FUSE_CHARGE
+ * @return percent left before the trip, 100 when cold
+ */
+uint8_t Fuse_GetMargin(FuseCurve curve);
+
+#endif
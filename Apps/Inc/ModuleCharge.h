@@ -0,0 +1,57 @@
+/** ModuleCharge.h
+ * State of charge and capacity of every module. Modules drift apart in both, the weakest one
+ * limits the range and the spread tells how much balancing is needed. See MODULE_* in config.h.
+ */
+
+#ifndef MODULE_CHARGE_H__
+#define MODULE_CHARGE_H__
+
+#include "common.h"
+#include "config.h"
+
+/** ModuleCharge_Init
+ * Starts every module at the state of charge of the pack with the nominal capacity.
+ * Call after Current_Init and Charge_Init.
+ */
+void ModuleCharge_Init(void);
+
+/** ModuleCharge_Update
+ * Takes the charge that Charge_Calculate counted since the last call off every module, and
+ * corrects the modules and learns their capacities when the pack has rested. The work per call
+ * is the same for every call except the one at the end of a rest.
+ */
+void ModuleCharge_Update(void);
+
+/** ModuleCharge_GetPercent
+ * Gets the state of charge of a module
+ * @param module index of the module (0-indexed)
+ * @return fixed point percentage. Resolution = 0.01 (45.55% = 4555)
+ */
+uint32_t ModuleCharge_GetPercent(uint8_t module);
+
+/** ModuleCharge_GetCapacity
+ * Gets the capacity learned for a module
+ * @param module index of the module (0-indexed)
+ * @return mAh
+ */
+uint32_t ModuleCharge_GetCapacity(uint8_t module);
+
+/** ModuleCharge_GetLowest
+ * Gets the module with the lowest state of charge
+ * @return index of the module (0-indexed)
+ */
+uint8_t ModuleCharge_GetLowest(void);
+
+/** ModuleCharge_GetHighest
+ * Gets the module with the highest state of charge
+ * @return index of the module (0-indexed)
+ */
+uint8_t ModuleCharge_GetHighest(void);
+
+/** ModuleCharge_GetSpread
+ * Gets how far the highest module is ahead of the lowest
+ * @return fixed point percentage. Resolution = 0.01 (45.55% = 4555)
+ */
+uint32_t ModuleCharge_GetSpread(void);
+
+#endif
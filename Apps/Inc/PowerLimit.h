@@ -0,0 +1,39 @@
+/** PowerLimit.h
+ * State of power. The current the motor controller may draw and the charger may push right
+ * now, so they can back off before the pack gets near a limit the BPS trips on.
+ * See POWER_LIMIT_* in config.h.
+ */
+
+#ifndef POWER_LIMIT_H__
+#define POWER_LIMIT_H__
+
+#include "common.h"
+#include "config.h"
+
+/** PowerLimit_Init
+ * Starts both limits at 0, they come up at POWER_LIMIT_RISE_RATE once the pack is measured.
+ * Call after Current_Init.
+ */
+void PowerLimit_Init(void);
+
+/** PowerLimit_Update
+ * Works out both limits from the weakest module's voltage headroom, the hottest sensor and
+ * the state of charge. Only does the work every POWER_LIMIT_PERIOD_MS, one pass over the
+ * modules and sensors no matter what they read.
+ * @return true if the limits were updated and are due on CAN
+ */
+bool PowerLimit_Update(void);
+
+/** PowerLimit_GetDischarge
+ * Gets the most current that may be drawn from the pack
+ * @return milliamperes
+ */
+int32_t PowerLimit_GetDischarge(void);
+
+/** PowerLimit_GetCharge
+ * Gets the most current that may be pushed into the pack
+ * @return milliamperes, positive
+ */
+int32_t PowerLimit_GetCharge(void);
+
+#endif
@@ -0,0 +1,85 @@
+/** Profiler.h
+ * Cycle count probes around the slow stages of the BPS. Every probe keeps the min, max, mean
+ * and a histogram of how long its stage took. The counts come from the DWT cycle counter on
+ * the target and from CLOCK_MONOTONIC in nanoseconds on the simulator. A stage preempted by a
+ * higher priority thread counts the time that thread took too.
+ * Every probe also marks the begin and end of its stage in the event trace of Trace.h.
+ * See PROFILER_* in config.h, with PROFILER_ENABLED at 0 the probes cost nothing.
+ */
+
+#ifndef PROFILER_H__
+#define PROFILER_H__
+
+#include "common.h"
+#include "config.h"
+#include "BSP_Timer.h"
+#include "Trace.h"
+
+typedef enum {
+	PROBE_CURRENT,				// Current_UpdateMeasurements
+	PROBE_CHECKS,				// Current, temperature and voltage safety checks
+	PROBE_VOLTAGE,				// Voltage_UpdateMeasurements
+	PROBE_TEMPERATURE_CHANNEL,	// Temperature_UpdateSingleChannel
+	PROBE_TEMPERATURE_SCAN,		// Temperature_FinishScan and the thermal model
+	PROBE_TEMPERATURE_ALL,		// Temperature_UpdateAllMeasurements at startup
+	PROBE_CHARGE,				// Charge_Calculate and its EEPROM journal
+	PROBE_EEPROM_LOG,			// Fault logging to the EEPROM
+	PROBE_CLI,					// One CLI command
+	NUM_PROBES
+} ProfilerProbe;
+
+typedef struct {
+	uint32_t count;
+	uint32_t min;
+	uint32_t max;
+	uint64_t sum;
+	uint32_t buckets[PROFILER_BUCKETS];		// Bucket i holds runs under 2^(PROFILER_BUCKET_SHIFT + i) cycles, the last one the rest
+} ProfilerStats;
+
+#if PROFILER_ENABLED
+#define PROFILE_BEGIN(probe)	TRACE_BEGIN(TRACE_STAGE, probe); uint32_t probe##_Start = BSP_Timer_GetCycleCount()
+#define PROFILE_END(probe)		Profiler_Record(probe, BSP_Timer_GetCycleCount() - probe##_Start); TRACE_END(TRACE_STAGE, probe)
+#else
+#define PROFILE_BEGIN(probe)	TRACE_BEGIN(TRACE_STAGE, probe)
+#define PROFILE_END(probe)		TRACE_END(TRACE_STAGE, probe)
+#endif
+
+/** Profiler_Record
+ * Adds a run of a stage. Use PROFILE_BEGIN and PROFILE_END instead.
+ * @param probe of the stage
+ * @param cycles the run took
+ */
+void Profiler_Record(ProfilerProbe probe, uint32_t cycles);
+
+/** Profiler_Reset
+ * Forgets every run
+ */
+void Profiler_Reset(void);
+
+/** Profiler_GetStats
+ * @param probe of the stage
+ * @return runs so far, NULL if the probes are compiled out
+ */
+const ProfilerStats *Profiler_GetStats(ProfilerProbe probe);
+
+/** Profiler_GetName
+ * @param probe of the stage
+ * @return name for reports
+ */
+const char *Profiler_GetName(ProfilerProbe probe);
+
+/** Profiler_GetPercentile
+ * Finds the histogram bucket the given share of the runs fits under
+ * @param probe of the stage
+ * @param percent of the runs, 1 to 100
+ * @return upper end of that bucket in cycles, UINT32_MAX for the last bucket and 0 without runs
+ */
+uint32_t Profiler_GetPercentile(ProfilerProbe probe, uint8_t percent);
+
+/** Profiler_ToMicroseconds
+ * @param cycles counted by a probe
+ * @return microseconds
+ */
+uint32_t Profiler_ToMicroseconds(uint32_t cycles);
+
+#endif
@@ -0,0 +1,49 @@
+/** Ripple.h
+ * Spectral analysis of the pack current. Ripple from the motor controller tells about
+ * inverter faults and aging DC link capacitors. See RIPPLE_FFT_SIZE in config.h.
+ */
+
+#ifndef RIPPLE_H__
+#define RIPPLE_H__
+
+#include "common.h"
+#include "config.h"
+
+/** Ripple_Init
+ * Starts collecting the first block of samples. Call after Current_Init.
+ */
+void Ripple_Init(void);
+
+/** Ripple_Update
+ * Analyses a complete block of samples and starts the next one. Does nothing while the block
+ * is still filling up. A block where the high precision sensor saturated is thrown away.
+ * The analysis always takes the same work, see Ripple_GetCycles.
+ * @return true if there are new results
+ */
+bool Ripple_Update(void);
+
+/** Ripple_GetRMS
+ * Gets the RMS of the current around its average over the last block
+ * @return milliamperes
+ */
+uint32_t Ripple_GetRMS(void);
+
+/** Ripple_GetFrequency
+ * Gets the frequency with the most ripple in the last block, DC left out
+ * @return Hz, to within ADC_SAMPLE_RATE_HZ / RIPPLE_FFT_SIZE
+ */
+uint32_t Ripple_GetFrequency(void);
+
+/** Ripple_GetCycles
+ * Gets how long the last analysis took
+ * @return CPU cycles (nanoseconds on the simulator)
+ */
+uint32_t Ripple_GetCycles(void);
+
+/** Ripple_GetMaxCycles
+ * Gets the longest any analysis took since Ripple_Init
+ * @return CPU cycles (nanoseconds on the simulator)
+ */
+uint32_t Ripple_GetMaxCycles(void);
+
+#endif
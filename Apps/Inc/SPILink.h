@@ -0,0 +1,58 @@
+/** SPILink.h
+ * isoSPI link rate manager. Runs every daisy chain as fast as its cable allows by watching
+ * the PEC errors of the LTC6811 reads, and remembers the fastest stable rate in the EEPROM.
+ */
+
+#ifndef SPILINK_H__
+#define SPILINK_H__
+
+#include "common.h"
+#include "config.h"
+#include "LTC6811.h"
+#include "BSP_SPI.h"
+
+// Fastest rate the manager will try. SPI_SPEED_1250K is past the 1Mbps the LTC6820 is rated
+// for, only raise this for bench testing.
+#ifndef SPILINK_MAX_SPEED
+#define SPILINK_MAX_SPEED			SPI_SPEED_625K
+#endif
+
+#define SPILINK_WINDOW_SCANS		10		// Scans (calls to SPILink_Update) in one error counting window
+#define SPILINK_MAX_ERRORS			2		// PEC errors a window may have before the rate is lowered
+#define SPILINK_PROBE_WINDOWS		6		// Clean windows before the next faster rate is tried
+#define SPILINK_MAX_HOLD_WINDOWS	96		// Longest wait between tries of a rate that keeps failing
+
+/** SPILink_Init
+ * Sets every chain to the rate stored in the EEPROM, or SPI_SPEED_DEFAULT if nothing is stored.
+ * Call after the LTC6811s and the EEPROM are initialized.
+ * @param boards LTC6811 data structure that holds the PEC error counters
+ */
+void SPILink_Init(cell_asic *boards);
+
+/** SPILink_Update
+ * Counts the PEC errors of the last scan and lowers or raises the rate of each chain.
+ * Call once after every Voltage and Temperature update.
+ */
+void SPILink_Update(void);
+
+/** SPILink_Save
+ * Writes the stable rate of every chain to the EEPROM if it changed since the last write.
+ * Call from the thread that holds the EEPROM.
+ */
+void SPILink_Save(void);
+
+/** SPILink_GetSpeed
+ * Gets the rate a chain is running at
+ * @param chain daisy chain
+ * @return current rate
+ */
+SPI_Speed SPILink_GetSpeed(SPI_Chain chain);
+
+/** SPILink_GetStoredSpeed
+ * Gets the fastest rate that was stable long enough to be saved to the EEPROM by SPILink_Save
+ * @param chain daisy chain
+ * @return stored rate
+ */
+SPI_Speed SPILink_GetStoredSpeed(SPI_Chain chain);
+
+#endif
@@ -0,0 +1,63 @@
+/** Scheduler.h
+ * Time-triggered scheduler on CMSIS-RTOS threads. Every task is released on its own period off
+ * the 1ms system tick and runs in its own thread. A task earlier in the task table has a higher
+ * priority and preempts the ones after it. See SCHED_* in config.h.
+ */
+
+#ifndef SCHEDULER_H__
+#define SCHEDULER_H__
+
+#include "common.h"
+#include "config.h"
+
+typedef struct {
+	const char *name;
+	bool (*run)(void);		// Returns false when the BPS has to trip, which stops the scheduler
+	uint32_t period;		// Time between two releases (ms)
+	uint32_t offset;		// First release after Scheduler_Start, spreads tasks with the same period (ms)
+	uint32_t deadline;		// Has to be done this long after its release (ms)
+} SchedulerTask;
+
+typedef struct {
+	uint32_t runs;
+	uint32_t misses;		// Runs that finished after their deadline
+	uint32_t skipped;		// Releases dropped because the task was still a whole period late
+	uint32_t maxJitter;		// Longest wait from release to start (ms)
+	uint32_t jitterSum;		// Wait from release to start of every run added up (ms)
+	uint32_t maxRuntime;	// Longest run (ms)
+} SchedulerStats;
+
+/** Scheduler_Init
+ * Takes the task table. The table has to stay around while the scheduler runs.
+ * @param tasks in order of priority, highest first
+ * @param count number of tasks, at most SCHED_MAX_TASKS
+ */
+void Scheduler_Init(const SchedulerTask *tasks, uint8_t count);
+
+/** Scheduler_Start
+ * Starts a thread per task and releases every task for the first time after its offset.
+ * The kernel has to be running.
+ */
+void Scheduler_Start(void);
+
+/** Scheduler_Run
+ * Waits until a task asks for a trip and the runs under way are done. The task threads end
+ * at their next release.
+ */
+void Scheduler_Run(void);
+
+/** Scheduler_GetStats
+ * Gets the deadline and jitter statistics of a task
+ * @param task index in the task table
+ * @return statistics since Scheduler_Start
+ */
+const SchedulerStats *Scheduler_GetStats(uint8_t task);
+
+/** Scheduler_GetTask
+ * Gets a task of the table
+ * @param task index in the task table
+ * @return task, NULL past the end of the table
+ */
+const SchedulerTask *Scheduler_GetTask(uint8_t task);
+
+#endif
@@ -0,0 +1,37 @@
+/** Supervisor.h
+ * Liveness supervision of the scheduler tasks. Every task checks in with the sequence token its
+ * last check-in handed out, and has to do so within its own interval. The watchdog should only
+ * be fed while Supervisor_Check finds every task healthy. See SUPERVISOR_* in config.h.
+ */
+
+#ifndef SUPERVISOR_H__
+#define SUPERVISOR_H__
+
+#include "common.h"
+#include "config.h"
+
+#define SUPERVISOR_HEALTHY		0xFF	// Supervisor_Check found no offender
+
+/** Supervisor_Init
+ * Starts watching the tasks, every interval starts now. The table has to stay around.
+ * @param maxIntervals longest each task may go between check-ins (ms), 0 leaves a task out
+ * @param count number of tasks, at most SCHED_MAX_TASKS
+ */
+void Supervisor_Init(const uint32_t *maxIntervals, uint8_t count);
+
+/** Supervisor_CheckIn
+ * Tells the supervisor a task is alive and got its work done
+ * @param task index in the task table
+ * @param token the last check-in of the task returned, 0 the first time
+ * @return token for the next check-in
+ */
+uint32_t Supervisor_CheckIn(uint8_t task, uint32_t token);
+
+/** Supervisor_Check
+ * Looks for a task that went past its interval or checked in with the wrong token.
+ * A wrong token stays an offence until Supervisor_Init.
+ * @return index of the first offending task, SUPERVISOR_HEALTHY if there is none
+ */
+uint8_t Supervisor_Check(void);
+
+#endif
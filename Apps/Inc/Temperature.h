@@ -11,6 +11,7 @@
 #include "common.h"
 #include "config.h"
 #include "LTC6811.h"
+#include "Topology.h"
 
 #define MUX1 0x90
 #define MUX2 0x92
@@ -20,6 +21,12 @@
 #define AUX_I2C_BLANK 0
 #define AUX_I2C_NO_TRANSMIT 0x7
 
+// Plausibility checks a sensor can fail, see Temperature_GetSensorFaults
+#define TEMP_FAULT_RANGE		0x01	// Reading outside TEMP_SENSOR_MIN_MV to TEMP_SENSOR_MAX_MV, shorted or open
+#define TEMP_FAULT_STUCK		0x02	// Exact same reading for TEMP_STUCK_SCANS scans
+#define TEMP_FAULT_NEIGHBOUR	0x04	// Much colder than the sensors around it
+#define TEMP_FAULT_DIE			0x08	// Much colder than the die of its LTC6811
+
 /** Temperature_Init
  * Initializes device drivers including SPI inside LTC6811_init and LTC6811 for Temperature Monitoring
  * @param boards LTC6811 data structure that contains the values of each register
@@ -36,13 +43,13 @@ ErrorStatus Temperature_Init(cell_asic *boards);
  */
 ErrorStatus Temperature_ChannelConfig(uint8_t tempChannel);
 
-/** convertVoltageToTemperature
- * Converts mv to temperature based on the temperature sensor equation
- * Equation : T(in C) = (((13.582 - sqrt((-13.582)*(-13.582) + 4 * 0.00433 * (2230.8 - milliVolt)))/ (2.0 * -0.00433)) + 30)
- * @param mV from ADC
- * @return temperature in Celsius (Fixed Point with .001 resolution) 
+/** Temperature_CodeToMilliCelsius
+ * Converts a GPIO1 reading to temperature with the sensor lookup table in ThermistorLUT.h.
+ * Interpolates between the two closest entries, no floating point math.
+ * @param adcCode LTC6811 auxiliary reading (100uV per code)
+ * @return temperature in Celsius (Fixed Point with .001 resolution)
  */
-int milliVoltToCelsius(float milliVolt);
+int32_t Temperature_CodeToMilliCelsius(uint16_t adcCode);
 
 /** Temperature_UpdateSingleChannel
  * Stores and updates the new measurements received on one particular temperature sensor
@@ -57,8 +64,19 @@ ErrorStatus Temperature_UpdateSingleChannel(uint8_t channel);
  */
 ErrorStatus Temperature_UpdateAllMeasurements(void);
 
+/** Temperature_FinishScan
+ * Finishes a scan that was done one Temperature_UpdateSingleChannel at a time: measures the
+ * die temperatures and runs the plausibility checks and the dT/dt window on the new readings.
+ * Call once every channel has been updated, every TEMPERATURE_SCAN_PERIOD_MS.
+ * @return SUCCESS or ERROR if a die temperature came back with a bad PEC
+ */
+ErrorStatus Temperature_FinishScan(void);
+
 /** Temperature_CheckStatus
- * Checks if all modules are safe
+ * Checks if all modules are safe. A sensor that is heating up fast enough to reach the
+ * limit within TEMP_PREDICT_HORIZON_S counts as unsafe too. Implausible sensors are
+ * ignored. A module that has no plausible sensor left is checked with the thermal model
+ * until its estimate gets too old.
  * @param 1 if pack is charging, 0 if discharging
  * @return SAFE or DANGER
  */
@@ -76,6 +94,7 @@ void Temperature_SetChargeState(uint8_t isCharging);
 /** Temperature_GetModulesInDanger
  * Finds all modules that are in danger and stores them into a list
  * This function is called when you can't use the current module to see if it is charging.
+ * Modules without a plausible sensor are checked with the thermal model.
  * @return pointer to index of modules that are in danger
  */
 uint8_t *Temperature_GetModulesInDanger(void);
@@ -89,9 +108,57 @@ uint8_t *Temperature_GetModulesInDanger(void);
  */
 int32_t Temperature_GetSingleTempSensor(uint8_t board, uint8_t sensorIdx);
 
+/** Temperature_GetSensorTemperature
+ * Gets the temperature of a sensor by its number in the pack
+ * @precondition: sensorIdx must be < NUM_TEMPERATURE_SENSORS
+ * @param index of sensor in the pack (0-indexed based)
+ * @return temperature of the sensor at specified index
+ */
+int32_t Temperature_GetSensorTemperature(uint8_t sensorIdx);
+
+/** Temperature_GetSensorSlope
+ * Gets how fast a sensor is heating up, estimated over the last TEMP_SLOPE_WINDOW scans
+ * @precondition: sensorIdx must be < NUM_TEMPERATURE_SENSORS
+ * @param index of sensor in the pack (0-indexed based)
+ * @return dT/dt in mC/s, 0 until the window is full
+ */
+int32_t Temperature_GetSensorSlope(uint8_t sensorIdx);
+
+/** Temperature_GetSensorFaults
+ * Gets the plausibility checks a sensor failed on the last scan
+ * @precondition: sensorIdx must be < NUM_TEMPERATURE_SENSORS
+ * @param index of sensor in the pack (0-indexed based)
+ * @return TEMP_FAULT_* flags, 0 if the sensor is plausible
+ */
+uint8_t Temperature_GetSensorFaults(uint8_t sensorIdx);
+
+/** Temperature_IsModuleCovered
+ * Checks if a module has at least one plausible sensor left
+ * @precondition: moduleIdx must be < NUM_BATTERY_MODULES
+ * @param index of module (0-indexed based)
+ * @return true if the module is measured, false if it depends on the thermal model
+ */
+bool Temperature_IsModuleCovered(uint8_t moduleIdx);
+
+/** Temperature_GetNumImplausibleSensors
+ * Counts the sensors that failed a plausibility check on the last scan
+ * @return number of sensors left out of the averages
+ */
+uint8_t Temperature_GetNumImplausibleSensors(void);
+
+/** Temperature_GetDieTemperature
+ * Gets the internal die temperature an LTC6811 reported on the last scan
+ * @precondition: board must be < NUM_MINIONS
+ * @param index of board (0-indexed based)
+ * @return temperature in Celsius (Fixed Point with .001 resolution)
+ */
+int32_t Temperature_GetDieTemperature(uint8_t board);
+
 /** Temperature_GetModuleTemperature
  * Gets the avg temperature of a certain battery module in the battery pack. Since there
- * are 2 sensors per module, the return value is the average
+ * are 2 sensors per module, the return value is the average of its plausible sensors.
+ * If none of them are plausible it is the thermal model's estimate, or the average of
+ * all of them if the estimate is too old.
  * @precondition: moduleIdx must be < NUM_BATTERY_MODULE
  * @param index of module (0-indexed based)
  * @return temperature of the battery module at specified index
@@ -99,7 +166,7 @@ int32_t Temperature_GetSingleTempSensor(uint8_t board, uint8_t sensorIdx);
 int32_t Temperature_GetModuleTemperature(uint8_t moduleIdx);
 
 /** Temperature_GetTotalPackAvgTemperature
- * Gets the average temperature of the whole battery pack
+ * Gets the average temperature of the whole battery pack. Implausible sensors are left out.
  * @return average temperature of battery pack
  */
 int32_t Temperature_GetTotalPackAvgTemperature(void);
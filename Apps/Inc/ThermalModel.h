@@ -0,0 +1,50 @@
+/** ThermalModel.h
+ * Estimates the temperature of every battery module so a module whose temperature sensors
+ * have all failed is still covered for a while. See the TEMP_MODEL_* settings in config.h.
+ */
+
+#ifndef THERMALMODEL_H__
+#define THERMALMODEL_H__
+
+#include "common.h"
+#include "config.h"
+
+/** ThermalModel_Init
+ * Forgets every estimate. A module has no estimate until it has been measured once.
+ */
+void ThermalModel_Init(void);
+
+/** ThermalModel_Update
+ * Moves the model one scan forward. Modules with a plausible sensor are set to their measured
+ * temperature, the others heat up by I^2R and settle toward the measured modules next to them.
+ * Call once after every Temperature update.
+ * @param current pack current in milliamperes
+ */
+void ThermalModel_Update(int32_t current);
+
+/** ThermalModel_IsValid
+ * Checks if the estimate of a module may still stand in for its sensors
+ * @precondition: moduleIdx must be < NUM_BATTERY_MODULES
+ * @param index of module (0-indexed based)
+ * @return true if the module was measured within TEMP_MODEL_MAX_AGE_S
+ */
+bool ThermalModel_IsValid(uint8_t moduleIdx);
+
+/** ThermalModel_GetEstimate
+ * Gets the modelled temperature of a module
+ * @precondition: moduleIdx must be < NUM_BATTERY_MODULES
+ * @param index of module (0-indexed based)
+ * @return temperature in Celsius (Fixed Point with .001 resolution)
+ */
+int32_t ThermalModel_GetEstimate(uint8_t moduleIdx);
+
+/** ThermalModel_GetUpperBound
+ * Gets the estimate plus TEMP_MODEL_DRIFT for every minute the module has gone without
+ * a sensor. Limit checks use this so the trip comes closer the older the estimate gets.
+ * @precondition: moduleIdx must be < NUM_BATTERY_MODULES
+ * @param index of module (0-indexed based)
+ * @return temperature in Celsius (Fixed Point with .001 resolution)
+ */
+int32_t ThermalModel_GetUpperBound(uint8_t moduleIdx);
+
+#endif
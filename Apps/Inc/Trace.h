@@ -0,0 +1,93 @@
+/** Trace.h
+ * Event trace of what the BPS spends its time on: task runs, profiler stages and mutex waits
+ * as begin/end pairs, trips as instants. Records go into a RAM ring of TRACE_SIZE, once it is
+ * full the oldest ones are overwritten. Trace_Dump prints the ring as text over the UART and
+ * Tools/trace2json.py turns that into Chrome trace JSON for Perfetto (ui.perfetto.dev).
+ * Timestamps are the cycle counts of BSP_Timer_GetCycleCount.
+ * See TRACE_* in config.h, with TRACE_ENABLED at 0 the trace costs nothing.
+ */
+
+#ifndef TRACE_H__
+#define TRACE_H__
+
+#include "common.h"
+#include "config.h"
+
+typedef enum {
+	TRACE_TASK,				// A scheduler task run, the argument is its index
+	TRACE_STAGE,			// A profiler stage, the argument is its ProfilerProbe
+	TRACE_LOCK,				// Waiting for a mutex, the argument is its TraceLock
+	TRACE_FAULT,			// The BPS tripped
+	NUM_TRACE_EVENTS
+} TraceEvent;
+
+typedef enum {
+	TRACE_LTC_LOCK,
+	TRACE_EEPROM_LOCK,
+	TRACE_SCAN_LOCK,
+	NUM_TRACE_LOCKS
+} TraceLock;
+
+typedef enum {
+	TRACE_TYPE_BEGIN,
+	TRACE_TYPE_END,
+	TRACE_TYPE_INSTANT
+} TraceType;
+
+typedef struct {
+	uint32_t time;			// Cycle count
+	uint16_t thread;		// Low bits of the osThreadId
+	uint8_t event;			// TraceType in the top 2 bits, TraceEvent below
+	uint8_t arg;
+} TraceRecord;
+
+#define TRACE_TYPE_SHIFT	6
+
+#if TRACE_ENABLED
+#define TRACE_BEGIN(event, arg)		Trace_Record(TRACE_TYPE_BEGIN << TRACE_TYPE_SHIFT | (event), arg)
+#define TRACE_END(event, arg)		Trace_Record(TRACE_TYPE_END << TRACE_TYPE_SHIFT | (event), arg)
+#define TRACE_INSTANT(event, arg)	Trace_Record(TRACE_TYPE_INSTANT << TRACE_TYPE_SHIFT | (event), arg)
+#else
+#define TRACE_BEGIN(event, arg)
+#define TRACE_END(event, arg)
+#define TRACE_INSTANT(event, arg)
+#endif
+
+/** Trace_Record
+ * Adds a record to the ring. Use TRACE_BEGIN, TRACE_END and TRACE_INSTANT instead.
+ * Safe from any thread or interrupt.
+ * @param event TraceEvent with its TraceType shifted in by TRACE_TYPE_SHIFT
+ * @param arg what the event is about
+ */
+void Trace_Record(uint8_t event, uint8_t arg);
+
+/** Trace_Reset
+ * Empties the ring and the counts of lost records
+ */
+void Trace_Reset(void);
+
+/** Trace_Get
+ * Pauses the trace and gets a record. Records that come in while paused are dropped.
+ * @param index of the record, 0 is the oldest one still in the ring
+ * @return the record, NULL past the newest one or if the trace is compiled out
+ */
+const TraceRecord *Trace_Get(uint32_t index);
+
+/** Trace_Resume
+ * Records again after Trace_Get
+ */
+void Trace_Resume(void);
+
+/** Trace_GetLost
+ * @param dropped set to the records that came in while paused, may be NULL
+ * @return records overwritten by newer ones
+ */
+uint32_t Trace_GetLost(uint32_t *dropped);
+
+/** Trace_Dump
+ * Prints the ring, oldest record first, with the names of the tasks, stages and mutexes the
+ * records refer to, then empties it. Tools/trace2json.py reads this format.
+ */
+void Trace_Dump(void);
+
+#endif
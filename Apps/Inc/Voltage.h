@@ -71,4 +71,16 @@ uint16_t Voltage_GetModuleMillivoltage(uint8_t moduleIdx);
  */
 uint32_t Voltage_GetTotalPackVoltage(void);
 
+/** Voltage_SetBalancing
+ * Turns the discharge switch of the LTC6811 on for the given modules and off for all others
+ * @param modules one bit per module, bit 0 is module 0
+ */
+void Voltage_SetBalancing(uint32_t modules);
+
+/** Voltage_GetBalancing
+ * Gets the modules that have their discharge switch on
+ * @return one bit per module, bit 0 is module 0
+ */
+uint32_t Voltage_GetBalancing(void);
+
 #endif
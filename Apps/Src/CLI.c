@@ -6,18 +6,29 @@
 #include "CLI.h"
 #include "Voltage.h"
 #include "Current.h"
+#include "Fuse.h"
+#include "Ripple.h"
+#include "PowerLimit.h"
+#include "ChargeControl.h"
 #include "Temperature.h"
 #include "BSP_Contactor.h"
 #include "BSP_WDTimer.h"
 #include "BSP_Lights.h"
 #include "config.h"
 #include "Charge.h"
+#include "ModuleCharge.h"
 #include "CANbus.h"
 #include "BSP_CAN.h"
 #include "BSP_UART.h"
+#include "BSP_Timer.h"
 #include "Images.h"
 #include "BSP_ADC.h"
 #include "EEPROM.h"
+#include "Scheduler.h"
+#include "Profiler.h"
+#include "Trace.h"
+#include "Counters.h"
+#include "cmsis_os.h"
 
 #define MAX_TOKEN_SIZE 4
 
@@ -26,6 +37,11 @@ char hexString[8];
 const float MILLI_UNIT_CONVERSION = 1000;
 const float PERCENT_CONVERSION = 100;
 
+// Same order as ChargeState
+static const char *ChargeStateNames[NUM_CHARGE_STATES] = {
+	"idle", "precharge", "constant current", "constant voltage", "balancing", "done", "fault"
+};
+
 /** CLI_Init
  * Initializes the CLI with the values it needs
  * @param boards is a cell_asic struct pointer to the minion boards
@@ -109,7 +125,9 @@ void CLI_Help(void) {
 	printf("Contactor/Switch\tCharge\t\t\tLights/LED\n\r");
 	printf("CAN\t\t\tEEPROM\t\t\tDisplay\n\r");
 	printf("LTC/Register\t\tWatchdog\t\tADC\n\r");
-	printf("Critical/Abort\t\tAll\n\r");
+	printf("Critical/Abort\t\tAll\t\t\tTasks\n\r");
+	printf("Perf\t\t\tIdle\t\t\tTrace\n\r");
+	printf("Counters\n\r");
 	printf("Keep in mind: all values are 1-indexed\n\r");
 	printf("-----------------------------------------------------------\n\r");
 }
@@ -177,6 +195,14 @@ void CLI_Current(int* hashTokens) {
 	if(hashTokens[1] == 0) {
 		printf("High: %.3fA\n\r", Current_GetHighPrecReading()/MILLI_UNIT_CONVERSION);	// Prints 4 digits, number, and A
 		printf("Low: %.3fA\n\r", Current_GetLowPrecReading()/MILLI_UNIT_CONVERSION);
+		printf("Fuse margin: %d%% discharge, %d%% charge\n\r", Fuse_GetMargin(FUSE_DISCHARGE), Fuse_GetMargin(FUSE_CHARGE));
+		printf("Limits: %.1fA discharge, %.1fA charge\n\r", PowerLimit_GetDischarge()/MILLI_UNIT_CONVERSION, PowerLimit_GetCharge()/MILLI_UNIT_CONVERSION);
+		printf("Ripple: %.3fA rms, strongest at %dHz\n\r", Ripple_GetRMS()/MILLI_UNIT_CONVERSION, Ripple_GetFrequency());
+#ifdef SIMULATION
+		printf("Ripple analysis: %dns, worst %dns\n\r", Ripple_GetCycles(), Ripple_GetMaxCycles());
+#else
+		printf("Ripple analysis: %d cycles, worst %d cycles\n\r", Ripple_GetCycles(), Ripple_GetMaxCycles());
+#endif
 		return;
 	}
 	switch (hashTokens[1]) {
@@ -210,6 +236,26 @@ void CLI_Current(int* hashTokens) {
 		}
 }
 
+/** CLI_PrintSensorFaults
+ * Ends a temperature sensor line with the plausibility checks it failed
+ * @param faults TEMP_FAULT_* flags of the sensor
+ */
+static void CLI_PrintSensorFaults(uint8_t faults) {
+	if(faults & TEMP_FAULT_RANGE) {
+		printf(" [out of range]");
+	}
+	if(faults & TEMP_FAULT_STUCK) {
+		printf(" [stuck]");
+	}
+	if(faults & TEMP_FAULT_NEIGHBOUR) {
+		printf(" [colder than neighbours]");
+	}
+	if(faults & TEMP_FAULT_DIE) {
+		printf(" [colder than LTC6811]");
+	}
+	printf("\n\r");
+}
+
 /** CLI_Temperature
  * Checks and displays the desired
  * temperature parameter(s)
@@ -218,40 +264,32 @@ void CLI_Current(int* hashTokens) {
 void CLI_Temperature(int* hashTokens) {
 	if(hashTokens[1] == 0) {
 		for(int i = 0; i < NUM_BATTERY_MODULES; i++) {
-			printf("Module number %d: %.3f C\n\r", i+1, Temperature_GetModuleTemperature(i)/MILLI_UNIT_CONVERSION);
+			printf("Module number %d: %.3f C%s\n\r", i+1, Temperature_GetModuleTemperature(i)/MILLI_UNIT_CONVERSION,
+					Temperature_IsModuleCovered(i) ? "" : " (estimated)");
 		}
 		return;
 	}
 	switch(hashTokens[1]) {			
 		// All temperature sensors
 		case CLI_ALL_HASH:
-			for(int i = 0; i < NUM_MINIONS; i++) {		// last minion only has 14 sensors
-				for(int j = 0; j < MAX_TEMP_SENSORS_PER_MINION_BOARD; j++) {
-					if(i == NUM_MINIONS-1 && j > NUM_TEMP_SENSORS_LAST_MINION-1) {	// -1 for 0-index
-						break;
-					}
-					printf("Sensor number %d: %.3f C\n\r",(i*MAX_TEMP_SENSORS_PER_MINION_BOARD)+j+1, Temperature_GetSingleTempSensor(i, j)/MILLI_UNIT_CONVERSION);
-				}
+			for(int i = 0; i < NUM_TEMPERATURE_SENSORS; i++) {
+				printf("Sensor number %d: %.3f C", i+1, Temperature_GetSensorTemperature(i)/MILLI_UNIT_CONVERSION);
+				CLI_PrintSensorFaults(Temperature_GetSensorFaults(i));
 			}
 			break;
 		// Temperature of specific module
 		case CLI_MODULE_HASH:
-			if (hashTokens[2] == 0 || hashTokens[2]-1 > NUM_BATTERY_MODULES || hashTokens[2]-1 < 0){
+			if (hashTokens[2] == 0 || hashTokens[2]-1 >= NUM_BATTERY_MODULES || hashTokens[2]-1 < 0){
 				printf("Invalid module number\n\r");
 			}
 			else {
 				if(hashTokens[3] == 0) {//temperature of module
 					printf("Module number %d: %.3f C\n\r", hashTokens[2], Temperature_GetModuleTemperature(hashTokens[2]-1)/MILLI_UNIT_CONVERSION);
-				} else if(hashTokens[3]-1 == 0 || hashTokens[3]-1 == 1) {//temperature of specific sensor in module
-					uint16_t boardNum = (hashTokens[2]-1)/MAX_VOLT_SENSORS_PER_MINION_BOARD;
-					uint16_t sensorNum;
-					if (hashTokens[3]-1) {
-						sensorNum = ((hashTokens[2]-1)%MAX_VOLT_SENSORS_PER_MINION_BOARD)+MAX_VOLT_SENSORS_PER_MINION_BOARD;
-					} else {
-						sensorNum = (hashTokens[2]-1)%MAX_VOLT_SENSORS_PER_MINION_BOARD;
-					}
-					printf("Sensor %d on module %d: %.3f C\n\r", hashTokens[3], hashTokens[2], 
-							Temperature_GetSingleTempSensor(boardNum, sensorNum)/MILLI_UNIT_CONVERSION);
+				} else if(hashTokens[3]-1 >= 0 && hashTokens[3]-1 < NUM_TEMP_SENSORS_PER_MOD) {//temperature of specific sensor in module
+					uint8_t sensorNum = ModuleSensors[hashTokens[2]-1][hashTokens[3]-1];
+					printf("Sensor %d on module %d: %.3f C", hashTokens[3], hashTokens[2], 
+							Temperature_GetSensorTemperature(sensorNum)/MILLI_UNIT_CONVERSION);
+					CLI_PrintSensorFaults(Temperature_GetSensorFaults(sensorNum));
 				} else {
 					printf("Invalid sensor number\n\r");
 				}
@@ -260,6 +298,9 @@ void CLI_Temperature(int* hashTokens) {
 		// Average temperature of the whole pack
 		case CLI_TOTAL_HASH:
 			printf("Total average temperature: %.3f C\n\r", Temperature_GetTotalPackAvgTemperature()/MILLI_UNIT_CONVERSION);
+			if(Temperature_GetNumImplausibleSensors() > 0) {
+				printf("%d implausible sensor(s) left out\n\r", Temperature_GetNumImplausibleSensors());
+			}
 			break;
 		default:
 			printf("Invalid temperature command\n\r");
@@ -350,6 +391,17 @@ void CLI_Contactor(int* hashTokens) {
 void CLI_Charge(int* hashTokens) {
 	if(hashTokens[1] == 0) {
 		printf("The battery percentage is %.2f%%\n\r", Charge_GetPercent()/PERCENT_CONVERSION);
+		printf("Lowest module: %d at %.2f%%, highest module: %d at %.2f%%, spread %.2f%%\n\r",
+			ModuleCharge_GetLowest(), ModuleCharge_GetPercent(ModuleCharge_GetLowest())/PERCENT_CONVERSION,
+			ModuleCharge_GetHighest(), ModuleCharge_GetPercent(ModuleCharge_GetHighest())/PERCENT_CONVERSION,
+			ModuleCharge_GetSpread()/PERCENT_CONVERSION);
+		printf("Charger: %s, %.1fV %.1fA\n\r", ChargeStateNames[ChargeControl_GetState()],
+			ChargeControl_GetVoltage()/MILLI_UNIT_CONVERSION, ChargeControl_GetCurrent()/MILLI_UNIT_CONVERSION);
+#ifdef SIMULATION
+		printf("Estimator update: %dns, worst %dns\n\r", Charge_GetCycles(), Charge_GetMaxCycles());
+#else
+		printf("Estimator update: %d cycles, worst %d cycles\n\r", Charge_GetCycles(), Charge_GetMaxCycles());
+#endif
 		return;
 	}
 	switch(hashTokens[1]) {
@@ -629,14 +681,141 @@ void CLI_ADC(void) {
 	printf("Low precision ADC: %d mV\n\r", BSP_ADC_Low_GetMilliVoltage());
 }
 
+/** CLI_Tasks
+ * Prints the deadline misses, jitter and run time of every scheduled task and the worst case
+ * fault response they add up to
+ */
+void CLI_Tasks(void) {
+	printf("Task\t\tPeriod\tRuns\tMissed\tSkipped\tJitter (avg/max)\tRun time (max)\n\r");
+	const SchedulerTask *task;
+	for(uint8_t i = 0; (task = Scheduler_GetTask(i)) != NULL; i++) {
+		const SchedulerStats *stats = Scheduler_GetStats(i);
+		float average = stats->runs ? (float)stats->jitterSum / stats->runs : 0;
+		printf("%-12s\t%lums\t%lu\t%lu\t%lu\t%.1f/%lums\t\t%lums\n\r", task->name,
+			(unsigned long)task->period, (unsigned long)stats->runs, (unsigned long)stats->misses,
+			(unsigned long)stats->skipped, average, (unsigned long)stats->maxJitter,
+			(unsigned long)stats->maxRuntime);
+	}
+
+	// A fault right after a safety check waits a whole period for the next one, which can be
+	// late and take long too. The first task is the safety task.
+	task = Scheduler_GetTask(0);
+	if(task != NULL) {
+		const SchedulerStats *stats = Scheduler_GetStats(0);
+		printf("Worst case fault response: %lums\n\r",
+			(unsigned long)(task->period + stats->maxJitter + stats->maxRuntime));
+	}
+}
+
+/** CLI_Perf
+ * Prints how long the stages under a profiler probe took, or resets the probes
+ * @param hashTokens is the array of hashed tokenized inputs
+ */
+void CLI_Perf(int* hashTokens) {
+	if(Profiler_GetStats(0) == NULL) {
+		printf("The profiler is compiled out (PROFILER_ENABLED)\n\r");
+		return;
+	}
+	if(hashTokens[1] == CLI_RESET_HASH) {
+		Profiler_Reset();
+		printf("Profiler reset\n\r");
+		return;
+	}
+
+	printf("Stage\t\tRuns\tMin\tMean\tMax\tp99 under (us)\n\r");
+	for(ProfilerProbe probe = 0; probe < NUM_PROBES; probe++) {
+		const ProfilerStats *stats = Profiler_GetStats(probe);
+		if(stats->count == 0) {
+			printf("%-12s\t0\n\r", Profiler_GetName(probe));
+			continue;
+		}
+		uint32_t p99 = Profiler_GetPercentile(probe, 99);
+		printf("%-12s\t%lu\t%lu\t%lu\t%lu\t", Profiler_GetName(probe), (unsigned long)stats->count,
+			(unsigned long)Profiler_ToMicroseconds(stats->min),
+			(unsigned long)Profiler_ToMicroseconds(stats->sum / stats->count),
+			(unsigned long)Profiler_ToMicroseconds(stats->max));
+		if(p99 == UINT32_MAX) {
+			printf(">%lu\n\r", (unsigned long)Profiler_ToMicroseconds(1UL << (PROFILER_BUCKET_SHIFT + PROFILER_BUCKETS - 2)));
+		} else {
+			printf("%lu\n\r", (unsigned long)Profiler_ToMicroseconds(p99));
+		}
+	}
+}
+
+/** CLI_Idle
+ * Prints the share of time the CPU slept since boot and since the last time it was asked
+ */
+void CLI_Idle(void) {
+	static uint64_t lastIdle;
+	static uint64_t lastTotal;
+	uint64_t total;
+	uint64_t idle = osKernelIdleTime(&total);
+	if(total == 0) {
+		printf("The kernel has not started\n\r");
+		return;
+	}
+
+	printf("Idle since boot: %.1f%% of %.1fs\n\r", 100.0f * idle / total,
+		total / 1000000.0f);
+	if(total > lastTotal) {
+		printf("Idle since last asked: %.1f%% of %lums\n\r",
+			100.0f * (idle - lastIdle) / (total - lastTotal),
+			(unsigned long)((total - lastTotal) / 1000));
+	}
+	lastIdle = idle;
+	lastTotal = total;
+}
+
+/** CLI_Trace
+ * Dumps the event trace for Tools/trace2json.py and empties it, or just empties it
+ * @param hashTokens is the array of hashed tokenized inputs
+ */
+void CLI_Trace(int* hashTokens) {
+	if(!TRACE_ENABLED) {
+		printf("The trace is compiled out (TRACE_ENABLED)\n\r");
+		return;
+	}
+	if(hashTokens[1] == CLI_RESET_HASH) {
+		Trace_Reset();
+		printf("Trace reset\n\r");
+		return;
+	}
+	Trace_Dump();
+}
+
+/** CLI_PrintCounter
+ * Prints a counter or gauge handed over by Counters_Export
+ */
+static void CLI_PrintCounter(CounterId id, const char *name, bool gauge, uint32_t value, void *context) {
+	printf("%-16s%-8s%lu\n\r", name, gauge ? "gauge" : "count", (unsigned long)value);
+}
+
+/** CLI_Counters
+ * Lists the error counters and gauges, or resets them
+ * @param hashTokens is the array of hashed tokenized inputs
+ */
+void CLI_Counters(int* hashTokens) {
+	if(hashTokens[1] == CLI_RESET_HASH) {
+		Counters_Reset();
+		printf("Counters reset\n\r");
+		return;
+	}
+	Counters_Export(0, NUM_COUNTERS, CLI_PrintCounter, NULL);
+}
 
 /** CLI_Critical
- * Shuts off contactor manually
+ * Shuts off contactor manually. Stops waiting for an answer after CLI_CRITICAL_TIMEOUT_MS so
+ * the CLI task keeps checking in with the supervisor.
  */  
 void CLI_Critical(void) {
 	static char response[128];
+	if(!BSP_Contactor_GetState()) {
+		printf("Contactor is already off\n\r");
+		return;
+	}
 	printf("Please type 'shutdown' to turn the contactor off\n\r");
 	printf(">> ");
+	uint32_t start = BSP_Timer_GetTick();
 	while(1) {
 		if(BSP_UART_ReadLine(response) > 0) {
 			if(CLI_StringHash(response) == CLI_SHUTDOWN_HASH) {
@@ -648,6 +827,14 @@ void CLI_Critical(void) {
 				break;
 			}
 		}
+		// Lower priority threads run while we wait for the answer
+		if(osKernelRunning()) {
+			osDelay(SCHED_CLI_PERIOD_MS);
+			if(BSP_Timer_GetTick() - start > CLI_CRITICAL_TIMEOUT_MS) {
+				printf("\n\rNo answer, contactor is still on\n\r");
+				break;
+			}
+		}
 	}
 }
 
@@ -772,6 +959,26 @@ void CLI_Handler(char* input) {
 		case CLI_ALL_HASH:
 			CLI_All();
 			break;
+		// Scheduler statistics
+		case CLI_TASKS_HASH:
+			CLI_Tasks();
+			break;
+		// Profiler probes
+		case CLI_PERF_HASH:
+			CLI_Perf(hashTokens);
+			break;
+		// CPU load
+		case CLI_IDLE_HASH:
+			CLI_Idle();
+			break;
+		// Event trace
+		case CLI_TRACE_HASH:
+			CLI_Trace(hashTokens);
+			break;
+		// Error counters and gauges
+		case CLI_COUNTERS_HASH:
+			CLI_Counters(hashTokens);
+			break;
 		default:
 			printf("Invalid command. Type 'help' or 'menu' for the help menu\n\r");
 			break;
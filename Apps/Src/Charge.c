@@ -2,47 +2,80 @@
  * Program for UTSVT BeVolt's Battery Protection System State of Charge
  */
 #include "Charge.h"
+#include "ChargeEKF.h"
+#include "ChargeJournal.h"
+#include "Current.h"
+#include "Voltage.h"
 #include "BSP_Timer.h"
+#include <stdatomic.h>
 
 #define CHARGE_RESOLUTION_SCALE 100     // What we need to multiply 100% by before storing
-#define MAX_CHARGE_AMP_HRS 1000*1000    // In amp-hours (Ah), for now it is a dummy value
+#define FULL_CHARGE             ((int64_t)PACK_CAPACITY_MAH * 3600 * 1000)  // In microamp seconds
+#define PERCENT_SCALE           (CHARGE_RESOLUTION_SCALE * 100)
 
-static uint32_t charge;  // % of charge left with 0.01% resolution
+static ChargeEKF pack;          // State of charge of the whole pack
+static int64_t lastMoved;       // Current_GetChargeMoved at the last calculation
+static uint32_t lastTime;       // Current_GetSampleTime at the last calculation
+static uint32_t cycles;
+static uint32_t maxCycles;
+
+// Charge_Calculate is the only caller of Current_GetChargeMoved, it publishes what it got for
+// the other tasks. The newest value goes into the copy readers are not on, then Published
+// moves over to it, so nobody reads half of a 64 bit write.
+static int64_t movedCopies[2];
+static atomic_uint published;
 
 /** Charge_Init
- * Initializes necessary timer and values to begin state of charge
- * calculation algorithm.
- * Info found on reference sheet stm32f413 page 535
+ * Initializes the values to begin state of charge calculation algorithm.
+ * The coulomb counting itself happens with every current sample, see Current_GetChargeMoved.
+ * Call after EEPROM_Init.
  */
 void Charge_Init(void){ 
-	BSP_Timer_Init();
-	
+	int64_t charge;
+
 	// Grab from EEPROM what is the current Charge
-	EEPROM_ReadMultipleBytes(EEPROM_SOC_PTR_LOC, 4, (uint8_t*)&charge);
+	if(ChargeJournal_Init(&charge)){
+		ChargeEKF_Init(&pack, FULL_CHARGE, charge * PERCENT_SCALE / FULL_CHARGE, CHARGE_EKF_INITIAL_ERROR);
+	} else {
+		// Nothing stored, leave it to the voltage
+		ChargeEKF_Init(&pack, FULL_CHARGE, PERCENT_SCALE / 2, 50);
+	}
+	maxCycles = 0;
 
-    BSP_Timer_Start();
+	movedCopies[0] = lastMoved;
+	movedCopies[1] = lastMoved;
 }
 
 /** Charge_Calculate
- * Calculates new Charge depending on the current reading
- * @param current reading from hall effect sensors. Fixed point of 0.001 (1.500 Amps = 1500)
- * not a constant samping. Add on however much from the previous
+ * Takes the charge that flowed since the last call off the charge left in the pack, then
+ * corrects it with the average module voltage.
+ * No matter how often this is called, every current sample is counted exactly once.
  */
-void Charge_Calculate(int32_t milliamps){ 
-	
-	uint32_t counter = BSP_Timer_GetTicksElapsed();
-	
-	float timeElapsed = (0xFFFF - counter) / 60;
-	timeElapsed /= BSP_Timer_GetRunFreq();  // Time in seconds
-    timeElapsed /= 60;  			        // time in minutes
-    timeElapsed /= 60;                      // time in hours
-	
-	float fAmps = ((float) milliamps) * 0.001;
-	
-	float accumulatedAmpHrs = timeElapsed * fAmps;
-	
-	/* Update Charge, units of 0.01% */
-	charge += (uint32_t) (CHARGE_RESOLUTION_SCALE * (100 * (accumulatedAmpHrs / MAX_CHARGE_AMP_HRS)));
+void Charge_Calculate(void){ 
+	uint32_t start = BSP_Timer_GetCycleCount();
+	int64_t moved = Current_GetChargeMoved();
+	uint32_t time = Current_GetSampleTime();
+
+	uint32_t next = atomic_load(&published) + 1;
+	movedCopies[next & 1] = moved;
+	atomic_store(&published, next);
+
+	ChargeEKF_Predict(&pack, moved - lastMoved, time - lastTime);
+	lastMoved = moved;
+	lastTime = time;
+
+	uint32_t milliVolts = 0;
+	for(int i = 0; i < NUM_BATTERY_MODULES; i++){
+		milliVolts += Voltage_GetModuleMillivoltage(i);
+	}
+	ChargeEKF_Correct(&pack, milliVolts / NUM_BATTERY_MODULES, Current_GetLowPrecReading());
+
+	ChargeJournal_Update(pack.charge, time);
+
+	cycles = BSP_Timer_GetCycleCount() - start;
+	if(cycles > maxCycles){
+		maxCycles = cycles;
+	}
 }
 
 /** Charge_Calibrate
@@ -53,9 +86,9 @@ void Charge_Calculate(int32_t milliamps){
  */
 void Charge_Calibrate(int8_t faultType){
 	if (faultType == UNDERVOLTAGE) {
-        charge = 0;
+        ChargeEKF_Init(&pack, FULL_CHARGE, 0, 1);
     } else {
-        charge = CHARGE_RESOLUTION_SCALE * 100;
+        ChargeEKF_Init(&pack, FULL_CHARGE, PERCENT_SCALE, 1);
     }
 }
 
@@ -64,7 +97,7 @@ void Charge_Calibrate(int8_t faultType){
  * @return fixed point percentage. Resolution = 0.01 (45.55% = 4555)
  */
 uint32_t Charge_GetPercent(void){
-	return charge;
+	return ChargeEKF_GetPercent(&pack);
 }
 
 /** Charge_SetAccum 
@@ -73,6 +106,38 @@ uint32_t Charge_GetPercent(void){
  *                    with a resolution = 0.01%
  */
 void Charge_SetAccum(int32_t accum){
-	charge = accum;
+	ChargeEKF_Init(&pack, FULL_CHARGE, accum, CHARGE_EKF_INITIAL_ERROR);
+}
+
+/** Charge_GetChargeMoved
+ * Gets Current_GetChargeMoved as of the last Charge_Calculate. Safe to call from any task.
+ * @return microamp seconds out of the pack since Current_Init, negative if more flowed in than out
+ */
+int64_t Charge_GetChargeMoved(void){
+	uint32_t seen;
+	int64_t moved;
+
+	// Try again only if Charge_Calculate published twice while the copy was read
+	do {
+		seen = atomic_load(&published);
+		moved = movedCopies[seen & 1];
+	} while(atomic_load(&published) != seen);
+	return moved;
+}
+
+/** Charge_GetCycles
+ * Gets how long the last Charge_Calculate took
+ * @return CPU cycles (nanoseconds on the simulator)
+ */
+uint32_t Charge_GetCycles(void){
+	return cycles;
+}
+
+/** Charge_GetMaxCycles
+ * Gets the longest any Charge_Calculate took since Charge_Init
+ * @return CPU cycles (nanoseconds on the simulator)
+ */
+uint32_t Charge_GetMaxCycles(void){
+	return maxCycles;
 }
 
@@ -0,0 +1,196 @@
+/** ChargeControl.c
+ * Charge profile state machine:
+ *     PRECHARGE -> CC -> CV -> BALANCE -> DONE
+ * PRECHARGE and CC ask the charger for a fixed current. CV integrates the distance of the
+ * highest module to CHARGE_CONTROL_CV_VOLTAGE into the current setpoint, so the module the
+ * BPS would trip on is the one that ends the charge. Once the current has tapered off, the
+ * modules more than CHARGE_CONTROL_BALANCE_VOLTAGE over the lowest one bleed through the
+ * LTC6811 discharge switches while a small top-off current brings the others up.
+ * In every state the setpoint is held to the charge limit of PowerLimit.c, which follows the
+ * temperature and voltage headroom. The charger always gets the pack voltage the CV setpoint
+ * would give on every module as its own ceiling.
+ */
+
+#include "ChargeControl.h"
+#include "PowerLimit.h"
+#include "Voltage.h"
+#include "Current.h"
+
+#define PACK_VOLTAGE		((uint32_t)CHARGE_CONTROL_CV_VOLTAGE * NUM_BATTERY_MODULES)
+
+static ChargeState Stage;
+static int32_t Setpoint;			// mA sent to the charger
+static int32_t CvCurrent;			// Integrated CV current (mA)
+static uint32_t LastUpdate;			// ms
+static uint32_t BalanceStart;		// ms
+static uint32_t OverSince;			// ms, the charger has pushed more than asked for since then
+static bool Over;
+
+/** ChargeControl_Off
+ * Moves to a state where the charger is off
+ * @param state CHARGE_IDLE, CHARGE_DONE or CHARGE_FAULT
+ */
+static void ChargeControl_Off(ChargeState state) {
+	Stage = state;
+	Setpoint = 0;
+	Voltage_SetBalancing(0);
+}
+
+/** ChargeControl_Init
+ * Starts out idle with the charger off. Call after Voltage_Init and PowerLimit_Init.
+ */
+void ChargeControl_Init(void) {
+	Stage = CHARGE_IDLE;
+	Setpoint = 0;
+	CvCurrent = 0;
+	Over = false;
+	LastUpdate = Current_GetSampleTime();
+}
+
+/** ChargeControl_Start
+ * Starts a charge, the charger has to be plugged in
+ */
+void ChargeControl_Start(void) {
+	Stage = CHARGE_PRECHARGE;
+	Over = false;
+}
+
+/** ChargeControl_Stop
+ * Stops the charge and turns the charger and balancing off
+ */
+void ChargeControl_Stop(void) {
+	ChargeControl_Off(CHARGE_IDLE);
+}
+
+/** ChargeControl_Update
+ * Runs the state machine once every CHARGE_CONTROL_PERIOD_MS. A new charge limit or a
+ * charger that pushes too much current shows in the setpoint of the same period.
+ * Call right after PowerLimit_Update.
+ * @return true if a new setpoint is due on CAN
+ */
+bool ChargeControl_Update(void) {
+	uint32_t time = Current_GetSampleTime();
+	uint32_t elapsed = time - LastUpdate;
+	if (elapsed < CHARGE_CONTROL_PERIOD_MS) {
+		return false;
+	}
+	LastUpdate = time;
+
+	if (Stage == CHARGE_IDLE || Stage == CHARGE_DONE || Stage == CHARGE_FAULT) {
+		return true;
+	}
+
+	// A charger that keeps pushing more than it was asked for gets turned off
+	int32_t measured = -Current_GetLowPrecReading();
+	if (measured > Setpoint + CHARGE_CONTROL_OVERCURRENT) {
+		if (!Over) {
+			Over = true;
+			OverSince = time;
+		}
+		if (time - OverSince >= CHARGE_CONTROL_FOLLOW_MS) {
+			ChargeControl_Off(CHARGE_FAULT);
+			return true;
+		}
+	} else {
+		Over = false;
+	}
+
+	uint16_t lowest = UINT16_MAX;
+	uint16_t highest = 0;
+	for (int i = 0; i < NUM_BATTERY_MODULES; i++) {
+		uint16_t milliVolts = Voltage_GetModuleMillivoltage(i);
+		lowest = milliVolts < lowest ? milliVolts : lowest;
+		highest = milliVolts > highest ? milliVolts : highest;
+	}
+	int32_t limit = PowerLimit_GetCharge();
+	int32_t target = 0;
+
+	switch (Stage) {
+		case CHARGE_PRECHARGE:
+			if (lowest >= CHARGE_CONTROL_PRECHARGE_VOLTAGE) {
+				Stage = CHARGE_CC;
+				target = CHARGE_CONTROL_CC_CURRENT;
+			} else {
+				target = CHARGE_CONTROL_PRECHARGE_CURRENT;
+			}
+			break;
+
+		case CHARGE_CC:
+			target = CHARGE_CONTROL_CC_CURRENT;
+			if (highest >= CHARGE_CONTROL_CV_VOLTAGE) {
+				Stage = CHARGE_CV;
+				CvCurrent = Setpoint;
+			}
+			break;
+
+		case CHARGE_CV:
+		case CHARGE_BALANCE:
+			CvCurrent += (int64_t)CHARGE_CONTROL_CV_GAIN * ((int32_t)CHARGE_CONTROL_CV_VOLTAGE - highest) * (int32_t)elapsed / 1000;
+			if (CvCurrent > CHARGE_CONTROL_CC_CURRENT) {
+				CvCurrent = CHARGE_CONTROL_CC_CURRENT;
+			}
+			if (CvCurrent > limit) {
+				CvCurrent = limit;
+			}
+			if (CvCurrent < 0) {
+				CvCurrent = 0;
+			}
+			target = CvCurrent;
+
+			if (Stage == CHARGE_CV && CvCurrent <= CHARGE_CONTROL_TAPER_CURRENT && measured <= CHARGE_CONTROL_TAPER_CURRENT) {
+				Stage = CHARGE_BALANCE;
+				BalanceStart = time;
+			}
+			if (Stage == CHARGE_BALANCE) {
+				if (highest - lowest <= CHARGE_CONTROL_BALANCE_VOLTAGE
+					|| time - BalanceStart >= CHARGE_CONTROL_BALANCE_TIME_S * 1000) {
+					ChargeControl_Off(CHARGE_DONE);
+					return true;
+				}
+				uint32_t bleed = 0;
+				for (int i = 0; i < NUM_BATTERY_MODULES; i++) {
+					if (Voltage_GetModuleMillivoltage(i) > lowest + CHARGE_CONTROL_BALANCE_VOLTAGE) {
+						bleed |= 1UL << i;
+					}
+				}
+				Voltage_SetBalancing(bleed);
+				if (target > CHARGE_CONTROL_TOPOFF_CURRENT) {
+					target = CHARGE_CONTROL_TOPOFF_CURRENT;
+				}
+			}
+			break;
+
+		default:
+			break;
+	}
+
+	Setpoint = target < limit ? target : limit;
+	return true;
+}
+
+/** ChargeControl_GetState
+ * Gets where the charge is at
+ * @return state of the charge profile
+ */
+ChargeState ChargeControl_GetState(void) {
+	return Stage;
+}
+
+/** ChargeControl_GetCurrent
+ * Gets the current setpoint of the charger
+ * @return milliamperes, 0 when the charger is off
+ */
+int32_t ChargeControl_GetCurrent(void) {
+	return Setpoint;
+}
+
+/** ChargeControl_GetVoltage
+ * Gets the pack voltage setpoint of the charger
+ * @return millivolts, 0 when the charger is off
+ */
+uint32_t ChargeControl_GetVoltage(void) {
+	if (Stage == CHARGE_IDLE || Stage == CHARGE_DONE || Stage == CHARGE_FAULT) {
+		return 0;
+	}
+	return PACK_VOLTAGE;
+}
@@ -0,0 +1,212 @@
+/** ChargeEKF.c
+ * Extended Kalman filter for the state of charge. The state is the charge left and the
+ * voltage over the RC pair of the module model:
+ *     V = OCV(charge / capacity) - I * R0 - Vrc
+ * The charge itself is kept in microamp seconds like the coulomb count, so the prediction
+ * loses nothing and only the corrections go through floating point. The STM32 does the
+ * matrix math with the CMSIS DSP library, other builds with plain C loops.
+ */
+
+#include "ChargeEKF.h"
+#ifdef ARM_MATH_CM4
+#include "arm_math.h"
+#endif
+
+#define OCV_LIMIT_MARGIN	500		// mV past the ends of the table a reading is still believed
+
+static const uint16_t OCVTable[] = CHARGE_OCV_TABLE;
+#define OCV_POINTS			(sizeof(OCVTable) / sizeof(OCVTable[0]))
+
+// Process noise per second, state of charge (fraction squared) and RC pair voltage (V squared)
+#define SOC_NOISE			((CHARGE_EKF_SOC_DRIFT / 100.0f) * (CHARGE_EKF_SOC_DRIFT / 100.0f) / 3600)
+#define RC_NOISE			1e-6f
+
+// Measurement noise (V squared)
+#define VOLTAGE_NOISE		((CHARGE_EKF_VOLTAGE_NOISE / 1000.0f) * (CHARGE_EKF_VOLTAGE_NOISE / 1000.0f))
+
+/** ChargeEKF_MatMult
+ * out = a * b, out may not be a or b
+ */
+static void ChargeEKF_MatMult(const float *a, const float *b, float *out, uint16_t rows, uint16_t inner, uint16_t cols) {
+#ifdef ARM_MATH_CM4
+	arm_matrix_instance_f32 matA, matB, matOut;
+	arm_mat_init_f32(&matA, rows, inner, (float32_t *)a);
+	arm_mat_init_f32(&matB, inner, cols, (float32_t *)b);
+	arm_mat_init_f32(&matOut, rows, cols, out);
+	arm_mat_mult_f32(&matA, &matB, &matOut);
+#else
+	for (int r = 0; r < rows; r++) {
+		for (int c = 0; c < cols; c++) {
+			float sum = 0;
+			for (int i = 0; i < inner; i++) {
+				sum += a[r * inner + i] * b[i * cols + c];
+			}
+			out[r * cols + c] = sum;
+		}
+	}
+#endif
+}
+
+/** ChargeEKF_MatTrans
+ * out = a transposed, out may not be a
+ */
+static void ChargeEKF_MatTrans(const float *a, float *out, uint16_t rows, uint16_t cols) {
+#ifdef ARM_MATH_CM4
+	arm_matrix_instance_f32 matA, matOut;
+	arm_mat_init_f32(&matA, rows, cols, (float32_t *)a);
+	arm_mat_init_f32(&matOut, cols, rows, out);
+	arm_mat_trans_f32(&matA, &matOut);
+#else
+	for (int r = 0; r < rows; r++) {
+		for (int c = 0; c < cols; c++) {
+			out[c * rows + r] = a[r * cols + c];
+		}
+	}
+#endif
+}
+
+/** ChargeEKF_MatSub
+ * out = a - b, out may be a
+ */
+static void ChargeEKF_MatSub(const float *a, const float *b, float *out, uint16_t rows, uint16_t cols) {
+#ifdef ARM_MATH_CM4
+	arm_matrix_instance_f32 matA, matB, matOut;
+	arm_mat_init_f32(&matA, rows, cols, (float32_t *)a);
+	arm_mat_init_f32(&matB, rows, cols, (float32_t *)b);
+	arm_mat_init_f32(&matOut, rows, cols, out);
+	arm_mat_sub_f32(&matA, &matB, &matOut);
+#else
+	for (int i = 0; i < rows * cols; i++) {
+		out[i] = a[i] - b[i];
+	}
+#endif
+}
+
+/** ChargeEKF_OCV
+ * Looks up the open circuit voltage and its slope
+ * @param soc state of charge, 0 to 1
+ * @param slope where to store dV/dSoC, volts per full charge
+ * @return volts
+ */
+static float ChargeEKF_OCV(float soc, float *slope) {
+	float pos = soc * (OCV_POINTS - 1);
+	if (pos < 0) {
+		pos = 0;
+	} else if (pos > OCV_POINTS - 1) {
+		pos = OCV_POINTS - 1;
+	}
+	uint32_t idx = (uint32_t)pos;
+	if (idx > OCV_POINTS - 2) {
+		idx = OCV_POINTS - 2;
+	}
+	float low = OCVTable[idx] / 1000.0f;
+	float high = OCVTable[idx + 1] / 1000.0f;
+	*slope = (high - low) * (OCV_POINTS - 1);
+	return low + (high - low) * (pos - idx);
+}
+
+/** ChargeEKF_Init
+ * Starts a filter at a state of charge with the RC pair at rest
+ * @param ekf filter to start
+ * @param capacity charge when full, microamp seconds
+ * @param percent state of charge, resolution 0.01% (45.55% = 4555)
+ * @param errorPercent how far percent may be off, whole percent
+ */
+void ChargeEKF_Init(ChargeEKF *ekf, int64_t capacity, uint32_t percent, uint32_t errorPercent) {
+	float error = errorPercent / 100.0f;
+
+	ekf->capacity = capacity;
+	ekf->charge = capacity * percent / 10000;
+	ekf->rcVoltage = 0;
+	ekf->covariance[0] = error * error;
+	ekf->covariance[1] = 0;
+	ekf->covariance[2] = 0;
+	ekf->covariance[3] = RC_NOISE;
+}
+
+/** ChargeEKF_Predict
+ * Takes the charge that flowed off the state of charge and moves the RC pair along
+ * @param ekf filter to update
+ * @param microAmpSeconds charge out of the pack since the last prediction
+ * @param milliSeconds time since the last prediction
+ */
+void ChargeEKF_Predict(ChargeEKF *ekf, int64_t microAmpSeconds, uint32_t milliSeconds) {
+	ekf->charge -= microAmpSeconds;
+	if (milliSeconds == 0) {
+		return;
+	}
+
+	float seconds = milliSeconds / 1000.0f;
+	float amps = (float)microAmpSeconds / (milliSeconds * 1000.0f);
+	float decay = expf(-seconds / CHARGE_EKF_TAU_S);
+	ekf->rcVoltage = ekf->rcVoltage * decay + amps * (CHARGE_EKF_R1 / 1000000.0f) * (1 - decay);
+
+	// P = F P F' + Q
+	float transition[4] = {1, 0, 0, decay};
+	float transitionT[4];
+	float temp[4];
+	ChargeEKF_MatTrans(transition, transitionT, 2, 2);
+	ChargeEKF_MatMult(transition, ekf->covariance, temp, 2, 2, 2);
+	ChargeEKF_MatMult(temp, transitionT, ekf->covariance, 2, 2, 2);
+	ekf->covariance[0] += SOC_NOISE * seconds;
+	ekf->covariance[3] += RC_NOISE * seconds;
+}
+
+/** ChargeEKF_Correct
+ * Corrects the state of charge and RC pair voltage with a voltage measurement. Readings far
+ * outside CHARGE_OCV_TABLE are left to the voltage checks.
+ * @param ekf filter to update
+ * @param milliVolts module voltage
+ * @param milliAmps current at the time of the measurement
+ */
+void ChargeEKF_Correct(ChargeEKF *ekf, uint16_t milliVolts, int32_t milliAmps) {
+	if (milliVolts + OCV_LIMIT_MARGIN < OCVTable[0] || milliVolts > OCVTable[OCV_POINTS - 1] + OCV_LIMIT_MARGIN) {
+		return;
+	}
+
+	float slope;
+	float ocv = ChargeEKF_OCV((float)ekf->charge / ekf->capacity, &slope);
+	float predicted = ocv - (milliAmps / 1000.0f) * (CHARGE_EKF_R0 / 1000000.0f) - ekf->rcVoltage;
+	float innovation = milliVolts / 1000.0f - predicted;
+
+	// S = H P H' + R, K = P H' / S
+	float measurement[2] = {slope, -1};
+	float measurementT[2];
+	float covarianceMT[2];
+	float innovationCov;
+	ChargeEKF_MatTrans(measurement, measurementT, 1, 2);
+	ChargeEKF_MatMult(ekf->covariance, measurementT, covarianceMT, 2, 2, 1);
+	ChargeEKF_MatMult(measurement, covarianceMT, &innovationCov, 1, 2, 1);
+	innovationCov += VOLTAGE_NOISE;
+	float gain[2] = {covarianceMT[0] / innovationCov, covarianceMT[1] / innovationCov};
+
+	ekf->charge += (int64_t)(gain[0] * innovation * ekf->capacity);
+	ekf->rcVoltage += gain[1] * innovation;
+
+	// P = P - K H P
+	float measurementCov[2];
+	float correction[4];
+	ChargeEKF_MatMult(measurement, ekf->covariance, measurementCov, 1, 2, 2);
+	ChargeEKF_MatMult(gain, measurementCov, correction, 2, 1, 2);
+	ChargeEKF_MatSub(ekf->covariance, correction, ekf->covariance, 2, 2);
+
+	// Keep it symmetric against rounding
+	float offDiagonal = (ekf->covariance[1] + ekf->covariance[2]) / 2;
+	ekf->covariance[1] = offDiagonal;
+	ekf->covariance[2] = offDiagonal;
+}
+
+/** ChargeEKF_GetPercent
+ * Gets the state of charge of a filter
+ * @param ekf filter
+ * @return fixed point percentage. Resolution = 0.01 (45.55% = 4555)
+ */
+uint32_t ChargeEKF_GetPercent(const ChargeEKF *ekf) {
+	if (ekf->charge <= 0) {
+		return 0;
+	}
+	if (ekf->charge >= ekf->capacity) {
+		return 10000;
+	}
+	return ekf->charge * 10000 / ekf->capacity;
+}
@@ -0,0 +1,182 @@
+/** ChargeJournal.c
+ * Keeps the state of charge across resets. Each checkpoint is a 16 byte record written to the
+ * next slot after the newest one, so the slots wear evenly and the older checkpoints stay
+ * intact while a new one is written. A slot never crosses an EEPROM page, a record is a single
+ * page write. At boot the good record with the highest sequence number wins.
+ */
+
+#include <stddef.h>
+#include "ChargeJournal.h"
+#include "EEPROM.h"
+#include "BSP_PVD.h"
+#include "cmsis_os.h"
+
+#define SLOT_SIZE			16
+#define DELTA_CHARGE		((int64_t)PACK_CAPACITY_MAH * 3600 * 1000 * CHARGE_JOURNAL_DELTA / 10000)	// microamp seconds
+#define CRC_POLYNOMIAL		0xEDB88320	// CRC-32, reflected
+
+typedef struct {
+	int64_t charge;			// microamp seconds
+	uint32_t sequence;		// One higher than the record before, wraps around
+	uint32_t crc;			// CRC-32 of the fields above
+} JournalRecord;
+
+_Static_assert(sizeof(JournalRecord) == SLOT_SIZE, "a journal record must fill its slot exactly");
+
+static uint32_t NextSlot;
+static uint32_t NextSequence;
+static int64_t LastCharge;			// Charge of the last checkpoint
+static uint32_t LastTime;			// Time of the last checkpoint (ms)
+static uint32_t Writes;
+
+static int64_t Latest;				// Charge of the last ChargeJournal_Update
+static volatile bool PowerFailed;	// The supply is dropping, only the final checkpoint is left
+static bool FinalWritten;
+
+// The supply drop interrupt only raises PowerFailed and wakes the thread waiting here, the
+// final checkpoint is written by that thread once it has the EEPROM to itself
+osMessageQDef(PowerFailQueue, 1, uint32_t);
+static osMessageQId PowerFailQueue;
+
+/** ChargeJournal_CRC
+ * Calculates the CRC of a record
+ * @param record record to check
+ * @return CRC-32 of everything before the crc field
+ */
+static uint32_t ChargeJournal_CRC(const JournalRecord *record) {
+	const uint8_t *bytes = (const uint8_t *)record;
+	uint32_t crc = 0xFFFFFFFF;
+	for (uint32_t i = 0; i < offsetof(JournalRecord, crc); i++) {
+		crc ^= bytes[i];
+		for (int bit = 0; bit < 8; bit++) {
+			crc = (crc >> 1) ^ (CRC_POLYNOMIAL & -(crc & 1));
+		}
+	}
+	return ~crc;
+}
+
+/** ChargeJournal_Write
+ * Writes a checkpoint to the next slot
+ * @param charge microamp seconds
+ */
+static void ChargeJournal_Write(int64_t charge) {
+	JournalRecord record;
+	record.charge = charge;
+	record.sequence = NextSequence;
+	record.crc = ChargeJournal_CRC(&record);
+
+	EEPROM_WriteMultipleBytes(EEPROM_CHARGE_JOURNAL_LOC + NextSlot * SLOT_SIZE, SLOT_SIZE, (uint8_t *)&record);
+
+	NextSlot = (NextSlot + 1) % CHARGE_JOURNAL_SLOTS;
+	NextSequence++;
+	Writes++;
+}
+
+/** ChargeJournal_Init
+ * Finds the newest good checkpoint and arms the final checkpoint on a supply drop.
+ * Call after EEPROM_Init.
+ * @param charge where to store the charge of the newest checkpoint, microamp seconds
+ * @return true if there was a good checkpoint
+ */
+bool ChargeJournal_Init(int64_t *charge) {
+	bool found = false;
+	JournalRecord newest = {0};
+	uint32_t newestSlot = CHARGE_JOURNAL_SLOTS - 1;
+
+	for (uint32_t slot = 0; slot < CHARGE_JOURNAL_SLOTS; slot++) {
+		JournalRecord record;
+		EEPROM_ReadMultipleBytes(EEPROM_CHARGE_JOURNAL_LOC + slot * SLOT_SIZE, SLOT_SIZE, (uint8_t *)&record);
+		if (record.crc != ChargeJournal_CRC(&record)) {
+			continue;	// Blank or torn
+		}
+		// Sequence numbers wrap around, newer means less than half the range ahead
+		if (!found || (int32_t)(record.sequence - newest.sequence) > 0) {
+			newest = record;
+			newestSlot = slot;
+			found = true;
+		}
+	}
+
+	NextSlot = (newestSlot + 1) % CHARGE_JOURNAL_SLOTS;
+	NextSequence = newest.sequence + 1;
+	LastCharge = newest.charge;
+	LastTime = 0;
+	Writes = 0;
+	Latest = newest.charge;
+	PowerFailed = false;
+	FinalWritten = false;
+
+	if (PowerFailQueue == NULL) {
+		PowerFailQueue = osMessageCreate(osMessageQ(PowerFailQueue), NULL);
+	}
+	while (osMessageGet(PowerFailQueue, 0).status == osEventMessage);
+	BSP_PVD_Init(ChargeJournal_PowerFail);
+
+	if (found) {
+		*charge = newest.charge;
+	}
+	return found;
+}
+
+/** ChargeJournal_Update
+ * Writes a checkpoint when CHARGE_JOURNAL_PERIOD_S has passed since the last one or the
+ * charge moved by CHARGE_JOURNAL_DELTA. A checkpoint is a single EEPROM page write, the
+ * EEPROM finishes it on its own while the loop goes on.
+ * @param charge charge left, microamp seconds
+ * @param milliSeconds current time
+ */
+void ChargeJournal_Update(int64_t charge, uint32_t milliSeconds) {
+	Latest = charge;
+
+	int64_t delta = charge > LastCharge ? charge - LastCharge : LastCharge - charge;
+	bool due = (milliSeconds - LastTime >= CHARGE_JOURNAL_PERIOD_S * 1000) && delta > 0;
+	if ((!due && delta < DELTA_CHARGE) || PowerFailed) {
+		return;
+	}
+
+	ChargeJournal_Write(charge);
+	LastCharge = charge;
+	LastTime = milliSeconds;
+}
+
+/** ChargeJournal_PowerFail
+ * Stops the regular checkpoints and wakes the thread in ChargeJournal_WaitPowerFail.
+ * Called from the supply drop interrupt, it does not touch the EEPROM.
+ */
+void ChargeJournal_PowerFail(void) {
+	PowerFailed = true;
+	osMessagePut(PowerFailQueue, 0, 0);		// Already full if the supply dropped before
+}
+
+/** ChargeJournal_WaitPowerFail
+ * Waits for the supply to drop
+ * @param millisec how long to wait, osWaitForever for no limit
+ * @return true if the supply dropped
+ */
+bool ChargeJournal_WaitPowerFail(uint32_t millisec) {
+	return osMessageGet(PowerFailQueue, millisec).status == osEventMessage;
+}
+
+/** ChargeJournal_WriteFinal
+ * Writes the final checkpoint with the charge of the last ChargeJournal_Update, unless the
+ * last checkpoint already has it. Only the first call writes. The caller has to hold the
+ * EEPROM like for ChargeJournal_Update.
+ */
+void ChargeJournal_WriteFinal(void) {
+	if (FinalWritten) {
+		return;
+	}
+	FinalWritten = true;
+	if (Latest != LastCharge) {
+		ChargeJournal_Write(Latest);
+		LastCharge = Latest;
+	}
+}
+
+/** ChargeJournal_GetWrites
+ * Gets how many checkpoints have been written since ChargeJournal_Init
+ * @return number of writes
+ */
+uint32_t ChargeJournal_GetWrites(void) {
+	return Writes;
+}
@@ -0,0 +1,79 @@
+/** Counters.c
+ * Error counters and gauges of the whole BPS. The table of names and kinds comes from the
+ * same COUNTERS list as the ids, so the two cannot get out of step.
+ */
+
+#include "Counters.h"
+
+volatile uint32_t Counters[NUM_COUNTERS];
+
+#define COUNTERS_NAME(id, gauge, name)	name,
+static const char *Names[NUM_COUNTERS] = {
+	COUNTERS(COUNTERS_NAME)
+};
+
+#define COUNTERS_GAUGE(id, gauge, name)	gauge,
+static const bool Gauges[NUM_COUNTERS] = {
+	COUNTERS(COUNTERS_GAUGE)
+};
+
+/** Counters_Export
+ * Hands entries to an exporter, starting at first and wrapping around the end of the table
+ * @param first entry
+ * @param count of entries, at most NUM_COUNTERS
+ * @param emit called for every entry
+ * @param context passed on to emit
+ * @return the entry after the last one handed over, where the next call can carry on
+ */
+CounterId Counters_Export(CounterId first, uint8_t count, CountersEmit emit, void *context) {
+	CounterId id = first < NUM_COUNTERS ? first : 0;
+	if (count > NUM_COUNTERS) {
+		count = NUM_COUNTERS;
+	}
+	for (uint8_t i = 0; i < count; i++) {
+		emit(id, Names[id], Gauges[id], Counters[id], context);
+		id = (id + 1) % NUM_COUNTERS;
+	}
+	return id;
+}
+
+/** Counters_Reset
+ * Sets every counter and gauge back to 0
+ */
+void Counters_Reset(void) {
+	for (CounterId id = 0; id < NUM_COUNTERS; id++) {
+		Counters[id] = 0;
+	}
+}
+
+#ifdef SIMULATION
+static void Counters_WriteName(CounterId id, const char *name, bool gauge, uint32_t value, void *context) {
+	fprintf(context, ",%s", name);
+}
+
+static void Counters_WriteValue(CounterId id, const char *name, bool gauge, uint32_t value, void *context) {
+	fprintf(context, ",%lu", (unsigned long)value);
+}
+
+/** Counters_DumpCSV
+ * Appends a row of every entry to a CSV file, with a header row if the file is new
+ * @param path of the file
+ * @param time of the row in ms
+ */
+void Counters_DumpCSV(const char *path, uint32_t time) {
+	FILE *file = fopen(path, "a");
+	if (file == NULL) {
+		return;
+	}
+	fseek(file, 0, SEEK_END);
+	if (ftell(file) == 0) {
+		fprintf(file, "time");
+		Counters_Export(0, NUM_COUNTERS, Counters_WriteName, file);
+		fprintf(file, "\n");
+	}
+	fprintf(file, "%lu", (unsigned long)time);
+	Counters_Export(0, NUM_COUNTERS, Counters_WriteValue, file);
+	fprintf(file, "\n");
+	fclose(file);
+}
+#endif
@@ -8,10 +8,18 @@
 // TODO: Think of better naming convention of current
 
 #include "Current.h"
+#include "Fuse.h"
 #include "BSP_ADC.h"
 
 int32_t HighPrecisionCurrent;	// Milliamp measurement of hall effect sensor of high precision
 int32_t LowPrecisionCurrent;	// Milliamp measurement of hall effect sensor of low precision
+static uint32_t SampleTime;		// ADC samples taken up to the newest reading
+
+// Coulomb counter, integrated from the ADC sums of every low precision sample
+static uint64_t ChargeCodes;		// ADC sum up to the last Current_GetChargeMoved
+static uint32_t ChargeSamples;		// Samples in that sum
+static int64_t ChargeMoved;			// Microamp seconds out of the pack
+static int64_t ChargeRemainder;		// Left over from dividing down to microamp seconds
 
 typedef enum {
 	HIGH_PRECISION,
@@ -19,31 +27,59 @@ typedef enum {
 } CurrentSensor;
 
 static int32_t Current_Conversion(uint32_t milliVolts, CurrentSensor s);
+static uint32_t Current_InverseConversion(int32_t milliAmps, CurrentSensor s);
 
 /** Current_Init
  * Initializes two ADCs to begin current monitoring.
+ * The analog watchdog guards the instantaneous limits of Current_CheckStatus between main loop passes.
  */
 void Current_Init(void){
+	Fuse_Init();
 	BSP_ADC_Init();	// Initialize the ADCs
+	BSP_ADC_Watchdog_Init(Current_InverseConversion(MAX_CHARGING_CURRENT, LOW_PRECISION),
+		Current_InverseConversion(MAX_CURRENT_LIMIT, LOW_PRECISION));
+
+	ChargeCodes = BSP_ADC_GetLowSum(&ChargeSamples);
+	ChargeMoved = 0;
+	ChargeRemainder = 0;
 }
 
 /** Current_UpdateMeasurements
- * Stores and updates the new measurements received
+ * Stores and updates the new measurements received. Goes through every averaged
+ * ADC reading since the last call, the newest one becomes the current measurement.
  * @return SUCCESS or ERROR
  */
 ErrorStatus Current_UpdateMeasurements(void){
-	HighPrecisionCurrent = Current_Conversion(BSP_ADC_High_GetMilliVoltage(), HIGH_PRECISION);
-	LowPrecisionCurrent  = Current_Conversion(BSP_ADC_Low_GetMilliVoltage(), LOW_PRECISION);
+	ADC_Sample samples[ADC_QUEUE_SIZE];
+	uint32_t count = BSP_ADC_ReadSamples(samples, ADC_QUEUE_SIZE);
+
+	for(uint32_t i = 0; i < count; i++) {
+		HighPrecisionCurrent = Current_Conversion(samples[i].highMilliVolts, HIGH_PRECISION);
+		LowPrecisionCurrent  = Current_Conversion(samples[i].lowMilliVolts, LOW_PRECISION);
+		SampleTime = samples[i].timestamp;
+
+		// Every reading counts toward the fuse curves, not just the newest
+		Fuse_Update(LowPrecisionCurrent);
+	}
 
 	return SUCCESS;	// TODO: Once this has been tested, stop returning errors
 }
 
 /** Current_CheckStatus
- * Checks if pack does not have a short circuit
+ * Checks if pack does not have a short circuit or an overload past the fuse curves.
+ * Stays DANGER once the analog watchdog or a fuse curve tripped.
  * @return SAFE or DANGER
  */
 SafetyStatus Current_CheckStatus(bool override) {
 
+	// The watchdog has already opened the contactor, keep it open
+	if(BSP_ADC_Watchdog_Tripped(NULL))
+		return DANGER;
+
+	// Too much current for too long
+	if(Fuse_CheckStatus() != SAFE)
+		return DANGER;
+
 	if((LowPrecisionCurrent > MAX_CHARGING_CURRENT)&&(LowPrecisionCurrent < MAX_CURRENT_LIMIT)&&(!override))
 		return SAFE;
 	else if((LowPrecisionCurrent <= 0)&&(LowPrecisionCurrent > MAX_CHARGING_CURRENT)&&override)
@@ -78,6 +114,40 @@ int32_t Current_GetLowPrecReading(void) {
 	return LowPrecisionCurrent;
 }
 
+/** Current_GetSampleTime
+ * Gets when the newest reading was taken
+ * @return milliseconds since Current_Init
+ */
+uint32_t Current_GetSampleTime(void) {
+	return (uint32_t)(((uint64_t)SampleTime * 1000) / ADC_SAMPLE_RATE_HZ);
+}
+
+/** Current_GetChargeMoved
+ * Gets the charge that has flowed out of the pack since Current_Init. Every sample of the
+ * low precision sensor counts, however long the main loop takes between two calls.
+ * Call at least once an hour, and from one task only: Charge_Calculate calls it, everyone
+ * else reads Charge_GetChargeMoved.
+ * @return microamp seconds, negative if more flowed in than out
+ */
+int64_t Current_GetChargeMoved(void) {
+	uint32_t samples;
+	uint64_t codes = BSP_ADC_GetLowSum(&samples);
+	int64_t newCodes = codes - ChargeCodes;
+	int64_t newSamples = (uint32_t)(samples - ChargeSamples);
+	ChargeCodes = codes;
+	ChargeSamples = samples;
+
+	// Current_Conversion of the low precision sensor, summed over every sample without
+	// rounding: mA = (3 * code * 3300 / 4096 - 4096) * 25, times 1000 / ADC_SAMPLE_RATE_HZ
+	// for microamp seconds. 1000 / 4096 is 125 / 512.
+	int64_t numerator = (newCodes * 9900 - newSamples * 4096 * 4096) * 25 * 125 + ChargeRemainder;
+	int64_t denominator = 512LL * ADC_SAMPLE_RATE_HZ;
+	ChargeMoved += numerator / denominator;
+	ChargeRemainder = numerator % denominator;
+
+	return ChargeMoved;
+}
+
 /** Current_Conversion
  * Returns the converted value of the current read by the sensor
  * @returns current in mA
@@ -99,3 +169,32 @@ static int32_t Current_Conversion (uint32_t milliVolts, CurrentSensor s) {
 			return sensorOutput * (100 / 4);	// In mA.
 	}
 }
+
+/** Current_InverseConversion
+ * Returns the sensor output that Current_Conversion turns into the given current. Rounded
+ * away from 0A so that the result is never inside the limit it came from.
+ * @returns millivolts
+ */
+static uint32_t Current_InverseConversion(int32_t milliAmps, CurrentSensor s) {
+	const int opAmpOffset = 4096;
+	const int opAmpGain = 3;
+
+	int32_t gain;
+	switch(s) {
+		case HIGH_PRECISION:
+			gain = 50 / 4;
+			break;
+		case LOW_PRECISION:
+		default:
+			gain = 100 / 4;
+			break;
+	}
+
+	// milliVolts * opAmpGain * gain = milliAmps + opAmpOffset * gain
+	int32_t numerator = milliAmps + opAmpOffset * gain;
+	int32_t denominator = opAmpGain * gain;
+	if(milliAmps > 0) {
+		numerator += denominator - 1;
+	}
+	return numerator < 0 ? 0 : numerator / denominator;
+}
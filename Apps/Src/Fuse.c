@@ -0,0 +1,149 @@
+/** Fuse.c
+ * Time-current protection. A curve point {I, t} means a current of I fills the counter in t.
+ * Between two points the fill rate is linear in I^2, so every segment is an I^2t curve:
+ *     rate = rate[k] + (rate[k+1] - rate[k]) * (I^2 - I[k]^2) / (I[k+1]^2 - I[k]^2)
+ * Point 0 is the rating, which fills at rate 0. Past the last point the last segment goes on.
+ * A table by whole amps finds the segment, so an update costs the same for every current.
+ */
+
+#include "Fuse.h"
+#include "BSP_ADC.h"
+
+#define FUSE_FULL			(1UL << 30)		// Counter value that trips
+#define FUSE_SQ_SHIFT		10				// Currents are squared in mA^2 >> FUSE_SQ_SHIFT
+#define FUSE_MAX_POINTS		8				// Points per curve, the rating included
+#define FUSE_LUT_SIZE		(MAX_CURRENT_LIMIT / 1000 + 1)
+
+// Time between two readings and the fraction of the counter that cools off in it (Q16)
+#define FUSE_SAMPLE_US		((ADC_BLOCK_SIZE * 1000000ULL) / ADC_SAMPLE_RATE_HZ)
+#define FUSE_COOL_ALPHA		((FUSE_SAMPLE_US * 65536) / (FUSE_COOL_TAU_S * 1000000ULL))
+
+#if FUSE_COOL_ALPHA == 0
+#error "FUSE_COOL_TAU_S is too long for the ADC reading rate"
+#endif
+
+typedef struct {
+	int32_t current;	// mA
+	uint32_t time;		// ms
+} FusePoint;
+
+typedef struct {
+	int64_t currentSq[FUSE_MAX_POINTS];		// Current of every point, squared
+	uint32_t rate[FUSE_MAX_POINTS];			// Counter filled per reading at that current
+	uint8_t numPoints;
+	uint8_t segment[FUSE_LUT_SIZE];			// Segment every whole amp starts in
+	uint32_t counter;
+	bool tripped;
+} Fuse;
+
+static const FusePoint DischargeCurve[] = FUSE_DISCHARGE_CURVE;
+static const FusePoint ChargeCurve[] = FUSE_CHARGE_CURVE;
+
+static Fuse Fuses[NUM_FUSE_CURVES];
+
+/** Fuse_Build
+ * Turns a curve from config.h into fill rates and fills the segment table
+ * @param fuse curve to build
+ * @param rating current that may flow forever in mA
+ * @param curve points past the rating, in increasing current
+ * @param numPoints number of points in curve
+ */
+static void Fuse_Build(Fuse *fuse, int32_t rating, const FusePoint *curve, uint8_t numPoints) {
+	fuse->currentSq[0] = ((int64_t)rating * rating) >> FUSE_SQ_SHIFT;
+	fuse->rate[0] = 0;
+	for (int i = 0; i < numPoints && i + 1 < FUSE_MAX_POINTS; i++) {
+		fuse->currentSq[i + 1] = ((int64_t)curve[i].current * curve[i].current) >> FUSE_SQ_SHIFT;
+		fuse->rate[i + 1] = ((uint64_t)FUSE_FULL * FUSE_SAMPLE_US) / ((uint64_t)curve[i].time * 1000);
+	}
+	fuse->numPoints = numPoints + 1 < FUSE_MAX_POINTS ? numPoints + 1 : FUSE_MAX_POINTS;
+
+	uint8_t k = 0;
+	for (int amps = 0; amps < FUSE_LUT_SIZE; amps++) {
+		int64_t sq = ((int64_t)amps * amps * 1000000) >> FUSE_SQ_SHIFT;
+		while (k + 2 < fuse->numPoints && sq >= fuse->currentSq[k + 1]) {
+			k++;
+		}
+		fuse->segment[amps] = k;
+	}
+
+	fuse->counter = 0;
+	fuse->tripped = false;
+}
+
+/** Fuse_Init
+ * Builds the lookup tables of both curves and starts them cold
+ */
+void Fuse_Init(void) {
+	Fuse_Build(&Fuses[FUSE_DISCHARGE], FUSE_DISCHARGE_RATING, DischargeCurve, sizeof(DischargeCurve) / sizeof(FusePoint));
+	Fuse_Build(&Fuses[FUSE_CHARGE], FUSE_CHARGE_RATING, ChargeCurve, sizeof(ChargeCurve) / sizeof(FusePoint));
+}
+
+/** Fuse_Rate
+ * Gets how fast a current fills the counter of a curve
+ * @param fuse curve
+ * @param current in mA, positive
+ * @return counter filled per reading, 0 at or below the rating
+ */
+static uint32_t Fuse_Rate(const Fuse *fuse, uint32_t current) {
+	int64_t sq = ((int64_t)current * current) >> FUSE_SQ_SHIFT;
+	if (sq <= fuse->currentSq[0]) {
+		return 0;
+	}
+
+	uint32_t amps = current / 1000;
+	uint8_t k = fuse->segment[amps < FUSE_LUT_SIZE ? amps : FUSE_LUT_SIZE - 1];
+
+	// The amp the current is in may be where the next segment starts
+	if (k + 2 < fuse->numPoints && sq >= fuse->currentSq[k + 1]) {
+		k++;
+	}
+
+	int64_t rate = fuse->rate[k] + ((int64_t)(fuse->rate[k + 1] - fuse->rate[k]) * (sq - fuse->currentSq[k]))
+		/ (fuse->currentSq[k + 1] - fuse->currentSq[k]);
+	return rate > FUSE_FULL ? FUSE_FULL : (uint32_t)rate;
+}
+
+/** Fuse_Add
+ * Fills or cools one curve by one reading
+ * @param fuse curve
+ * @param current in mA in the direction of the curve, 0 if it flows the other way
+ */
+static void Fuse_Add(Fuse *fuse, uint32_t current) {
+	uint32_t rate = Fuse_Rate(fuse, current);
+	if (rate == 0) {
+		fuse->counter -= ((uint64_t)fuse->counter * FUSE_COOL_ALPHA) >> 16;
+	} else {
+		fuse->counter = fuse->counter + rate > FUSE_FULL ? FUSE_FULL : fuse->counter + rate;
+	}
+
+	if (fuse->counter >= FUSE_FULL) {
+		fuse->tripped = true;
+	}
+}
+
+/** Fuse_Update
+ * Adds one current reading. Takes the same time no matter the current.
+ * Call for every ADC reading, they are ADC_BLOCK_SIZE samples apart.
+ * @param current pack current in milliamperes, negative while charging
+ */
+void Fuse_Update(int32_t current) {
+	Fuse_Add(&Fuses[FUSE_DISCHARGE], current > 0 ? current : 0);
+	Fuse_Add(&Fuses[FUSE_CHARGE], current < 0 ? -current : 0);
+}
+
+/** Fuse_CheckStatus
+ * Checks if either curve has run out. A trip stays until Fuse_Init.
+ * @return SAFE or DANGER
+ */
+SafetyStatus Fuse_CheckStatus(void) {
+	return (Fuses[FUSE_DISCHARGE].tripped || Fuses[FUSE_CHARGE].tripped) ? DANGER : SAFE;
+}
+
+/** Fuse_GetMargin
+ * Gets how much of a curve is left
+ * @param curve FUSE_DISCHARGE or FUSE_CHARGE
+ * @return percent left before the trip, 100 when cold
+ */
+uint8_t Fuse_GetMargin(FuseCurve curve) {
+	return ((uint64_t)(FUSE_FULL - Fuses[curve].counter) * 100) / FUSE_FULL;
+}
@@ -0,0 +1,208 @@
+/** ModuleCharge.c
+ * State of charge and capacity of every module. All modules carry the pack current, so between
+ * rests each one only needs the charge moved divided by its own capacity. At the end of a rest
+ * the module voltages are read as open circuit voltages and set every state of charge. The
+ * capacity is a least squares fit of the charge moved against the change in state of charge
+ * between rests, fading out the old swings so it follows aging.
+ */
+
+#include "ModuleCharge.h"
+#include "Charge.h"
+#include "Current.h"
+#include "Voltage.h"
+
+#define NOMINAL_CAPACITY	((float)PACK_CAPACITY_MAH * 3600 * 1000)	// microamp seconds
+#define MEMORY				(1 - 1.0f / MODULE_CAPACITY_MEMORY)
+
+static const uint16_t OCVTable[] = CHARGE_OCV_TABLE;
+#define OCV_POINTS			(sizeof(OCVTable) / sizeof(OCVTable[0]))
+
+static float Soc[NUM_BATTERY_MODULES];				// 0 to 1
+static float InvCapacity[NUM_BATTERY_MODULES];		// 1 / microamp seconds
+
+// Capacity fit, sums of swing * swing and swing * charge moved
+static float SwingSquares[NUM_BATTERY_MODULES];
+static float SwingCharge[NUM_BATTERY_MODULES];
+
+// State of charge at the last rest the capacity was learned from
+static float AnchorSoc[NUM_BATTERY_MODULES];
+static int64_t AnchorMoved;
+static bool HaveAnchor;
+
+static int64_t LastMoved;		// Charge_GetChargeMoved at the last update
+static bool Resting;
+static bool RestTaken;			// The rest has already been read
+static uint32_t RestStart;		// ms
+
+static uint8_t Lowest;
+static uint8_t Highest;
+
+/** ModuleCharge_OCVToSoc
+ * Looks up the state of charge for an open circuit voltage
+ * @param milliVolts open circuit voltage of a module
+ * @return 0 to 1
+ */
+static float ModuleCharge_OCVToSoc(int32_t milliVolts) {
+	if (milliVolts <= OCVTable[0]) {
+		return 0;
+	}
+	for (uint32_t i = 1; i < OCV_POINTS; i++) {
+		if (milliVolts < OCVTable[i]) {
+			float frac = (float)(milliVolts - OCVTable[i - 1]) / (OCVTable[i] - OCVTable[i - 1]);
+			return (i - 1 + frac) / (OCV_POINTS - 1);
+		}
+	}
+	return 1;
+}
+
+/** ModuleCharge_Rest
+ * Sets every module to its open circuit voltage and learns the capacities from the swing
+ * since the anchor rest
+ * @param moved Charge_GetChargeMoved now
+ * @param milliAmps current during the rest
+ */
+static void ModuleCharge_Rest(int64_t moved, int32_t milliAmps) {
+	float charge = (float)(moved - AnchorMoved);
+	bool learn = false;
+
+	for (int i = 0; i < NUM_BATTERY_MODULES; i++) {
+		// The little current that is still flowing drops over the series resistance
+		int32_t milliVolts = Voltage_GetModuleMillivoltage(i) + milliAmps * CHARGE_EKF_R0 / 1000000;
+		float soc = ModuleCharge_OCVToSoc(milliVolts);
+
+		float swing = AnchorSoc[i] - soc;
+		if (HaveAnchor && fabsf(swing) * 10000 >= MODULE_CAPACITY_MIN_SWING) {
+			SwingSquares[i] = SwingSquares[i] * MEMORY + swing * swing;
+			SwingCharge[i] = SwingCharge[i] * MEMORY + swing * charge;
+			float capacity = SwingCharge[i] / SwingSquares[i];
+
+			// A fit that says the module gained or lost half its capacity is a bad reading
+			if (capacity > NOMINAL_CAPACITY / 2 && capacity < NOMINAL_CAPACITY * 3 / 2) {
+				InvCapacity[i] = 1 / capacity;
+			}
+			learn = true;
+		}
+		Soc[i] = soc;
+	}
+
+	// The swing is the same size for every module, they all move the anchor together
+	if (learn || !HaveAnchor) {
+		for (int i = 0; i < NUM_BATTERY_MODULES; i++) {
+			AnchorSoc[i] = Soc[i];
+		}
+		AnchorMoved = moved;
+		HaveAnchor = true;
+	}
+}
+
+/** ModuleCharge_Init
+ * Starts every module at the state of charge of the pack with the nominal capacity.
+ * Call after Current_Init and Charge_Init.
+ */
+void ModuleCharge_Init(void) {
+	float soc = Charge_GetPercent() / 10000.0f;
+
+	for (int i = 0; i < NUM_BATTERY_MODULES; i++) {
+		Soc[i] = soc;
+		InvCapacity[i] = 1 / NOMINAL_CAPACITY;
+
+		// Start the fit as if one swing of 5% had shown the nominal capacity
+		SwingSquares[i] = 0.05f * 0.05f;
+		SwingCharge[i] = 0.05f * 0.05f * NOMINAL_CAPACITY;
+	}
+	HaveAnchor = false;
+	LastMoved = Charge_GetChargeMoved();
+	Resting = false;
+	Lowest = 0;
+	Highest = 0;
+}
+
+/** ModuleCharge_Update
+ * Takes the charge that Charge_Calculate counted since the last call off every module, and
+ * corrects the modules and learns their capacities when the pack has rested. The work per call
+ * is the same for every call except the one at the end of a rest.
+ */
+void ModuleCharge_Update(void) {
+	int64_t moved = Charge_GetChargeMoved();
+	float charge = (float)(moved - LastMoved);
+	LastMoved = moved;
+
+	Lowest = 0;
+	Highest = 0;
+	for (int i = 0; i < NUM_BATTERY_MODULES; i++) {
+		Soc[i] -= charge * InvCapacity[i];
+		if (Soc[i] < Soc[Lowest]) {
+			Lowest = i;
+		}
+		if (Soc[i] > Soc[Highest]) {
+			Highest = i;
+		}
+	}
+
+	int32_t milliAmps = Current_GetLowPrecReading();
+	uint32_t time = Current_GetSampleTime();
+	if (milliAmps > MODULE_REST_CURRENT || milliAmps < -MODULE_REST_CURRENT) {
+		Resting = false;
+		return;
+	}
+	if (!Resting) {
+		Resting = true;
+		RestTaken = false;
+		RestStart = time;
+	}
+	if (!RestTaken && time - RestStart >= MODULE_REST_TIME_S * 1000) {
+		ModuleCharge_Rest(moved, milliAmps);
+		RestTaken = true;
+	}
+}
+
+/** ModuleCharge_GetPercent
+ * Gets the state of charge of a module
+ * @param module index of the module (0-indexed)
+ * @return fixed point percentage. Resolution = 0.01 (45.55% = 4555)
+ */
+uint32_t ModuleCharge_GetPercent(uint8_t module) {
+	if (module >= NUM_BATTERY_MODULES || Soc[module] <= 0) {
+		return 0;
+	}
+	if (Soc[module] >= 1) {
+		return 10000;
+	}
+	return Soc[module] * 10000;
+}
+
+/** ModuleCharge_GetCapacity
+ * Gets the capacity learned for a module
+ * @param module index of the module (0-indexed)
+ * @return mAh
+ */
+uint32_t ModuleCharge_GetCapacity(uint8_t module) {
+	if (module >= NUM_BATTERY_MODULES) {
+		return 0;
+	}
+	return 1 / InvCapacity[module] / (3600 * 1000);
+}
+
+/** ModuleCharge_GetLowest
+ * Gets the module with the lowest state of charge
+ * @return index of the module (0-indexed)
+ */
+uint8_t ModuleCharge_GetLowest(void) {
+	return Lowest;
+}
+
+/** ModuleCharge_GetHighest
+ * Gets the module with the highest state of charge
+ * @return index of the module (0-indexed)
+ */
+uint8_t ModuleCharge_GetHighest(void) {
+	return Highest;
+}
+
+/** ModuleCharge_GetSpread
+ * Gets how far the highest module is ahead of the lowest
+ * @return fixed point percentage. Resolution = 0.01 (45.55% = 4555)
+ */
+uint32_t ModuleCharge_GetSpread(void) {
+	return ModuleCharge_GetPercent(Highest) - ModuleCharge_GetPercent(Lowest);
+}
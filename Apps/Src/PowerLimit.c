@@ -0,0 +1,174 @@
+/** PowerLimit.c
+ * State of power. Each limit is the smallest of:
+ *  - the current that takes the weakest module to its voltage limit, from the voltage it would
+ *    have with no current flowing and the resistance of a module over a few seconds
+ *  - the same, tapered to 0 over POWER_LIMIT_TEMP_DERATE as the hottest sensor gets to its
+ *    limit. A sensor heating up counts as hot as it will be in TEMP_PREDICT_HORIZON_S, the
+ *    same way the predictive trip in Temperature.c sees it.
+ *  - the same, tapered to 0 over POWER_LIMIT_SOC_DERATE as the lowest module gets empty or
+ *    the highest gets full
+ *  - the fuse rating once a fuse curve is close to running out
+ * A limit drops at once and comes back at POWER_LIMIT_RISE_RATE.
+ */
+
+#include "PowerLimit.h"
+#include "Voltage.h"
+#include "Current.h"
+#include "Temperature.h"
+#include "ModuleCharge.h"
+#include "Fuse.h"
+
+#define MAX_DISCHARGE		MAX_CURRENT_LIMIT
+#define MAX_CHARGE			(-MAX_CHARGING_CURRENT)
+
+static int32_t DischargeLimit;		// mA
+static int32_t ChargeLimit;			// mA
+static uint32_t LastUpdate;			// ms
+
+/** PowerLimit_FromVoltage
+ * Current that takes a module from its open circuit voltage to a voltage limit
+ * @param headroom open circuit voltage to the limit (mV)
+ * @param max most current the limit may be
+ * @return milliamperes, 0 to max
+ */
+static int32_t PowerLimit_FromVoltage(int32_t headroom, int32_t max) {
+	if (headroom <= 0) {
+		return 0;
+	}
+	int64_t milliAmps = (int64_t)headroom * 1000000 / POWER_LIMIT_RESISTANCE;
+	return milliAmps < max ? milliAmps : max;
+}
+
+/** PowerLimit_Taper
+ * Scales a limit down to 0 as its margin runs out
+ * @param limit limit with plenty of margin
+ * @param margin what is left before the limit, any unit
+ * @param range margin where the taper starts, same unit
+ * @return limit, less if the margin is below range
+ */
+static int32_t PowerLimit_Taper(int32_t limit, int32_t margin, int32_t range) {
+	if (margin <= 0) {
+		return 0;
+	}
+	if (margin >= range) {
+		return limit;
+	}
+	return (int64_t)limit * margin / range;
+}
+
+/** PowerLimit_Follow
+ * Moves a limit to its new value, at once going down and at POWER_LIMIT_RISE_RATE going up
+ * @param limit current limit
+ * @param target new value
+ * @param milliSeconds time since the last update
+ * @return new limit
+ */
+static int32_t PowerLimit_Follow(int32_t limit, int32_t target, uint32_t milliSeconds) {
+	int64_t rise = (int64_t)POWER_LIMIT_RISE_RATE * milliSeconds / 1000;
+	if (target > limit + rise) {
+		return limit + (int32_t)rise;
+	}
+	return target;
+}
+
+/** PowerLimit_GetHottest
+ * Finds the hottest plausible sensor, counting one that is heating up fast at what it will read
+ * in TEMP_PREDICT_HORIZON_S. Modules without a plausible sensor count at their estimate.
+ * @return mC
+ */
+static int32_t PowerLimit_GetHottest(void) {
+	int32_t hottest = INT32_MIN;
+	for (int sensor = 0; sensor < NUM_TEMPERATURE_SENSORS; sensor++) {
+		if (Temperature_GetSensorFaults(sensor) != 0) {
+			continue;
+		}
+		int32_t temperature = Temperature_GetSensorTemperature(sensor);
+		int32_t slope = Temperature_GetSensorSlope(sensor);
+		if (slope >= TEMP_PREDICT_MIN_SLOPE) {
+			temperature += slope * TEMP_PREDICT_HORIZON_S;
+		}
+		hottest = temperature > hottest ? temperature : hottest;
+	}
+	for (int module = 0; module < NUM_BATTERY_MODULES; module++) {
+		if (!Temperature_IsModuleCovered(module)) {
+			int32_t temperature = Temperature_GetModuleTemperature(module);
+			hottest = temperature > hottest ? temperature : hottest;
+		}
+	}
+	return hottest;
+}
+
+/** PowerLimit_Init
+ * Starts both limits at 0, they come up at POWER_LIMIT_RISE_RATE once the pack is measured.
+ * Call after Current_Init.
+ */
+void PowerLimit_Init(void) {
+	DischargeLimit = 0;
+	ChargeLimit = 0;
+	LastUpdate = Current_GetSampleTime();
+}
+
+/** PowerLimit_Update
+ * Works out both limits from the weakest module's voltage headroom, the hottest sensor and
+ * the state of charge. Only does the work every POWER_LIMIT_PERIOD_MS, one pass over the
+ * modules and sensors no matter what they read.
+ * @return true if the limits were updated and are due on CAN
+ */
+bool PowerLimit_Update(void) {
+	uint32_t time = Current_GetSampleTime();
+	uint32_t elapsed = time - LastUpdate;
+	if (elapsed < POWER_LIMIT_PERIOD_MS) {
+		return false;
+	}
+	LastUpdate = time;
+
+	// Weakest module both ways, at the voltage it would have with no current flowing
+	int32_t lowest = INT32_MAX;
+	int32_t highest = 0;
+	for (int i = 0; i < NUM_BATTERY_MODULES; i++) {
+		int32_t milliVolts = Voltage_GetModuleMillivoltage(i);
+		lowest = milliVolts < lowest ? milliVolts : lowest;
+		highest = milliVolts > highest ? milliVolts : highest;
+	}
+	int32_t drop = (int64_t)Current_GetLowPrecReading() * POWER_LIMIT_RESISTANCE / 1000000;
+	int32_t discharge = PowerLimit_FromVoltage(lowest + drop
+		- (int32_t)(MIN_VOLTAGE_LIMIT * MILLI_SCALING_FACTOR) - POWER_LIMIT_VOLTAGE_MARGIN, MAX_DISCHARGE);
+	int32_t charge = PowerLimit_FromVoltage((int32_t)(MAX_VOLTAGE_LIMIT * MILLI_SCALING_FACTOR)
+		- POWER_LIMIT_VOLTAGE_MARGIN - (highest + drop), MAX_CHARGE);
+
+	int32_t hottest = PowerLimit_GetHottest();
+	discharge = PowerLimit_Taper(discharge, (int32_t)(MAX_DISCHARGE_TEMPERATURE_LIMIT * MILLI_SCALING_FACTOR) - hottest,
+		POWER_LIMIT_TEMP_DERATE * MILLI_SCALING_FACTOR);
+	charge = PowerLimit_Taper(charge, (int32_t)(MAX_CHARGE_TEMPERATURE_LIMIT * MILLI_SCALING_FACTOR) - hottest,
+		POWER_LIMIT_TEMP_DERATE * MILLI_SCALING_FACTOR);
+
+	discharge = PowerLimit_Taper(discharge, ModuleCharge_GetPercent(ModuleCharge_GetLowest()), POWER_LIMIT_SOC_DERATE);
+	charge = PowerLimit_Taper(charge, 10000 - ModuleCharge_GetPercent(ModuleCharge_GetHighest()), POWER_LIMIT_SOC_DERATE);
+
+	if (Fuse_GetMargin(FUSE_DISCHARGE) < POWER_LIMIT_FUSE_MARGIN && discharge > FUSE_DISCHARGE_RATING) {
+		discharge = FUSE_DISCHARGE_RATING;
+	}
+	if (Fuse_GetMargin(FUSE_CHARGE) < POWER_LIMIT_FUSE_MARGIN && charge > FUSE_CHARGE_RATING) {
+		charge = FUSE_CHARGE_RATING;
+	}
+
+	DischargeLimit = PowerLimit_Follow(DischargeLimit, discharge, elapsed);
+	ChargeLimit = PowerLimit_Follow(ChargeLimit, charge, elapsed);
+	return true;
+}
+
+/** PowerLimit_GetDischarge
+ * Gets the most current that may be drawn from the pack
+ * @return milliamperes
+ */
+int32_t PowerLimit_GetDischarge(void) {
+	return DischargeLimit;
+}
+
+/** PowerLimit_GetCharge
+ * Gets the most current that may be pushed into the pack
+ * @return milliamperes, positive
+ */
+int32_t PowerLimit_GetCharge(void) {
+	return ChargeLimit;
+}
@@ -0,0 +1,111 @@
+/** Profiler.c
+ * Cycle count probes around the slow stages of the BPS. Recording a run is a handful of
+ * compares and adds, the histogram bucket comes from counting leading zeros so it costs
+ * the same for every run.
+ */
+
+#include "Profiler.h"
+
+static const char *Names[NUM_PROBES] = {
+	"current",
+	"checks",
+	"voltage",
+	"temp channel",
+	"temp scan",
+	"temp all",
+	"charge",
+	"eeprom log",
+	"cli",
+};
+
+#if PROFILER_ENABLED
+static ProfilerStats Stats[NUM_PROBES];
+#endif
+
+/** Profiler_Record
+ * Adds a run of a stage. Use PROFILE_BEGIN and PROFILE_END instead.
+ * @param probe of the stage
+ * @param cycles the run took
+ */
+void Profiler_Record(ProfilerProbe probe, uint32_t cycles) {
+#if PROFILER_ENABLED
+	ProfilerStats *stats = &Stats[probe];
+	if (stats->count == 0 || cycles < stats->min) {
+		stats->min = cycles;
+	}
+	if (cycles > stats->max) {
+		stats->max = cycles;
+	}
+	stats->count++;
+	stats->sum += cycles;
+
+	uint32_t scaled = cycles >> PROFILER_BUCKET_SHIFT;
+	uint32_t bucket = scaled ? 32 - __builtin_clz(scaled) : 0;
+	stats->buckets[bucket < PROFILER_BUCKETS ? bucket : PROFILER_BUCKETS - 1]++;
+#endif
+}
+
+/** Profiler_Reset
+ * Forgets every run
+ */
+void Profiler_Reset(void) {
+#if PROFILER_ENABLED
+	memset(Stats, 0, sizeof(Stats));
+#endif
+}
+
+/** Profiler_GetStats
+ * @param probe of the stage
+ * @return runs so far, NULL if the probes are compiled out
+ */
+const ProfilerStats *Profiler_GetStats(ProfilerProbe probe) {
+#if PROFILER_ENABLED
+	return probe < NUM_PROBES ? &Stats[probe] : NULL;
+#else
+	return NULL;
+#endif
+}
+
+/** Profiler_GetName
+ * @param probe of the stage
+ * @return name for reports
+ */
+const char *Profiler_GetName(ProfilerProbe probe) {
+	return probe < NUM_PROBES ? Names[probe] : "";
+}
+
+/** Profiler_GetPercentile
+ * Finds the histogram bucket the given share of the runs fits under
+ * @param probe of the stage
+ * @param percent of the runs, 1 to 100
+ * @return upper end of that bucket in cycles, UINT32_MAX for the last bucket and 0 without runs
+ */
+uint32_t Profiler_GetPercentile(ProfilerProbe probe, uint8_t percent) {
+	const ProfilerStats *stats = Profiler_GetStats(probe);
+	if (stats == NULL || stats->count == 0) {
+		return 0;
+	}
+
+	// Runs that have to fit, rounded up
+	uint64_t needed = ((uint64_t)stats->count * percent + 99) / 100;
+	uint64_t runs = 0;
+	for (uint8_t i = 0; i < PROFILER_BUCKETS - 1; i++) {
+		runs += stats->buckets[i];
+		if (runs >= needed) {
+			return 1UL << (PROFILER_BUCKET_SHIFT + i);
+		}
+	}
+	return UINT32_MAX;
+}
+
+/** Profiler_ToMicroseconds
+ * @param cycles counted by a probe
+ * @return microseconds
+ */
+uint32_t Profiler_ToMicroseconds(uint32_t cycles) {
+#ifdef SIMULATION
+	return cycles / 1000;		// The simulator counts nanoseconds
+#else
+	return cycles / (BSP_Timer_GetRunFreq() / 1000000);
+#endif
+}
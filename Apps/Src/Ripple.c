@@ -0,0 +1,228 @@
+/** Ripple.c
+ * Spectral analysis of the pack current. Blocks of RIPPLE_FFT_SIZE raw high precision
+ * conversions are captured back to back by the ADC. Each block has its average taken out
+ * for the ripple RMS, then goes through a Hann window and a real FFT for the strongest
+ * frequency. The STM32 uses the CMSIS DSP library, other builds a plain C FFT with the
+ * same output layout.
+ */
+
+#include "Ripple.h"
+#include "BSP_ADC.h"
+#include "BSP_Timer.h"
+#ifdef ARM_MATH_CM4
+#include "arm_math.h"
+#endif
+
+#if (RIPPLE_FFT_SIZE % ADC_BLOCK_SIZE != 0) || (RIPPLE_FFT_SIZE & (RIPPLE_FFT_SIZE - 1)) != 0
+#error "RIPPLE_FFT_SIZE must be a power of 2 and a multiple of ADC_BLOCK_SIZE"
+#endif
+
+#define RIPPLE_BINS			(RIPPLE_FFT_SIZE / 2)
+
+// Milliamps per code of the high precision sensor, same gains as Current_Conversion
+#define RIPPLE_MA_PER_CODE	((3300.0f / 4096) * 3 * (50 / 4))
+#define RIPPLE_MAX_CODE		4095
+#define RIPPLE_PI			3.14159265f
+
+static uint16_t Capture[RIPPLE_FFT_SIZE];
+static float Samples[RIPPLE_FFT_SIZE];
+static float Window[RIPPLE_FFT_SIZE];
+
+// Real FFT output: [0] DC, [1] Nyquist, then real and imaginary of bins 1 to RIPPLE_BINS - 1
+static float Spectrum[RIPPLE_FFT_SIZE];
+
+static uint32_t RMS;
+static uint32_t Frequency;
+static uint32_t Cycles;
+static uint32_t MaxCycles;
+
+#ifdef ARM_MATH_CM4
+static arm_rfft_fast_instance_f32 FFT;
+static float Power[RIPPLE_BINS];
+#else
+static float FFTReal[RIPPLE_FFT_SIZE];
+static float FFTImag[RIPPLE_FFT_SIZE];
+static float Cosine[RIPPLE_BINS];
+static float Sine[RIPPLE_BINS];
+#endif
+
+/** Ripple_TransformInit
+ * Sets up the FFT for RIPPLE_FFT_SIZE samples
+ */
+static void Ripple_TransformInit(void) {
+#ifdef ARM_MATH_CM4
+	arm_rfft_fast_init_f32(&FFT, RIPPLE_FFT_SIZE);
+#else
+	for (int k = 0; k < RIPPLE_BINS; k++) {
+		Cosine[k] = cosf(2 * RIPPLE_PI * k / RIPPLE_FFT_SIZE);
+		Sine[k] = sinf(2 * RIPPLE_PI * k / RIPPLE_FFT_SIZE);
+	}
+#endif
+}
+
+/** Ripple_Transform
+ * Runs the real FFT of Samples into Spectrum. Samples is overwritten.
+ */
+static void Ripple_Transform(void) {
+#ifdef ARM_MATH_CM4
+	arm_rfft_fast_f32(&FFT, Samples, Spectrum, 0);
+#else
+	// Radix-2 decimation in time, starting from bit reversed order
+	for (int i = 0; i < RIPPLE_FFT_SIZE; i++) {
+		int reversed = 0;
+		for (int bit = 1, rbit = RIPPLE_FFT_SIZE >> 1; bit < RIPPLE_FFT_SIZE; bit <<= 1, rbit >>= 1) {
+			if (i & bit) {
+				reversed |= rbit;
+			}
+		}
+		FFTReal[reversed] = Samples[i];
+		FFTImag[reversed] = 0;
+	}
+
+	for (int size = 2; size <= RIPPLE_FFT_SIZE; size <<= 1) {
+		int half = size / 2;
+		int step = RIPPLE_FFT_SIZE / size;
+		for (int start = 0; start < RIPPLE_FFT_SIZE; start += size) {
+			for (int k = 0; k < half; k++) {
+				float wr = Cosine[k * step];
+				float wi = -Sine[k * step];
+				int a = start + k;
+				int b = a + half;
+				float tr = wr * FFTReal[b] - wi * FFTImag[b];
+				float ti = wr * FFTImag[b] + wi * FFTReal[b];
+				FFTReal[b] = FFTReal[a] - tr;
+				FFTImag[b] = FFTImag[a] - ti;
+				FFTReal[a] += tr;
+				FFTImag[a] += ti;
+			}
+		}
+	}
+
+	Spectrum[0] = FFTReal[0];
+	Spectrum[1] = FFTReal[RIPPLE_BINS];
+	for (int k = 1; k < RIPPLE_BINS; k++) {
+		Spectrum[2 * k] = FFTReal[k];
+		Spectrum[2 * k + 1] = FFTImag[k];
+	}
+#endif
+}
+
+/** Ripple_StrongestBin
+ * Finds the bin of Spectrum with the most power, DC and Nyquist left out
+ * @return bin index from 1 to RIPPLE_BINS - 1
+ */
+static uint32_t Ripple_StrongestBin(void) {
+#ifdef ARM_MATH_CM4
+	float32_t max;
+	uint32_t idx;
+	arm_cmplx_mag_squared_f32(&Spectrum[2], Power, RIPPLE_BINS - 1);
+	arm_max_f32(Power, RIPPLE_BINS - 1, &max, &idx);
+	return idx + 1;
+#else
+	float max = -1;
+	uint32_t bin = 1;
+	for (int k = 1; k < RIPPLE_BINS; k++) {
+		float power = Spectrum[2 * k] * Spectrum[2 * k] + Spectrum[2 * k + 1] * Spectrum[2 * k + 1];
+		if (power > max) {
+			max = power;
+			bin = k;
+		}
+	}
+	return bin;
+#endif
+}
+
+/** Ripple_Init
+ * Starts collecting the first block of samples. Call after Current_Init.
+ */
+void Ripple_Init(void) {
+	// Hann window keeps a strong tone from leaking into the bins around it
+	for (int i = 0; i < RIPPLE_FFT_SIZE; i++) {
+		Window[i] = 0.5f - 0.5f * cosf(2 * RIPPLE_PI * i / RIPPLE_FFT_SIZE);
+	}
+	Ripple_TransformInit();
+
+	RMS = 0;
+	Frequency = 0;
+	Cycles = 0;
+	MaxCycles = 0;
+	BSP_ADC_StartCapture(Capture, RIPPLE_FFT_SIZE);
+}
+
+/** Ripple_Update
+ * Analyses a complete block of samples and starts the next one. Does nothing while the block
+ * is still filling up. A block where the high precision sensor saturated is thrown away.
+ * The analysis always takes the same work, see Ripple_GetCycles.
+ * @return true if there are new results
+ */
+bool Ripple_Update(void) {
+	if (!BSP_ADC_IsCaptureDone()) {
+		return false;
+	}
+
+	uint32_t start = BSP_Timer_GetCycleCount();
+
+	bool saturated = false;
+	float mean = 0;
+	for (int i = 0; i < RIPPLE_FFT_SIZE; i++) {
+		saturated |= Capture[i] == 0 || Capture[i] >= RIPPLE_MAX_CODE;
+		Samples[i] = Capture[i] * RIPPLE_MA_PER_CODE;
+		mean += Samples[i];
+	}
+
+	// The next block fills up while this one is analysed
+	BSP_ADC_StartCapture(Capture, RIPPLE_FFT_SIZE);
+	if (saturated) {
+		return false;
+	}
+
+	mean /= RIPPLE_FFT_SIZE;
+	float power = 0;
+	for (int i = 0; i < RIPPLE_FFT_SIZE; i++) {
+		float ripple = Samples[i] - mean;
+		power += ripple * ripple;
+		Samples[i] = ripple * Window[i];
+	}
+	RMS = sqrtf(power / RIPPLE_FFT_SIZE);
+
+	Ripple_Transform();
+	Frequency = (Ripple_StrongestBin() * ADC_SAMPLE_RATE_HZ) / RIPPLE_FFT_SIZE;
+
+	Cycles = BSP_Timer_GetCycleCount() - start;
+	if (Cycles > MaxCycles) {
+		MaxCycles = Cycles;
+	}
+	return true;
+}
+
+/** Ripple_GetRMS
+ * Gets the RMS of the current around its average over the last block
+ * @return milliamperes
+ */
+uint32_t Ripple_GetRMS(void) {
+	return RMS;
+}
+
+/** Ripple_GetFrequency
+ * Gets the frequency with the most ripple in the last block, DC left out
+ * @return Hz, to within ADC_SAMPLE_RATE_HZ / RIPPLE_FFT_SIZE
+ */
+uint32_t Ripple_GetFrequency(void) {
+	return Frequency;
+}
+
+/** Ripple_GetCycles
+ * Gets how long the last analysis took
+ * @return CPU cycles (nanoseconds on the simulator)
+ */
+uint32_t Ripple_GetCycles(void) {
+	return Cycles;
+}
+
+/** Ripple_GetMaxCycles
+ * Gets the longest any analysis took since Ripple_Init
+ * @return CPU cycles (nanoseconds on the simulator)
+ */
+uint32_t Ripple_GetMaxCycles(void) {
+	return MaxCycles;
+}
@@ -0,0 +1,174 @@
+/** SPILink.c
+ * isoSPI link rate manager. Every chain starts at the rate stored in the EEPROM. A rate that
+ * stays under SPILINK_MAX_ERRORS PEC errors for SPILINK_PROBE_WINDOWS windows is saved and the
+ * next faster rate is tried. Too many errors drop the chain one rate right away, and a rate that
+ * failed is tried again less often every time it fails. The EEPROM write is left to
+ * SPILink_Save, so the scans never wait for the EEPROM.
+ */
+
+#include "SPILink.h"
+#include "EEPROM.h"
+
+// Stored rates are tagged so a blank EEPROM (0x00 or 0xFF) is not taken for SPI_SPEED_156K
+#define SPILINK_EEPROM_TAG		0xA0
+#define SPILINK_EEPROM_MASK		0xF0
+
+typedef struct {
+	SPI_Speed speed;			// Rate the chain runs at
+	SPI_Speed stored;			// Fastest stable rate, to be saved in the EEPROM
+	SPI_Speed saved;			// Rate in the EEPROM
+	bool probing;				// speed is a faster rate that has not proven itself yet
+	uint8_t scans;				// Scans in the current window
+	uint16_t errors;			// PEC errors in the current window
+	uint16_t cleanWindows;		// Windows in a row without too many errors
+	uint16_t holdWindows;		// Clean windows needed before the next try
+} LinkState;
+
+static cell_asic *Minions;
+static LinkState Links[NUM_CHAINS];
+static uint16_t LastPecCount[NUM_MINIONS];
+
+/** SPILink_SetSpeed
+ * Changes the rate of a chain and starts a new window
+ * @param chain daisy chain
+ * @param speed new rate
+ */
+static void SPILink_SetSpeed(SPI_Chain chain, SPI_Speed speed) {
+	Links[chain].speed = speed;
+	Links[chain].scans = 0;
+	Links[chain].errors = 0;
+	Links[chain].cleanWindows = 0;
+	BSP_SPI_SetSpeed(chain, speed);
+}
+
+/** SPILink_CountErrors
+ * Gets the PEC errors the boards of a chain have seen since the last call
+ * @param chain daisy chain
+ * @return number of new PEC errors
+ */
+static uint16_t SPILink_CountErrors(SPI_Chain chain) {
+	uint16_t errors = 0;
+	for(int board = chain * NUM_MINIONS_PER_CHAIN; board < (chain + 1) * NUM_MINIONS_PER_CHAIN; board++) {
+		// The counters wrap around, the unsigned difference is still correct
+		errors += (uint16_t)(Minions[board].crc_count.pec_count - LastPecCount[board]);
+		LastPecCount[board] = Minions[board].crc_count.pec_count;
+	}
+	return errors;
+}
+
+/** SPILink_Init
+ * Sets every chain to the rate stored in the EEPROM, or SPI_SPEED_DEFAULT if nothing is stored.
+ * Call after the LTC6811s and the EEPROM are initialized.
+ * @param boards LTC6811 data structure that holds the PEC error counters
+ */
+void SPILink_Init(cell_asic *boards) {
+	Minions = boards;
+
+	for(int board = 0; board < NUM_MINIONS; board++) {
+		LastPecCount[board] = Minions[board].crc_count.pec_count;
+	}
+
+	for(int chain = 0; chain < NUM_CHAINS; chain++) {
+		uint8_t saved = EEPROM_ReadByte(EEPROM_SPI_SPEED_LOC + chain);
+		SPI_Speed speed = SPI_SPEED_DEFAULT;
+		if((saved & SPILINK_EEPROM_MASK) == SPILINK_EEPROM_TAG
+			&& (saved & ~SPILINK_EEPROM_MASK) < NUM_SPI_SPEEDS) {
+			speed = (SPI_Speed)(saved & ~SPILINK_EEPROM_MASK);
+		}
+		if(speed > SPILINK_MAX_SPEED) {
+			speed = SPILINK_MAX_SPEED;
+		}
+
+		Links[chain].stored = speed;
+		Links[chain].saved = speed;
+		Links[chain].probing = false;
+		Links[chain].holdWindows = SPILINK_PROBE_WINDOWS;
+		SPILink_SetSpeed(chain, speed);
+	}
+}
+
+/** SPILink_Update
+ * Counts the PEC errors of the last scan and lowers or raises the rate of each chain.
+ * Call once after every Voltage and Temperature update.
+ */
+void SPILink_Update(void) {
+	for(int chain = 0; chain < NUM_CHAINS; chain++) {
+		LinkState *link = &Links[chain];
+		link->errors += SPILink_CountErrors(chain);
+
+		// Too many errors, slow down right away
+		if(link->errors > SPILINK_MAX_ERRORS) {
+			if(link->probing) {
+				// The faster rate did not work out, wait longer before the next try
+				link->probing = false;
+				link->holdWindows *= 2;
+				if(link->holdWindows > SPILINK_MAX_HOLD_WINDOWS) {
+					link->holdWindows = SPILINK_MAX_HOLD_WINDOWS;
+				}
+			}
+			if(link->speed > SPI_SPEED_156K) {
+				SPILink_SetSpeed(chain, link->speed - 1);
+			} else {
+				SPILink_SetSpeed(chain, link->speed);
+			}
+			continue;
+		}
+
+		if(++link->scans < SPILINK_WINDOW_SCANS) {
+			continue;
+		}
+
+		// Clean window
+		link->scans = 0;
+		link->errors = 0;
+		if(++link->cleanWindows < link->holdWindows) {
+			continue;
+		}
+
+		// The rate is stable, SPILink_Save writes it to the EEPROM
+		if(link->probing) {
+			link->probing = false;
+			link->holdWindows = SPILINK_PROBE_WINDOWS;
+		}
+		link->stored = link->speed;
+
+		if(link->speed < SPILINK_MAX_SPEED) {
+			link->probing = true;
+			SPILink_SetSpeed(chain, link->speed + 1);
+		} else {
+			link->cleanWindows = 0;
+		}
+	}
+}
+
+/** SPILink_Save
+ * Writes the stable rate of every chain to the EEPROM if it changed since the last write.
+ * Call from the thread that holds the EEPROM.
+ */
+void SPILink_Save(void) {
+	for(int chain = 0; chain < NUM_CHAINS; chain++) {
+		SPI_Speed stored = Links[chain].stored;
+		if(stored != Links[chain].saved) {
+			EEPROM_WriteByte(EEPROM_SPI_SPEED_LOC + chain, SPILINK_EEPROM_TAG | stored);
+			Links[chain].saved = stored;
+		}
+	}
+}
+
+/** SPILink_GetSpeed
+ * Gets the rate a chain is running at
+ * @param chain daisy chain
+ * @return current rate
+ */
+SPI_Speed SPILink_GetSpeed(SPI_Chain chain) {
+	return Links[chain].speed;
+}
+
+/** SPILink_GetStoredSpeed
+ * Gets the fastest rate that was stable long enough to be saved to the EEPROM by SPILink_Save
+ * @param chain daisy chain
+ * @return stored rate
+ */
+SPI_Speed SPILink_GetStoredSpeed(SPI_Chain chain) {
+	return Links[chain].stored;
+}
@@ -0,0 +1,153 @@
+/** Scheduler.c
+ * Time-triggered scheduler on CMSIS-RTOS threads. Each task keeps its next release on the 1ms
+ * system tick and sleeps in its own thread until then. The thread runs the task to completion
+ * and moves its release on by one period, so a late run does not shift the releases after it.
+ * A task that is still late by a whole period skips the releases it missed instead of
+ * running back to back to catch up. Priorities follow the task table, the first task gets
+ * osPriorityRealtime and each one after it a level less, down to osPriorityLow.
+ */
+
+#include "Scheduler.h"
+#include "Trace.h"
+#include "Counters.h"
+#include "BSP_Timer.h"
+#include "cmsis_os.h"
+
+static const SchedulerTask *Tasks;
+static uint8_t NumTasks;
+static uint32_t Release[SCHED_MAX_TASKS];		// Next release (tick)
+static SchedulerStats Stats[SCHED_MAX_TASKS];
+static volatile bool Active[SCHED_MAX_TASKS];	// Thread is running its task
+static volatile bool Stopped;
+static volatile uint32_t Generation;			// Threads of an earlier Scheduler_Start end
+
+osMessageQDef(StopQueue, 1, uint32_t);
+static osMessageQId StopQueue;
+
+/** Scheduler_Thread
+ * Runs one task on its releases until a task asks for a trip
+ * @param argument index of the task in the table
+ */
+static void Scheduler_Thread(void const *argument) {
+	uint8_t i = (uintptr_t)argument;
+	uint32_t generation = Generation;
+
+	while (1) {
+		// osDelay may end a tick early, check again before running
+		int32_t wait = (int32_t)(Release[i] - BSP_Timer_GetTick());
+		if (wait > 0 && generation == Generation) {
+			osDelay(wait);
+			continue;
+		}
+
+		// Marked before checking so Scheduler_Run cannot miss a run that is starting
+		Active[i] = true;
+		if (Stopped || generation != Generation) {
+			Active[i] = false;
+			break;
+		}
+
+		uint32_t start = BSP_Timer_GetTick();
+		TRACE_BEGIN(TRACE_TASK, i);
+		bool keepRunning = Tasks[i].run();
+		TRACE_END(TRACE_TASK, i);
+		uint32_t end = BSP_Timer_GetTick();
+
+		SchedulerStats *stats = &Stats[i];
+		uint32_t jitter = start - Release[i];
+		uint32_t runtime = end - start;
+		stats->runs++;
+		stats->jitterSum += jitter;
+		stats->maxJitter = jitter > stats->maxJitter ? jitter : stats->maxJitter;
+		stats->maxRuntime = runtime > stats->maxRuntime ? runtime : stats->maxRuntime;
+		if (end - Release[i] > Tasks[i].deadline) {
+			stats->misses++;
+			COUNTER_INC(COUNTER_TASK_OVERRUNS);
+		}
+
+		Release[i] += Tasks[i].period;
+		while ((int32_t)(end - Release[i]) >= (int32_t)Tasks[i].period) {
+			Release[i] += Tasks[i].period;
+			stats->skipped++;
+			COUNTER_INC(COUNTER_TASK_SKIPS);
+		}
+		Active[i] = false;
+
+		if (!keepRunning) {
+			Stopped = true;
+			osMessagePut(StopQueue, i, 0);
+		}
+	}
+	osThreadTerminate(osThreadGetId());
+}
+
+/** Scheduler_Init
+ * Takes the task table. The table has to stay around while the scheduler runs.
+ * @param tasks in order of priority, highest first
+ * @param count number of tasks, at most SCHED_MAX_TASKS
+ */
+void Scheduler_Init(const SchedulerTask *tasks, uint8_t count) {
+	Tasks = tasks;
+	NumTasks = count < SCHED_MAX_TASKS ? count : SCHED_MAX_TASKS;
+	if (StopQueue == NULL) {
+		StopQueue = osMessageCreate(osMessageQ(StopQueue), NULL);
+	}
+}
+
+/** Scheduler_Start
+ * Starts a thread per task and releases every task for the first time after its offset.
+ * The kernel has to be running.
+ */
+void Scheduler_Start(void) {
+	Generation++;
+	Stopped = false;
+	while (osMessageGet(StopQueue, 0).status == osEventMessage);
+
+	uint32_t now = BSP_Timer_GetTick();
+	for (uint8_t i = 0; i < NumTasks; i++) {
+		Release[i] = now + Tasks[i].offset;
+		memset(&Stats[i], 0, sizeof(Stats[i]));
+		Active[i] = false;
+	}
+	for (uint8_t i = 0; i < NumTasks; i++) {
+		int32_t priority = osPriorityRealtime - i;
+		osThreadDef_t thread = {
+			Scheduler_Thread,
+			priority > osPriorityLow ? (osPriority)priority : osPriorityLow,
+			1,
+			SCHED_STACK_SIZE
+		};
+		osThreadCreate(&thread, (void *)(uintptr_t)i);
+	}
+}
+
+/** Scheduler_Run
+ * Waits until a task asks for a trip and the runs under way are done. The task threads end
+ * at their next release.
+ */
+void Scheduler_Run(void) {
+	osMessageGet(StopQueue, osWaitForever);
+	for (uint8_t i = 0; i < NumTasks; i++) {
+		while (Active[i]) {
+			osDelay(1);
+		}
+	}
+}
+
+/** Scheduler_GetStats
+ * Gets the deadline and jitter statistics of a task
+ * @param task index in the task table
+ * @return statistics since Scheduler_Start
+ */
+const SchedulerStats *Scheduler_GetStats(uint8_t task) {
+	return &Stats[task];
+}
+
+/** Scheduler_GetTask
+ * Gets a task of the table
+ * @param task index in the task table
+ * @return task, NULL past the end of the table
+ */
+const SchedulerTask *Scheduler_GetTask(uint8_t task) {
+	return task < NumTasks ? &Tasks[task] : NULL;
+}
@@ -0,0 +1,69 @@
+/** Supervisor.c
+ * Liveness supervision of the scheduler tasks. The tokens of a task follow a fixed sequence,
+ * so a task that checks in from the wrong place, twice, or with a corrupted token is caught
+ * as well as one that stops checking in.
+ */
+
+#include "Supervisor.h"
+#include "BSP_Timer.h"
+
+static const uint32_t *MaxIntervals;
+static uint8_t NumTasks;
+static uint32_t Expected[SCHED_MAX_TASKS];		// Token of the next check-in
+static uint32_t LastCheckIn[SCHED_MAX_TASKS];	// Tick
+static bool BadToken[SCHED_MAX_TASKS];
+
+/** Supervisor_Init
+ * Starts watching the tasks, every interval starts now. The table has to stay around.
+ * @param maxIntervals longest each task may go between check-ins (ms), 0 leaves a task out
+ * @param count number of tasks, at most SCHED_MAX_TASKS
+ */
+void Supervisor_Init(const uint32_t *maxIntervals, uint8_t count) {
+	MaxIntervals = maxIntervals;
+	NumTasks = count < SCHED_MAX_TASKS ? count : SCHED_MAX_TASKS;
+
+	uint32_t now = BSP_Timer_GetTick();
+	for (uint8_t i = 0; i < NumTasks; i++) {
+		Expected[i] = 0;
+		LastCheckIn[i] = now;
+		BadToken[i] = false;
+	}
+}
+
+/** Supervisor_CheckIn
+ * Tells the supervisor a task is alive and got its work done
+ * @param task index in the task table
+ * @param token the last check-in of the task returned, 0 the first time
+ * @return token for the next check-in
+ */
+uint32_t Supervisor_CheckIn(uint8_t task, uint32_t token) {
+	if (task >= NumTasks) {
+		return 0;
+	}
+	if (token != Expected[task]) {
+		BadToken[task] = true;
+	}
+	LastCheckIn[task] = BSP_Timer_GetTick();
+
+	// Next in the sequence, a linear congruential step so a stuck or zeroed token fails
+	Expected[task] = Expected[task] * 1664525 + 1013904223;
+	return Expected[task];
+}
+
+/** Supervisor_Check
+ * Looks for a task that went past its interval or checked in with the wrong token.
+ * A wrong token stays an offence until Supervisor_Init.
+ * @return index of the first offending task, SUPERVISOR_HEALTHY if there is none
+ */
+uint8_t Supervisor_Check(void) {
+	uint32_t now = BSP_Timer_GetTick();
+	for (uint8_t i = 0; i < NumTasks; i++) {
+		if (MaxIntervals[i] == 0) {
+			continue;
+		}
+		if (BadToken[i] || now - LastCheckIn[i] > MaxIntervals[i]) {
+			return i;
+		}
+	}
+	return SUPERVISOR_HEALTHY;
+}
@@ -3,17 +3,50 @@
  * battery pack.
  */
 #include "Temperature.h"
+#include "ThermistorLUT.h"
+#include "ThermalModel.h"
 
 // Holds the temperatures in Celsius (Fixed Point with .001 resolution) for each sensor on each board
 int32_t ModuleTemperatures[NUM_MINIONS][MAX_TEMP_SENSORS_PER_MINION_BOARD];
 
+// Raw GPIO1 readings (100uV per code) behind ModuleTemperatures, used by the plausibility checks
+static uint16_t ModuleCodes[NUM_MINIONS][MAX_TEMP_SENSORS_PER_MINION_BOARD];
+
+// LTC6811 die temperatures in mC. A board whose status register came back with a PEC error
+// is left out of the die check until the next good read.
+static int32_t DieTemperatures[NUM_MINIONS];
+static bool DieValid[NUM_MINIONS];
+
+// Plausibility checks each sensor failed on the last scan (TEMP_FAULT_*)
+static uint8_t SensorFaults[NUM_TEMPERATURE_SENSORS];
+static uint16_t LastCode[NUM_TEMPERATURE_SENSORS];
+static uint16_t StuckScans[NUM_TEMPERATURE_SENSORS];
+
 // 0 if discharging 1 if charging
 static uint8_t ChargingState;
 
+// Last TEMP_SLOPE_WINDOW readings of every sensor for the dT/dt estimate. The window sums are
+// updated as samples come and go so the slopes cost the same no matter how long the window is.
+// x is the age of a sample in the window, the oldest sample has x = 0.
+#define SLOPE_SUM_X		((TEMP_SLOPE_WINDOW - 1) * TEMP_SLOPE_WINDOW / 2)
+#define SLOPE_SUM_XX	((TEMP_SLOPE_WINDOW - 1) * TEMP_SLOPE_WINDOW * (2 * TEMP_SLOPE_WINDOW - 1) / 6)
+#define SLOPE_DENOM		(TEMP_SLOPE_WINDOW * SLOPE_SUM_XX - SLOPE_SUM_X * SLOPE_SUM_X)
+#define PREDICT_HORIZON_SCANS	((TEMP_PREDICT_HORIZON_S * 1000) / TEMPERATURE_SCAN_PERIOD_MS)
+
+static int32_t TemperatureHistory[NUM_TEMPERATURE_SENSORS][TEMP_SLOPE_WINDOW];
+static int32_t HistorySum[NUM_TEMPERATURE_SENSORS];			// sum of y
+static int32_t HistoryWeightedSum[NUM_TEMPERATURE_SENSORS];	// sum of x * y
+static uint8_t HistoryOldest;		// Index of the oldest sample once the window is full
+static uint8_t HistoryCount;		// Number of samples in the window
+
 // Interface to communicate with LTC6811 (Register values)
 // Temperature.c uses auxiliary registers to view ADC data and COM register for I2C with LTC1380 MUX
 static cell_asic *Minions;
 
+static void Temperature_UpdateSlopes(void);
+static ErrorStatus Temperature_UpdateDieTemperatures(void);
+static void Temperature_CheckPlausibility(void);
+
 /** Temperature_Init
  * Initializes device drivers including SPI inside LTC6811_init and LTC6811 for Temperature Monitoring
  * @param boards LTC6811 data structure that contains the values of each register
@@ -23,19 +56,39 @@ ErrorStatus Temperature_Init(cell_asic *boards){
 	Minions = boards;
 
 	// Initialize peripherals
-	wakeup_sleep(NUM_MINIONS);
+	wakeup_sleep_chains(NUM_MINIONS_PER_CHAIN);
 	LTC6811_Init(Minions);
 
 	// Write Configuration Register
-	LTC6811_wrcfg(NUM_MINIONS, Minions);
+	for(int chain = 0; chain < NUM_CHAINS; chain++){
+		LTC6811_SelectChain(chain);
+		LTC6811_wrcfg(NUM_MINIONS_PER_CHAIN, &Minions[chain * NUM_MINIONS_PER_CHAIN]);
+	}
 
 	// Read Configuration Register
-	wakeup_sleep(NUM_MINIONS);
-	int8_t error = LTC6811_rdcfg(NUM_MINIONS, Minions);
+	wakeup_sleep_chains(NUM_MINIONS_PER_CHAIN);
+	int8_t error = 0;
+	for(int chain = 0; chain < NUM_CHAINS; chain++){
+		LTC6811_SelectChain(chain);
+		error |= LTC6811_rdcfg(NUM_MINIONS_PER_CHAIN, &Minions[chain * NUM_MINIONS_PER_CHAIN]);
+	}
 
 	return error == 0 ? SUCCESS : ERROR;
 }
 
+/** Temperature_SendComm
+ * Writes the COMM register of every board and clocks the I2C transaction out to the MUXs.
+ * Each daisy chain gets the part of Minions that belongs to it.
+ */
+static void Temperature_SendComm(void) {
+	wakeup_sleep_chains(NUM_MINIONS_PER_CHAIN);
+	for(int chain = 0; chain < NUM_CHAINS; chain++){
+		LTC6811_SelectChain(chain);
+		LTC6811_wrcomm(NUM_MINIONS_PER_CHAIN, &Minions[chain * NUM_MINIONS_PER_CHAIN]);
+		LTC6811_stcomm();
+	}
+}
+
 /** Temperature_ChannelConfig
  * Configures which temperature channel you're sampling from in every board
  * Assumes there are only 2 muxes; 0 index based - 0 is sensor 1
@@ -86,9 +139,7 @@ ErrorStatus Temperature_ChannelConfig(uint8_t tempChannel) {
     }
 
     // Send data
-    wakeup_sleep(NUM_MINIONS);
-    LTC6811_wrcomm(NUM_MINIONS, Minions);
-    LTC6811_stcomm();
+    Temperature_SendComm();
         
 	for (int board = 0; board < NUM_MINIONS; board++) {
 		/* Open channel on mux */
@@ -110,29 +161,23 @@ ErrorStatus Temperature_ChannelConfig(uint8_t tempChannel) {
     }
 
     // Send data
-    wakeup_sleep(NUM_MINIONS);
-    LTC6811_wrcomm(NUM_MINIONS, Minions);
-    LTC6811_stcomm();
+    Temperature_SendComm();
 
 	return SUCCESS;
 }
 
-/** convertVoltageToTemperature
- * Converts mv to temperature based on the temperature sensor equation
- * Equation : T(in C) = (((13.582 - sqrt((-13.582)*(-13.582) + 4 * 0.00433 * (2230.8 - milliVolt)))/ (2.0 * -0.00433)) + 30)
- * @param mV from ADC
- * @return temperature in Celsius (Fixed Point with .001 resolution) 
+/** Temperature_CodeToMilliCelsius
+ * Converts a GPIO1 reading to temperature with the sensor lookup table in ThermistorLUT.h.
+ * Interpolates between the two closest entries, no floating point math.
+ * @param adcCode LTC6811 auxiliary reading (100uV per code)
+ * @return temperature in Celsius (Fixed Point with .001 resolution)
  */
-int milliVoltToCelsius(float milliVolt){
-	// Typecasting to get rid of warnings
-	float sumInRt = (float)(-13.582)*(float)(-13.582) + (float)4.0 * (float)0.00433 * ((float)2230.8 - milliVolt);
-	float rt = sqrt(sumInRt);				
-	float numerator = (float)13.582 - rt;
-	float denom = (2.0 * - 0.00433);		
-	float frac = numerator/denom;			
-	float retVal = frac + 30;			
-	
-	return retVal * 1000;
+int32_t Temperature_CodeToMilliCelsius(uint16_t adcCode){
+	uint32_t idx = adcCode >> THERMISTOR_LUT_SHIFT;
+	int32_t frac = adcCode & (THERMISTOR_LUT_STEP - 1);
+	int32_t low = ThermistorLUT[idx];
+
+	return low + (((ThermistorLUT[idx + 1] - low) * frac) >> THERMISTOR_LUT_SHIFT);
 }
 
 /** Temperature_UpdateSingleChannel
@@ -146,17 +191,18 @@ ErrorStatus Temperature_UpdateSingleChannel(uint8_t channel){
 		return ERROR;
 	}
 	
-	// Sample ADC channel
-	Temperature_SampleADC(MD_422HZ_1KHZ);
+	// Sample ADC channel, a reading with a bad PEC is still stored but the update fails
+	ErrorStatus status = Temperature_SampleADC(MD_422HZ_1KHZ);
 	
 	// Convert to Celsius
 	for(int board = 0; board < NUM_MINIONS; board++) {
 		
 		// update adc value from GPIO1 stored in a_codes[0]; 
-		// a_codes[0] is fixed point with .001 resolution in volts -> multiply by .001 * 1000 to get mV in double form
-		ModuleTemperatures[board][channel] = milliVoltToCelsius(Minions[board].aux.a_codes[0]*0.1);
+		// a_codes[0] is fixed point with .0001 resolution in volts
+		ModuleCodes[board][channel] = Minions[board].aux.a_codes[0];
+		ModuleTemperatures[board][channel] = Temperature_CodeToMilliCelsius(Minions[board].aux.a_codes[0]);
 	}
-	return SUCCESS;
+	return status;
 }
 
 /** Temperature_UpdateAllMeasurements
@@ -164,14 +210,242 @@ ErrorStatus Temperature_UpdateSingleChannel(uint8_t channel){
  * @return SUCCESS or ERROR
  */
 ErrorStatus Temperature_UpdateAllMeasurements(){
+	ErrorStatus status = SUCCESS;
 	for (int sensorCh = 0; sensorCh < MAX_TEMP_SENSORS_PER_MINION_BOARD; sensorCh++) {
-		Temperature_UpdateSingleChannel(sensorCh);
+		if (Temperature_UpdateSingleChannel(sensorCh) != SUCCESS) {
+			status = ERROR;
+		}
 	}
-	return SUCCESS;
+	if (Temperature_FinishScan() != SUCCESS) {
+		status = ERROR;
+	}
+	return status;
+}
+
+/** Temperature_FinishScan
+ * Finishes a scan that was done one Temperature_UpdateSingleChannel at a time: measures the
+ * die temperatures and runs the plausibility checks and the dT/dt window on the new readings.
+ * Call once every channel has been updated, every TEMPERATURE_SCAN_PERIOD_MS.
+ * @return SUCCESS or ERROR if a die temperature came back with a bad PEC
+ */
+ErrorStatus Temperature_FinishScan(void) {
+	ErrorStatus status = Temperature_UpdateDieTemperatures();
+	Temperature_CheckPlausibility();
+	Temperature_UpdateSlopes();
+	return status;
+}
+
+/** Temperature_UpdateDieTemperatures
+ * Measures the internal die temperature of every LTC6811. Only ITMP is converted so this
+ * costs one conversion and one register read per chain, little next to the 16 mux channels.
+ * @return SUCCESS or ERROR
+ */
+static ErrorStatus Temperature_UpdateDieTemperatures(void) {
+	wakeup_sleep_chains(NUM_MINIONS_PER_CHAIN);
+	for(int chain = 0; chain < NUM_CHAINS; chain++){
+		LTC6811_SelectChain(chain);
+		LTC6811_adstat(MD_7KHZ_3KHZ, STAT_CH_ITEMP);
+	}
+	for(int chain = 0; chain < NUM_CHAINS; chain++){
+		LTC6811_SelectChain(chain);
+		LTC6811_pollAdc();
+	}
+
+	wakeup_sleep_chains(NUM_MINIONS_PER_CHAIN);
+	int8_t error = 0;
+	for(int chain = 0; chain < NUM_CHAINS; chain++){
+		LTC6811_SelectChain(chain);
+		error |= LTC6811_rdstat(1, NUM_MINIONS_PER_CHAIN, &Minions[chain * NUM_MINIONS_PER_CHAIN]);
+	}
+
+	for(int board = 0; board < NUM_MINIONS; board++) {
+		// ITMP is 7.5mV per Kelvin in 100uV steps
+		DieTemperatures[board] = (Minions[board].stat.stat_codes[1] * 40) / 3 - 273000;
+		DieValid[board] = Minions[board].stat.pec_match[0] == 0;
+	}
+	return error == 0 ? SUCCESS : ERROR;
+}
+
+/** Temperature_GetSensorCode
+ * Gets the raw reading of a sensor by its number in the pack
+ * @param sensor index of sensor in the pack
+ * @return GPIO1 reading (100uV per code)
+ */
+static uint16_t Temperature_GetSensorCode(uint8_t sensor) {
+	const SensorTap *tap = &SensorMap[sensor];
+	return ModuleCodes[tap->board][tap->mux * (MAX_TEMP_SENSORS_PER_MINION_BOARD / 2) + tap->channel];
+}
+
+/** Temperature_CheckPlausibility
+ * Runs the plausibility checks on every sensor. The range, stuck and die checks only need
+ * the sensor itself. The neighbour check then compares each sensor with the sensors on its
+ * own module and the modules next to it that passed those first checks. It uses the median
+ * so one hot module does not make the modules next to it look too cold, and a sensor has to
+ * be colder than the other sensors on its own module too.
+ */
+static void Temperature_CheckPlausibility(void) {
+	const uint8_t selfFaults = TEMP_FAULT_RANGE | TEMP_FAULT_STUCK | TEMP_FAULT_DIE;
+	const int32_t maxDiff = TEMP_NEIGHBOUR_MAX_DIFF * MILLI_SCALING_FACTOR;
+
+	for (int sensor = 0; sensor < NUM_TEMPERATURE_SENSORS; sensor++) {
+		uint16_t code = Temperature_GetSensorCode(sensor);
+		uint8_t board = SensorMap[sensor].board;
+		uint8_t faults = 0;
+
+		if (code < TEMP_SENSOR_MIN_MV * 10 || code > TEMP_SENSOR_MAX_MV * 10) {
+			faults |= TEMP_FAULT_RANGE;
+		}
+
+		// A real sensor always has a little noise on it, the exact same code for minutes is not
+		if (code != LastCode[sensor]) {
+			LastCode[sensor] = code;
+			StuckScans[sensor] = 0;
+		} else if (StuckScans[sensor] < TEMP_STUCK_SCANS) {
+			StuckScans[sensor]++;
+		}
+		if (StuckScans[sensor] >= TEMP_STUCK_SCANS) {
+			faults |= TEMP_FAULT_STUCK;
+		}
+
+		if (DieValid[board]
+			&& Temperature_GetSensorTemperature(sensor) < DieTemperatures[board] - TEMP_DIE_MAX_DIFF * MILLI_SCALING_FACTOR) {
+			faults |= TEMP_FAULT_DIE;
+		}
+
+		SensorFaults[sensor] = faults;
+	}
+
+	for (int sensor = 0; sensor < NUM_TEMPERATURE_SENSORS; sensor++) {
+		int module = SensorModule[sensor];
+		int32_t temperature = Temperature_GetSensorTemperature(sensor);
+		int32_t around[3 * NUM_TEMP_SENSORS_PER_MOD];
+		int count = 0;
+		bool colderThanModule = true;
+
+		for (int neighbour = module - 1; neighbour <= module + 1; neighbour++) {
+			if (neighbour < 0 || neighbour >= NUM_BATTERY_MODULES) {
+				continue;
+			}
+			for (int i = 0; i < NUM_TEMP_SENSORS_PER_MOD; i++) {
+				uint8_t other = ModuleSensors[neighbour][i];
+				if (other == sensor || (SensorFaults[other] & selfFaults) != 0) {
+					continue;
+				}
+				int32_t otherTemperature = Temperature_GetSensorTemperature(other);
+				if (neighbour == module && temperature >= otherTemperature - maxDiff) {
+					colderThanModule = false;
+				}
+
+				// Insertion sort, there are only a handful of sensors around
+				int pos = count++;
+				while (pos > 0 && around[pos - 1] > otherTemperature) {
+					around[pos] = around[pos - 1];
+					pos--;
+				}
+				around[pos] = otherTemperature;
+			}
+		}
+
+		if (count > 0 && colderThanModule && temperature < around[count / 2] - maxDiff) {
+			SensorFaults[sensor] |= TEMP_FAULT_NEIGHBOUR;
+		}
+	}
+}
+
+/** Temperature_IsModuleCovered
+ * Checks if a module has at least one plausible sensor left
+ * @precondition: moduleIdx must be < NUM_BATTERY_MODULES
+ * @param index of module (0-indexed based)
+ * @return true if the module is measured, false if it depends on the thermal model
+ */
+bool Temperature_IsModuleCovered(uint8_t moduleIdx) {
+	for (int i = 0; i < NUM_TEMP_SENSORS_PER_MOD; i++) {
+		if (SensorFaults[ModuleSensors[moduleIdx][i]] == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/** Temperature_UpdateSlopes
+ * Pushes the latest reading of every sensor into the dT/dt window. An implausible sensor
+ * repeats its last sample so a shorted or open reading does not show up as a slope later.
+ */
+static void Temperature_UpdateSlopes(void) {
+	uint8_t newestIdx = HistoryCount < TEMP_SLOPE_WINDOW
+		? HistoryCount - 1
+		: (HistoryOldest + TEMP_SLOPE_WINDOW - 1) % TEMP_SLOPE_WINDOW;
+
+	for (int sensor = 0; sensor < NUM_TEMPERATURE_SENSORS; sensor++) {
+		int32_t newest = Temperature_GetSensorTemperature(sensor);
+		if (SensorFaults[sensor] != 0 && HistoryCount > 0) {
+			newest = TemperatureHistory[sensor][newestIdx];
+		}
+
+		if (HistoryCount < TEMP_SLOPE_WINDOW) {
+			TemperatureHistory[sensor][HistoryCount] = newest;
+			HistoryWeightedSum[sensor] += HistoryCount * newest;
+			HistorySum[sensor] += newest;
+		} else {
+			// The oldest sample leaves and every other sample gets one step older
+			int32_t oldest = TemperatureHistory[sensor][HistoryOldest];
+			TemperatureHistory[sensor][HistoryOldest] = newest;
+			HistoryWeightedSum[sensor] += (TEMP_SLOPE_WINDOW - 1) * newest - (HistorySum[sensor] - oldest);
+			HistorySum[sensor] += newest - oldest;
+		}
+	}
+
+	if (HistoryCount < TEMP_SLOPE_WINDOW) {
+		HistoryCount++;
+	} else {
+		HistoryOldest = (HistoryOldest + 1) % TEMP_SLOPE_WINDOW;
+	}
+}
+
+/** Temperature_SlopeNumerator
+ * Least squares slope of a sensor's window, scaled by SLOPE_DENOM
+ * @param sensor index of sensor in the pack
+ * @return dT/dt in mC per scan * SLOPE_DENOM
+ */
+static int32_t Temperature_SlopeNumerator(uint8_t sensor) {
+	return TEMP_SLOPE_WINDOW * HistoryWeightedSum[sensor] - SLOPE_SUM_X * HistorySum[sensor];
+}
+
+/** Temperature_IsRisingToLimit
+ * Checks if a sensor is projected to reach the limit within TEMP_PREDICT_HORIZON_S
+ * @param sensor index of sensor in the pack
+ * @param temperatureLimit limit in mC
+ * @return true if the sensor should trip early
+ */
+static bool Temperature_IsRisingToLimit(uint8_t sensor, int32_t temperatureLimit) {
+	if (PREDICT_HORIZON_SCANS == 0 || HistoryCount < TEMP_SLOPE_WINDOW) {
+		return false;
+	}
+
+	// Compare scaled by SLOPE_DENOM to stay away from divisions
+	int64_t slope = Temperature_SlopeNumerator(sensor);
+	if (slope * 1000 < (int64_t)TEMP_PREDICT_MIN_SLOPE * TEMPERATURE_SCAN_PERIOD_MS * SLOPE_DENOM) {
+		return false;
+	}
+	int64_t headroom = temperatureLimit - Temperature_GetSensorTemperature(sensor);
+	return slope * PREDICT_HORIZON_SCANS >= headroom * SLOPE_DENOM;
+}
+
+/** Temperature_IsModuleEstimateUnsafe
+ * Checks a module that has no plausible sensor left against the thermal model
+ * @param module index of module
+ * @param temperatureLimit limit in mC
+ * @return true if the estimate is too old or its upper bound is over the limit
+ */
+static bool Temperature_IsModuleEstimateUnsafe(uint8_t module, int32_t temperatureLimit) {
+	return !ThermalModel_IsValid(module) || ThermalModel_GetUpperBound(module) > temperatureLimit;
 }
 
 /** Temperature_CheckStatus
- * Checks if all modules are safe
+ * Checks if all modules are safe. A sensor that is heating up fast enough to reach the
+ * limit within TEMP_PREDICT_HORIZON_S counts as unsafe too. Implausible sensors are
+ * ignored. A module that has no plausible sensor left is checked with the thermal model
+ * until its estimate gets too old.
  * @param 1 if pack is charging, 0 if discharging
  * @return SAFE or DANGER
  */
@@ -179,12 +453,19 @@ SafetyStatus Temperature_CheckStatus(uint8_t isCharging){
 	int32_t temperatureLimit = isCharging == 1 ? MAX_CHARGE_TEMPERATURE_LIMIT : MAX_DISCHARGE_TEMPERATURE_LIMIT;
 	temperatureLimit *= MILLI_SCALING_FACTOR;
 
-	for (int i = 0; i < NUM_MINIONS; i++) {
-		for (int j = 0; j < MAX_TEMP_SENSORS_PER_MINION_BOARD; j++) {
-			if (i * MAX_TEMP_SENSORS_PER_MINION_BOARD + j >= NUM_TEMPERATURE_SENSORS) break;
-			if (ModuleTemperatures[i][j] > temperatureLimit) {
-				return DANGER;
-			}
+	for (int module = 0; module < NUM_BATTERY_MODULES; module++) {
+		if (!Temperature_IsModuleCovered(module) && Temperature_IsModuleEstimateUnsafe(module, temperatureLimit)) {
+			return DANGER;
+		}
+	}
+
+	for (int sensor = 0; sensor < NUM_TEMPERATURE_SENSORS; sensor++) {
+		if (SensorFaults[sensor] != 0) {
+			continue;
+		}
+		if (Temperature_GetSensorTemperature(sensor) > temperatureLimit
+			|| Temperature_IsRisingToLimit(sensor, temperatureLimit)) {
+			return DANGER;
 		}
 	}
 	return SAFE;
@@ -204,18 +485,26 @@ void Temperature_SetChargeState(uint8_t isCharging){
 /** Temperature_GetModulesInDanger
  * Finds all modules that are in danger and stores them into a list
  * This function is called when you can't use the current module to see if it is charging.
+ * Modules without a plausible sensor are checked with the thermal model.
  * @return pointer to index of modules that are in danger
  */
 uint8_t *Temperature_GetModulesInDanger(void){
 	static uint8_t ModuleTempStatus[NUM_BATTERY_MODULES];
 	int32_t temperatureLimit = ChargingState == 1 ? MAX_CHARGE_TEMPERATURE_LIMIT : MAX_DISCHARGE_TEMPERATURE_LIMIT;
+	temperatureLimit *= MILLI_SCALING_FACTOR;
 
-	for (int i = 0; i < NUM_MINIONS-1; i++) {
-		for (int j = 0; j < MAX_TEMP_SENSORS_PER_MINION_BOARD; j++) {
-			if (i * MAX_TEMP_SENSORS_PER_MINION_BOARD + j >= NUM_TEMPERATURE_SENSORS) break;
-			if (ModuleTemperatures[i][j] > temperatureLimit) {
-				ModuleTempStatus[(i * (NUM_TEMP_SENSORS_PER_MOD/2)) + (j % (NUM_TEMP_SENSORS_PER_MOD/2))] = 1;
-			}
+	for (int module = 0; module < NUM_BATTERY_MODULES; module++) {
+		ModuleTempStatus[module] = !Temperature_IsModuleCovered(module)
+			&& Temperature_IsModuleEstimateUnsafe(module, temperatureLimit);
+	}
+
+	for (int sensor = 0; sensor < NUM_TEMPERATURE_SENSORS; sensor++) {
+		if (SensorFaults[sensor] != 0) {
+			continue;
+		}
+		if (Temperature_GetSensorTemperature(sensor) > temperatureLimit
+			|| Temperature_IsRisingToLimit(sensor, temperatureLimit)) {
+			ModuleTempStatus[SensorModule[sensor]] = 1;
 		}
 	}
 	return ModuleTempStatus;
@@ -231,36 +520,115 @@ int32_t Temperature_GetSingleTempSensor(uint8_t board, uint8_t sensorIdx) {
 	return ModuleTemperatures[board][sensorIdx];
 }
 
+/** Temperature_GetSensorTemperature
+ * Gets the temperature of a sensor by its number in the pack
+ * @precondition: sensorIdx must be < NUM_TEMPERATURE_SENSORS
+ * @param index of sensor in the pack (0-indexed based)
+ * @return temperature of the sensor at specified index
+ */
+int32_t Temperature_GetSensorTemperature(uint8_t sensorIdx) {
+	const SensorTap *tap = &SensorMap[sensorIdx];
+	return ModuleTemperatures[tap->board][tap->mux * (MAX_TEMP_SENSORS_PER_MINION_BOARD / 2) + tap->channel];
+}
+
+/** Temperature_GetSensorSlope
+ * Gets how fast a sensor is heating up, estimated over the last TEMP_SLOPE_WINDOW scans
+ * @precondition: sensorIdx must be < NUM_TEMPERATURE_SENSORS
+ * @param index of sensor in the pack (0-indexed based)
+ * @return dT/dt in mC/s, 0 until the window is full
+ */
+int32_t Temperature_GetSensorSlope(uint8_t sensorIdx) {
+	if (HistoryCount < TEMP_SLOPE_WINDOW) {
+		return 0;
+	}
+	return ((int64_t)Temperature_SlopeNumerator(sensorIdx) * 1000) / ((int64_t)SLOPE_DENOM * TEMPERATURE_SCAN_PERIOD_MS);
+}
+
+/** Temperature_GetSensorFaults
+ * Gets the plausibility checks a sensor failed on the last scan
+ * @precondition: sensorIdx must be < NUM_TEMPERATURE_SENSORS
+ * @param index of sensor in the pack (0-indexed based)
+ * @return TEMP_FAULT_* flags, 0 if the sensor is plausible
+ */
+uint8_t Temperature_GetSensorFaults(uint8_t sensorIdx) {
+	return SensorFaults[sensorIdx];
+}
+
+/** Temperature_GetNumImplausibleSensors
+ * Counts the sensors that failed a plausibility check on the last scan
+ * @return number of sensors left out of the averages
+ */
+uint8_t Temperature_GetNumImplausibleSensors(void) {
+	uint8_t count = 0;
+	for (int sensor = 0; sensor < NUM_TEMPERATURE_SENSORS; sensor++) {
+		if (SensorFaults[sensor] != 0) {
+			count++;
+		}
+	}
+	return count;
+}
+
+/** Temperature_GetDieTemperature
+ * Gets the internal die temperature an LTC6811 reported on the last scan
+ * @precondition: board must be < NUM_MINIONS
+ * @param index of board (0-indexed based)
+ * @return temperature in Celsius (Fixed Point with .001 resolution)
+ */
+int32_t Temperature_GetDieTemperature(uint8_t board) {
+	return DieTemperatures[board];
+}
+
 /** Temperature_GetModuleTemperature
  * Gets the avg temperature of a certain battery module in the battery pack. Since there
- * are 2 sensors per module, the return value is the average
+ * are 2 sensors per module, the return value is the average of its plausible sensors.
+ * If none of them are plausible it is the thermal model's estimate, or the average of
+ * all of them if the estimate is too old.
  * @precondition: moduleIdx must be < NUM_BATTERY_MODULE
  * @param index of module (0-indexed based)
  * @return temperature of the battery module at specified index
  */
 int32_t Temperature_GetModuleTemperature(uint8_t moduleIdx){
 	int32_t total = 0;
-	uint8_t board = (moduleIdx * 2) / MAX_TEMP_SENSORS_PER_MINION_BOARD;
-	uint8_t sensor = moduleIdx % (MAX_TEMP_SENSORS_PER_MINION_BOARD / 2);
-	
-	total += ModuleTemperatures[board][sensor];
-	
-	// Get temperature from other sensor on other side
-	total += ModuleTemperatures[board][sensor + MAX_TEMP_SENSORS_PER_MINION_BOARD / 2];
-	total /= 2;
-	return total;
+	int32_t plausibleTotal = 0;
+	int32_t plausibleCount = 0;
+	for (int i = 0; i < NUM_TEMP_SENSORS_PER_MOD; i++) {
+		uint8_t sensor = ModuleSensors[moduleIdx][i];
+		total += Temperature_GetSensorTemperature(sensor);
+		if (SensorFaults[sensor] == 0) {
+			plausibleTotal += Temperature_GetSensorTemperature(sensor);
+			plausibleCount++;
+		}
+	}
+	if (plausibleCount > 0) {
+		return plausibleTotal / plausibleCount;
+	}
+	if (ThermalModel_IsValid(moduleIdx)) {
+		return ThermalModel_GetEstimate(moduleIdx);
+	}
+	return total / NUM_TEMP_SENSORS_PER_MOD;
 }
 
 /** Temperature_GetTotalPackAvgTemperature
- * Gets the average temperature of the whole battery pack
+ * Gets the average temperature of the whole battery pack. Implausible sensors are left out.
  * @return average temperature of battery pack
  */
 int32_t Temperature_GetTotalPackAvgTemperature(void){
 	int32_t total = 0;
-	for (int i = 0; i < NUM_BATTERY_MODULES; i++) {
-		total += Temperature_GetModuleTemperature(i);
+	int32_t count = 0;
+	for (int sensor = 0; sensor < NUM_TEMPERATURE_SENSORS; sensor++) {
+		if (SensorFaults[sensor] == 0) {
+			total += Temperature_GetSensorTemperature(sensor);
+			count++;
+		}
 	}
-	return total /= NUM_BATTERY_MODULES;
+	if (count == 0) {
+		// Nothing is plausible, fall back to every sensor rather than a made up number
+		for (int i = 0; i < NUM_BATTERY_MODULES; i++) {
+			total += Temperature_GetModuleTemperature(i);
+		}
+		return total / NUM_BATTERY_MODULES;
+	}
+	return total / count;
 }
 
 /** Temperature_SampleADC
@@ -269,11 +637,17 @@ int32_t Temperature_GetTotalPackAvgTemperature(void){
  * @return SUCCESS or ERROR
  */
 ErrorStatus Temperature_SampleADC(uint8_t ADCMode) {
-	wakeup_sleep(NUM_MINIONS);
-	LTC6811_adax(ADCMode, AUX_CH_GPIO1);							// Start ADC conversion on GPIO1
-	LTC6811_pollAdc();
+	wakeup_sleep_chains(NUM_MINIONS_PER_CHAIN);
+	for(int chain = 0; chain < NUM_CHAINS; chain++){
+		LTC6811_SelectChain(chain);
+		LTC6811_adax(ADCMode, AUX_CH_GPIO1);							// Start ADC conversion on GPIO1
+	}
+	for(int chain = 0; chain < NUM_CHAINS; chain++){
+		LTC6811_SelectChain(chain);
+		LTC6811_pollAdc();
+	}
 
-	wakeup_sleep(NUM_MINIONS);
-	int8_t error = LTC6811_rdaux(AUX_CH_GPIO1, NUM_MINIONS, Minions);   // Update Minions with fresh values
-	return error != -1 ? SUCCESS : ERROR;
+	wakeup_sleep_chains(NUM_MINIONS_PER_CHAIN);
+	uint8_t error = LTC6811_rdaux_chains(AUX_CH_GPIO1, NUM_MINIONS_PER_CHAIN, Minions);   // Update Minions with fresh values
+	return error == 0 ? SUCCESS : ERROR;		// Number of chain registers with a bad PEC
 }
@@ -0,0 +1,117 @@
+/** ThermalModel.c
+ * Thermal model of the battery modules. Every module is a first order RC network:
+ *     T' = (Tref + I^2 * R * Rth - T) / tau
+ * where Tref is the average of the measured modules next to it, or the pack average when
+ * neither neighbour is measured. Runs in fixed point once per scan.
+ */
+
+#include "ThermalModel.h"
+#include "Temperature.h"
+
+// Estimates are kept with 8 extra fraction bits so slow changes are not rounded away
+#define MODEL_FRAC_BITS		8
+
+// Fraction of the way to the target the estimate moves every scan (Q16)
+#define MODEL_ALPHA			((TEMPERATURE_SCAN_PERIOD_MS * 65536) / (TEMP_MODEL_TAU_S * 1000))
+
+#define MODEL_MAX_AGE_SCANS	((TEMP_MODEL_MAX_AGE_S * 1000) / TEMPERATURE_SCAN_PERIOD_MS)
+#define MODEL_SCANS_PER_MIN	(60000 / TEMPERATURE_SCAN_PERIOD_MS)
+
+#if MODEL_ALPHA == 0
+#error "TEMP_MODEL_TAU_S is too long for TEMPERATURE_SCAN_PERIOD_MS"
+#endif
+
+static int32_t Estimates[NUM_BATTERY_MODULES];		// mC << MODEL_FRAC_BITS
+static uint16_t ScansUnmeasured[NUM_BATTERY_MODULES];
+static bool Seeded[NUM_BATTERY_MODULES];			// Measured at least once
+
+/** ThermalModel_Init
+ * Forgets every estimate. A module has no estimate until it has been measured once.
+ */
+void ThermalModel_Init(void) {
+	for (int module = 0; module < NUM_BATTERY_MODULES; module++) {
+		Estimates[module] = 0;
+		ScansUnmeasured[module] = 0;
+		Seeded[module] = false;
+	}
+}
+
+/** ThermalModel_Reference
+ * Gets the temperature an unmeasured module settles toward without any current
+ * @param module index of module
+ * @return temperature in mC
+ */
+static int32_t ThermalModel_Reference(int module) {
+	int32_t total = 0;
+	int32_t count = 0;
+	for (int neighbour = module - 1; neighbour <= module + 1; neighbour += 2) {
+		if (neighbour >= 0 && neighbour < NUM_BATTERY_MODULES && Temperature_IsModuleCovered(neighbour)) {
+			total += Temperature_GetModuleTemperature(neighbour);
+			count++;
+		}
+	}
+	return count > 0 ? total / count : Temperature_GetTotalPackAvgTemperature();
+}
+
+/** ThermalModel_Update
+ * Moves the model one scan forward. Modules with a plausible sensor are set to their measured
+ * temperature, the others heat up by I^2R and settle toward the measured modules next to them.
+ * Call once after every Temperature update.
+ * @param current pack current in milliamperes
+ */
+void ThermalModel_Update(int32_t current) {
+	// Every module carries the pack current. I^2 * R in mW, times Rth in mK/W gives the
+	// temperature rise over the reference in mC.
+	int64_t power = ((int64_t)current * current * TEMP_MODEL_RESISTANCE) / 1000000000;
+	int32_t rise = (int32_t)((power * TEMP_MODEL_THERMAL_RESISTANCE) / 1000);
+
+	for (int module = 0; module < NUM_BATTERY_MODULES; module++) {
+		if (Temperature_IsModuleCovered(module)) {
+			Estimates[module] = Temperature_GetModuleTemperature(module) << MODEL_FRAC_BITS;
+			ScansUnmeasured[module] = 0;
+			Seeded[module] = true;
+			continue;
+		}
+		if (!Seeded[module]) {
+			continue;
+		}
+
+		int32_t target = (ThermalModel_Reference(module) + rise) << MODEL_FRAC_BITS;
+		Estimates[module] += (int32_t)(((int64_t)(target - Estimates[module]) * MODEL_ALPHA) >> 16);
+		if (ScansUnmeasured[module] <= MODEL_MAX_AGE_SCANS) {
+			ScansUnmeasured[module]++;
+		}
+	}
+}
+
+/** ThermalModel_IsValid
+ * Checks if the estimate of a module may still stand in for its sensors
+ * @precondition: moduleIdx must be < NUM_BATTERY_MODULES
+ * @param index of module (0-indexed based)
+ * @return true if the module was measured within TEMP_MODEL_MAX_AGE_S
+ */
+bool ThermalModel_IsValid(uint8_t moduleIdx) {
+	return Seeded[moduleIdx] && ScansUnmeasured[moduleIdx] <= MODEL_MAX_AGE_SCANS;
+}
+
+/** ThermalModel_GetEstimate
+ * Gets the modelled temperature of a module
+ * @precondition: moduleIdx must be < NUM_BATTERY_MODULES
+ * @param index of module (0-indexed based)
+ * @return temperature in Celsius (Fixed Point with .001 resolution)
+ */
+int32_t ThermalModel_GetEstimate(uint8_t moduleIdx) {
+	return Estimates[moduleIdx] >> MODEL_FRAC_BITS;
+}
+
+/** ThermalModel_GetUpperBound
+ * Gets the estimate plus TEMP_MODEL_DRIFT for every minute the module has gone without
+ * a sensor. Limit checks use this so the trip comes closer the older the estimate gets.
+ * @precondition: moduleIdx must be < NUM_BATTERY_MODULES
+ * @param index of module (0-indexed based)
+ * @return temperature in Celsius (Fixed Point with .001 resolution)
+ */
+int32_t ThermalModel_GetUpperBound(uint8_t moduleIdx) {
+	return ThermalModel_GetEstimate(moduleIdx)
+		+ (ScansUnmeasured[moduleIdx] * TEMP_MODEL_DRIFT) / MODEL_SCANS_PER_MIN;
+}
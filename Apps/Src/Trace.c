@@ -0,0 +1,154 @@
+/** Trace.c
+ * Event trace in a RAM ring. A record takes a slot with one atomic add and fills in its 8
+ * bytes, the ring index is a mask so nothing is ever out of bounds. Newer records overwrite
+ * the oldest ones, records that come in while the ring is read are dropped and counted.
+ */
+
+#include "Trace.h"
+#include "Profiler.h"
+#include "Scheduler.h"
+#include "BSP_Timer.h"
+#include "cmsis_os.h"
+#include <stdatomic.h>
+
+_Static_assert((TRACE_SIZE & (TRACE_SIZE - 1)) == 0, "TRACE_SIZE has to be a power of 2");
+
+static const char *EventNames[NUM_TRACE_EVENTS] = {
+	"task",
+	"stage",
+	"lock",
+	"fault",
+};
+
+static const char *LockNames[NUM_TRACE_LOCKS] = {
+	"ltc",
+	"eeprom",
+	"scan",
+};
+
+#if TRACE_ENABLED
+static TraceRecord Ring[TRACE_SIZE];
+static atomic_uint Written;				// Records ever taken, the newest one is Written - 1
+static atomic_uint Dropped;
+static volatile bool Paused;
+#endif
+
+/** Trace_Record
+ * Adds a record to the ring. Use TRACE_BEGIN, TRACE_END and TRACE_INSTANT instead.
+ * Safe from any thread or interrupt.
+ * @param event TraceEvent with its TraceType shifted in by TRACE_TYPE_SHIFT
+ * @param arg what the event is about
+ */
+void Trace_Record(uint8_t event, uint8_t arg) {
+#if TRACE_ENABLED
+	if (Paused) {
+		atomic_fetch_add_explicit(&Dropped, 1, memory_order_relaxed);
+		return;
+	}
+	uint32_t slot = atomic_fetch_add_explicit(&Written, 1, memory_order_relaxed);
+	TraceRecord *record = &Ring[slot & (TRACE_SIZE - 1)];
+	record->time = BSP_Timer_GetCycleCount();
+	record->thread = (uint16_t)((uintptr_t)osThreadGetId() >> 2);
+	record->event = event;
+	record->arg = arg;
+#endif
+}
+
+/** Trace_Reset
+ * Empties the ring and the counts of lost records
+ */
+void Trace_Reset(void) {
+#if TRACE_ENABLED
+	atomic_store(&Written, 0);
+	atomic_store(&Dropped, 0);
+#endif
+}
+
+/** Trace_Get
+ * Pauses the trace and gets a record. Records that come in while paused are dropped.
+ * @param index of the record, 0 is the oldest one still in the ring
+ * @return the record, NULL past the newest one or if the trace is compiled out
+ */
+const TraceRecord *Trace_Get(uint32_t index) {
+#if TRACE_ENABLED
+	Paused = true;
+	uint32_t written = atomic_load(&Written);
+	uint32_t count = written < TRACE_SIZE ? written : TRACE_SIZE;
+	if (index >= count) {
+		return NULL;
+	}
+	return &Ring[(written - count + index) & (TRACE_SIZE - 1)];
+#else
+	return NULL;
+#endif
+}
+
+/** Trace_Resume
+ * Records again after Trace_Get
+ */
+void Trace_Resume(void) {
+#if TRACE_ENABLED
+	Paused = false;
+#endif
+}
+
+/** Trace_GetLost
+ * @param dropped set to the records that came in while paused, may be NULL
+ * @return records overwritten by newer ones
+ */
+uint32_t Trace_GetLost(uint32_t *dropped) {
+#if TRACE_ENABLED
+	uint32_t written = atomic_load(&Written);
+	if (dropped != NULL) {
+		*dropped = atomic_load(&Dropped);
+	}
+	return written > TRACE_SIZE ? written - TRACE_SIZE : 0;
+#else
+	if (dropped != NULL) {
+		*dropped = 0;
+	}
+	return 0;
+#endif
+}
+
+/** Trace_Dump
+ * Prints the ring, oldest record first, with the names of the tasks, stages and mutexes the
+ * records refer to, then empties it. Tools/trace2json.py reads this format.
+ */
+void Trace_Dump(void) {
+#ifdef SIMULATION
+	uint32_t frequency = 1000000000;		// The simulator counts nanoseconds
+#else
+	uint32_t frequency = BSP_Timer_GetRunFreq();
+#endif
+	const TraceRecord *record = Trace_Get(0);
+	uint32_t dropped;
+	uint32_t overwritten = Trace_GetLost(&dropped);
+	printf("trace begin %lu %lu %lu\n\r", (unsigned long)frequency, (unsigned long)overwritten,
+		(unsigned long)dropped);
+
+	for (TraceEvent event = 0; event < NUM_TRACE_EVENTS; event++) {
+		printf("kind %u %s\n\r", event, EventNames[event]);
+	}
+	const SchedulerTask *task;
+	for (uint8_t i = 0; (task = Scheduler_GetTask(i)) != NULL; i++) {
+		printf("name %u %u %s\n\r", TRACE_TASK, i, task->name);
+	}
+	for (ProfilerProbe probe = 0; probe < NUM_PROBES; probe++) {
+		printf("name %u %u %s\n\r", TRACE_STAGE, probe, Profiler_GetName(probe));
+	}
+	for (TraceLock lock = 0; lock < NUM_TRACE_LOCKS; lock++) {
+		printf("name %u %u %s\n\r", TRACE_LOCK, lock, LockNames[lock]);
+	}
+	printf("name %u 0 trip\n\r", TRACE_FAULT);
+
+	// time thread type/event arg
+	for (uint32_t i = 0; record != NULL; record = Trace_Get(++i)) {
+		printf("%08lx %04x %02x %02x\n\r", (unsigned long)record->time, record->thread,
+			record->event, record->arg);
+	}
+	printf("trace end\n\r");
+
+	Trace_Reset();
+	Trace_Resume();
+}
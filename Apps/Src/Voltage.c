@@ -6,10 +6,16 @@
 #include "Voltage.h"
 #include "LTC6811.h"
 #include "config.h"
+#include "Topology.h"
 #include <stdlib.h>
 
+#if NUM_BATTERY_MODULES > 32
+#error "Voltage_SetBalancing keeps one bit per module in 32 bits"
+#endif
+
 static cell_asic *Minions;
 static uint16_t VoltageVal[NUM_BATTERY_MODULES]; //Voltage values gathered
+static uint32_t Balancing;		// Modules with their discharge switch on, one bit each
 /** LTC ADC measures with resolution of 4 decimal places, 
  * But we standardized to have 3 decimal places to work with
  * millivolts
@@ -23,18 +29,25 @@ static uint16_t VoltageVal[NUM_BATTERY_MODULES]; //Voltage values gathered
 ErrorStatus Voltage_Init(cell_asic *boards){
 	// Record pointer
 	Minions = boards;
+	Balancing = 0;
 
 	int8_t error = 0;
 	
-	wakeup_sleep(NUM_MINIONS);
+	wakeup_sleep_chains(NUM_MINIONS_PER_CHAIN);
 	LTC6811_Init(Minions);
 	
 	// Write Configuration Register
-	LTC6811_wrcfg(NUM_MINIONS, Minions);
+	for(int chain = 0; chain < NUM_CHAINS; chain++){
+		LTC6811_SelectChain(chain);
+		LTC6811_wrcfg(NUM_MINIONS_PER_CHAIN, &Minions[chain * NUM_MINIONS_PER_CHAIN]);
+	}
 
 	// Read Configuration Register
-	wakeup_sleep(NUM_MINIONS);
-	error = LTC6811_rdcfg(NUM_MINIONS, Minions);
+	wakeup_sleep_chains(NUM_MINIONS_PER_CHAIN);
+	for(int chain = 0; chain < NUM_CHAINS; chain++){
+		LTC6811_SelectChain(chain);
+		error |= LTC6811_rdcfg(NUM_MINIONS_PER_CHAIN, &Minions[chain * NUM_MINIONS_PER_CHAIN]);
+	}
 	
 	if(error == 0){
 		return SUCCESS;
@@ -49,20 +62,26 @@ ErrorStatus Voltage_Init(cell_asic *boards){
  * @return SUCCESS or ERROR
  */
 ErrorStatus Voltage_UpdateMeasurements(void){
-	int8_t error = 0;
+	uint8_t error = 0;
 	
-	// Start Cell ADC Measurements
-	wakeup_idle(NUM_MINIONS);
-	LTC6811_adcv(ADC_CONVERSION_MODE,ADC_DCP,CELL_CH_TO_CONVERT);
-	LTC6811_pollAdc();	// In case you want to time the length of the conversion time
+	// Start Cell ADC Measurements on every chain so they all convert at the same time
+	wakeup_idle_chains(NUM_MINIONS_PER_CHAIN);
+	for(int chain = 0; chain < NUM_CHAINS; chain++){
+		LTC6811_SelectChain(chain);
+		LTC6811_adcv(ADC_CONVERSION_MODE,ADC_DCP,CELL_CH_TO_CONVERT);
+	}
+	for(int chain = 0; chain < NUM_CHAINS; chain++){
+		LTC6811_SelectChain(chain);
+		LTC6811_pollAdc();	// In case you want to time the length of the conversion time
+	}
 	
 	// Read Cell Voltage Registers
-	wakeup_idle(NUM_MINIONS); // Not sure if wakeup is necessary if you start conversion then read consecutively
-	error = LTC6811_rdcv(0, NUM_MINIONS, Minions); // Set to read back all cell voltage registers
+	wakeup_idle_chains(NUM_MINIONS_PER_CHAIN); // Not sure if wakeup is necessary if you start conversion then read consecutively
+	error = LTC6811_rdcv_chains(0, NUM_MINIONS_PER_CHAIN, Minions); // Set to read back all cell voltage registers
 	
 	//copies values from cells.c_codes to private array
 	for(int i = 0; i < NUM_BATTERY_MODULES; i++){
-		VoltageVal[i] = Minions[i / MAX_VOLT_SENSORS_PER_MINION_BOARD].cells.c_codes[i % MAX_VOLT_SENSORS_PER_MINION_BOARD];
+		VoltageVal[i] = Minions[ModuleMap[i].board].cells.c_codes[ModuleMap[i].cell];
 	}
 	
 	if(error == 0){
@@ -127,8 +146,11 @@ SafetyStatus *Voltage_GetModulesInDanger(void){
  * Runs the open wire method with print=true
  */
 void Voltage_OpenWireSummary(void){
-	wakeup_idle(NUM_MINIONS);
-	LTC6811_run_openwire_multi(NUM_MINIONS, Minions, true);
+	for(int chain = 0; chain < NUM_CHAINS; chain++){
+		LTC6811_SelectChain(chain);
+		wakeup_idle(NUM_MINIONS_PER_CHAIN);
+		LTC6811_run_openwire_multi(NUM_MINIONS_PER_CHAIN, &Minions[chain * NUM_MINIONS_PER_CHAIN], true);
+	}
 }
 
 /** Voltage_OpenWire
@@ -136,8 +158,7 @@ void Voltage_OpenWireSummary(void){
  * @return SafetyStatus
  */
 SafetyStatus Voltage_OpenWire(void){
-	wakeup_idle(NUM_MINIONS);
-	long openwires = LTC6811_run_openwire_multi(NUM_MINIONS, Minions, false);
+	long openwires = Voltage_GetOpenWire();
 	if(openwires != 0){
 		return DANGER;
 	} else {
@@ -150,8 +171,14 @@ SafetyStatus Voltage_OpenWire(void){
  * @return hexadecimal string (1 means open wire, 0 means closed)
  */
 uint32_t Voltage_GetOpenWire(void){
-	wakeup_idle(NUM_MINIONS);
-	return LTC6811_run_openwire_multi(NUM_MINIONS, Minions, false);
+	uint32_t openwires = 0;
+	// Each chain reports its open wires independently, merge them into one
+	for(int chain = 0; chain < NUM_CHAINS; chain++){
+		LTC6811_SelectChain(chain);
+		wakeup_idle(NUM_MINIONS_PER_CHAIN);
+		openwires |= LTC6811_run_openwire_multi(NUM_MINIONS_PER_CHAIN, &Minions[chain * NUM_MINIONS_PER_CHAIN], false);
+	}
+	return openwires;
 }
 
 /** Voltage_GetModuleVoltage
@@ -162,19 +189,11 @@ uint32_t Voltage_GetOpenWire(void){
  */
 uint16_t Voltage_GetModuleMillivoltage(uint8_t moduleIdx){
     // These if statements prevents a hardfault.
+    // Topology.h makes sure every module is mapped to a board that is present.
     if(moduleIdx >= NUM_BATTERY_MODULES) {
         return 0xFFFF;  // return -1 which indicates error voltage
     }
 
-    // Each board will measure the same number of modules except for the last board in the daisy chain.
-    // To find which minion board the battery module (moduleIdx) is assigned to, we need to
-    // divide the moduleIdx by how many battery modules are assigned to each minion board
-    // (indicated by MAX_VOLT_SENSORS_PER_MINION_BOARD). If the minion idx exceeds how many minion
-    // boards are currently present, then return an error voltage.
-    if((moduleIdx / MAX_VOLT_SENSORS_PER_MINION_BOARD) >= NUM_MINIONS) {
-        return 0xFFFF;  // return -1 which indicates error voltage
-    }
-
 	return VoltageVal[moduleIdx] / 10;
 }
 
@@ -190,6 +209,36 @@ uint32_t Voltage_GetTotalPackVoltage(void){
 	return sum;
 }
 
+/** Voltage_SetBalancing
+ * Turns the discharge switch of the LTC6811 on for the given modules and off for all others.
+ * The configuration registers are only written when the set of modules changes.
+ * @param modules one bit per module, bit 0 is module 0
+ */
+void Voltage_SetBalancing(uint32_t modules){
+	if(modules == Balancing) {
+		return;
+	}
+	Balancing = modules;
 
+	bool dcc[NUM_MINIONS][12] = {{false}};
+	for(int i = 0; i < NUM_BATTERY_MODULES; i++){
+		dcc[ModuleMap[i].board][ModuleMap[i].cell] = (modules >> i) & 1;
+	}
+	for(int board = 0; board < NUM_MINIONS; board++){
+		LTC6811_set_cfgr_dis(board, Minions, dcc[board]);
+	}
 
+	wakeup_idle_chains(NUM_MINIONS_PER_CHAIN);
+	for(int chain = 0; chain < NUM_CHAINS; chain++){
+		LTC6811_SelectChain(chain);
+		LTC6811_wrcfg(NUM_MINIONS_PER_CHAIN, &Minions[chain * NUM_MINIONS_PER_CHAIN]);
+	}
+}
 
+/** Voltage_GetBalancing
+ * Gets the modules that have their discharge switch on
+ * @return one bit per module, bit 0 is module 0
+ */
+uint32_t Voltage_GetBalancing(void){
+	return Balancing;
+}
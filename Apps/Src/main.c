@@ -7,24 +7,96 @@
 #include "LTC6811.h"
 #include "Voltage.h"
 #include "Current.h"
+#include "Fuse.h"
+#include "Ripple.h"
 #include "Temperature.h"
+#include "ThermalModel.h"
+#include "SPILink.h"
 #include "EEPROM.h"
 #include "Charge.h"
+#include "ModuleCharge.h"
+#include "PowerLimit.h"
+#include "ChargeControl.h"
+#include "ChargeJournal.h"
+#include "Scheduler.h"
+#include "Supervisor.h"
+#include "Profiler.h"
+#include "Trace.h"
+#include "Counters.h"
 #include "CLI.h"
+#include "CANbus.h"
 #include "BSP_UART.h"
 #include "BSP_Contactor.h"
 #include "BSP_Lights.h"
 #include "BSP_WDTimer.h"
+#include "BSP_Timer.h"
+#include "cmsis_os.h"
+#ifdef SIMULATION
+#include "simulator_conf.h"
+#endif
 
 cell_asic Minions[NUM_MINIONS];
 bool override = false;		// This will be changed by user via CLI
 char command[COMMAND_SIZE];
 
-void heartbeat(void);
+bool safetyTask(void);
+bool acquisitionTask(void);
+bool commsTask(void);
+bool loggingTask(void);
+bool heartbeatTask(void);
+bool cliTask(void);
+void sendFuseMargins(void);
+void sendRipple(void);
+void sendModuleCharge(void);
+void sendPowerLimits(void);
+void sendChargerSetpoint(void);
+void sendPerformance(void);
+void sendCounters(void);
+void sendCounter(CounterId id, const char *name, bool gauge, uint32_t value, void *context);
+void superviseTasks(void);
+void lock(osMutexId mutex, TraceLock trace);
+void powerFailThread(void const *argument);
 void initialize(void);
 void preliminaryCheck(void);
 void faultCondition(void);
 
+// Highest priority first, every task runs in its own thread. The offsets keep tasks with the
+// same period out of each other's way.
+static const SchedulerTask Tasks[] = {
+	{"safety",		safetyTask,			SCHED_SAFETY_PERIOD_MS,			0,	SCHED_SAFETY_PERIOD_MS},
+	{"acquisition",	acquisitionTask,	SCHED_ACQUISITION_PERIOD_MS,	1,	SCHED_ACQUISITION_PERIOD_MS},
+	{"comms",		commsTask,			SCHED_COMMS_PERIOD_MS,			2,	SCHED_COMMS_PERIOD_MS},
+	{"logging",		loggingTask,		SCHED_LOGGING_PERIOD_MS,		3,	SCHED_LOGGING_PERIOD_MS},
+	{"heartbeat",	heartbeatTask,		HEARTBEAT_PERIOD_MS,			4,	HEARTBEAT_PERIOD_MS},
+	{"cli",			cliTask,			SCHED_CLI_PERIOD_MS,			5,	SCHED_CLI_PERIOD_MS},
+};
+enum {SAFETY_TASK = 0, ACQUISITION_TASK, COMMS_TASK, LOGGING_TASK, HEARTBEAT_TASK, CLI_TASK};
+
+// Longest each task may go without checking in before the watchdog is left to reset the BPS
+static const uint32_t MaxIntervals[] = {
+	SUPERVISOR_SAFETY_INTERVAL_MS,
+	SUPERVISOR_ACQUISITION_INTERVAL_MS,
+	SUPERVISOR_COMMS_INTERVAL_MS,
+	SUPERVISOR_LOGGING_INTERVAL_MS,
+	SUPERVISOR_HEARTBEAT_INTERVAL_MS,
+	SUPERVISOR_CLI_INTERVAL_MS,
+};
+_Static_assert(sizeof(MaxIntervals) / sizeof(MaxIntervals[0]) == sizeof(Tasks) / sizeof(Tasks[0]),
+	"every task needs a check-in interval");
+
+// LtcMutex: the LTC6811 chains, scans and balancing
+// EepromMutex: the EEPROM and the state of charge it keeps
+// ScanMutex: the end of a temperature scan against the safety checks that read it
+osMutexDef(LtcMutex);
+osMutexDef(EepromMutex);
+osMutexDef(ScanMutex);
+static osMutexId LtcMutex;
+static osMutexId EepromMutex;
+static osMutexId ScanMutex;
+
+// Next to the safety task and above the rest, so the final checkpoint only waits for the EEPROM
+osThreadDef(powerFailThread, osPriorityRealtime, 1, 0);
+
 #ifndef SIMULATION
 static void __enable_irq() { asm("CPSIE I"); }
 static void __disable_irq(){ asm("CPSID I"); }
@@ -35,6 +107,11 @@ int main(){
         __disable_irq();		// Disable all interrupts until initialization is done
 	#endif
         
+        osKernelInitialize();
+        LtcMutex = osMutexCreate(osMutex(LtcMutex));
+        EepromMutex = osMutexCreate(osMutex(EepromMutex));
+        ScanMutex = osMutexCreate(osMutex(ScanMutex));
+
         initialize();			// Initialize codes/pins
 	preliminaryCheck();		// Wait until all boards are powered on
 	
@@ -42,43 +119,14 @@ int main(){
         __enable_irq();			// Enable interrupts
         #endif
 
+	osKernelStart();		// main carries on as a thread
 	BSP_WDTimer_Start();
+	osThreadCreate(osThread(powerFailThread), NULL);
 
-	while(1) {
-		// First update the measurements.
-		Voltage_UpdateMeasurements();
-		Current_UpdateMeasurements();
-    	Temperature_UpdateAllMeasurements();
-
-		// Update battery percentage
-		Charge_Calculate(Current_GetLowPrecReading());
-
-		// Checks for user input to send to CLI
-		if(BSP_UART_ReadLine(command)) {
-			CLI_Handler(command);
-		}
-		
-		SafetyStatus current = Current_CheckStatus(override);
-		SafetyStatus temp = Temperature_CheckStatus(Current_IsCharging());
-		SafetyStatus voltage = Voltage_CheckStatus();
-
-		// Check if everything is safe (all return SAFE = 0)
-		if((current == SAFE) && (temp == SAFE) && (voltage == SAFE)) {
-			BSP_Contactor_On();
-		}
-		else if((current == SAFE) && (temp == SAFE) && (voltage == UNDERVOLTAGE) && override) {
-			BSP_Contactor_On();
-		} else {
-			break;
-		}
-
-		heartbeat();
-
-		// Update necessary
-		// CAN_SendMessageStatus()	// Most likely need to put this on a timer if sending too frequently
-
-		BSP_WDTimer_Reset();
-	}
+	Scheduler_Init(Tasks, sizeof(Tasks) / sizeof(Tasks[0]));
+	Supervisor_Init(MaxIntervals, sizeof(MaxIntervals) / sizeof(MaxIntervals[0]));
+	Scheduler_Start();
+	Scheduler_Run();
 
 	// BPS has tripped if this line is reached
 	faultCondition();
@@ -98,10 +146,17 @@ void initialize(void){
 	BSP_Contactor_Off();
 	BSP_WDTimer_Init();
 	EEPROM_Init();
+	CANbus_Init();
 	Charge_Init();
 	Current_Init();
+	Ripple_Init();
+	ModuleCharge_Init();
+	PowerLimit_Init();
+	ChargeControl_Init();
 	Voltage_Init(Minions);
 	Temperature_Init(Minions);
+	ThermalModel_Init();
+	SPILink_Init(Minions);
 	CLI_Init(Minions);
 
 	// __enable_irq();
@@ -116,11 +171,21 @@ void initialize(void){
 		while(wait < STARTUP_WAIT_TIME) {
 			if(BSP_UART_ReadLine(command)) {
 				override = command[0] == 'y' ? true : false;
+				if(override) {
+					ChargeControl_Start();
+				}
 				break;
 			}
 			wait++;
 		}
 	}
+
+	// The tasks check the latest scans, start them off with a whole one
+	Current_UpdateMeasurements();
+	PROFILE_BEGIN(PROBE_TEMPERATURE_ALL);
+	Temperature_UpdateAllMeasurements();
+	PROFILE_END(PROBE_TEMPERATURE_ALL);
+	ThermalModel_Update(Current_GetLowPrecReading());
 }
 
 /** preliminaryCheck
@@ -137,16 +202,368 @@ void preliminaryCheck(void){
 	}
 }
 
-/** heartbeat
+/** safetyTask
+ * Takes in the newest current readings and runs every safety check. Voltage and temperature
+ * are checked on their latest scan, but the temperature limit depends on the direction of the
+ * current so it is checked here too. Opens the contactor right away on a trip. Feeds the
+ * watchdog while every task keeps checking in.
+ * @return false if the BPS has to trip
+ */
+bool safetyTask(void){
+	static uint32_t token;
+	PROFILE_BEGIN(PROBE_CURRENT);
+	Current_UpdateMeasurements();
+	PROFILE_END(PROBE_CURRENT);
+
+	lock(ScanMutex, TRACE_SCAN_LOCK);
+	PROFILE_BEGIN(PROBE_CHECKS);
+	SafetyStatus temp = Temperature_CheckStatus(Current_IsCharging());
+	SafetyStatus voltage = Voltage_CheckStatus();
+	osMutexRelease(ScanMutex);
+
+	// Current goes last, right before closing, so a trip of the analog watchdog during the
+	// other checks does not get the contactor closed again
+	SafetyStatus current = Current_CheckStatus(override);
+	PROFILE_END(PROBE_CHECKS);
+
+	// Check if everything is safe (all return SAFE = 0)
+	if((current == SAFE) && (temp == SAFE) && (voltage == SAFE)) {
+		BSP_Contactor_On();
+	}
+	else if((current == SAFE) && (temp == SAFE) && (voltage == UNDERVOLTAGE) && override) {
+		BSP_Contactor_On();
+	} else {
+		BSP_Contactor_Off();
+		return false;
+	}
+
+	token = Supervisor_CheckIn(SAFETY_TASK, token);
+	superviseTasks();
+	return true;
+}
+
+/** acquisitionTask
+ * Reads one mux channel of the temperature scan per slice and scans the module voltages every
+ * SCHED_VOLTAGE_PERIOD_MS. The slice after the last channel finishes the temperature scan,
+ * the rest of the slices are left free so a scan takes exactly TEMPERATURE_SCAN_PERIOD_MS.
+ * Only checks in on slices the LTC6811s answered without PEC errors.
+ * @return true
+ */
+bool acquisitionTask(void){
+	static uint8_t slice;
+	static uint32_t token;
+	ErrorStatus status = SUCCESS;
+	lock(LtcMutex, TRACE_LTC_LOCK);
+	if(slice % (SCHED_VOLTAGE_PERIOD_MS / SCHED_ACQUISITION_PERIOD_MS) == 0) {
+		PROFILE_BEGIN(PROBE_VOLTAGE);
+		status = Voltage_UpdateMeasurements();
+		PROFILE_END(PROBE_VOLTAGE);
+
+		// Adjust the isoSPI rates to the PEC errors of this scan
+		SPILink_Update();
+	}
+
+	if(slice < MAX_TEMP_SENSORS_PER_MINION_BOARD) {
+		PROFILE_BEGIN(PROBE_TEMPERATURE_CHANNEL);
+		if(Temperature_UpdateSingleChannel(slice) != SUCCESS) {
+			status = ERROR;
+		}
+		PROFILE_END(PROBE_TEMPERATURE_CHANNEL);
+	} else if(slice == MAX_TEMP_SENSORS_PER_MINION_BOARD) {
+		lock(ScanMutex, TRACE_SCAN_LOCK);
+		PROFILE_BEGIN(PROBE_TEMPERATURE_SCAN);
+		if(Temperature_FinishScan() != SUCCESS) {
+			status = ERROR;
+		}
+
+		// Keep an estimate of every module in case its sensors fail
+		ThermalModel_Update(Current_GetLowPrecReading());
+		PROFILE_END(PROBE_TEMPERATURE_SCAN);
+		osMutexRelease(ScanMutex);
+	}
+	osMutexRelease(LtcMutex);
+
+	if(status == SUCCESS) {
+		token = Supervisor_CheckIn(ACQUISITION_TASK, token);
+	} else {
+		COUNTER_INC(COUNTER_SPI_SCAN_ERRORS);
+	}
+	slice = (slice + 1) % SCHED_TEMPERATURE_SLICES;
+	return true;
+}
+
+/** commsTask
+ * Updates the module charges, the power limits and the charge profile and sends them on CAN
+ * @return true
+ */
+bool commsTask(void){
+	static uint32_t token;
+	ModuleCharge_Update();
+	sendModuleCharge();
+
+	// Let the motor controller back off before a fuse curve runs out
+	sendFuseMargins();
+
+	// Let the motor controller and charger back off before anything trips
+	if(PowerLimit_Update()) {
+		sendPowerLimits();
+	}
+
+	// Run the charge profile while a charger is plugged in, it balances through the LTC6811s
+	lock(LtcMutex, TRACE_LTC_LOCK);
+	bool setpoint = ChargeControl_Update();
+	osMutexRelease(LtcMutex);
+	if(setpoint) {
+		sendChargerSetpoint();
+	}
+
+	// Analyse the current ripple whenever a block of samples is complete
+	if(Ripple_Update()) {
+		sendRipple();
+	}
+
+	sendPerformance();
+	sendCounters();
+	token = Supervisor_CheckIn(COMMS_TASK, token);
+	return true;
+}
+
+/** loggingTask
+ * Updates the state of charge, which journals it to the EEPROM, and saves the isoSPI rates
+ * the acquisition task settled on
+ * @return true
+ */
+bool loggingTask(void){
+	static uint32_t token;
+	lock(EepromMutex, TRACE_EEPROM_LOCK);
+	PROFILE_BEGIN(PROBE_CHARGE);
+	Charge_Calculate();
+	PROFILE_END(PROBE_CHARGE);
+	SPILink_Save();
+	osMutexRelease(EepromMutex);
+	token = Supervisor_CheckIn(LOGGING_TASK, token);
+	return true;
+}
+
+/** heartbeatTask
  * Toggle heartbeat at visible frequency (RUN light)
+ * @return true
+ */
+bool heartbeatTask(void){
+	static uint32_t token;
+	BSP_Light_Toggle(RUN);
+	token = Supervisor_CheckIn(HEARTBEAT_TASK, token);
+	return true;
+}
+
+/** cliTask
+ * Checks for user input to send to CLI. Commands read and reset the EEPROM and the state of
+ * charge, so the logging task waits while one runs.
+ * @return true
  */
-void heartbeat(void){
-	// increment heartcount variable once per while(1) loop
-	static int heartcount;
-	heartcount = (heartcount + 1)%(HEARTBEAT_DELAY);
-	if(heartcount == 0) {
-		BSP_Light_Toggle(RUN);
+bool cliTask(void){
+	static uint32_t token;
+	if(BSP_UART_ReadLine(command)) {
+		lock(EepromMutex, TRACE_EEPROM_LOCK);
+		PROFILE_BEGIN(PROBE_CLI);
+		CLI_Handler(command);
+		PROFILE_END(PROBE_CLI);
+		osMutexRelease(EepromMutex);
 	}
+	token = Supervisor_CheckIn(CLI_TASK, token);
+	return true;
+}
+
+/** sendFuseMargins
+ * Sends how much of each fuse curve is left over CAN whenever it changes
+ */
+void sendFuseMargins(void){
+	static uint8_t lastMargin[NUM_FUSE_CURVES] = {0xFF, 0xFF};
+	for(FuseCurve curve = FUSE_DISCHARGE; curve < NUM_FUSE_CURVES; curve++) {
+		uint8_t margin = Fuse_GetMargin(curve);
+		if(margin != lastMargin[curve]) {
+			CANPayload_t payload = {.idx = curve, .data.b = margin};
+			if(CANbus_Send(FUSE_MARGIN, payload)) {
+				lastMargin[curve] = margin;
+			}
+		}
+	}
+}
+
+/** sendRipple
+ * Sends the ripple RMS and its strongest frequency over CAN
+ */
+void sendRipple(void){
+	uint32_t rms = Ripple_GetRMS();
+	CANPayload_t payload = {.idx = 0, .data.w = (Ripple_GetFrequency() << 16) | (rms > 0xFFFF ? 0xFFFF : rms)};
+	CANbus_Send(RIPPLE_DATA, payload);
+}
+
+/** sendModuleCharge
+ * Sends the lowest and highest module and the spread between them whenever one of them
+ * moves by 0.1%
+ */
+void sendModuleCharge(void){
+	static uint32_t lastSent[3] = {UINT32_MAX, UINT32_MAX, UINT32_MAX};
+	uint8_t lowest = ModuleCharge_GetLowest();
+	uint8_t highest = ModuleCharge_GetHighest();
+	uint32_t values[3] = {
+		((uint32_t)lowest << 16) | ModuleCharge_GetPercent(lowest),
+		((uint32_t)highest << 16) | ModuleCharge_GetPercent(highest),
+		ModuleCharge_GetSpread()
+	};
+	for(uint8_t i = 0; i < 3; i++) {
+		uint32_t diff = values[i] > lastSent[i] ? values[i] - lastSent[i] : lastSent[i] - values[i];
+		if(diff >= 10) {
+			CANPayload_t payload = {.idx = i, .data.w = values[i]};
+			if(CANbus_Send(MODULE_SOC, payload)) {
+				lastSent[i] = values[i];
+			}
+		}
+	}
+}
+
+/** sendPowerLimits
+ * Sends the discharge and charge current limits over CAN
+ */
+void sendPowerLimits(void){
+	uint32_t discharge = PowerLimit_GetDischarge() / 100;
+	uint32_t charge = PowerLimit_GetCharge() / 100;
+	CANPayload_t payload = {.idx = 0, .data.w = (discharge << 16) | charge};
+	CANbus_Send(POWER_LIMITS, payload);
+}
+
+/** sendChargerSetpoint
+ * Sends the charger its pack voltage and current setpoint, or turns it off
+ */
+void sendChargerSetpoint(void){
+	uint32_t voltage = ChargeControl_GetVoltage() / 100;
+	uint32_t current = ChargeControl_GetCurrent() / 100;
+	CANPayload_t payload = {.idx = voltage != 0 && current != 0, .data.w = (voltage << 16) | current};
+	CANbus_Send(CHARGER_SETPOINT, payload);
+}
+
+/** sendPerformance
+ * Sends the mean and max of one profiler probe over CAN, the next one on the next call
+ */
+void sendPerformance(void){
+	static ProfilerProbe probe;
+	const ProfilerStats *stats = Profiler_GetStats(probe);
+	if(stats == NULL) {
+		return;
+	}
+	if(stats->count > 0) {
+		uint32_t mean = Profiler_ToMicroseconds(stats->sum / stats->count);
+		uint32_t max = Profiler_ToMicroseconds(stats->max);
+		mean = mean > 0xFFFF ? 0xFFFF : mean;
+		max = max > 0xFFFF ? 0xFFFF : max;
+		CANPayload_t payload = {.idx = probe, .data.w = (max << 16) | mean};
+		CANbus_Send(PERF_DATA, payload);
+	}
+	probe = (probe + 1) % NUM_PROBES;
+}
+
+/** sendCounters
+ * Updates the gauges and sends the next counter over CAN, all of them go out every
+ * NUM_COUNTERS comms periods. The simulator also appends them to Counters.csv every
+ * COUNTERS_CSV_PERIOD_MS.
+ */
+void sendCounters(void){
+	static CounterId next;
+	static uint64_t lastIdle;
+	static uint64_t lastTotal;
+	uint64_t total;
+	uint64_t idle = osKernelIdleTime(&total);
+	if(total > lastTotal) {
+		GAUGE_SET(GAUGE_IDLE_PERCENT, (uint32_t)(100 * (idle - lastIdle) / (total - lastTotal)));
+	}
+	lastIdle = idle;
+	lastTotal = total;
+	GAUGE_SET(GAUGE_SAFETY_JITTER_MS, Scheduler_GetStats(SAFETY_TASK)->maxJitter);
+
+	next = Counters_Export(next, 1, sendCounter, NULL);
+
+	#ifdef SIMULATION
+	static bool started = false;
+	static uint32_t lastDump;
+	uint32_t now = BSP_Timer_GetTick();
+	if(!started) {
+		remove(GET_CSV_PATH(COUNTERS_CSV_FILE));		// Every run starts a new file
+		started = true;
+		lastDump = now;
+	}
+	if(now - lastDump >= COUNTERS_CSV_PERIOD_MS) {
+		Counters_DumpCSV(GET_CSV_PATH(COUNTERS_CSV_FILE), now);
+		lastDump = now;
+	}
+	#endif
+}
+
+/** sendCounter
+ * Sends a counter or gauge handed over by Counters_Export on CAN
+ */
+void sendCounter(CounterId id, const char *name, bool gauge, uint32_t value, void *context){
+	CANPayload_t payload = {.idx = id, .data.w = value};
+	CANbus_Send(COUNTER_DATA, payload);
+}
+
+/** superviseTasks
+ * Feeds the watchdog while every task checks in on time. Once one does not, logs it to the
+ * EEPROM and lets the watchdog reset the BPS. The EEPROM may be held by the offender, after
+ * SUPERVISOR_LOG_WAIT_MS it cannot be in the middle of a write and is logged to regardless.
+ */
+void superviseTasks(void){
+	static uint8_t offender = SUPERVISOR_HEALTHY;
+	static uint32_t caught;
+	static bool logged;
+
+	if(offender == SUPERVISOR_HEALTHY) {
+		offender = Supervisor_Check();
+		caught = BSP_Timer_GetTick();
+	}
+	if(offender == SUPERVISOR_HEALTHY) {
+		BSP_WDTimer_Reset();
+		return;
+	}
+	if(logged) {
+		return;		// Wait for the reset
+	}
+
+	bool locked = osMutexWait(EepromMutex, 0) == osOK;
+	if(!locked && BSP_Timer_GetTick() - caught < SUPERVISOR_LOG_WAIT_MS) {
+		BSP_WDTimer_Reset();	// Give the EEPROM a chance to free up
+		return;
+	}
+	EEPROM_LogError(FAULT_WATCHDOG);
+	EEPROM_LogData(FAULT_WATCHDOG, offender);
+	if(locked) {
+		osMutexRelease(EepromMutex);
+	}
+	logged = true;
+}
+
+/** powerFailThread
+ * Writes the final state of charge checkpoint once the supply starts to drop. Takes the
+ * EEPROM like every other user of the I2C bus, a transfer already under way finishes first.
+ * @param argument unused
+ */
+void powerFailThread(void const *argument){
+	while(!ChargeJournal_WaitPowerFail(osWaitForever));
+	lock(EepromMutex, TRACE_EEPROM_LOCK);
+	ChargeJournal_WriteFinal();
+	osMutexRelease(EepromMutex);
+}
+
+/** lock
+ * Waits for a mutex and marks the wait in the event trace, so a task held up by another
+ * one shows in it
+ * @param mutex to take
+ * @param trace name of the mutex in the trace
+ */
+void lock(osMutexId mutex, TraceLock trace){
+	TRACE_BEGIN(TRACE_LOCK, trace);
+	osMutexWait(mutex, osWaitForever);
+	TRACE_END(TRACE_LOCK, trace);
 }
 
 /** faultCondition
@@ -156,6 +573,10 @@ void heartbeat(void){
  */
 void faultCondition(void){
 	BSP_Contactor_Off();
+	TRACE_INSTANT(TRACE_FAULT, 0);
+	BSP_WDTimer_Reset();
+	ChargeControl_Stop();
+	sendChargerSetpoint();
 	BSP_Light_Off(RUN);
     BSP_Light_On(FAULT);
 
@@ -194,9 +615,12 @@ void faultCondition(void){
 		BSP_Light_On(OTEMP);
 	}
 
-	// Log all the errors that we have
+	// Log all the errors that we have. Every EEPROM write takes a few ms, keep feeding the
+	// watchdog so it does not run out before the fault loop.
+	PROFILE_BEGIN(PROBE_EEPROM_LOG);
 	for(int i = 1; i < 0x00FF; i <<= 1) {
 		if(error & i) EEPROM_LogError(i);
+		BSP_WDTimer_Reset();
 	}
 
 	// Log all the relevant data for each error
@@ -210,8 +634,10 @@ void faultCondition(void){
 		// Temperature fault handling
 		case FAULT_HIGH_TEMP:
 			temp_modules = Temperature_GetModulesInDanger();
-			for(int j = 0; j < NUM_BATTERY_MODULES; ++j)
+			for(int j = 0; j < NUM_BATTERY_MODULES; ++j) {
 				if(temp_modules[j]) EEPROM_LogData(FAULT_HIGH_TEMP, j);
+				BSP_WDTimer_Reset();
+			}
 			break;
 
 		// Voltage fault handling
@@ -219,8 +645,10 @@ void faultCondition(void){
 		case FAULT_LOW_VOLT:
 		case FAULT_VOLT_MISC:
 			voltage_modules = Voltage_GetModulesInDanger();
-			for(int j = 0; j < NUM_BATTERY_MODULES; ++j)
+			for(int j = 0; j < NUM_BATTERY_MODULES; ++j) {
 				if(voltage_modules[j]) EEPROM_LogData(i, j);
+				BSP_WDTimer_Reset();
+			}
 			break;
 
 		// Current fault handling
@@ -234,6 +662,7 @@ void faultCondition(void){
 			break;
 		}
 	}
+	PROFILE_END(PROBE_EEPROM_LOG);
 
 	while(1) {
 		Current_UpdateMeasurements();
@@ -242,6 +671,7 @@ void faultCondition(void){
 		}
 		BSP_WDTimer_Reset();	// Even though faulted, WDTimer needs to be updated or else system will reset
 					// causing WDOG error. WDTimer can't be stopped after it starts.
+		osDelay(SCHED_SAFETY_PERIOD_MS);
 	}
 }
 	
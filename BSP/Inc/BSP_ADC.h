@@ -6,26 +6,111 @@
 //return this if the ADC is not available
 #define BAD_ADC 0xffff
 
+/**
+ * @note    Both hall effect sensors are sampled together at ADC_SAMPLE_RATE_HZ by a timer.
+ *          The DMA fills one half of a double buffer while the interrupt averages the other
+ *          half into one reading per ADC_BLOCK_SIZE samples. Readings wait in a queue of
+ *          ADC_QUEUE_SIZE until BSP_ADC_ReadSamples takes them.
+ */
+#ifndef ADC_SAMPLE_RATE_HZ
+#define ADC_SAMPLE_RATE_HZ  2000        // Conversions per second of each channel (1kHz - 10kHz)
+#endif
+#define ADC_BLOCK_SIZE      64          // Samples averaged into one reading
+#define ADC_QUEUE_SIZE      32          // Readings kept until they are read, must be a power of 2
+
+typedef struct {
+    uint32_t timestamp;         // Samples taken since BSP_ADC_Init, at the end of the block
+    uint16_t highMilliVolts;    // Average of the high precision sensor over the block
+    uint16_t lowMilliVolts;     // Average of the low precision sensor over the block
+} ADC_Sample;
+
 /**
  * @brief   Initializes the ADC module. This is to measure the hall effect sensors
- *          on the Current Monitor Board.
+ *          on the Current Monitor Board. Sampling starts right away.
  * @param   None
  * @return  None
  */
 void BSP_ADC_Init(void);
 
+/**
+ * @brief   Takes the readings that were averaged since the last call, oldest first.
+ *          If the queue filled up the newest readings were dropped, the timestamps show the gap.
+ * @param   samples array to store the readings in
+ * @param   max     size of the array
+ * @return  number of readings stored
+ */
+uint32_t BSP_ADC_ReadSamples(ADC_Sample *samples, uint32_t max);
+
+/**
+ * @brief   Gets the sum of every conversion of the low precision sensor since BSP_ADC_Init.
+ *          The DMA interrupt keeps the sum so no sample is lost however late the reader is.
+ * @param   count   where to store how many conversions were summed, same count as
+ *                  ADC_Sample.timestamp. Wraps around, subtract two counts.
+ * @return  sum of the 12 bit codes
+ */
+uint64_t BSP_ADC_GetLowSum(uint32_t *count);
+
 /**
  * @brief   Gets converted ADC value in units of mV.
  * @param   None
- * @return  millivoltage value ADC measurement
+ * @return  millivoltage value ADC measurement, average of the newest block
  */
 uint16_t BSP_ADC_High_GetMilliVoltage(void);
 
 /**
  * @brief   Gets converted ADC value in units of mV.
  * @param   None
- * @return  millivoltage value ADC measurement
+ * @return  millivoltage value ADC measurement, average of the newest block
  */
 uint16_t BSP_ADC_Low_GetMilliVoltage(void);
 
+/**
+ * @brief   Copies the next raw conversions of the high precision sensor into a buffer so
+ *          the waveform can be analysed. Whole blocks are copied as they are averaged.
+ * @param   buffer  where to store the 12 bit codes, in use until BSP_ADC_IsCaptureDone
+ * @param   count   number of conversions, a multiple of ADC_BLOCK_SIZE
+ * @return  None
+ */
+void BSP_ADC_StartCapture(uint16_t *buffer, uint32_t count);
+
+/**
+ * @brief   Checks if the capture started by BSP_ADC_StartCapture is complete
+ * @param   None
+ * @return  true once the buffer holds all the conversions
+ */
+bool BSP_ADC_IsCaptureDone(void);
+
+/**
+ * @brief   Arms the analog watchdog on the low precision channel. A single conversion outside
+ *          the window opens the contactor right from the ADC interrupt and latches the trip,
+ *          without waiting for the block average or the main loop.
+ * @param   lowMilliVolts   conversions below this trip
+ * @param   highMilliVolts  conversions above this trip
+ * @return  None
+ */
+void BSP_ADC_Watchdog_Init(uint16_t lowMilliVolts, uint16_t highMilliVolts);
+
+/**
+ * @brief   Checks if the analog watchdog has tripped since it was armed. The trip stays
+ *          latched until BSP_ADC_Watchdog_Init is called again.
+ * @param   timestamp   where to store the sample the trip happened on, same count as
+ *                      ADC_Sample.timestamp. May be NULL.
+ * @return  true if it tripped
+ */
+bool BSP_ADC_Watchdog_Tripped(uint32_t *timestamp);
+
+#ifdef SIMULATION
+/**
+ * @brief   Runs raw conversions through the same double buffer and block averaging the STM32
+ *          does in its DMA interrupt, and checks each conversion against the analog watchdog like
+ *          the ADC interrupt would. Once this has been called the simulator stops sampling
+ *          ADC.csv so tests see only the samples they feed in.
+ * @param   high    12 bit codes of the high precision sensor
+ * @param   low     12 bit codes of the low precision sensor
+ * @param   count   number of conversions
+ * @return  None
+ */
+void BSP_ADC_SimulateSamples(const uint16_t *high, const uint16_t *low, uint32_t count);
+#endif
+
 #endif
@@ -41,4 +41,13 @@ void BSP_Contactor_Off(void);
  */
 bool BSP_Contactor_GetState(void);
 
+#ifdef SIMULATION
+/**
+ * @brief   Tells when BSP_Contactor_Off first opened the closed contactor
+ * @param   cycles  where to store BSP_Timer_GetCycleCount of that call, may be NULL
+ * @return  times a closed contactor has been opened since BSP_Contactor_Init
+ */
+uint32_t BSP_Contactor_GetOpenings(uint32_t *cycles);
+#endif
+
 #endif
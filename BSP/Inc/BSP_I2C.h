@@ -32,4 +32,14 @@ uint8_t BSP_I2C_Write(uint8_t deviceAddr, uint16_t regAddr, uint8_t *txData, uin
  */
 uint8_t BSP_I2C_Read(uint8_t deviceAddr, uint16_t regAddr, uint8_t *rxData, uint32_t rxLen);
 
+#ifdef SIMULATION
+/**
+ * @brief   Cuts the power during the next write. The EEPROM only gets the first bytes of it right,
+ *          the rest of the page it was writing is left garbled.
+ * @param   bytes : how many bytes of the next write make it
+ * @return  None
+ */
+void BSP_I2C_SimulatePowerLoss(uint32_t bytes);
+#endif
+
 #endif
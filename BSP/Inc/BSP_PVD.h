@@ -0,0 +1,24 @@
+#ifndef __BSP_PVD_H
+#define __BSP_PVD_H
+
+#include "common.h"
+
+/**
+ * @brief   Initializes the programmable voltage detector. The handler is called from an interrupt
+ *          as soon as the supply starts to drop, while there is still time for a short EEPROM write.
+ *          It runs at interrupt priority, so it has to hand the write over to a thread.
+ * @param   handler   function to call when the supply drops
+ * @return  None
+ */
+void BSP_PVD_Init(void (*handler)(void));
+
+#ifdef SIMULATION
+/**
+ * @brief   Drops the supply, runs the handler like the interrupt would.
+ * @param   None
+ * @return  None
+ */
+void BSP_PVD_SimulateDrop(void);
+#endif
+
+#endif
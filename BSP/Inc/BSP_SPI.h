@@ -4,18 +4,36 @@
 #include "common.h"
 
 /**
- * @note    If other ICs need to be connected onto the SPI line, this code will have to be modified.
+ * @note    Each LTC6811 daisy chain is connected to its own SPI peripheral and LTC6820.
+ *          Every function takes the chain handle so the chains can be driven independently.
+ *          If other ICs need to be connected onto the SPI line, this code will have to be modified.
  */
 
+typedef enum {SPI_CHAIN_0 = 0, SPI_CHAIN_1, SPI_CHAIN_2, SPI_CHAIN_3, MAX_SPI_CHAINS} SPI_Chain;
+
+// isoSPI bit rates a chain can be clocked at. The SPI prescaler only divides by powers of two
+// so every step doubles the rate. The LTC6820 is rated for 1Mbps, SPI_SPEED_1250K is past that.
+typedef enum {SPI_SPEED_156K = 0, SPI_SPEED_312K, SPI_SPEED_625K, SPI_SPEED_1250K, NUM_SPI_SPEEDS} SPI_Speed;
+
+#define SPI_SPEED_DEFAULT	SPI_SPEED_625K		// Rate set up by BSP_SPI_Init
+
 /**
- * @brief   Initializes the SPI port connected to the LTC6820.
+ * @brief   Initializes the SPI port connected to the LTC6820 of a daisy chain.
  *          This port communicates with the LTC6811 voltage and temperature
  *          monitoring IC. The LTC6820 converts the SPI pins to 2-wire isolated SPI.
  *          Look at analog devices website and LTC6811's or LTC6820's datasheets.
- * @param   None
+ * @param   chain   daisy chain to initialize
+ * @return  None
+ */
+void BSP_SPI_Init(SPI_Chain chain);
+
+/**
+ * @brief   Changes the bit rate of a daisy chain. Waits for a running transfer to finish first.
+ * @param   chain   daisy chain to change
+ * @param   speed   new bit rate
  * @return  None
  */
-void BSP_SPI_Init(void);
+void BSP_SPI_SetSpeed(SPI_Chain chain, SPI_Speed speed);
 
 /**
  * @brief   Transmits data to through SPI.
@@ -24,11 +42,12 @@ void BSP_SPI_Init(void);
  *          the SPI protocol expects where a transmit and receive happen
  *          simultaneously.
  * @note    Blocking statement
+ * @param   chain   daisy chain to send the data on
  * @param   txBuf   data array that contains the data to be sent.
  * @param   txLen   length of data array.
  * @return  None
  */
-void BSP_SPI_Write(uint8_t *txBuf, uint32_t txLen);
+void BSP_SPI_Write(SPI_Chain chain, uint8_t *txBuf, uint32_t txLen);
 
 /**
  * @brief   Gets the data from SPI. With the way the LTC6811 communication works,
@@ -36,20 +55,85 @@ void BSP_SPI_Write(uint8_t *txBuf, uint32_t txLen);
  *          The SPI protocol requires the uC to transmit data in order to receive
  *          anything so the uC will send junk data.
  * @note    Blocking statement
+ * @param   chain   daisy chain to read the data from
  * @param   rxBuf   data array to store the data that is received.
  * @param   rxLen   length of data array.
  * @return  None
  */
-void BSP_SPI_Read(uint8_t *rxBuf, uint32_t rxLen);
+void BSP_SPI_Read(SPI_Chain chain, uint8_t *rxBuf, uint32_t rxLen);
+
+/**
+ * @brief   Starts a command + read transaction in the background.
+ *          txBuf is clocked out first and the following rxLen bytes are stored in rxBuf.
+ *          Transfers on different chains run at the same time, which lets the whole pack
+ *          be read in the time it takes to read the longest chain.
+ * @note    Non-blocking. Chip select is not touched, pull it low before the call and
+ *          only release it once BSP_SPI_IsBusy returns false. Both buffers must stay
+ *          valid until then.
+ * @param   chain   daisy chain to run the transaction on
+ * @param   txBuf   command bytes to send
+ * @param   txLen   number of command bytes
+ * @param   rxBuf   data array to store the data that is received
+ * @param   rxLen   number of bytes to receive after the command
+ * @return  None
+ */
+void BSP_SPI_StartWriteRead(SPI_Chain chain, uint8_t *txBuf, uint32_t txLen, uint8_t *rxBuf, uint32_t rxLen);
+
+/**
+ * @brief   Checks if a transaction started by BSP_SPI_StartWriteRead is still running.
+ * @param   chain   daisy chain to check
+ * @return  true if the transfer is still in progress, false if rxBuf is ready
+ */
+bool BSP_SPI_IsBusy(SPI_Chain chain);
 
 /**
  * @brief   Sets the state of the chip select output pin.
  *          Set the state to low/0 to notify the LTC6811 that the data sent on the
  *          SPI lines are for it. Set the state to high/1 to make the LTC6811
  *          go to standby.
+ * @param   chain   daisy chain whose chip select pin is set
  * @param   state   0 for select, 1 to deselect
  * @return  None
  */
-void BSP_SPI_SetStateCS(uint8_t state);
+void BSP_SPI_SetStateCS(SPI_Chain chain, uint8_t state);
+
+#ifdef SIMULATION
+/**
+ * @brief   Gets how long the simulated isoSPI link of a chain has been busy since BSP_SPI_Init.
+ *          Used to compare scan times of different chain layouts.
+ * @param   chain   daisy chain to check
+ * @return  bus time in microseconds
+ */
+uint32_t BSP_SPI_GetBusTimeUs(SPI_Chain chain);
+
+/**
+ * @brief   Sets the fastest rate the simulated isoSPI cable of a chain carries cleanly.
+ *          Reads at higher rates get PEC errors, more often the further past the limit they are.
+ *          Every chain is clean at all rates until this is called.
+ * @param   chain   daisy chain to change
+ * @param   fastest fastest error free bit rate
+ * @return  None
+ */
+void BSP_SPI_SetLinkLimit(SPI_Chain chain, SPI_Speed fastest);
+
+// Faults the simulator can put on a temperature sensor
+typedef enum {
+    SIM_SENSOR_OK = 0,      // Reads the temperature in SPI.csv
+    SIM_SENSOR_SHORTED,     // Output shorted to ground, reads 0V
+    SIM_SENSOR_OPEN,        // Output disconnected, GPIO1 floats up to 5V
+    SIM_SENSOR_STUCK,       // Keeps the reading it had when the fault was set
+    SIM_SENSOR_DETACHED     // Fell off its module, reads the air around it (20C)
+} SimSensorFault;
+
+/**
+ * @brief   Puts a fault on a simulated temperature sensor. A stuck sensor keeps the reading
+ *          it had when the fault was set. Faults are cleared by BSP_SPI_Init.
+ * @param   board   index of board (0-indexed)
+ * @param   channel board channel, mux * 8 + mux channel (0-indexed)
+ * @param   fault   fault to inject, SIM_SENSOR_OK to repair the sensor
+ * @return  None
+ */
+void BSP_SPI_SetSensorFault(uint8_t board, uint8_t channel, SimSensorFault fault);
+#endif
 
 #endif
@@ -31,4 +31,36 @@ uint32_t BSP_Timer_GetTicksElapsed(void);
  */
 uint32_t BSP_Timer_GetRunFreq(void);
 
+/**
+ * @brief   Gets a free running count of CPU cycles for measuring how long code takes.
+ *          The simulator counts nanoseconds instead. Wraps around, subtract two counts.
+ * @param   None
+ * @return  cycle count
+ */
+uint32_t BSP_Timer_GetCycleCount(void);
+
+/**
+ * @brief   Starts the 1ms system tick the scheduler runs on.
+ * @param   None
+ * @return  None
+ */
+void BSP_Timer_StartTick(void);
+
+/**
+ * @brief   Gets the number of 1ms system ticks since BSP_Timer_StartTick.
+ *          Wraps around after 49 days, subtract two counts.
+ * @param   None
+ * @return  milliseconds
+ */
+uint32_t BSP_Timer_GetTick(void);
+
+/**
+ * @brief   Sleeps until the next interrupt. Over more than one tick the tick interrupt is
+ *          held off, every other interrupt stays armed and wakes the CPU early. Call with
+ *          interrupts disabled. The simulator has no interrupts and just waits the ticks.
+ * @param   ticks until the next thread is due
+ * @return  ticks that went by without a tick interrupt, the caller has to catch up on them
+ */
+uint32_t BSP_Timer_Sleep(uint32_t ticks);
+
 #endif
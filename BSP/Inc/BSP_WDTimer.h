@@ -3,6 +3,10 @@
 
 #include "common.h"
 
+#ifndef WDTIMER_TIMEOUT_MS
+#define WDTIMER_TIMEOUT_MS  250     // Time without BSP_WDTimer_Reset before a reset, 1 to 4095
+#endif
+
 /**
  * @brief   Initialize the watch dog timer.
  * @param   None
@@ -1,9 +1,33 @@
 #include "BSP_ADC.h"
+#include "BSP_Contactor.h"
 #include "stm32f4xx.h"
 
-static volatile uint16_t ADCresults[2];
+#define ADC_TIMER_CLOCK     1000000     // TIM3 counts at 1MHz
 
-static uint16_t ConvertBitsToMilliVoltage(uint16_t data);
+// Each half holds ADC_BLOCK_SIZE conversions of both channels, high precision first
+static volatile uint16_t ADCresults[2][ADC_BLOCK_SIZE][2];
+
+// Readings published by the DMA interrupt. Only the interrupt moves head and only
+// BSP_ADC_ReadSamples moves tail so neither needs to disable interrupts.
+static volatile ADC_Sample sampleQueue[ADC_QUEUE_SIZE];
+static volatile uint32_t queueHead;
+static volatile uint32_t queueTail;
+static volatile ADC_Sample newest;
+static volatile uint32_t sampleCount;
+static volatile uint64_t lowSum;			// Every low precision conversion added up
+
+// Analog watchdog trip, latched by the ADC interrupt
+static volatile bool watchdogTripped;
+static volatile uint32_t watchdogTimestamp;
+
+// Raw conversions copied out for BSP_ADC_StartCapture
+static uint16_t * volatile captureBuffer;
+static volatile uint32_t captureCount;
+static volatile uint32_t captureIdx;
+
+static uint16_t ConvertBlockToMilliVoltage(uint32_t sum);
+static uint16_t ConvertMilliVoltageToCode(uint16_t milliVolts);
+static void ADC_AverageBlock(volatile uint16_t (*block)[2]);
 
 static void ADC_InitDMA(void) {
 	// Start the clock for the DMA
@@ -16,7 +40,7 @@ static void ADC_InitDMA(void) {
 	DMA_InitStruct.DMA_PeripheralBaseAddr = (uint32_t)&(ADC1->DR);
 	DMA_InitStruct.DMA_Memory0BaseAddr = (uint32_t) &ADCresults;
 	DMA_InitStruct.DMA_DIR = DMA_DIR_PeripheralToMemory;
-	DMA_InitStruct.DMA_BufferSize = 2;
+	DMA_InitStruct.DMA_BufferSize = 2 * ADC_BLOCK_SIZE * 2;
 	DMA_InitStruct.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
 	DMA_InitStruct.DMA_MemoryInc = DMA_MemoryInc_Enable;
 	DMA_InitStruct.DMA_PeripheralDataSize = DMA_PeripheralDataSize_HalfWord;
@@ -29,13 +53,45 @@ static void ADC_InitDMA(void) {
 	DMA_InitStruct.DMA_PeripheralBurst = DMA_PeripheralBurst_Single;
 	DMA_Init(DMA2_Stream0, &DMA_InitStruct);
 
+	// Interrupt when either half is full
+	DMA_ITConfig(DMA2_Stream0, DMA_IT_HT | DMA_IT_TC, ENABLE);
+
+	NVIC_InitTypeDef NVIC_InitStructure;
+	NVIC_InitStructure.NVIC_IRQChannel = DMA2_Stream0_IRQn;
+	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 1;
+	NVIC_InitStructure.NVIC_IRQChannelSubPriority = 1;
+	NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_Init(&NVIC_InitStructure);
+
 	// Enable DMA2 stream 0
 	DMA_Cmd(DMA2_Stream0, ENABLE);
 }
 
+/**
+ * @brief   Sets up TIM3 to start one conversion of both channels every 1/ADC_SAMPLE_RATE_HZ
+ */
+static void ADC_InitTimer(void) {
+	RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM3, ENABLE);
+
+	// APB1 runs at SYSCLK/4 so its timers get twice that
+	RCC_ClocksTypeDef clocks;
+	RCC_GetClocksFreq(&clocks);
+
+	TIM_TimeBaseInitTypeDef Init_TIM3;
+	Init_TIM3.TIM_Prescaler = (clocks.PCLK1_Frequency * 2) / ADC_TIMER_CLOCK - 1;
+	Init_TIM3.TIM_CounterMode = TIM_CounterMode_Up;
+	Init_TIM3.TIM_Period = ADC_TIMER_CLOCK / ADC_SAMPLE_RATE_HZ - 1;
+	Init_TIM3.TIM_ClockDivision = TIM_CKD_DIV1;
+	Init_TIM3.TIM_RepetitionCounter = 0;
+	TIM_TimeBaseInit(TIM3, &Init_TIM3);
+
+	// Every update event triggers the ADC
+	TIM_SelectOutputTrigger(TIM3, TIM_TRGOSource_Update);
+}
+
 /**
  * @brief   Initializes the ADC module. This is to measure the hall effect sensors
- *          on the Current Monitor Board.
+ *          on the Current Monitor Board. Sampling starts right away.
  * @param   None
  * @return  None
  */
@@ -43,7 +99,15 @@ void BSP_ADC_Init(void) {
     RCC_APB2PeriphClockCmd(RCC_APB2Periph_ADC1, ENABLE);	// Enable the ADC clock
 	RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_GPIOA, ENABLE);	// Enable the PA clock
 
+	queueHead = 0;
+	queueTail = 0;
+	sampleCount = 0;
+	lowSum = 0;
+	captureCount = 0;
+	captureIdx = 0;
+
 	ADC_InitDMA();
+	ADC_InitTimer();
 
 	GPIO_InitTypeDef GPIO_InitStruct;
 	GPIO_InitStruct.GPIO_Pin = GPIO_Pin_3 | GPIO_Pin_2;	// Using pins PA2 and PA3 for the ADC
@@ -63,9 +127,9 @@ void BSP_ADC_Init(void) {
 	ADC_InitTypeDef ADC_InitStruct;	// Initialization structure
 	ADC_InitStruct.ADC_Resolution = ADC_Resolution_12b;	// High resolution
 	ADC_InitStruct.ADC_ScanConvMode = ENABLE;						// So we can go through all the channels
-	ADC_InitStruct.ADC_ContinuousConvMode = ENABLE; 		// Cycle the channels
-	ADC_InitStruct.ADC_ExternalTrigConvEdge = ADC_ExternalTrigConvEdge_None;
-	ADC_InitStruct.ADC_ExternalTrigConv = DISABLE;
+	ADC_InitStruct.ADC_ContinuousConvMode = DISABLE; 		// One scan of both channels per trigger
+	ADC_InitStruct.ADC_ExternalTrigConvEdge = ADC_ExternalTrigConvEdge_Rising;
+	ADC_InitStruct.ADC_ExternalTrigConv = ADC_ExternalTrigConv_T3_TRGO;
 	ADC_InitStruct.ADC_DataAlign = ADC_DataAlign_Right;
 	ADC_InitStruct.ADC_NbrOfConversion = 2;							// We have two channels that we need to read
 
@@ -74,6 +138,7 @@ void BSP_ADC_Init(void) {
 	// Configure the channels
 	// Apparently channel 2 has priority, or is at least read first.
 	// If you change the priorities, be prepared to have the order in the array change.
+	// Both conversions (2 x (480 + 12) cycles at 20MHz) take about 50us, well inside 1/ADC_SAMPLE_RATE_HZ.
 	ADC_RegularChannelConfig(ADC1, ADC_Channel_2, 2, ADC_SampleTime_480Cycles);
 	ADC_RegularChannelConfig(ADC1, ADC_Channel_3, 1, ADC_SampleTime_480Cycles);
 
@@ -84,44 +149,203 @@ void BSP_ADC_Init(void) {
 	// Enable ADC1
 	ADC_Cmd(ADC1, ENABLE);
 
-	ADC_SoftwareStartConv(ADC1);
+	// Conversions start with the first timer update
+	TIM_Cmd(TIM3, ENABLE);
 }
 
 /**
- * @brief   Gets converted ADC value in units of mV.
+ * @brief   Copies the next raw conversions of the high precision sensor into a buffer so
+ *          the waveform can be analysed. Whole blocks are copied as they are averaged.
+ * @param   buffer  where to store the 12 bit codes, in use until BSP_ADC_IsCaptureDone
+ * @param   count   number of conversions, a multiple of ADC_BLOCK_SIZE
+ * @return  None
+ */
+void BSP_ADC_StartCapture(uint16_t *buffer, uint32_t count) {
+	// The interrupt copies nothing while the count is 0
+	captureCount = 0;
+	captureBuffer = buffer;
+	captureIdx = 0;
+	captureCount = count;
+}
+
+/**
+ * @brief   Checks if the capture started by BSP_ADC_StartCapture is complete
  * @param   None
- * @return  millivoltage value ADC measurement
+ * @return  true once the buffer holds all the conversions
  */
-uint16_t BSP_ADC_High_GetMilliVoltage(void) {
+bool BSP_ADC_IsCaptureDone(void) {
+	return captureCount > 0 && captureIdx >= captureCount;
+}
+
+/**
+ * @brief   Arms the analog watchdog on the low precision channel. A single conversion outside
+ *          the window opens the contactor right from the ADC interrupt and latches the trip,
+ *          without waiting for the block average or the main loop.
+ * @param   lowMilliVolts   conversions below this trip
+ * @param   highMilliVolts  conversions above this trip
+ * @return  None
+ */
+void BSP_ADC_Watchdog_Init(uint16_t lowMilliVolts, uint16_t highMilliVolts) {
+	watchdogTripped = false;
+	watchdogTimestamp = 0;
+
+	// There is one watchdog per ADC. The high precision sensor saturates below the discharge
+	// limit so only the low precision sensor (channel 2) can see the whole range.
+	ADC_AnalogWatchdogThresholdsConfig(ADC1, ConvertMilliVoltageToCode(highMilliVolts), ConvertMilliVoltageToCode(lowMilliVolts));
+	ADC_AnalogWatchdogSingleChannelConfig(ADC1, ADC_Channel_2);
+	ADC_AnalogWatchdogCmd(ADC1, ADC_AnalogWatchdog_SingleRegEnable);
+
+	ADC_ClearITPendingBit(ADC1, ADC_IT_AWD);
+	ADC_ITConfig(ADC1, ADC_IT_AWD, ENABLE);
 
-    // TODO: Get ADC value and convert
-    // Get ADC raw data
-    uint16_t data = ADCresults[0];
-    
-    // Convert to millivoltage
-    uint16_t mV = ConvertBitsToMilliVoltage(data);
+	// Above the DMA interrupt so a trip is never held up by the block averaging
+	NVIC_InitTypeDef NVIC_InitStructure;
+	NVIC_InitStructure.NVIC_IRQChannel = ADC_IRQn;
+	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 0;
+	NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+	NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_Init(&NVIC_InitStructure);
+}
 
-    return mV;
+/**
+ * @brief   Checks if the analog watchdog has tripped since it was armed. The trip stays
+ *          latched until BSP_ADC_Watchdog_Init is called again.
+ * @param   timestamp   where to store the sample the trip happened on, same count as
+ *                      ADC_Sample.timestamp. May be NULL.
+ * @return  true if it tripped
+ */
+bool BSP_ADC_Watchdog_Tripped(uint32_t *timestamp) {
+	if(watchdogTripped && timestamp != NULL) {
+		*timestamp = watchdogTimestamp;
+	}
+	return watchdogTripped;
+}
+
+/**
+ * @brief   Takes the readings that were averaged since the last call, oldest first.
+ *          If the queue filled up the newest readings were dropped, the timestamps show the gap.
+ * @param   samples array to store the readings in
+ * @param   max     size of the array
+ * @return  number of readings stored
+ */
+uint32_t BSP_ADC_ReadSamples(ADC_Sample *samples, uint32_t max) {
+	uint32_t count = 0;
+	while(count < max && queueTail != queueHead) {
+		samples[count] = sampleQueue[queueTail % ADC_QUEUE_SIZE];
+		queueTail++;
+		count++;
+	}
+	return count;
+}
+
+/**
+ * @brief   Gets the sum of every conversion of the low precision sensor since BSP_ADC_Init.
+ *          The DMA interrupt keeps the sum so no sample is lost however late the reader is.
+ * @param   count   where to store how many conversions were summed, same count as
+ *                  ADC_Sample.timestamp. Wraps around, subtract two counts.
+ * @return  sum of the 12 bit codes
+ */
+uint64_t BSP_ADC_GetLowSum(uint32_t *count) {
+	uint64_t sum;
+	uint32_t before;
+
+	// The sum takes two reads, start over if a block was added in between
+	do {
+		before = sampleCount;
+		sum = lowSum;
+	} while(before != sampleCount);
+
+	*count = before;
+	return sum;
+}
+
+/**
+ * @brief   Gets converted ADC value in units of mV.
+ * @param   None
+ * @return  millivoltage value ADC measurement, average of the newest block
+ */
+uint16_t BSP_ADC_High_GetMilliVoltage(void) {
+    return newest.highMilliVolts;
 }
 
 /**
  * @brief   Gets converted ADC value in units of mV.
  * @param   None
- * @return  millivoltage value ADC measurement
+ * @return  millivoltage value ADC measurement, average of the newest block
  */
 uint16_t BSP_ADC_Low_GetMilliVoltage(void) {
+    return newest.lowMilliVolts;
+}
+
+/**
+ * @brief   Averages one half of the double buffer and publishes the reading
+ * @param   block   ADC_BLOCK_SIZE conversions of both channels
+ */
+static void ADC_AverageBlock(volatile uint16_t (*block)[2]) {
+	uint32_t high = 0;
+	uint32_t low = 0;
+	for(int i = 0; i < ADC_BLOCK_SIZE; i++) {
+		high += block[i][0];
+		low += block[i][1];
+	}
 
-    // TODO: Get ADC value and convert
-    // Get ADC raw data
-    uint16_t data = ADCresults[1];
-    
-    // Convert to millivoltage
-    uint16_t mV = ConvertBitsToMilliVoltage(data);
+	// Hand the raw high precision conversions to a capture in progress
+	if(captureIdx < captureCount) {
+		for(int i = 0; i < ADC_BLOCK_SIZE; i++) {
+			captureBuffer[captureIdx + i] = block[i][0];
+		}
+		captureIdx += ADC_BLOCK_SIZE;
+	}
 
-    return mV;
+	lowSum += low;
+	sampleCount += ADC_BLOCK_SIZE;
+	newest.timestamp = sampleCount;
+	newest.highMilliVolts = ConvertBlockToMilliVoltage(high);
+	newest.lowMilliVolts = ConvertBlockToMilliVoltage(low);
+
+	// Drop the reading if the main loop has fallen a whole queue behind
+	if(queueHead - queueTail < ADC_QUEUE_SIZE) {
+		sampleQueue[queueHead % ADC_QUEUE_SIZE] = newest;
+		queueHead++;
+	}
+}
+
+static uint16_t ConvertBlockToMilliVoltage(uint32_t sum) {
+    // Convert to millivoltage, dividing the sum keeps the extra resolution of the average
+    return (sum * 3300) / (4096 * ADC_BLOCK_SIZE);   // For 12-bit ADCs
 }
 
-static uint16_t ConvertBitsToMilliVoltage(uint16_t data) {
-    // Convert to millivoltage
-    return (data * 3300) >> 12;   // For 12-bit ADCs
-}
\ No newline at end of file
+static uint16_t ConvertMilliVoltageToCode(uint16_t milliVolts) {
+	// Rounded down, the watchdog compares raw 12 bit conversions
+	return ((uint32_t)milliVolts * 4096) / 3300;
+}
+
+void ADC_IRQHandler(void) {
+	if(ADC_GetITStatus(ADC1, ADC_IT_AWD) != RESET) {
+		// Open the contactor first, everything else can wait
+		BSP_Contactor_Off();
+
+		// Stay latched, the watchdog would fire on every conversion until the current drops
+		ADC_ITConfig(ADC1, ADC_IT_AWD, DISABLE);
+		ADC_ClearITPendingBit(ADC1, ADC_IT_AWD);
+
+		// Samples taken so far, the DMA has stored (buffer size - remaining) / 2 of this round
+		uint32_t stored = (2 * ADC_BLOCK_SIZE * 2 - DMA_GetCurrDataCounter(DMA2_Stream0)) / 2;
+		watchdogTimestamp = sampleCount + (stored - 1) % ADC_BLOCK_SIZE + 1;
+		watchdogTripped = true;
+	}
+}
+
+void DMA2_Stream0_IRQHandler(void) {
+	// First half is full, the DMA moved on to the second
+	if(DMA_GetITStatus(DMA2_Stream0, DMA_IT_HTIF0) != RESET) {
+		DMA_ClearITPendingBit(DMA2_Stream0, DMA_IT_HTIF0);
+		ADC_AverageBlock(ADCresults[0]);
+	}
+
+	// Second half is full, the DMA wrapped around to the first
+	if(DMA_GetITStatus(DMA2_Stream0, DMA_IT_TCIF0) != RESET) {
+		DMA_ClearITPendingBit(DMA2_Stream0, DMA_IT_TCIF0);
+		ADC_AverageBlock(ADCresults[1]);
+	}
+}
@@ -90,9 +90,9 @@ void BSP_CAN_Init(void) {
     /* Enable FIFO 0 message pending Interrupt */
     CAN_ITConfig(CAN1, CAN_IT_FMP0, ENABLE);
 
-    // Enable Rx interrupts
+    // Enable Rx interrupts, below the analog watchdog
     NVIC_InitStructure.NVIC_IRQChannel = CAN1_RX0_IRQn;
-    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 0x0;
+    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 0x1;
     NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0x0;
     NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
     NVIC_Init(&NVIC_InitStructure);	
@@ -111,7 +111,7 @@ uint8_t BSP_CAN_Write(uint32_t id, uint8_t data[8], uint8_t length) {
 	for(int i = 0; i < length; i++){
         TxMessage.Data[i] = data[i];
 	}
-	return CAN_Transmit(CAN1, &TxMessage);
+	return CAN_Transmit(CAN1, &TxMessage) != CAN_TxStatus_NoMailBox;
 }
 
 /**
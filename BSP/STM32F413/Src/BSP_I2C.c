@@ -1,8 +1,19 @@
 #include "BSP_I2C.h"
 #include "stm32f4xx.h"
+#include "Counters.h"
 
 #define TIMEOUT_THRESHOLD   1200000 // 15 ms delay threshold (3x the write time)
 
+/**
+ * @brief   Counts a transfer given up on after TIMEOUT_THRESHOLD.
+ * @param   None
+ * @return  ERROR
+ */
+static uint8_t TimedOut(void) {
+    COUNTER_INC(COUNTER_I2C_TIMEOUTS);
+    return ERROR;
+}
+
 /**
  * @brief   Initializes the I2C port that interfaces with the EEPROM.
  * @param   None
@@ -61,7 +72,7 @@ uint8_t BSP_I2C_Write(uint8_t deviceAddr, uint16_t regAddr, uint8_t *txData, uin
 		timeout_count++;
 		// Returns and breaks after timeout threshold
 		if(timeout_count > TIMEOUT_THRESHOLD) {
-			return ERROR;
+			return TimedOut();
 		}
 	}
 
@@ -79,7 +90,7 @@ uint8_t BSP_I2C_Write(uint8_t deviceAddr, uint16_t regAddr, uint8_t *txData, uin
 		timeout_count++;
 		// Returns and breaks after timeout threshold
 		if(timeout_count > TIMEOUT_THRESHOLD) {
-			return ERROR;
+			return TimedOut();
 		}
 	}
 
@@ -99,7 +110,7 @@ uint8_t BSP_I2C_Write(uint8_t deviceAddr, uint16_t regAddr, uint8_t *txData, uin
 		timeout_count++;
 		// Returns and breaks after timeout threshold
 		if(timeout_count > TIMEOUT_THRESHOLD) {
-			return ERROR;
+			return TimedOut();
 		}
 	}
 
@@ -112,7 +123,7 @@ uint8_t BSP_I2C_Write(uint8_t deviceAddr, uint16_t regAddr, uint8_t *txData, uin
 		timeout_count++;
 		// Returns and breaks after timeout threshold
 		if(timeout_count > TIMEOUT_THRESHOLD) {
-			return ERROR;
+			return TimedOut();
 		}
 	}
 	// Send rest of start address (LSB)
@@ -124,7 +135,7 @@ uint8_t BSP_I2C_Write(uint8_t deviceAddr, uint16_t regAddr, uint8_t *txData, uin
 		timeout_count++;
 		// Returns and breaks after timeout threshold
 		if(timeout_count > TIMEOUT_THRESHOLD) {
-			return ERROR;
+			return TimedOut();
 		}
 	}
 
@@ -135,7 +146,7 @@ uint8_t BSP_I2C_Write(uint8_t deviceAddr, uint16_t regAddr, uint8_t *txData, uin
 		timeout_count++;
 		// Returns and breaks after timeout threshold
 		if(timeout_count > TIMEOUT_THRESHOLD) {
-			return ERROR;
+			return TimedOut();
 		}
 	}
 
@@ -153,7 +164,7 @@ uint8_t BSP_I2C_Write(uint8_t deviceAddr, uint16_t regAddr, uint8_t *txData, uin
 		timeout_count++;
 		// Returns and breaks after timeout threshold
 		if(timeout_count > TIMEOUT_THRESHOLD) {
-			return ERROR;
+			return TimedOut();
 		}
 	}
 
@@ -176,7 +187,7 @@ uint8_t BSP_I2C_Read(uint8_t deviceAddr, uint16_t regAddr, uint8_t *rxData, uint
 		timeout_count++;
 		// Returns and breaks after timeout threshold
 		if(timeout_count > TIMEOUT_THRESHOLD) {
-			return ERROR;
+			return TimedOut();
 		}
 	}
 	
@@ -194,7 +205,7 @@ uint8_t BSP_I2C_Read(uint8_t deviceAddr, uint16_t regAddr, uint8_t *rxData, uint
 		timeout_count++;
 		// Returns and breaks after timeout threshold
 		if(timeout_count > TIMEOUT_THRESHOLD) {
-			return ERROR;
+			return TimedOut();
 		}
 	}
 
@@ -212,7 +223,7 @@ uint8_t BSP_I2C_Read(uint8_t deviceAddr, uint16_t regAddr, uint8_t *rxData, uint
 		timeout_count++;
 		// Returns and breaks after timeout threshold
 		if(timeout_count > TIMEOUT_THRESHOLD) {
-			return ERROR;
+			return TimedOut();
 		}
 	}
 
@@ -225,7 +236,7 @@ uint8_t BSP_I2C_Read(uint8_t deviceAddr, uint16_t regAddr, uint8_t *rxData, uint
 		timeout_count++;
 		// Returns and breaks after timeout threshold
 		if(timeout_count > TIMEOUT_THRESHOLD) {
-			return ERROR;
+			return TimedOut();
 		}
 	}
 	// Send rest of start address (LSB)
@@ -237,7 +248,7 @@ uint8_t BSP_I2C_Read(uint8_t deviceAddr, uint16_t regAddr, uint8_t *rxData, uint
 		timeout_count++;
 		// Returns and breaks after timeout threshold
 		if(timeout_count > TIMEOUT_THRESHOLD) {
-			return ERROR;
+			return TimedOut();
 		}
 	}
 
@@ -248,7 +259,7 @@ uint8_t BSP_I2C_Read(uint8_t deviceAddr, uint16_t regAddr, uint8_t *rxData, uint
 		timeout_count++;
 		// Returns and breaks after timeout threshold
 		if(timeout_count > TIMEOUT_THRESHOLD) {
-			return ERROR;
+			return TimedOut();
 		}
 	}
 
@@ -264,7 +275,7 @@ uint8_t BSP_I2C_Read(uint8_t deviceAddr, uint16_t regAddr, uint8_t *rxData, uint
 		timeout_count++;
 		// Returns and breaks after timeout threshold
 		if(timeout_count > TIMEOUT_THRESHOLD) {
-			return ERROR;
+			return TimedOut();
 		}
 	}
 
@@ -277,7 +288,7 @@ uint8_t BSP_I2C_Read(uint8_t deviceAddr, uint16_t regAddr, uint8_t *rxData, uint
 		timeout_count++;
 		// Returns and breaks after timeout threshold
 		if(timeout_count > TIMEOUT_THRESHOLD) {
-			return ERROR;
+			return TimedOut();
 		}
 	}
 
@@ -290,7 +301,7 @@ uint8_t BSP_I2C_Read(uint8_t deviceAddr, uint16_t regAddr, uint8_t *rxData, uint
 				timeout_count++;
 				// Returns and breaks after timeout threshold
 				if(timeout_count > TIMEOUT_THRESHOLD) {
-					return ERROR;
+					return TimedOut();
 				}
 			}
 			*rxData = I2C_ReceiveData(I2C3);
@@ -306,7 +317,7 @@ uint8_t BSP_I2C_Read(uint8_t deviceAddr, uint16_t regAddr, uint8_t *rxData, uint
 				timeout_count++;
 				// Returns and breaks after timeout threshold
 				if(timeout_count > TIMEOUT_THRESHOLD) {
-					return ERROR;
+					return TimedOut();
 				}
 			}
 
@@ -0,0 +1,46 @@
+#include "BSP_PVD.h"
+#include "stm32f4xx.h"
+
+static void (*dropHandler)(void);
+
+/**
+ * @brief   Initializes the programmable voltage detector. The handler is called from an interrupt
+ *          as soon as the supply starts to drop, while there is still time for a short EEPROM write.
+ *          It runs at interrupt priority, so it has to hand the write over to a thread.
+ * @param   handler   function to call when the supply drops
+ * @return  None
+ */
+void BSP_PVD_Init(void (*handler)(void)) {
+	dropHandler = handler;
+
+	RCC_APB1PeriphClockCmd(RCC_APB1Periph_PWR, ENABLE);
+
+	// Highest threshold (2.9V) to leave the most time before the brown out reset
+	PWR_PVDLevelConfig(PWR_PVDLevel_7);
+
+	// The PVD output rises when VDD falls below the threshold, it reaches the NVIC through EXTI line 16
+	EXTI_InitTypeDef EXTI_InitStructure;
+	EXTI_InitStructure.EXTI_Line = EXTI_Line16;
+	EXTI_InitStructure.EXTI_Mode = EXTI_Mode_Interrupt;
+	EXTI_InitStructure.EXTI_Trigger = EXTI_Trigger_Rising;
+	EXTI_InitStructure.EXTI_LineCmd = ENABLE;
+	EXTI_Init(&EXTI_InitStructure);
+
+	NVIC_InitTypeDef NVIC_InitStructure;
+	NVIC_InitStructure.NVIC_IRQChannel = PVD_IRQn;
+	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 1;
+	NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+	NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_Init(&NVIC_InitStructure);
+
+	PWR_PVDCmd(ENABLE);
+}
+
+void PVD_IRQHandler(void) {
+	if(EXTI_GetITStatus(EXTI_Line16) != RESET) {
+		EXTI_ClearITPendingBit(EXTI_Line16);
+		if(dropHandler != NULL) {
+			dropHandler();
+		}
+	}
+}
@@ -4,57 +4,164 @@
 // Use this macro function to wait until SPI communication is complete
 #define SPI_Wait(SPIx)		while(((SPIx)->SR & (SPI_SR_TXE | SPI_SR_RXNE)) == 0 || ((SPIx)->SR & SPI_SR_BSY))
 
-/** SPI1_WriteRead
+// Largest transaction on a chain: 4B command + 8B register for every IC on the chain
+#define SPI_DMA_BUFFER_SIZE		256
+
+typedef struct {
+	GPIO_TypeDef *port;
+	uint16_t pin;
+	uint8_t source;
+	uint8_t af;
+} SPI_Pin;
+
+typedef struct {
+	SPI_TypeDef *spi;
+	bool apb2;						// SPI1 and SPI4 hang off APB2, SPI2 and SPI3 off APB1
+	uint32_t rccPeriph;
+	SPI_Pin sck;
+	SPI_Pin miso;
+	SPI_Pin mosi;
+	GPIO_TypeDef *csPort;
+	uint16_t csPin;
+	DMA_Stream_TypeDef *rxStream;
+	DMA_Stream_TypeDef *txStream;
+	uint32_t dmaChannel[2];			// [rx, tx]
+	uint32_t rxCompleteIT;
+	IRQn_Type rxIRQ;
+} SPI_ChainConfig;
+
+// DMA2 Stream0 belongs to the ADC so SPI1/SPI4 use the alternate DMA2 streams.
+static const SPI_ChainConfig ChainConfig[MAX_SPI_CHAINS] = {
+	// SPI1: PB3 SCK, PB4 MISO, PB5 MOSI, PB6 CS
+	{SPI1, true, RCC_APB2Periph_SPI1,
+		{GPIOB, GPIO_Pin_3, GPIO_PinSource3, GPIO_AF_SPI1},
+		{GPIOB, GPIO_Pin_4, GPIO_PinSource4, GPIO_AF_SPI1},
+		{GPIOB, GPIO_Pin_5, GPIO_PinSource5, GPIO_AF_SPI1},
+		GPIOB, GPIO_Pin_6,
+		DMA2_Stream2, DMA2_Stream5, {DMA_Channel_3, DMA_Channel_3}, DMA_IT_TCIF2, DMA2_Stream2_IRQn},
+	// SPI2: PC7 SCK, PB14 MISO, PB15 MOSI, PB7 CS
+	{SPI2, false, RCC_APB1Periph_SPI2,
+		{GPIOC, GPIO_Pin_7, GPIO_PinSource7, GPIO_AF_SPI2},
+		{GPIOB, GPIO_Pin_14, GPIO_PinSource14, GPIO_AF_SPI2},
+		{GPIOB, GPIO_Pin_15, GPIO_PinSource15, GPIO_AF_SPI2},
+		GPIOB, GPIO_Pin_7,
+		DMA1_Stream3, DMA1_Stream4, {DMA_Channel_0, DMA_Channel_0}, DMA_IT_TCIF3, DMA1_Stream3_IRQn},
+	// SPI3: PC10 SCK, PC11 MISO, PC12 MOSI, PA15 CS
+	{SPI3, false, RCC_APB1Periph_SPI3,
+		{GPIOC, GPIO_Pin_10, GPIO_PinSource10, GPIO_AF_SPI3},
+		{GPIOC, GPIO_Pin_11, GPIO_PinSource11, GPIO_AF_SPI3},
+		{GPIOC, GPIO_Pin_12, GPIO_PinSource12, GPIO_AF_SPI3},
+		GPIOA, GPIO_Pin_15,
+		DMA1_Stream0, DMA1_Stream5, {DMA_Channel_0, DMA_Channel_0}, DMA_IT_TCIF0, DMA1_Stream0_IRQn},
+	// SPI4: PB13 SCK, PA11 MISO, PA1 MOSI, PC8 CS
+	{SPI4, true, RCC_APB2Periph_SPI4,
+		{GPIOB, GPIO_Pin_13, GPIO_PinSource13, GPIO_AF6_SPI4},
+		{GPIOA, GPIO_Pin_11, GPIO_PinSource11, GPIO_AF6_SPI4},
+		{GPIOA, GPIO_Pin_1, GPIO_PinSource1, GPIO_AF_SPI4},
+		GPIOC, GPIO_Pin_8,
+		DMA2_Stream3, DMA2_Stream1, {DMA_Channel_5, DMA_Channel_4}, DMA_IT_TCIF3, DMA2_Stream3_IRQn},
+};
+
+// Prescalers for each SPI_Speed. APB2 runs at 40MHz and APB1 at 20MHz so both
+// buses end up at the same isoSPI bit rate.
+static const uint16_t PrescalerAPB2[NUM_SPI_SPEEDS] = {
+	SPI_BaudRatePrescaler_256, SPI_BaudRatePrescaler_128, SPI_BaudRatePrescaler_64, SPI_BaudRatePrescaler_32
+};
+static const uint16_t PrescalerAPB1[NUM_SPI_SPEEDS] = {
+	SPI_BaudRatePrescaler_128, SPI_BaudRatePrescaler_64, SPI_BaudRatePrescaler_32, SPI_BaudRatePrescaler_16
+};
+
+// Background transfer state of each chain
+static uint8_t txStage[MAX_SPI_CHAINS][SPI_DMA_BUFFER_SIZE];
+static uint8_t rxStage[MAX_SPI_CHAINS][SPI_DMA_BUFFER_SIZE];
+static uint8_t *rxDest[MAX_SPI_CHAINS];
+static uint32_t rxOffset[MAX_SPI_CHAINS];
+static uint32_t rxCount[MAX_SPI_CHAINS];
+static volatile bool transferBusy[MAX_SPI_CHAINS];
+
+/** SPI_WriteRead
  * @brief   Sends and receives a byte of data on the SPI line.
+ * @param   SPIx   SPI peripheral of the chain
  * @param   txData single byte that will be sent to the device.
  * @return  rxData single byte that was read from the device.
  */
-static uint8_t SPI_WriteRead(uint8_t txData){
-	SPI_Wait(SPI1);
-	SPI1->DR = txData & 0x00FF;
-	SPI_Wait(SPI1);
-	return SPI1->DR & 0x00FF;
+static uint8_t SPI_WriteRead(SPI_TypeDef *SPIx, uint8_t txData){
+	SPI_Wait(SPIx);
+	SPIx->DR = txData & 0x00FF;
+	SPI_Wait(SPIx);
+	return SPIx->DR & 0x00FF;
+}
+
+static void SPI_InitPin(const SPI_Pin *p) {
+	GPIO_InitTypeDef GPIO_InitStruct;
+	GPIO_InitStruct.GPIO_Pin = p->pin;
+	GPIO_InitStruct.GPIO_Mode = GPIO_Mode_AF;
+	GPIO_InitStruct.GPIO_PuPd = GPIO_PuPd_UP;
+	GPIO_InitStruct.GPIO_Speed = GPIO_Speed_50MHz;
+	GPIO_InitStruct.GPIO_OType = GPIO_OType_PP;
+	GPIO_Init(p->port, &GPIO_InitStruct);
+	GPIO_PinAFConfig(p->port, p->source, p->af);
+}
+
+static void SPI_InitDMAStream(DMA_Stream_TypeDef *stream, uint32_t channel, uint32_t dir,
+								SPI_TypeDef *spi, uint8_t *buf, uint32_t len) {
+	DMA_InitTypeDef DMA_InitStruct;
+
+	// Resets the stream and clears its event flags, a stream can't be enabled with stale flags
+	DMA_DeInit(stream);
+
+	DMA_InitStruct.DMA_Channel = channel;
+	DMA_InitStruct.DMA_PeripheralBaseAddr = (uint32_t)&(spi->DR);
+	DMA_InitStruct.DMA_Memory0BaseAddr = (uint32_t)buf;
+	DMA_InitStruct.DMA_DIR = dir;
+	DMA_InitStruct.DMA_BufferSize = len;
+	DMA_InitStruct.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+	DMA_InitStruct.DMA_MemoryInc = DMA_MemoryInc_Enable;
+	DMA_InitStruct.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+	DMA_InitStruct.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+	DMA_InitStruct.DMA_Mode = DMA_Mode_Normal;
+	DMA_InitStruct.DMA_Priority = DMA_Priority_Medium;
+	DMA_InitStruct.DMA_FIFOMode = DMA_FIFOMode_Disable;
+	DMA_InitStruct.DMA_FIFOThreshold = DMA_FIFOThreshold_HalfFull;
+	DMA_InitStruct.DMA_MemoryBurst = DMA_MemoryBurst_Single;
+	DMA_InitStruct.DMA_PeripheralBurst = DMA_PeripheralBurst_Single;
+	DMA_Init(stream, &DMA_InitStruct);
 }
 
 /**
- * @brief   Initializes the SPI port connected to the LTC6820.
+ * @brief   Initializes the SPI port connected to the LTC6820 of a daisy chain.
  *          This port communicates with the LTC6811 voltage and temperature
  *          monitoring IC. The LTC6820 converts the SPI pins to 2-wire isolated SPI.
  *          Look at analog devices website and LTC6811's or LTC6820's datasheets.
- * @param   None
+ * @param   chain   daisy chain to initialize
  * @return  None
  */
-void BSP_SPI_Init(void) {
+void BSP_SPI_Init(SPI_Chain chain) {
     //      SPI configuration:
-    //          speed : 125kbps
+    //          speed : SPI_SPEED_DEFAULT, 625kbps (APB2 / 64 or APB1 / 32). Changed with BSP_SPI_SetSpeed
     //          CPOL : 1 (polarity of clock during idle is high)
     //          CPHA : 1 (tx recorded during 2nd edge)
-    // Pins:
-    //      SPI1:
-    //          PB3 : SCK
-    //          PB4 : MISO
-    //          PB5 : MOSI 
-    //          PB6 : CS
+    // Pins: see ChainConfig
 
+	const SPI_ChainConfig *cfg = &ChainConfig[chain];
     GPIO_InitTypeDef GPIO_InitStruct;
 	SPI_InitTypeDef SPI_InitStruct;
-	
+	NVIC_InitTypeDef NVIC_InitStructure;
+
 	// Initialize clocks
-	RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_GPIOB, ENABLE);
-	RCC_APB2PeriphClockCmd(RCC_APB2Periph_SPI1, ENABLE);
-	
+	RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_GPIOA | RCC_AHB1Periph_GPIOB | RCC_AHB1Periph_GPIOC, ENABLE);
+	RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_DMA1 | RCC_AHB1Periph_DMA2, ENABLE);
+	if(cfg->apb2) {
+		RCC_APB2PeriphClockCmd(cfg->rccPeriph, ENABLE);
+	} else {
+		RCC_APB1PeriphClockCmd(cfg->rccPeriph, ENABLE);
+	}
+
 	// Initialize pins
-	GPIO_InitStruct.GPIO_Pin = GPIO_Pin_3 | GPIO_Pin_4 | GPIO_Pin_5;
-	GPIO_InitStruct.GPIO_Mode = GPIO_Mode_AF;
-	GPIO_InitStruct.GPIO_PuPd = GPIO_PuPd_UP;
-	GPIO_InitStruct.GPIO_Speed = GPIO_Speed_50MHz;
-	GPIO_InitStruct.GPIO_OType = GPIO_OType_PP;
-	GPIO_Init(GPIOB, &GPIO_InitStruct);
-	
-	GPIO_PinAFConfig(GPIOB, GPIO_PinSource3, GPIO_AF_SPI1);
-	GPIO_PinAFConfig(GPIOB, GPIO_PinSource4, GPIO_AF_SPI1);
-	GPIO_PinAFConfig(GPIOB, GPIO_PinSource5, GPIO_AF_SPI1);
-	
+	SPI_InitPin(&cfg->sck);
+	SPI_InitPin(&cfg->miso);
+	SPI_InitPin(&cfg->mosi);
+
 	// Initialize SPI port
 	SPI_InitStruct.SPI_Direction = SPI_Direction_2Lines_FullDuplex;
 	SPI_InitStruct.SPI_Mode = SPI_Mode_Master;
@@ -62,19 +169,47 @@ void BSP_SPI_Init(void) {
 	SPI_InitStruct.SPI_CPOL = SPI_CPOL_High;
 	SPI_InitStruct.SPI_CPHA = SPI_CPHA_2Edge;
 	SPI_InitStruct.SPI_NSS = SPI_NSS_Soft;
-	SPI_InitStruct.SPI_BaudRatePrescaler = SPI_BaudRatePrescaler_64;
+	SPI_InitStruct.SPI_BaudRatePrescaler = cfg->apb2 ? PrescalerAPB2[SPI_SPEED_DEFAULT] : PrescalerAPB1[SPI_SPEED_DEFAULT];
 	SPI_InitStruct.SPI_FirstBit = SPI_FirstBit_MSB;
-	SPI_InitStruct.SPI_CRCPolynomial = 0;	
-	SPI_Init(SPI1, &SPI_InitStruct);
-	SPI_Cmd(SPI1, ENABLE);
+	SPI_InitStruct.SPI_CRCPolynomial = 0;
+	SPI_Init(cfg->spi, &SPI_InitStruct);
+	SPI_Cmd(cfg->spi, ENABLE);
 
     // Initialize CS pin
-    GPIO_InitStruct.GPIO_Pin = GPIO_Pin_6;
+    GPIO_InitStruct.GPIO_Pin = cfg->csPin;
     GPIO_InitStruct.GPIO_Mode = GPIO_Mode_OUT;
     GPIO_InitStruct.GPIO_PuPd = GPIO_PuPd_UP;
 	GPIO_InitStruct.GPIO_Speed = GPIO_Speed_50MHz;
 	GPIO_InitStruct.GPIO_OType = GPIO_OType_PP;
-    GPIO_Init(GPIOB, &GPIO_InitStruct);
+    GPIO_Init(cfg->csPort, &GPIO_InitStruct);
+	GPIO_SetBits(cfg->csPort, cfg->csPin);
+
+	// Only the receive stream raises an interrupt. It finishes after the transmit stream.
+	transferBusy[chain] = false;
+	NVIC_InitStructure.NVIC_IRQChannel = cfg->rxIRQ;
+	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 1;
+	NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+	NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_Init(&NVIC_InitStructure);
+}
+
+/**
+ * @brief   Changes the bit rate of a daisy chain. Waits for a running transfer to finish first.
+ * @param   chain   daisy chain to change
+ * @param   speed   new bit rate
+ * @return  None
+ */
+void BSP_SPI_SetSpeed(SPI_Chain chain, SPI_Speed speed) {
+	const SPI_ChainConfig *cfg = &ChainConfig[chain];
+	uint16_t prescaler = cfg->apb2 ? PrescalerAPB2[speed] : PrescalerAPB1[speed];
+
+	// The baud rate bits may only be changed while the peripheral is idle
+	while(transferBusy[chain]);
+	while(cfg->spi->SR & SPI_SR_BSY);
+
+	SPI_Cmd(cfg->spi, DISABLE);
+	cfg->spi->CR1 = (cfg->spi->CR1 & ~SPI_CR1_BR) | prescaler;
+	SPI_Cmd(cfg->spi, ENABLE);
 }
 
 /**
@@ -84,13 +219,14 @@ void BSP_SPI_Init(void) {
  *          the SPI protocol expects where a transmit and receive happen
  *          simultaneously.
  * @note    Blocking statement
+ * @param   chain   daisy chain to send the data on
  * @param   txBuf   data array that contains the data to be sent.
  * @param   txLen   length of data array.
  * @return  None
  */
-void BSP_SPI_Write(uint8_t *txBuf, uint32_t txLen) {
+void BSP_SPI_Write(SPI_Chain chain, uint8_t *txBuf, uint32_t txLen) {
     for(uint32_t i = 0; i < txLen; i++){
-		SPI_WriteRead(txBuf[i]);
+		SPI_WriteRead(ChainConfig[chain].spi, txBuf[i]);
 	}
 }
 
@@ -100,29 +236,122 @@ void BSP_SPI_Write(uint8_t *txBuf, uint32_t txLen) {
  *          The SPI protocol requires the uC to transmit data in order to receive
  *          anything so the uC will send junk data.
  * @note    Blocking statement
+ * @param   chain   daisy chain to read the data from
  * @param   rxBuf   data array to store the data that is received.
  * @param   rxLen   length of data array.
  * @return  None
  */
-void BSP_SPI_Read(uint8_t *rxBuf, uint32_t rxLen) {
+void BSP_SPI_Read(SPI_Chain chain, uint8_t *rxBuf, uint32_t rxLen) {
     for(uint32_t i = 0; i < rxLen; i++){
-		rxBuf[i] = SPI_WriteRead(0x00);
+		rxBuf[i] = SPI_WriteRead(ChainConfig[chain].spi, 0x00);
 	}
 }
 
+/**
+ * @brief   Starts a command + read transaction in the background.
+ *          txBuf is clocked out first and the following rxLen bytes are stored in rxBuf.
+ *          Transfers on different chains run at the same time, which lets the whole pack
+ *          be read in the time it takes to read the longest chain.
+ * @note    Non-blocking. Chip select is not touched, pull it low before the call and
+ *          only release it once BSP_SPI_IsBusy returns false. Both buffers must stay
+ *          valid until then.
+ * @param   chain   daisy chain to run the transaction on
+ * @param   txBuf   command bytes to send
+ * @param   txLen   number of command bytes
+ * @param   rxBuf   data array to store the data that is received
+ * @param   rxLen   number of bytes to receive after the command
+ * @return  None
+ */
+void BSP_SPI_StartWriteRead(SPI_Chain chain, uint8_t *txBuf, uint32_t txLen, uint8_t *rxBuf, uint32_t rxLen) {
+	const SPI_ChainConfig *cfg = &ChainConfig[chain];
+	uint32_t len = txLen + rxLen;
+
+	if(len > SPI_DMA_BUFFER_SIZE) {
+		// Too long for the staging buffers, fall back to the blocking path
+		BSP_SPI_Write(chain, txBuf, txLen);
+		BSP_SPI_Read(chain, rxBuf, rxLen);
+		return;
+	}
+
+	// The command is followed by junk bytes that clock the response out of the chain
+	memcpy(txStage[chain], txBuf, txLen);
+	memset(&txStage[chain][txLen], 0, rxLen);
+	rxDest[chain] = rxBuf;
+	rxOffset[chain] = txLen;
+	rxCount[chain] = rxLen;
+	transferBusy[chain] = true;
+
+	// Flush anything left in the receive register from the polled functions
+	SPI_Wait(cfg->spi);
+	(void)cfg->spi->DR;
+
+	SPI_InitDMAStream(cfg->rxStream, cfg->dmaChannel[0], DMA_DIR_PeripheralToMemory, cfg->spi, rxStage[chain], len);
+	SPI_InitDMAStream(cfg->txStream, cfg->dmaChannel[1], DMA_DIR_MemoryToPeripheral, cfg->spi, txStage[chain], len);
+	DMA_ITConfig(cfg->rxStream, DMA_IT_TC, ENABLE);
+
+	// Receive stream has to be armed first so no byte is missed
+	DMA_Cmd(cfg->rxStream, ENABLE);
+	DMA_Cmd(cfg->txStream, ENABLE);
+	SPI_I2S_DMACmd(cfg->spi, SPI_I2S_DMAReq_Rx | SPI_I2S_DMAReq_Tx, ENABLE);
+}
+
+/**
+ * @brief   Checks if a transaction started by BSP_SPI_StartWriteRead is still running.
+ * @param   chain   daisy chain to check
+ * @return  true if the transfer is still in progress, false if rxBuf is ready
+ */
+bool BSP_SPI_IsBusy(SPI_Chain chain) {
+	return transferBusy[chain];
+}
+
 /**
  * @brief   Sets the state of the chip select output pin.
  *          Set the state to low/0 to notify the LTC6811 that the data sent on the
  *          SPI lines are for it. Set the state to high/1 to make the LTC6811
  *          go to standby.
+ * @param   chain   daisy chain whose chip select pin is set
  * @param   state   0 for select, 1 to deselect
  * @return  None
  */
-void BSP_SPI_SetStateCS(uint8_t state) {
-    // PB6 is the Chip Select pin for the LTC6811
+void BSP_SPI_SetStateCS(SPI_Chain chain, uint8_t state) {
     if(state) {
-        GPIO_SetBits(GPIOB, GPIO_Pin_6);
+        GPIO_SetBits(ChainConfig[chain].csPort, ChainConfig[chain].csPin);
     } else {
-        GPIO_ResetBits(GPIOB, GPIO_Pin_6);
+        GPIO_ResetBits(ChainConfig[chain].csPort, ChainConfig[chain].csPin);
     }
 }
+
+/**
+ * @brief   Finishes a background transfer once the receive stream is done.
+ * @param   chain   daisy chain that completed
+ */
+static void SPI_TransferComplete(SPI_Chain chain) {
+	const SPI_ChainConfig *cfg = &ChainConfig[chain];
+
+	if(DMA_GetITStatus(cfg->rxStream, cfg->rxCompleteIT) != RESET) {
+		DMA_ClearITPendingBit(cfg->rxStream, cfg->rxCompleteIT);
+
+		SPI_I2S_DMACmd(cfg->spi, SPI_I2S_DMAReq_Rx | SPI_I2S_DMAReq_Tx, DISABLE);
+		DMA_Cmd(cfg->rxStream, DISABLE);
+		DMA_Cmd(cfg->txStream, DISABLE);
+
+		memcpy(rxDest[chain], &rxStage[chain][rxOffset[chain]], rxCount[chain]);
+		transferBusy[chain] = false;
+	}
+}
+
+void DMA2_Stream2_IRQHandler(void) {
+	SPI_TransferComplete(SPI_CHAIN_0);
+}
+
+void DMA1_Stream3_IRQHandler(void) {
+	SPI_TransferComplete(SPI_CHAIN_1);
+}
+
+void DMA1_Stream0_IRQHandler(void) {
+	SPI_TransferComplete(SPI_CHAIN_2);
+}
+
+void DMA2_Stream3_IRQHandler(void) {
+	SPI_TransferComplete(SPI_CHAIN_3);
+}
@@ -1,5 +1,9 @@
 #include "BSP_Timer.h"
 #include "stm32f4xx.h"
+#include "cmsis_os.h"
+
+static volatile uint32_t Tick;
+static uint32_t TickCycles;			// SysTick counts per 1ms tick
 
 /**
  * @brief   Initialize the timer for time measurements.
@@ -53,3 +57,117 @@ uint32_t BSP_Timer_GetRunFreq(void) {
 
     return RCC_Clocks.SYSCLK_Frequency;
 }
+
+/**
+ * @brief   Gets a free running count of CPU cycles for measuring how long code takes.
+ *          The simulator counts nanoseconds instead. Wraps around, subtract two counts.
+ * @param   None
+ * @return  cycle count
+ */
+uint32_t BSP_Timer_GetCycleCount(void) {
+	// The DWT cycle counter is off after reset
+	if(!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) {
+		CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+		DWT->CYCCNT = 0;
+		DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	}
+	return DWT->CYCCNT;
+}
+
+/**
+ * @brief   Starts the 1ms system tick the scheduler runs on.
+ * @param   None
+ * @return  None
+ */
+void BSP_Timer_StartTick(void) {
+	RCC_ClocksTypeDef RCC_Clocks;
+	RCC_GetClocksFreq(&RCC_Clocks);
+
+	Tick = 0;
+	TickCycles = RCC_Clocks.HCLK_Frequency / 1000;
+	SysTick_Config(TickCycles);
+}
+
+/**
+ * @brief   Gets the number of 1ms system ticks since BSP_Timer_StartTick.
+ *          Wraps around after 49 days, subtract two counts.
+ * @param   None
+ * @return  milliseconds
+ */
+uint32_t BSP_Timer_GetTick(void) {
+	return Tick;
+}
+
+/**
+ * @brief   Sleeps until the next interrupt. Over more than one tick the tick interrupt is
+ *          held off by stretching the SysTick period, every other interrupt stays armed and
+ *          wakes the CPU early. Call with interrupts disabled, they run once the caller
+ *          enables them again. SLEEPDEEP stays cleared: Stop mode would halt the ADC timer,
+ *          its DMA and the analog watchdog.
+ * @param   ticks until the next thread is due
+ * @return  ticks that went by without a tick interrupt, the caller has to catch up on them
+ */
+uint32_t BSP_Timer_Sleep(uint32_t ticks) {
+	SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+
+	// The 24-bit SysTick limits how far the tick can be stretched
+	uint32_t maxTicks = SysTick_LOAD_RELOAD_Msk / TickCycles;
+	if(ticks > maxTicks) {
+		ticks = maxTicks;
+	}
+	if(ticks <= 1 || TickCycles == 0) {
+		__DSB();
+		__WFI();
+		return 0;
+	}
+
+	// Stop the counter, a tick that is already pending is not worth sleeping through
+	SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+	if(SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) {
+		SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+		return 0;
+	}
+	uint32_t left = SysTick->VAL;
+	uint32_t stretched = left + (ticks - 1) * TickCycles;
+	SysTick->LOAD = stretched - 1;
+	SysTick->VAL = 0;
+	SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+
+	__DSB();
+	__WFI();
+
+	SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+	uint32_t elapsed;
+	uint32_t remaining;
+	if(SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) {
+		// Slept all the way, the pending tick interrupt counts the last tick. The counter
+		// already started on another stretched period.
+		elapsed = ticks - 1;
+		uint32_t into = stretched - 1 - SysTick->VAL;
+		remaining = into < TickCycles ? TickCycles - into : 1;
+	} else {
+		// Woken early by another interrupt
+		uint32_t done = stretched - 1 - SysTick->VAL;
+		if(done < left) {
+			elapsed = 0;
+			remaining = left - done;
+		} else {
+			elapsed = 1 + (done - left) / TickCycles;
+			remaining = TickCycles - (done - left) % TickCycles;
+		}
+	}
+
+	// Finish the current tick, then back to 1ms periods
+	SysTick->LOAD = remaining - 1;
+	SysTick->VAL = 0;
+	SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+	SysTick->LOAD = TickCycles - 1;
+
+	Tick += elapsed;
+	return elapsed;
+}
+
+void SysTick_Handler(void) {
+	Tick++;
+	osSystickHandler();
+}
@@ -1,5 +1,6 @@
 #include "BSP_UART.h"
 #include "stm32f4xx.h"
+#include "Counters.h"
 
 #define TX_SIZE     128
 #define RX_SIZE     64
@@ -61,9 +62,10 @@ void BSP_UART_Init(void) {
 
     USART_Cmd(USART3, ENABLE);
 
+    // Below the analog watchdog, it has priority 0 to itself
     NVIC_InitTypeDef NVIC_InitStructure;
   	NVIC_InitStructure.NVIC_IRQChannel = USART3_IRQn;
-    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 0;
+    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 1;
     NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
     NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
     NVIC_Init(&NVIC_InitStructure);
@@ -111,7 +113,11 @@ uint32_t BSP_UART_Write(char *str, uint32_t len) {
     USART_ITConfig(USART3, USART_IT_TC, RESET);
     uint32_t sent = 0;
     while(*str != '\0' && len > 0) {
-        sent += TxFifo_Put(*str);
+        if(TxFifo_Put(*str)) {
+            sent++;
+        } else {
+            COUNTER_INC(COUNTER_UART_TX_DROPS);
+        }
         str++;
         len--;
     }
@@ -137,7 +143,9 @@ void USART3_IRQHandler(void) {
             // Sweet, just a "regular" key. Put it into the fifo
             // Doesn't matter if it fails. If it fails, then the data gets thrown away
             // and the easiest solution for this is to increase RX_SIZE
-            RxFifo_Put(data);
+            if(!RxFifo_Put(data)) {
+                COUNTER_INC(COUNTER_UART_RX_DROPS);
+            }
 
         } else {
 
@@ -163,7 +171,9 @@ void USART3_IRQHandler(void) {
     }
 
     if(USART_GetITStatus(USART3, USART_IT_ORE) != RESET) {
-
+        // A byte came in before the last one was read. Reading DR after SR clears the flag.
+        COUNTER_INC(COUNTER_UART_RX_DROPS);
+        (void)USART3->DR;
     }
 }
 
@@ -8,10 +8,11 @@
  */
 void BSP_WDTimer_Init(void) {
     // Independent Watchdog Init
-    // IWDG has a timeout value of 4.096 seconds.
+    // The 32kHz LSI divided by 32 counts milliseconds, the reload is the timeout.
+    // The LSI can run anywhere from 17kHz to 47kHz, the safety task feeds it far more often.
 	IWDG_WriteAccessCmd(IWDG_WriteAccess_Enable);       // Enable access to the IWDG_PR and IWDG_RLR registers
 	IWDG_SetPrescaler(IWDG_Prescaler_32);               // Prescaler divider feeding the counter clock
-	IWDG_SetReload(IWDG_RLR_RL);                        // Reload value set to 0xFFF
+	IWDG_SetReload(WDTIMER_TIMEOUT_MS & IWDG_RLR_RL);   // Reload value, at most 0xFFF
 }
 
 /**
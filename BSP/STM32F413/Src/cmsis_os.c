@@ -0,0 +1,580 @@
+/* The CMSIS-RTOS API of cmsis_os.h on a small preemptive kernel for the Cortex-M4.
+ * The highest priority ready thread runs, threads of the same priority take turns every tick.
+ * The 1ms SysTick (BSP_Timer) wakes delayed threads and times out waits, PendSV switches
+ * threads and saves the upper FPU registers only for threads that used the FPU.
+ * Mutexes are recursive and the owner inherits the priority of the highest thread waiting
+ * for it until it releases the mutex. Kernel objects come from fixed tables, nothing is freed.
+ * With nothing to run the idle thread sleeps until the next delay or timeout ends, skipping
+ * the ticks in between, and counts the cycles it slept for osKernelIdleTime.
+ * Critical sections lock out interrupts through BASEPRI, not PRIMASK. Priority 0 interrupts, the
+ * analog watchdog above all, are never held up by it and must not call it. In the kernel only
+ * the idle thread sets PRIMASK, from its last check to the wake up, so a masked interrupt can
+ * end the sleep.
+ */
+
+#include "cmsis_os.h"
+#include "BSP_Timer.h"
+#include "stm32f4xx.h"
+#include <stdbool.h>
+#include <string.h>
+
+#define MAX_THREADS         12
+#define MAX_MUTEXES         8
+#define MAX_QUEUES          4
+#define STACK_POOL_SIZE     (48 * 1024)     // Stacks of all threads but main (bytes)
+#define QUEUE_POOL_SIZE     64              // Messages of all queues
+#define DEFAULT_STACK_SIZE  2048
+#define IDLE_STACK_SIZE     256
+#define HANDLER_STACK_SIZE  2048            // Interrupts run on their own stack once main is a thread
+
+#if __NVIC_PRIO_BITS != 4
+#error "KERNEL_BASEPRI is priority 1 in the upper 4 bits"
+#endif
+#define KERNEL_BASEPRI  0x10        // Masks priority 1 and below, kept as a literal for PendSV_Handler
+#define STRINGIFY(x)    #x
+#define TO_STRING(x)    STRINGIFY(x)
+
+#define LOCK()      uint32_t basepri = __get_BASEPRI(); __set_BASEPRI_MAX(KERNEL_BASEPRI); __ISB()
+#define UNLOCK()    __set_BASEPRI(basepri)
+
+typedef enum {UNUSED = 0, READY, DELAYED, BLOCKED, TERMINATED} ThreadState;
+
+struct os_thread_cb {
+	uint32_t *sp;				// Saved stack pointer while switched out, has to stay first for PendSV
+	osPriority priority;		// Raised above basePriority while it owns a mutex a higher thread waits for
+	osPriority basePriority;
+	ThreadState state;
+	uint32_t wake;				// Tick a delay or a timed wait ends on
+	bool timed;
+	void *waitingOn;			// Mutex or queue while BLOCKED
+	uint32_t message;			// Handed over by osMessagePut to a thread waiting in osMessageGet
+	osStatus result;			// How the last wait ended
+};
+
+struct os_mutex_cb {
+	osThreadId owner;
+	uint32_t count;				// Times the owner took it
+	bool used;
+};
+
+struct os_messageQ_cb {
+	uint32_t *buffer;
+	uint32_t size;
+	uint32_t head;
+	uint32_t count;
+};
+
+static struct os_thread_cb Threads[MAX_THREADS];			// 0 is idle, 1 is main
+static struct os_mutex_cb Mutexes[MAX_MUTEXES];
+static struct os_messageQ_cb Queues[MAX_QUEUES];
+static uint32_t NumQueues;
+static uint64_t StackPool[STACK_POOL_SIZE / 8];
+static uint32_t StackUsed;
+static uint64_t IdleStack[IDLE_STACK_SIZE / 8];
+static uint64_t HandlerStack[HANDLER_STACK_SIZE / 8];
+static uint32_t QueuePool[QUEUE_POOL_SIZE];
+static uint32_t QueueUsed;
+static volatile uint32_t Ticks;
+static volatile bool Running = false;
+static uint64_t IdleCycles;					// Slept since osKernelStart
+static volatile uint32_t TickWraps;			// Ticks counted past 32 bits for osKernelIdleTime
+
+// Used by PendSV_Handler
+__attribute__((used)) static struct os_thread_cb *volatile Current;
+
+static void ThreadExit(void) {
+	osThreadTerminate(osThreadGetId());
+	while (1);
+}
+
+/** Reschedule
+ * Asks PendSV to switch to the highest priority ready thread once interrupts are enabled
+ * and no other handler runs
+ */
+static void Reschedule(void) {
+	if (Running) {
+		SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+	}
+}
+
+/** NextThread
+ * Picks the highest priority ready thread. The search starts after the current thread so
+ * threads of the same priority take turns.
+ * @return thread to run
+ */
+static struct os_thread_cb *NextThread(void) {
+	uint32_t current = Current - Threads;
+	struct os_thread_cb *next = NULL;
+	for (uint32_t i = 1; i <= MAX_THREADS; i++) {
+		struct os_thread_cb *thread = &Threads[(current + i) % MAX_THREADS];
+		if (thread->state == READY && (next == NULL || thread->priority > next->priority)) {
+			next = thread;
+		}
+	}
+	return next;		// Idle is always ready
+}
+
+/** Switch
+ * Called by PendSV_Handler between saving the old thread and restoring the new one
+ */
+__attribute__((used)) static void Switch(void) {
+	Current = NextThread();
+}
+
+/** Block
+ * Takes the current thread off the CPU until Wake or a timeout. Call with interrupts
+ * disabled, the switch happens once the caller enables them again.
+ * @param object mutex or queue to wait for
+ * @param millisec timeout, osWaitForever for none
+ */
+static void Block(void *object, uint32_t millisec) {
+	Current->state = BLOCKED;
+	Current->waitingOn = object;
+	Current->timed = millisec != osWaitForever;
+	Current->wake = Ticks + millisec;
+	Current->result = osEventTimeout;
+	Reschedule();
+}
+
+/** Wake
+ * Makes a blocked or delayed thread ready again. Call with interrupts disabled.
+ * @param thread to wake
+ * @param result why its wait ended
+ */
+static void Wake(struct os_thread_cb *thread, osStatus result) {
+	thread->state = READY;
+	thread->waitingOn = NULL;
+	thread->result = result;
+	if (thread->priority > Current->priority) {
+		Reschedule();
+	}
+}
+
+/** WakeDue
+ * Wakes the threads whose delay or timeout has run out. Call with interrupts disabled.
+ */
+static void WakeDue(void) {
+	for (uint32_t i = 0; i < MAX_THREADS; i++) {
+		struct os_thread_cb *thread = &Threads[i];
+		bool waiting = thread->state == DELAYED || (thread->state == BLOCKED && thread->timed);
+		if (waiting && (int32_t)(Ticks - thread->wake) >= 0) {
+			Wake(thread, osEventTimeout);
+		}
+	}
+}
+
+/** TicksToNextWake
+ * Call with interrupts disabled
+ * @return ticks until the first delay or timeout runs out, UINT32_MAX if none is running
+ */
+static uint32_t TicksToNextWake(void) {
+	uint32_t next = UINT32_MAX;
+	for (uint32_t i = 0; i < MAX_THREADS; i++) {
+		struct os_thread_cb *thread = &Threads[i];
+		bool waiting = thread->state == DELAYED || (thread->state == BLOCKED && thread->timed);
+		if (waiting) {
+			int32_t left = (int32_t)(thread->wake - Ticks);
+			if (left <= 0) {
+				return 0;
+			}
+			if ((uint32_t)left < next) {
+				next = left;
+			}
+		}
+	}
+	return next;
+}
+
+/** IdleThread
+ * Sleeps while no other thread is ready. The kernel stays locked from finding the next wake
+ * until after the sleep, a pending interrupt still ends the sleep and runs right after.
+ * WFI does not wake for an interrupt BASEPRI masks, so the sleep itself runs under PRIMASK.
+ */
+static void IdleThread(void const *argument) {
+	while (1) {
+		LOCK();
+		uint32_t start = BSP_Timer_GetCycleCount();
+		__disable_irq();
+		uint32_t skipped = BSP_Timer_Sleep(TicksToNextWake());
+		__enable_irq();		// Priority 0 runs here, everything else at UNLOCK
+		IdleCycles += BSP_Timer_GetCycleCount() - start;
+		if (skipped) {
+			if (Ticks + skipped < Ticks) {
+				TickWraps++;
+			}
+			Ticks += skipped;
+			WakeDue();
+		}
+		UNLOCK();
+	}
+}
+
+/** HighestWaiter
+ * @param object mutex or queue
+ * @return highest priority thread blocked on it, NULL if there is none
+ */
+static struct os_thread_cb *HighestWaiter(void *object) {
+	struct os_thread_cb *waiter = NULL;
+	for (uint32_t i = 0; i < MAX_THREADS; i++) {
+		struct os_thread_cb *thread = &Threads[i];
+		if (thread->state == BLOCKED && thread->waitingOn == object
+			&& (waiter == NULL || thread->priority > waiter->priority)) {
+			waiter = thread;
+		}
+	}
+	return waiter;
+}
+
+static bool InHandler(void) {
+	return __get_IPSR() != 0;
+}
+
+osStatus osKernelInitialize(void) {
+	// All 4 priority bits preempt (NVIC_PriorityGroup_4), the priorities NVIC_Init sets are
+	// the ones BASEPRI compares against
+	NVIC_SetPriorityGrouping(3);
+
+	LOCK();
+	memset(Threads, 0, sizeof(Threads));
+	memset(Mutexes, 0, sizeof(Mutexes));
+	NumQueues = 0;
+	StackUsed = 0;
+	QueueUsed = 0;
+
+	// main carries on as thread 1, its stack pointer gets saved on the first switch
+	Threads[1].priority = Threads[1].basePriority = osPriorityNormal;
+	Threads[1].state = READY;
+	Current = &Threads[1];
+	UNLOCK();
+
+	// Idle takes slot 0
+	osThreadDef_t idle = {IdleThread, osPriorityIdle, 1, 0};
+	osThreadCreate(&idle, NULL);
+	return osOK;
+}
+
+osStatus osKernelStart(void) {
+	if (Running) {
+		return osErrorOS;
+	}
+
+	// PendSV below everything so a switch never interrupts a handler
+	NVIC_SetPriority(PendSV_IRQn, (1 << __NVIC_PRIO_BITS) - 1);
+	NVIC_SetPriority(SysTick_IRQn, (1 << __NVIC_PRIO_BITS) - 2);
+
+	// main keeps its stack through the PSP, handlers get their own
+	__set_PSP(__get_MSP());
+	__set_CONTROL(__get_CONTROL() | CONTROL_SPSEL_Msk);
+	__ISB();
+	__set_MSP((uint32_t)&HandlerStack[HANDLER_STACK_SIZE / 8]);
+
+	IdleCycles = 0;
+	Running = true;
+	BSP_Timer_StartTick();
+	Reschedule();
+	return osOK;
+}
+
+int32_t osKernelRunning(void) {
+	return Running;
+}
+
+void osSystickHandler(void) {
+	if (!Running) {
+		return;
+	}
+
+	if (++Ticks == 0) {
+		TickWraps++;
+	}
+	WakeDue();
+
+	// Threads of the same priority as the current one get their turn
+	Reschedule();
+}
+
+uint64_t osKernelIdleTime(uint64_t *total) {
+	LOCK();
+	uint64_t cycles = IdleCycles;
+	uint64_t ticks = ((uint64_t)TickWraps << 32) | Ticks;		// Ticks only run once started
+	UNLOCK();
+	if (total != NULL) {
+		*total = ticks * 1000;
+	}
+	return cycles / (SystemCoreClock / 1000000);
+}
+
+osThreadId osThreadCreate(const osThreadDef_t *thread_def, void *argument) {
+	if (thread_def == NULL || thread_def->pthread == NULL) {
+		return NULL;
+	}
+	uint32_t size = thread_def->stacksize ? thread_def->stacksize : DEFAULT_STACK_SIZE;
+	size = (size + 7) & ~7UL;
+
+	LOCK();
+	struct os_thread_cb *thread = NULL;
+	for (uint32_t i = 0; i < MAX_THREADS && thread == NULL; i++) {
+		if (Threads[i].state == UNUSED) {
+			thread = &Threads[i];
+		}
+	}
+	uint32_t *top;
+	if (thread == &Threads[0]) {
+		top = (uint32_t *)&IdleStack[IDLE_STACK_SIZE / 8];
+	} else if (thread != NULL && StackUsed + size <= STACK_POOL_SIZE) {
+		StackUsed += size;
+		top = (uint32_t *)((uint8_t *)StackPool + StackUsed);
+	} else {
+		UNLOCK();
+		return NULL;
+	}
+
+	// The frame PendSV_Handler restores: exception frame first, then r4-r11 and EXC_RETURN
+	uint32_t *sp = top;
+	*--sp = 0x01000000;									// xPSR, Thumb
+	*--sp = (uint32_t)thread_def->pthread & ~1UL;		// PC
+	*--sp = (uint32_t)ThreadExit;						// LR, the thread returned
+	*--sp = 0;											// r12
+	*--sp = 0;											// r3
+	*--sp = 0;											// r2
+	*--sp = 0;											// r1
+	*--sp = (uint32_t)argument;							// r0
+	*--sp = 0xFFFFFFFD;									// EXC_RETURN, thread mode on the PSP without FPU state
+	for (uint8_t i = 0; i < 8; i++) {
+		*--sp = 0;										// r11-r4
+	}
+
+	thread->sp = sp;
+	thread->priority = thread->basePriority = thread_def->tpriority;
+	thread->waitingOn = NULL;
+	thread->state = READY;
+	if (thread->priority > Current->priority) {
+		Reschedule();
+	}
+	UNLOCK();
+	return thread;
+}
+
+osThreadId osThreadGetId(void) {
+	return Current;
+}
+
+osStatus osThreadTerminate(osThreadId thread_id) {
+	if (thread_id == NULL || thread_id == &Threads[0]) {
+		return osErrorParameter;
+	}
+	LOCK();
+	thread_id->state = TERMINATED;
+	if (thread_id == Current) {
+		Reschedule();
+	}
+	UNLOCK();
+	return osOK;
+}
+
+osStatus osThreadYield(void) {
+	Reschedule();
+	return osOK;
+}
+
+osStatus osDelay(uint32_t millisec) {
+	if (InHandler()) {
+		return osErrorISR;
+	}
+	LOCK();
+	Current->state = DELAYED;
+	Current->wake = Ticks + millisec;
+	Reschedule();
+	UNLOCK();
+	return osEventTimeout;
+}
+
+osMutexId osMutexCreate(const osMutexDef_t *mutex_def) {
+	if (mutex_def == NULL) {
+		return NULL;
+	}
+	LOCK();
+	struct os_mutex_cb *mutex = NULL;
+	for (uint32_t i = 0; i < MAX_MUTEXES && mutex == NULL; i++) {
+		if (!Mutexes[i].used) {
+			mutex = &Mutexes[i];
+			mutex->used = true;
+			mutex->owner = NULL;
+			mutex->count = 0;
+		}
+	}
+	UNLOCK();
+	return mutex;
+}
+
+osStatus osMutexWait(osMutexId mutex_id, uint32_t millisec) {
+	if (mutex_id == NULL) {
+		return osErrorParameter;
+	}
+	if (InHandler()) {
+		return osErrorISR;
+	}
+
+	LOCK();
+	if (mutex_id->owner == NULL || mutex_id->owner == Current) {
+		mutex_id->owner = Current;
+		mutex_id->count++;
+		UNLOCK();
+		return osOK;
+	}
+	if (millisec == 0) {
+		UNLOCK();
+		return osErrorResource;
+	}
+
+	// The owner runs at our priority until it lets go
+	if (mutex_id->owner->priority < Current->priority) {
+		mutex_id->owner->priority = Current->priority;
+	}
+	Block(mutex_id, millisec);
+	UNLOCK();
+
+	// osMutexRelease handed it over or the wait timed out
+	return Current->result == osOK ? osOK : osErrorTimeoutResource;
+}
+
+osStatus osMutexRelease(osMutexId mutex_id) {
+	if (mutex_id == NULL) {
+		return osErrorParameter;
+	}
+	if (InHandler()) {
+		return osErrorISR;
+	}
+
+	LOCK();
+	if (mutex_id->owner != Current) {
+		UNLOCK();
+		return osErrorResource;
+	}
+	if (--mutex_id->count > 0) {
+		UNLOCK();
+		return osOK;
+	}
+
+	// Back to its own priority, inheritance through a second mutex is not tracked
+	Current->priority = Current->basePriority;
+	struct os_thread_cb *waiter = HighestWaiter(mutex_id);
+	mutex_id->owner = waiter;
+	if (waiter != NULL) {
+		mutex_id->count = 1;
+		Wake(waiter, osOK);
+	}
+	Reschedule();
+	UNLOCK();
+	return osOK;
+}
+
+osMessageQId osMessageCreate(const osMessageQDef_t *queue_def, osThreadId thread_id) {
+	if (queue_def == NULL || queue_def->queue_sz == 0) {
+		return NULL;
+	}
+	LOCK();
+	if (NumQueues >= MAX_QUEUES || QueueUsed + queue_def->queue_sz > QUEUE_POOL_SIZE) {
+		UNLOCK();
+		return NULL;
+	}
+	struct os_messageQ_cb *queue = &Queues[NumQueues++];
+	queue->buffer = &QueuePool[QueueUsed];
+	queue->size = queue_def->queue_sz;
+	queue->head = 0;
+	queue->count = 0;
+	QueueUsed += queue_def->queue_sz;
+	UNLOCK();
+	return queue;
+}
+
+osStatus osMessagePut(osMessageQId queue_id, uint32_t info, uint32_t millisec) {
+	if (queue_id == NULL) {
+		return osErrorParameter;
+	}
+
+	LOCK();
+	// A waiting thread gets the message straight away
+	struct os_thread_cb *waiter = HighestWaiter(queue_id);
+	if (waiter != NULL) {
+		waiter->message = info;
+		Wake(waiter, osEventMessage);
+		UNLOCK();
+		return osOK;
+	}
+	if (queue_id->count == queue_id->size) {
+		UNLOCK();
+		return osErrorResource;
+	}
+	queue_id->buffer[(queue_id->head + queue_id->count) % queue_id->size] = info;
+	queue_id->count++;
+	UNLOCK();
+	return osOK;
+}
+
+osEvent osMessageGet(osMessageQId queue_id, uint32_t millisec) {
+	osEvent event = {.status = osErrorParameter, .def.message_id = queue_id};
+	if (queue_id == NULL) {
+		return event;
+	}
+
+	LOCK();
+	if (queue_id->count > 0) {
+		event.status = osEventMessage;
+		event.value.v = queue_id->buffer[queue_id->head];
+		queue_id->head = (queue_id->head + 1) % queue_id->size;
+		queue_id->count--;
+		UNLOCK();
+		return event;
+	}
+	if (millisec == 0) {
+		event.status = osOK;
+		UNLOCK();
+		return event;
+	}
+	if (InHandler()) {
+		event.status = osErrorISR;
+		UNLOCK();
+		return event;
+	}
+
+	Block(queue_id, millisec);
+	UNLOCK();
+
+	event.status = Current->result;
+	event.value.v = Current->message;
+	return event;
+}
+
+/** PendSV_Handler
+ * Saves the current thread on its own stack, lets Switch pick the next one and restores it.
+ * Bit 4 of EXC_RETURN is clear when the thread used the FPU, then s16-s31 go on the stack too.
+ * Locks the kernel like LOCK does, the analog watchdog can still interrupt a switch.
+ */
+__attribute__((naked)) void PendSV_Handler(void) {
+	__asm volatile(
+		"	mov		r0, #" TO_STRING(KERNEL_BASEPRI) "		\n"
+		"	msr		basepri, r0			\n"
+		"	isb							\n"
+		"	mrs		r0, psp				\n"
+		"	tst		lr, #0x10			\n"
+		"	it		eq					\n"
+		"	vstmdbeq r0!, {s16-s31}		\n"
+		"	stmdb	r0!, {r4-r11, lr}	\n"
+		"	ldr		r1, =Current		\n"
+		"	ldr		r2, [r1]			\n"
+		"	str		r0, [r2]			\n"
+		"	bl		Switch				\n"
+		"	ldr		r1, =Current		\n"
+		"	ldr		r2, [r1]			\n"
+		"	ldr		r0, [r2]			\n"
+		"	ldmia	r0!, {r4-r11, lr}	\n"
+		"	tst		lr, #0x10			\n"
+		"	it		eq					\n"
+		"	vldmiaeq r0!, {s16-s31}		\n"
+		"	msr		psp, r0				\n"
+		"	mov		r0, #0				\n"		// Nothing held BASEPRI or PendSV would not be running
+		"	msr		basepri, r0			\n"
+		"	bx		lr					\n"
+	);
+}
@@ -16,6 +16,8 @@ file = config.directory_path + config.files['SPI']
 wires = []                  # list of 31 modules (1 = connected; 0 = open)
 voltage_values = []         # list of 31 modules (fixed point 0.0001)
 temperature_values = []     # list of 31 pairs of sensors (fixed point 0.001)
+temperature_range = None    # (state, mode) the random temperatures were picked for
+temperature_base = []       # random temperatures picked for temperature_range
 
 
 def open_wires(battery=None):
@@ -58,10 +60,16 @@ def specific_voltage(battery):
 def random_temperature(state, mode):
     """
     @brief generate randomized temperature values in specified ranges
+           Values are picked once per range and then only change by sensor noise,
+           real modules do not jump tens of degrees between two scans.
     @param state : 'charging' or 'discharging'
     @param mode : 'low', 'normal', or 'high' ranges respective to the state
     """
-    global temperature_values
+    global temperature_values, temperature_range, temperature_base
+    if temperature_range == (state, mode):
+        temperature_values = [(t1+random.randint(-50, 50), t2+random.randint(-50, 50)) for t1, t2 in temperature_base]
+        return
+    temperature_range = (state, mode)
     if state == 'charging':
         if mode == 'low':
             temperature_values = [(random.randint(10000, 25000), random.randint(10000, 25000)) for i in range(31)]
@@ -76,6 +84,17 @@ def random_temperature(state, mode):
             temperature_values = [(random.randint(30000, 72000), random.randint(30000, 72000)) for i in range(31)]
         elif mode == 'high':
             temperature_values = [(random.randint(73000, 90000), random.randint(73000, 90000)) for i in range(31)]
+    temperature_base = temperature_values
+
+
+def specific_temperature(battery):
+    """
+    @brief generate list of temperature values based on battery object
+           with +-0.05C error on each sensor
+    @param battery : battery object with module temperatures
+    """
+    global temperature_values
+    temperature_values = [(int(module.temperature*1000)+random.randint(-50, 50), int(module.temperature*1000)+random.randint(-50, 50)) for module in battery.modules]
 
 
 def generate(state, mode, battery=None):
@@ -91,7 +110,7 @@ def generate(state, mode, battery=None):
     open_wires(battery)
     if battery is not None:
         specific_voltage(battery)
-        random_temperature('discharging', 'normal')
+        specific_temperature(battery)
     else:
         random_voltage(mode)
         random_temperature(state, mode)
@@ -6,13 +6,38 @@ All specifications taken from the specification sheets
 on the team Google Drive under the Battery folder
 """
 
+import math
+
+# Open circuit voltage (V) of a cell every 10% state of charge, from empty to full.
+# Same curve as CHARGE_OCV_TABLE in config.h.
+OCV_TABLE = [3.000, 3.450, 3.550, 3.610, 3.660, 3.710, 3.780, 3.870, 3.950, 4.050, 4.180]
+
+
+def ocv(soc):
+    """
+    @brief open circuit voltage of a cell
+    @param soc : state of charge from 0 to 1
+    @return Volts, interpolated in OCV_TABLE
+    """
+    pos = min(max(soc, 0), 1) * (len(OCV_TABLE) - 1)
+    idx = min(int(pos), len(OCV_TABLE) - 2)
+    return OCV_TABLE[idx] + (OCV_TABLE[idx + 1] - OCV_TABLE[idx]) * (pos - idx)
+
+
 # A battery consists of 31 Modules in series
 class Battery:
-    def __init__(self, current, capacity, charge=None):
+    def __init__(self, current, capacity, charge=None, module_capacities=None, module_charges=None):
+        """
+        @param module_capacities : optional list of the capacity of each module (mAh), for a
+                                   pack with mismatched modules. Default is capacity for all.
+        @param module_charges : optional list of the charge of each module (mAh)
+        """
         self.num_modules = 31
         self.current = current
         self.capacity = capacity
         self.charge = charge if charge is not None else capacity
+        self.module_capacities = module_capacities or [self.capacity] * self.num_modules
+        self.module_charges = module_charges or [self.charge] * self.num_modules
         self.modules = self.create_modules()
         self.voltage = self.calc_voltage()
     
@@ -24,7 +49,8 @@ class Battery:
     def create_modules(self):
         module_list = []
         for i in range(self.num_modules):
-            module_list.append(self.Module(self.current, self.capacity/self.num_modules, self.charge/self.num_modules))
+            # Modules in series all see the whole pack current, so each holds the pack capacity
+            module_list.append(self.Module(self.current, self.module_capacities[i], self.module_charges[i]))
         return module_list
 
 
@@ -35,8 +61,50 @@ class Battery:
         self.voltage = self.calc_voltage()
 
 
+    def set_current(self, current):
+        """
+        @brief change the current drawn from the pack
+        @param current : Amperes, positive when discharging
+        """
+        self.current = current
+        for module in self.modules:
+            module.set_current(current + module.bleed_current)
+
+
+    def balance(self, modules, current):
+        """
+        @brief turn the balancing resistors of some modules on and all others off
+        @param modules : indices of the modules that bleed (0-indexed)
+        @param current : Amperes that flow through a balancing resistor
+        """
+        for i, module in enumerate(self.modules):
+            module.bleed_current = current if i in modules else 0.0
+        self.set_current(self.current)
+
+
+    def heat(self, module, rate):
+        """
+        @brief start a heating ramp on a module, e.g. a cell going into thermal runaway
+        @param module : index of module (0-indexed)
+        @param rate : degrees C per update, 0 stops the ramp
+        """
+        self.modules[module].heating_rate = rate
+
+
+    def cool(self, module, ambient, thermal_resistance):
+        """
+        @brief let a module heat up from its own losses and cool down to the ambient
+        @param module : index of module (0-indexed)
+        @param ambient : degrees C the module settles at without current
+        @param thermal_resistance : degrees C per Watt from the module to the ambient
+        """
+        self.modules[module].ambient = ambient
+        self.modules[module].thermal_resistance = thermal_resistance
+
+
     def calc_charge(self):
-        return sum([module.charge for module in self.modules])
+        # A series pack is empty as soon as its weakest module is
+        return min([module.charge for module in self.modules])
 
 
     def calc_voltage(self):
@@ -53,6 +121,13 @@ class Battery:
             self.cells = self.create_cells()
             self.voltage = self.calc_voltage()
             self.connected = True
+            self.bleed_current = 0.0    # Amperes through the balancing resistor
+            # Temperature values (degrees C)
+            self.temperature = 25.0
+            self.heating_rate = 0.0     # degrees C added every update
+            self.ambient = 25.0
+            self.thermal_resistance = 0.0   # degrees C per Watt, 0 leaves out the losses
+            self.thermal_time_constant = 300
         
 
         def __str__(self):
@@ -71,6 +146,16 @@ class Battery:
                 cell.update()
             self.charge = self.calc_charge()
             self.voltage = self.calc_voltage()
+            if self.thermal_resistance:
+                settle = self.ambient + self.current ** 2 * self.calc_resistance() * self.thermal_resistance
+                self.temperature += (settle - self.temperature) / self.thermal_time_constant
+            self.temperature += self.heating_rate
+
+
+        def set_current(self, current):
+            self.current = current
+            for cell in self.cells:
+                cell.current = current / self.num_cells
 
 
         def calc_charge(self):
@@ -81,6 +166,12 @@ class Battery:
             return sum([cell.voltage for cell in self.cells]) / self.num_cells
 
 
+        def calc_resistance(self):
+            # Losses of the series resistance and the RC pair once it has settled
+            cell = self.cells[0]
+            return (cell.series_resistance + cell.rc_resistance) / self.num_cells
+
+
         class Cell:
             def __init__(self, current, capacity, charge=None):
                 # Voltage values (V)
@@ -96,6 +187,12 @@ class Battery:
                 self.discharge_capacity = 2950
                 self.capacity = capacity
                 self.charge = charge if charge is not None else capacity
+                # Equivalent circuit, a series resistance and one RC pair (Ohms, seconds)
+                # 14 cells in parallel make the module values in config.h
+                self.series_resistance = 0.0252
+                self.rc_resistance = 0.0154
+                self.rc_time_constant = 30
+                self.rc_voltage = 0.0
                 # Temperature values (degrees C)
                 # TODO
                 # Variable values
@@ -108,13 +205,16 @@ class Battery:
 
             def update(self):
                 self.charge = self.calc_charge()
+                decay = math.exp(-1 / self.rc_time_constant)
+                self.rc_voltage = self.rc_voltage * decay + self.current * self.rc_resistance * (1 - decay)
                 self.voltage = self.calc_voltage()
             
 
             def calc_charge(self):
-                return self.charge - (self.current/3600)
+                # One update is one second, current is in A and charge in mAh
+                return self.charge - (self.current * 1000 / 3600)
 
 
             def calc_voltage(self):
-                slope = (self.end_voltage - self.cutoff_voltage) / self.capacity
-                return self.cutoff_voltage + ((self.capacity- self.charge) * slope)
+                # Terminal voltage sags under load and recovers as the RC pair discharges
+                return ocv(self.charge / self.capacity) - self.current * self.series_resistance - self.rc_voltage
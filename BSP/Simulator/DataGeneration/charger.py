@@ -0,0 +1,43 @@
+"""
+Charger class to simulate the CC-CV charger BeVolt is charged with
+
+It takes a pack voltage and current setpoint over CAN and gives whichever is less of the
+setpoint current and the current that brings the pack to the setpoint voltage.
+"""
+
+
+class Charger:
+    def __init__(self, max_current):
+        """
+        @param max_current : most the charger can give (A)
+        """
+        self.max_current = max_current
+        self.enabled = False
+        self.voltage = 0.0      # V
+        self.current = 0.0      # A
+
+
+    def set(self, enabled, voltage, current):
+        """
+        @brief new setpoint, like the CHARGER_SETPOINT message
+        @param enabled : False turns the output off
+        @param voltage : pack voltage setpoint (V)
+        @param current : current setpoint (A)
+        """
+        self.enabled = enabled
+        self.voltage = voltage
+        self.current = min(current, self.max_current)
+
+
+    def output(self, battery):
+        """
+        @brief current the charger pushes into a pack
+        @param battery : battery.Battery
+        @return Amperes, positive into the pack
+        """
+        if not self.enabled:
+            return 0.0
+        # Pack voltage with no current flowing and resistance of the whole pack
+        resting = sum(m.voltage + m.current * m.calc_resistance() for m in battery.modules)
+        resistance = sum(m.calc_resistance() for m in battery.modules)
+        return max(0.0, min(self.current, (self.voltage - resting) / resistance))
@@ -0,0 +1,189 @@
+"""
+Generates an hour long drive of BeVolt for the state of charge tests and runs it through
+battery.py as the ground truth of the charge left in the pack.
+
+Stores one row per second in Scenario.csv, the current drawn during that second and the pack
+charge and module voltage at the end of it:
+    current (mA), charge (mAh), module voltage (mV)
+The first row holds the starting charge and open circuit voltage with a current of 0.
+
+With "modules" it runs a pack of mismatched modules instead, with a long stop every few minutes,
+and stores ScenarioModules.csv. The first row holds the capacity of every module (mAh), then one
+row per second with the current and the voltage (mV) and state of charge (0.01%) of every module:
+    current (mA), voltage 0, ..., voltage 30, charge 0, ..., charge 30
+
+With "plant" it runs a hot, mismatched pack in closed loop with a test instead. Every second it
+prints the current the driver asks for in the next second with the voltage (mV) and temperature
+(mC) of every module, then reads the current (mA) the test let flow and runs the pack with it:
+    demand (mA), voltage 0, ..., voltage 30, temperature 0, ..., temperature 30
+It stops after PLANT_DURATION_S or when the input ends.
+
+With "charge" it puts a mismatched pack on charger.py instead. The rows start with the pack
+current (mA, negative while charging) and every second it reads the CHARGER_SETPOINT the test
+sent and the modules that are balancing:
+    on (0 or 1), pack voltage (mV), current (mA), one bit per module that is balancing
+It stops after CHARGE_DURATION_S or when the input ends.
+
+Run from the top of the repo:
+    python3 BSP/Simulator/DataGeneration/scenario.py [modules | plant | charge]
+"""
+
+import os
+import random
+import sys
+import battery
+import charger
+import config
+
+# path/name of file
+file = config.directory_path + "Scenario.csv"
+modules_file = config.directory_path + "ScenarioModules.csv"
+
+DURATION_S = 3600
+START_CHARGE_MAH = 2500 * config.num_batt_cells_parallel_per_module
+SEED = 37
+MODULES_DURATION_S = 3600
+REST_EVERY_S = 420          # Driving between two long stops
+REST_S = 180                # Long enough for the module voltages to settle
+PLANT_DURATION_S = 1200
+PLANT_AMBIENT = 58          # Hot day, degrees C
+PLANT_HOT_MODULE = 12       # Sits in a spot with poor cooling
+CHARGE_DURATION_S = 7200
+CHARGER_MAX_CURRENT = 20    # A
+BLEED_CURRENT = 0.12        # Balancing resistor of the minion boards at 4V (A)
+
+
+def drive_cycle(seconds):
+    """
+    @brief   Made up but repeatable race day: cruising around 30A, hills up to 80A, regenerative
+             braking down to -15A and a few stops
+    @param   seconds : length of the drive
+    @return  list of the current (A) for every second
+    """
+    rng = random.Random(SEED)
+    currents = []
+    while len(currents) < seconds:
+        kind = rng.random()
+        length = rng.randint(5, 90)
+        if kind < 0.55:
+            level = rng.uniform(20, 40)      # cruise
+        elif kind < 0.75:
+            level = rng.uniform(50, 80)      # hill
+        elif kind < 0.9:
+            level = rng.uniform(-15, -5)     # regenerative braking
+            length = min(length, 20)
+        else:
+            level = 0.5                      # stopped, only the electrical system
+        for _ in range(length):
+            currents.append(level + rng.uniform(-1, 1))
+    return currents[:seconds]
+
+
+def mismatched_pack():
+    """
+    @brief   Pack where every module has its own capacity (up to 12% short) and state of charge
+    @return  battery.Battery
+    """
+    rng = random.Random(SEED + 1)
+    capacities = [config.total_batt_pack_capacity_mah * rng.uniform(0.88, 1.0) for _ in range(config.num_batt_modules_series)]
+    charges = [c * rng.uniform(0.82, 0.92) for c in capacities]
+    return battery.Battery(0, config.total_batt_pack_capacity_mah, None, capacities, charges)
+
+
+def module_row(BeVolt, milliamps):
+    voltages = [str(round(m.voltage * 1000)) for m in BeVolt.modules]
+    charges = [str(round(m.charge * 10000 / m.capacity)) for m in BeVolt.modules]
+    return ",".join([str(milliamps)] + voltages + charges) + "\n"
+
+
+def write_modules():
+    BeVolt = mismatched_pack()
+    currents = []
+    for current in drive_cycle(MODULES_DURATION_S):
+        if len(currents) % (REST_EVERY_S + REST_S) >= REST_EVERY_S:
+            current = 0.3   # Only the electrical system
+        currents.append(current)
+
+    with open(modules_file, "w") as csvfile:
+        csvfile.write(",".join("%.1f" % m.capacity for m in BeVolt.modules) + "\n")
+        csvfile.write(module_row(BeVolt, 0))
+        for current in currents:
+            milliamps = round(current * 1000)
+            BeVolt.set_current(milliamps / 1000)
+            BeVolt.update()
+            csvfile.write(module_row(BeVolt, milliamps))
+
+
+def hot_pack():
+    """
+    @brief   Mismatched pack on a hot day, close to full and with one badly cooled module
+    @return  battery.Battery
+    """
+    rng = random.Random(SEED + 2)
+    capacities = [config.total_batt_pack_capacity_mah * rng.uniform(0.9, 1.0) for _ in range(config.num_batt_modules_series)]
+    charges = [c * rng.uniform(0.74, 0.83) for c in capacities]
+    BeVolt = battery.Battery(0, config.total_batt_pack_capacity_mah, None, capacities, charges)
+    for i in range(config.num_batt_modules_series):
+        BeVolt.cool(i, PLANT_AMBIENT, 1.5 if i == PLANT_HOT_MODULE else 0.5)
+        BeVolt.modules[i].temperature = PLANT_AMBIENT
+    return BeVolt
+
+
+def plant_row(BeVolt, demand):
+    voltages = [str(round(m.voltage * 1000)) for m in BeVolt.modules]
+    temperatures = [str(round(m.temperature * 1000)) for m in BeVolt.modules]
+    return ",".join([str(round(demand * 1000))] + voltages + temperatures)
+
+
+def run_plant():
+    BeVolt = hot_pack()
+    demand = drive_cycle(PLANT_DURATION_S) + [0]
+    print(plant_row(BeVolt, demand[0]), flush=True)
+    for second in range(PLANT_DURATION_S):
+        line = sys.stdin.readline()
+        if not line:
+            break
+        BeVolt.set_current(int(line) / 1000)
+        BeVolt.update()
+        print(plant_row(BeVolt, demand[second + 1]), flush=True)
+
+
+def run_charge():
+    rng = random.Random(SEED + 3)
+    capacities = [config.total_batt_pack_capacity_mah * rng.uniform(0.95, 1.0) for _ in range(config.num_batt_modules_series)]
+    charges = [c * rng.uniform(0.58, 0.64) for c in capacities]
+    BeVolt = battery.Battery(0, config.total_batt_pack_capacity_mah, None, capacities, charges)
+    plug = charger.Charger(CHARGER_MAX_CURRENT)
+    print(plant_row(BeVolt, BeVolt.current), flush=True)
+    for second in range(CHARGE_DURATION_S):
+        line = sys.stdin.readline()
+        if not line:
+            break
+        enabled, voltage, current, bleeding = [int(x) for x in line.split(",")]
+        plug.set(enabled != 0, voltage / 1000, current / 1000)
+        BeVolt.balance([i for i in range(config.num_batt_modules_series) if bleeding >> i & 1], BLEED_CURRENT)
+        BeVolt.set_current(-plug.output(BeVolt))
+        BeVolt.update()
+        print(plant_row(BeVolt, BeVolt.current), flush=True)
+
+
+if __name__ == "__main__":
+    os.makedirs(config.directory_path, exist_ok=True)
+    if len(sys.argv) > 1 and sys.argv[1] == "modules":
+        write_modules()
+        sys.exit(0)
+    if len(sys.argv) > 1 and sys.argv[1] == "plant":
+        run_plant()
+        sys.exit(0)
+    if len(sys.argv) > 1 and sys.argv[1] == "charge":
+        run_charge()
+        sys.exit(0)
+
+    BeVolt = battery.Battery(0, config.total_batt_pack_capacity_mah, START_CHARGE_MAH)
+    with open(file, "w") as csvfile:
+        csvfile.write("0,%.6f,%d\n" % (BeVolt.charge, round(BeVolt.modules[0].voltage * 1000)))
+        for current in drive_cycle(DURATION_S):
+            milliamps = round(current * 1000)
+            BeVolt.set_current(milliamps / 1000)
+            BeVolt.update()
+            csvfile.write("%d,%.6f,%d\n" % (milliamps, BeVolt.charge, round(BeVolt.modules[0].voltage * 1000)))
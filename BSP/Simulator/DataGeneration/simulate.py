@@ -132,6 +132,18 @@ def change_wires(battery):
         else:
             done = True
 
+def heat_module(battery):
+    print("Which module should heat up? (0 to stop all ramps)")
+    print(">>", end="")
+    module = int(input())
+    if module:
+        print("How fast? (degrees C per second)")
+        print(">>", end="")
+        battery.heat(module-1, float(input()))
+    else:
+        for i in range(battery.num_modules):
+            battery.heat(i, 0)
+
 def launch_bevolt():
     # Suppress stdout and stderr
     null_fds = [os.open(os.devnull, os.O_RDWR) for x in range(2)]
@@ -201,13 +213,17 @@ def main():
         except KeyboardInterrupt:
             curses.endwin()
             if BeVolt is not None:
-                print("\n\rWould you like to change 'wires', 'quit', or 'PLL'?")
+                print("\n\rWould you like to change 'wires', 'heat', 'quit', or 'PLL'?")
                 print(">>", end="")
                 choice = input()
                 if choice == 'wires':
                     change_wires(BeVolt)
                     stdscr = curses.initscr()
                     curses.start_color()
+                elif choice == 'heat':
+                    heat_module(BeVolt)
+                    stdscr = curses.initscr()
+                    curses.start_color()
                 elif choice == 'quit':
                     break
                 elif choice == 'PLL':
@@ -1,4 +1,5 @@
 #include "BSP_ADC.h"
+#include "BSP_Contactor.h"
 #include "simulator_conf.h"
 #include <unistd.h>
 #include <sys/file.h>
@@ -6,13 +7,56 @@
 // Path relative to the executable
 static const char* file = GET_CSV_PATH(ADC_CSV_FILE);
 
+// Same double buffer and queue as the STM32. There is no timer or DMA in the simulator,
+// conversions come from ADC.csv one block per read, or from BSP_ADC_SimulateSamples.
+static uint16_t ADCresults[2][ADC_BLOCK_SIZE][2];
+static uint32_t bufferIdx;
+static ADC_Sample sampleQueue[ADC_QUEUE_SIZE];
+static uint32_t queueHead;
+static uint32_t queueTail;
+static ADC_Sample newest;
+static uint32_t sampleCount;
+static uint64_t lowSum;             // Every low precision conversion added up
+static bool fedByTest;
+
+// Analog watchdog, checked on every conversion like the ADC does in hardware
+static bool watchdogArmed;
+static bool watchdogTripped;
+static uint32_t watchdogTimestamp;
+static uint16_t watchdogLow;
+static uint16_t watchdogHigh;
+
+// Raw conversions copied out for BSP_ADC_StartCapture
+static uint16_t *captureBuffer;
+static uint32_t captureCount;
+static uint32_t captureIdx;
+
+static void ADC_SampleFile(void);
+static void ADC_Convert(uint16_t high, uint16_t low);
+static void ADC_AverageBlock(uint16_t (*block)[2]);
+static uint16_t ConvertBlockToMilliVoltage(uint32_t sum);
+static uint16_t ConvertMilliVoltageToCode(uint16_t milliVolts);
+static void ADC_IRQHandler(void);
+
 /**
  * @brief   Initializes the ADC module. This is to measure the hall effect sensors
- *          on the Current Monitor Board.
+ *          on the Current Monitor Board. Sampling starts right away.
  * @param   None
  * @return  None
  */
 void BSP_ADC_Init(void) {
+    bufferIdx = 0;
+    queueHead = 0;
+    queueTail = 0;
+    sampleCount = 0;
+    lowSum = 0;
+    fedByTest = false;
+    watchdogArmed = false;
+    watchdogTripped = false;
+    captureCount = 0;
+    captureIdx = 0;
+    memset(&newest, 0, sizeof(newest));
+
     // Check if simulator is running i.e. were the csv files created?
     if(access(file, F_OK) != 0) {
         // File doesn't exit if true
@@ -22,47 +66,146 @@ void BSP_ADC_Init(void) {
 }
 
 /**
- * @brief   Gets converted ADC value in units of mV.
+ * @brief   Copies the next raw conversions of the high precision sensor into a buffer so
+ *          the waveform can be analysed. Whole blocks are copied as they are averaged.
+ * @param   buffer  where to store the 12 bit codes, in use until BSP_ADC_IsCaptureDone
+ * @param   count   number of conversions, a multiple of ADC_BLOCK_SIZE
+ * @return  None
+ */
+void BSP_ADC_StartCapture(uint16_t *buffer, uint32_t count) {
+    // The interrupt copies nothing while the count is 0
+    captureCount = 0;
+    captureBuffer = buffer;
+    captureIdx = 0;
+    captureCount = count;
+}
+
+/**
+ * @brief   Checks if the capture started by BSP_ADC_StartCapture is complete
  * @param   None
- * @return  millivoltage value ADC measurement
+ * @return  true once the buffer holds all the conversions
  */
-uint16_t BSP_ADC_High_GetMilliVoltage(void) {
-    FILE* fp = fopen(file, "r");
-    if (!fp) {
-        // File doesn't exit if true
-        perror(ADC_CSV_FILE);
-        exit(EXIT_FAILURE);
+bool BSP_ADC_IsCaptureDone(void) {
+    return captureCount > 0 && captureIdx >= captureCount;
+}
+
+/**
+ * @brief   Arms the analog watchdog on the low precision channel. A single conversion outside
+ *          the window opens the contactor right from the ADC interrupt and latches the trip,
+ *          without waiting for the block average or the main loop.
+ * @param   lowMilliVolts   conversions below this trip
+ * @param   highMilliVolts  conversions above this trip
+ * @return  None
+ */
+void BSP_ADC_Watchdog_Init(uint16_t lowMilliVolts, uint16_t highMilliVolts) {
+    watchdogLow = ConvertMilliVoltageToCode(lowMilliVolts);
+    watchdogHigh = ConvertMilliVoltageToCode(highMilliVolts);
+    watchdogTripped = false;
+    watchdogTimestamp = 0;
+    watchdogArmed = true;
+}
+
+/**
+ * @brief   Checks if the analog watchdog has tripped since it was armed. The trip stays
+ *          latched until BSP_ADC_Watchdog_Init is called again.
+ * @param   timestamp   where to store the sample the trip happened on, same count as
+ *                      ADC_Sample.timestamp. May be NULL.
+ * @return  true if it tripped
+ */
+bool BSP_ADC_Watchdog_Tripped(uint32_t *timestamp) {
+    if(watchdogTripped && timestamp != NULL) {
+        *timestamp = watchdogTimestamp;
     }
+    return watchdogTripped;
+}
 
-    // Lock the file so simulator.py/ADC.py can not write it during a read op.
-    // This is a blocking statement
-    int fno = fileno(fp);
-    flock(fno, LOCK_EX);
+/**
+ * @brief   Takes the readings that were averaged since the last call, oldest first.
+ *          If the queue filled up the newest readings were dropped, the timestamps show the gap.
+ * @param   samples array to store the readings in
+ * @param   max     size of the array
+ * @return  number of readings stored
+ */
+uint32_t BSP_ADC_ReadSamples(ADC_Sample *samples, uint32_t max) {
+    if(!fedByTest) {
+        ADC_SampleFile();
+    }
 
-    // Get raw CSV string
-    char csv[16];
-    fgets(csv, 16, fp);
-    // Get only 2nd (high precision) value
-    char* dataString = csv;
-    dataString += 5;
-    // Convert to int
-    uint16_t data = atoi(dataString);
-    // Convert to millivoltage
-    uint16_t mV = (data * 3300) >> 12;   // For 12-bit ADCs
+    uint32_t count = 0;
+    while(count < max && queueTail != queueHead) {
+        samples[count] = sampleQueue[queueTail % ADC_QUEUE_SIZE];
+        queueTail++;
+        count++;
+    }
+    return count;
+}
 
-    // Unlock the lock so the simulator can write to ADC.csv again
-    flock(fno, LOCK_UN);
+/**
+ * @brief   Gets the sum of every conversion of the low precision sensor since BSP_ADC_Init.
+ *          The DMA interrupt keeps the sum so no sample is lost however late the reader is.
+ * @param   count   where to store how many conversions were summed, same count as
+ *                  ADC_Sample.timestamp. Wraps around, subtract two counts.
+ * @return  sum of the 12 bit codes
+ */
+uint64_t BSP_ADC_GetLowSum(uint32_t *count) {
+    uint64_t sum;
+    uint32_t before;
 
-    fclose(fp);
-    return mV;
+    // The sum takes two reads, start over if a block was added in between
+    do {
+        before = sampleCount;
+        sum = lowSum;
+    } while(before != sampleCount);
+
+    *count = before;
+    return sum;
+}
+
+/**
+ * @brief   Gets converted ADC value in units of mV.
+ * @param   None
+ * @return  millivoltage value ADC measurement, average of the newest block
+ */
+uint16_t BSP_ADC_High_GetMilliVoltage(void) {
+    if(!fedByTest) {
+        ADC_SampleFile();
+    }
+    return newest.highMilliVolts;
 }
 
 /**
  * @brief   Gets converted ADC value in units of mV.
  * @param   None
- * @return  millivoltage value ADC measurement
+ * @return  millivoltage value ADC measurement, average of the newest block
  */
 uint16_t BSP_ADC_Low_GetMilliVoltage(void) {
+    if(!fedByTest) {
+        ADC_SampleFile();
+    }
+    return newest.lowMilliVolts;
+}
+
+/**
+ * @brief   Runs raw conversions through the same double buffer and block averaging the STM32
+ *          does in its DMA interrupt, and checks each conversion against the analog watchdog like
+ *          the ADC interrupt would. Once this has been called the simulator stops sampling
+ *          ADC.csv so tests see only the samples they feed in.
+ * @param   high    12 bit codes of the high precision sensor
+ * @param   low     12 bit codes of the low precision sensor
+ * @param   count   number of conversions
+ * @return  None
+ */
+void BSP_ADC_SimulateSamples(const uint16_t *high, const uint16_t *low, uint32_t count) {
+    fedByTest = true;
+    for(uint32_t i = 0; i < count; i++) {
+        ADC_Convert(high[i], low[i]);
+    }
+}
+
+/**
+ * @brief   Takes one block of conversions of the values in ADC.csv
+ */
+static void ADC_SampleFile(void) {
     FILE* fp = fopen(file, "r");
     if (!fp) {
         // File doesn't exit if true
@@ -75,23 +218,105 @@ uint16_t BSP_ADC_Low_GetMilliVoltage(void) {
     int fno = fileno(fp);
     flock(fno, LOCK_EX);
 
-    // Get raw CSV string
+    // Get raw CSV string, the low precision value comes first
     char csv[16];
-    fgets(csv, 16, fp);
-    // Get only 1st (low precision) value
-    char* dataString = csv;
-    *(dataString+5) = 0;
-    dataString = csv;
-    // Convert to int
-    uint16_t data = atoi(dataString);
-    // Convert to millivoltage
-    uint16_t mV = (data * 3300) >> 12;   // For 12-bit ADCs
+    uint16_t low = 0;
+    uint16_t high = 0;
+    if(fgets(csv, 16, fp) != NULL) {
+        char *saveDataPtr = NULL;
+        char *lowString = __strtok_r(csv, ",", &saveDataPtr);
+        char *highString = __strtok_r(NULL, ",", &saveDataPtr);
+        low = lowString ? atoi(lowString) : 0;
+        high = highString ? atoi(highString) : 0;
+    }
 
     // Unlock the lock so the simulator can write to ADC.csv again
     flock(fno, LOCK_UN);
 
     fclose(fp);
 
-    return mV;
+    for(int i = 0; i < ADC_BLOCK_SIZE; i++) {
+        ADC_Convert(high, low);
+    }
 }
 
+/**
+ * @brief   Stores one conversion of both channels where the DMA would put it and runs the
+ *          half and full transfer handling when a half of the buffer fills up
+ * @param   high    12 bit code of the high precision sensor
+ * @param   low     12 bit code of the low precision sensor
+ */
+static void ADC_Convert(uint16_t high, uint16_t low) {
+    ADCresults[bufferIdx / ADC_BLOCK_SIZE][bufferIdx % ADC_BLOCK_SIZE][0] = high;
+    ADCresults[bufferIdx / ADC_BLOCK_SIZE][bufferIdx % ADC_BLOCK_SIZE][1] = low;
+    bufferIdx++;
+
+    // The watchdog looks at single conversions of the low precision channel
+    if(watchdogArmed && (low < watchdogLow || low > watchdogHigh)) {
+        ADC_IRQHandler();
+    }
+
+    if(bufferIdx == ADC_BLOCK_SIZE) {
+        ADC_AverageBlock(ADCresults[0]);
+    } else if(bufferIdx == 2 * ADC_BLOCK_SIZE) {
+        ADC_AverageBlock(ADCresults[1]);
+        bufferIdx = 0;
+    }
+}
+
+/**
+ * @brief   Averages one half of the double buffer and publishes the reading
+ * @param   block   ADC_BLOCK_SIZE conversions of both channels
+ */
+static void ADC_AverageBlock(uint16_t (*block)[2]) {
+    uint32_t high = 0;
+    uint32_t low = 0;
+    for(int i = 0; i < ADC_BLOCK_SIZE; i++) {
+        high += block[i][0];
+        low += block[i][1];
+    }
+
+    // Hand the raw high precision conversions to a capture in progress
+    if(captureIdx < captureCount) {
+        for(int i = 0; i < ADC_BLOCK_SIZE; i++) {
+            captureBuffer[captureIdx + i] = block[i][0];
+        }
+        captureIdx += ADC_BLOCK_SIZE;
+    }
+
+    lowSum += low;
+    sampleCount += ADC_BLOCK_SIZE;
+    newest.timestamp = sampleCount;
+    newest.highMilliVolts = ConvertBlockToMilliVoltage(high);
+    newest.lowMilliVolts = ConvertBlockToMilliVoltage(low);
+
+    // Drop the reading if the main loop has fallen a whole queue behind
+    if(queueHead - queueTail < ADC_QUEUE_SIZE) {
+        sampleQueue[queueHead % ADC_QUEUE_SIZE] = newest;
+        queueHead++;
+    }
+}
+
+static uint16_t ConvertBlockToMilliVoltage(uint32_t sum) {
+    // Convert to millivoltage, dividing the sum keeps the extra resolution of the average
+    return (sum * 3300) / (4096 * ADC_BLOCK_SIZE);   // For 12-bit ADCs
+}
+
+static uint16_t ConvertMilliVoltageToCode(uint16_t milliVolts) {
+    // Rounded down, the watchdog compares raw 12 bit conversions
+    return ((uint32_t)milliVolts * 4096) / 3300;
+}
+
+/**
+ * @brief   Same as the STM32 ADC interrupt: opens the contactor and latches the trip
+ */
+static void ADC_IRQHandler(void) {
+    // Stay latched, the watchdog would fire on every conversion until the current drops.
+    // Latched before opening, the safety task is a thread here and could otherwise check the
+    // latch in the middle of the interrupt and close the contactor again.
+    watchdogArmed = false;
+    watchdogTimestamp = sampleCount + (bufferIdx - 1) % ADC_BLOCK_SIZE + 1;
+    watchdogTripped = true;
+
+    BSP_Contactor_Off();
+}
@@ -1,10 +1,16 @@
 #include "BSP_Contactor.h"
+#include "BSP_Timer.h"
 #include "simulator_conf.h"
 #include <stdio.h>
 #include <sys/file.h>
 
 static const char* file = GET_CSV_PATH(CONTACTOR_CSV_FILE);
 
+// When the contactor was first opened, for measuring how fast the BPS reacts to a fault
+static bool closed;
+static uint32_t openings;
+static uint32_t openedAt;
+
 /*
  * @brief   Initializes the GPIO pins that interfaces with the Contactor.
  *          Two GPIO pins are initialized. One as an output and one as an input.
@@ -18,6 +24,8 @@ void BSP_Contactor_Init(void) {
           and the other must be configued as an output.
     Software: Create file that contains one unsigned integer, 0 means off, 1 means on
     */
+    closed = false;
+    openings = 0;
     FILE* fp = fopen(file, "w+"); //if file doesn't exist, it is created
     int fno = fileno(fp); //lock file
     flock(fno, LOCK_EX);
@@ -36,6 +44,7 @@ void BSP_Contactor_On(void) {
     // Hardware: Set the state to high for the output pin.
     //      Use Positive Logic.
     // Software: Set integer to 1
+    closed = true;
     FILE* fp = fopen(file, "w"); //Open file to write
     int fno = fileno(fp); //lock file
     flock(fno, LOCK_EX);
@@ -53,6 +62,14 @@ void BSP_Contactor_On(void) {
 void BSP_Contactor_Off(void) {
     // Hardware: Set the state to low for the output pin.
     // Software: Set integer to 0
+    // Timestamped before the file write, that is when the pin would change
+    if(closed) {
+        if(openings == 0) {
+            openedAt = BSP_Timer_GetCycleCount();
+        }
+        openings++;
+        closed = false;
+    }
     FILE* fp = fopen(file, "w"); //Open file to write
     int fno = fileno(fp); //lock file
     flock(fno, LOCK_EX);
@@ -80,3 +97,15 @@ bool BSP_Contactor_GetState(void) {
     fclose(fp); //close file
     return ContactorState;
 }
+
+/**
+ * @brief   Tells when BSP_Contactor_Off first opened the closed contactor
+ * @param   cycles  where to store BSP_Timer_GetCycleCount of that call, may be NULL
+ * @return  times a closed contactor has been opened since BSP_Contactor_Init
+ */
+uint32_t BSP_Contactor_GetOpenings(uint32_t *cycles) {
+    if(cycles != NULL) {
+        *cycles = openedAt;
+    }
+    return openings;
+}
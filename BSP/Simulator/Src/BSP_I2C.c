@@ -13,6 +13,9 @@
 //path for EEPROM file
 static const char* file = GET_CSV_PATH(I2C_CSV_FILE);
 
+// Bytes of the next write that make it before the power goes, -1 for no power loss
+static int32_t powerLossAfter = -1;
+
 /**
  * @brief   Initializes the I2C port that interfaces with the EEPROM. Creates EEPROM txt file if it does not already exist
  * @param   None
@@ -93,8 +96,12 @@ uint8_t  BSP_I2C_Write(uint8_t deviceAddr, uint16_t regAddr, uint8_t *txData, ui
 
     char data[3];
     for (uint32_t i = 0; i < txLen; i++){
-        sprintf(data, "%x", txData[i]);//convert uint8_t to char[], so that it can be written to txt file
-        if (txData[i] > 0x0f){
+        uint8_t byte = txData[i];
+        if (powerLossAfter >= 0 && i >= (uint32_t)powerLossAfter){
+            byte = rand();//the write cycle never finished
+        }
+        sprintf(data, "%x", byte);//convert uint8_t to char[], so that it can be written to txt file
+        if (byte > 0x0f){
             fprintf(fp, "%c%c", data[0], data[1]);
         }else{//handle edge case where data is only one character
             fprintf(fp, "0%c", data[0]);
@@ -106,9 +113,23 @@ uint8_t  BSP_I2C_Write(uint8_t deviceAddr, uint16_t regAddr, uint8_t *txData, ui
     flock(fno, LOCK_UN);
     fclose(fp);
 
+    if (powerLossAfter >= 0){
+        powerLossAfter = -1;
+        return ERROR;
+    }
     return SUCCESS;
 }
 
+/**
+ * @brief   Cuts the power during the next write. The EEPROM only gets the first bytes of it right,
+ *          the rest of the page it was writing is left garbled.
+ * @param   bytes : how many bytes of the next write make it
+ * @return  None
+ */
+void BSP_I2C_SimulatePowerLoss(uint32_t bytes) {
+    powerLossAfter = bytes;
+}
+
 /**
  * @brief   Gets the data from a device through the I2C bus.
  * @param   deviceAddr : the device/IC that the data needs to be read from.
@@ -0,0 +1,25 @@
+#include "BSP_PVD.h"
+
+static void (*dropHandler)(void);
+
+/**
+ * @brief   Initializes the programmable voltage detector. The handler is called from an interrupt
+ *          as soon as the supply starts to drop, while there is still time for a short EEPROM write.
+ *          It runs at interrupt priority, so it has to hand the write over to a thread.
+ * @param   handler   function to call when the supply drops
+ * @return  None
+ */
+void BSP_PVD_Init(void (*handler)(void)) {
+    dropHandler = handler;
+}
+
+/**
+ * @brief   Drops the supply, runs the handler like the interrupt would.
+ * @param   None
+ * @return  None
+ */
+void BSP_PVD_SimulateDrop(void) {
+    if(dropHandler != NULL) {
+        dropHandler();
+    }
+}
@@ -1,5 +1,6 @@
 #include "BSP_SPI.h"
 #include "config.h"
+#include "Topology.h"
 #include "simulator_conf.h"
 #include <unistd.h>
 #include <sys/file.h>
@@ -60,6 +61,12 @@
 #define SIM_LTC1380_MUX1        0x90        // MUX addresses on Minion boards
 #define SIM_LTC1380_MUX2        0x92
 
+#define SIM_SHORTED_MV          0           // Temperature sensor output shorted to ground
+#define SIM_OPEN_MV             5000        // GPIO1 pulled up to 5V with nothing driving it
+#define SIM_AMBIENT_TEMPERATURE 20000       // What a sensor that fell off its module reads (mC)
+#define SIM_VA_CODE             50000       // Analog supply, 5V
+#define SIM_VD_CODE             33000       // Digital supply, 3.3V
+
 typedef struct {
     uint8_t config[6];              // Configuration data of the LTC6811
     uint16_t voltage_data[12];      // Each board can support 12 battery modules
@@ -68,6 +75,8 @@ typedef struct {
                                     //      The process of getting temperature data requires knowing what the MUX is set to.
                                     //      Only one temperature sensor is sent from the LTC6811 at a time.
     int32_t temperature_data[16];   // Each board can support 16 temperature sensors
+    uint8_t sensor_fault[16];       // SimSensorFault injected on each temperature sensor
+    uint16_t stuck_mv[16];          // Reading a stuck temperature sensor keeps returning
     uint16_t open_wire;             // Each bit indicates a battery node wire
 } ltc6811_sim_t;
 
@@ -78,15 +87,15 @@ typedef enum {
 // Path relative to the executable
 static const char* file = GET_CSV_PATH(SPI_CSV_FILE);
 
-static uint8_t chipSelectState = 1;     // During idle, the cs pin should be high.
+static uint8_t chipSelectState[MAX_SPI_CHAINS] = {1, 1, 1, 1};     // During idle, the cs pin should be high.
                                         // Knowing the cs pin's state is not needed for the simulator,
                                         // but checking if the pin is low before any file read/writes
                                         // will make sure the developer follows the correct SPI protocol.
 
-static uint16_t currCmd = 0;            // Before every BSP_SPI_Read, BSP_SPI_Write needs to be called to
+static uint16_t currCmd[MAX_SPI_CHAINS];  // Before every BSP_SPI_Read, BSP_SPI_Write needs to be called to
                                         // specify the command to handle.
 
-static bool openWireOpFlag = false;     // The reading of voltages for both regular and openwire modes are
+static bool openWireOpFlag[MAX_SPI_CHAINS];     // The reading of voltages for both regular and openwire modes are
                                         // the same. The commands are different though. To measure the
                                         // regular voltage values, the ADCV command code is used. To measure
                                         // the open wire voltage values, the ADOW command code is used.
@@ -99,7 +108,7 @@ static bool openWireOpFlag = false;     // The reading of voltages for both regu
                                         // still triggers and ADC conversion (e.g. ADCV), then this flag should
                                         // be set to false.
 
-static bool openWirePUFlag = false;     // Indicates if the pull-up voltage values should be copied or not.
+static bool openWirePUFlag[MAX_SPI_CHAINS];     // Indicates if the pull-up voltage values should be copied or not.
                                         // This flag is set if the ADOWPU command was issued in
                                         // BSP_SPI_Write. The CopyOpenWireVoltageToByteArray function uses
                                         // this flag to determine which voltage values should be written.
@@ -107,6 +116,24 @@ static bool openWirePUFlag = false;     // Indicates if the pull-up voltage valu
 static char csvBuffer[CSV_SPI_BUFFER_SIZE];
 static ltc6811_sim_t simulationData[NUM_MINIONS];
 
+// Every daisy chain is its own stack of LTC6811s. The boards of chain n start at
+// simulationData[n * NUM_MINIONS_PER_CHAIN]. The public functions select the chain
+// before calling into the command handlers.
+static SPI_Chain currChain = SPI_CHAIN_0;
+static ltc6811_sim_t *chainData = simulationData;
+
+// The simulator keeps track of how long each isoSPI link would have been busy clocking
+// bytes at the rate set with BSP_SPI_SetSpeed so scan times of different chain layouts can be compared.
+static const uint32_t SpeedBitrate[NUM_SPI_SPEEDS] = {156250, 312500, 625000, 1250000};
+static SPI_Speed chainSpeed[MAX_SPI_CHAINS];
+static uint64_t busTimeNs[MAX_SPI_CHAINS];
+
+// Models the isoSPI cable of each chain. Every 8 byte register read above the link limit
+// gets a flipped bit with a probability out of 32768 that grows with each step past the limit.
+static SPI_Speed linkLimit[MAX_SPI_CHAINS] = {NUM_SPI_SPEEDS - 1, NUM_SPI_SPEEDS - 1, NUM_SPI_SPEEDS - 1, NUM_SPI_SPEEDS - 1};
+static const uint16_t LinkErrorOdds[NUM_SPI_SPEEDS] = {0, 1024, 8192, 32768};
+static uint32_t linkNoiseState = 1;
+
 /**
  * @brief   Data formating functions
  */
@@ -115,6 +142,8 @@ static void RDCommandHandler(uint8_t *buf, uint32_t len);
 static void PEC15_Table_Init(void);
 static uint16_t PEC15_Calc(char *data , int len);
 static uint16_t ExtractCmdFromBuff(uint8_t *buf, uint32_t len);
+static bool LinkNoise(void);
+static void CountBusTime(SPI_Chain chain, uint32_t bytes);
 static void ExtractDataFromBuff(uint8_t *data, uint8_t *buf, uint32_t len);
 static void ExtractMUXAddrFromBuff(uint8_t *comm);
 static void ExtractMUXSelFromBuff(uint8_t *comm);
@@ -122,6 +151,9 @@ static void CreateReadPacket(uint8_t *pkt, uint8_t *data, uint32_t dataSize);
 static void CopyVoltageToByteArray(uint8_t *data, Group group);
 static void CopyOpenWireVoltageToByteArray(uint8_t *data, Group group, bool pullup);
 static void CopyTemperatureToByteArray(uint8_t *data, Group group);
+static void CopyStatusToByteArray(uint8_t *data, Group group);
+static uint16_t SensorMilliVolts(ltc6811_sim_t *board, uint8_t channel);
+static int32_t DieTemperature(uint8_t board);
 static uint16_t ConvertTemperatureToMilliVolts(int32_t celcius);
 static Group DetermineGroupLetter(uint16_t cmd);
 
@@ -131,17 +163,32 @@ static Group DetermineGroupLetter(uint16_t cmd);
 static bool UpdateSimulationData(void);
 
 /**
- * @brief   Initializes the SPI port connected to the LTC6820.
+ * @brief   Points the command handlers at the LTC6811s of a chain.
+ * @param   chain   daisy chain the next transaction is for
+ */
+static void SelectChain(SPI_Chain chain) {
+    currChain = chain;
+    chainData = &simulationData[chain * NUM_MINIONS_PER_CHAIN];
+}
+
+/**
+ * @brief   Initializes the SPI port connected to the LTC6820 of a daisy chain.
  *          This port communicates with the LTC6811 voltage and temperature
  *          monitoring IC. The LTC6820 converts the SPI pins to 2-wire isolated SPI.
  *          Look at analog devices website and LTC6811's or LTC6820's datasheets.
- * @param   None
+ * @param   chain   daisy chain to initialize
  * @return  None
  */
-void BSP_SPI_Init(void) {
+void BSP_SPI_Init(SPI_Chain chain) {
 
     // Reset values
-    memset(simulationData, 0, sizeof(simulationData));
+    memset(&simulationData[chain * NUM_MINIONS_PER_CHAIN], 0, sizeof(ltc6811_sim_t) * NUM_MINIONS_PER_CHAIN);
+    chipSelectState[chain] = 1;
+    currCmd[chain] = 0;
+    openWireOpFlag[chain] = false;
+    openWirePUFlag[chain] = false;
+    chainSpeed[chain] = SPI_SPEED_DEFAULT;
+    busTimeNs[chain] = 0;
 
     PEC15_Table_Init();
 
@@ -153,6 +200,16 @@ void BSP_SPI_Init(void) {
     }
 }
 
+/**
+ * @brief   Changes the bit rate of a daisy chain. Waits for a running transfer to finish first.
+ * @param   chain   daisy chain to change
+ * @param   speed   new bit rate
+ * @return  None
+ */
+void BSP_SPI_SetSpeed(SPI_Chain chain, SPI_Speed speed) {
+    chainSpeed[chain] = speed;
+}
+
 /**
  * @brief   Transmits data to through SPI.
  *          With the way the LTC6811 communication works, the LTC6811 will not send
@@ -160,15 +217,19 @@ void BSP_SPI_Init(void) {
  *          the SPI protocol expects where a transmit and receive happen
  *          simultaneously.
  * @note    Blocking statement
+ * @param   chain   daisy chain to send the data on
  * @param   txBuf   data array that contains the data to be sent.
  * @param   txLen   length of data array.
  * @return  None
  */
-void BSP_SPI_Write(uint8_t *txBuf, uint32_t txLen) {
-    currCmd = ExtractCmdFromBuff(txBuf, txLen);
+void BSP_SPI_Write(SPI_Chain chain, uint8_t *txBuf, uint32_t txLen) {
+    SelectChain(chain);
+    CountBusTime(chain, txLen);
+
+    currCmd[currChain] = ExtractCmdFromBuff(txBuf, txLen);
 
-    if(((currCmd & 0x600) == 0x200) || (currCmd & 0x700) == 0x400) {
-        currCmd &= ~0x187;  // Bit Mask to ignore any cmd configuration bits i.e. ignore the MD, DCP, etc. bits
+    if(((currCmd[currChain] & 0x600) == 0x200) || (currCmd[currChain] & 0x700) == 0x400) {
+        currCmd[currChain] &= ~0x187;  // Bit Mask to ignore any cmd configuration bits i.e. ignore the MD, DCP, etc. bits
     }
 
     // Ignore PEC (bits 2 and 3), PEC is meant to be able to check if EMI/noise affected the data
@@ -182,30 +243,100 @@ void BSP_SPI_Write(uint8_t *txBuf, uint32_t txLen) {
  *          The SPI protocol requires the uC to transmit data in order to receive
  *          anything so the uC will send junk data.
  * @note    Blocking statement
+ * @param   chain   daisy chain to read the data from
  * @param   rxBuf   data array to store the data that is received.
  * @param   rxLen   length of data array.
  * @return  None
  */
-void BSP_SPI_Read(uint8_t *rxBuf, uint32_t rxLen) {
+void BSP_SPI_Read(SPI_Chain chain, uint8_t *rxBuf, uint32_t rxLen) {
+    SelectChain(chain);
+    CountBusTime(chain, rxLen);
 
     // One register is 8 bytes or greater. If there was an SPI call where rxLen
     // is less than 8, that means it's either a wakeup call or some generic call
     // that does not require data to be returned by the LTC6811
     if(rxLen >= 8) {
-        RDCommandHandler(rxBuf, rxLen);
+        // Every LTC6811 on the chain answers with 8 bytes, anything shorter can't hold the packet
+        if(rxLen >= NUM_MINIONS_PER_CHAIN * 8) {
+            RDCommandHandler(rxBuf, rxLen);
+        }
+    } else {
+        // Conversions finish instantly in the simulator. The LTC6811 holds SDO high once
+        // it's done so polling the ADC returns right away.
+        memset(rxBuf, 0xFF, rxLen);
     }
 }
 
+/**
+ * @brief   Starts a command + read transaction in the background.
+ *          The simulator has no DMA so the transfer is done before this returns.
+ * @param   chain   daisy chain to run the transaction on
+ * @param   txBuf   command bytes to send
+ * @param   txLen   number of command bytes
+ * @param   rxBuf   data array to store the data that is received
+ * @param   rxLen   number of bytes to receive after the command
+ * @return  None
+ */
+void BSP_SPI_StartWriteRead(SPI_Chain chain, uint8_t *txBuf, uint32_t txLen, uint8_t *rxBuf, uint32_t rxLen) {
+    BSP_SPI_Write(chain, txBuf, txLen);
+    BSP_SPI_Read(chain, rxBuf, rxLen);
+}
+
+/**
+ * @brief   Checks if a transaction started by BSP_SPI_StartWriteRead is still running.
+ * @param   chain   daisy chain to check
+ * @return  always false, simulated transfers finish immediately
+ */
+bool BSP_SPI_IsBusy(SPI_Chain chain) {
+    return false;
+}
+
 /**
  * @brief   Sets the state of the chip select output pin.
  *          Set the state to low/0 to notify the LTC6811 that the data sent on the
  *          SPI lines are for it. Set the state to high/1 to make the LTC6811
  *          go to standby.
+ * @param   chain   daisy chain whose chip select pin is set
  * @param   state   0 for select, 1 to deselect
  * @return  None
  */
-void BSP_SPI_SetStateCS(uint8_t state) {
-    chipSelectState = state;
+void BSP_SPI_SetStateCS(SPI_Chain chain, uint8_t state) {
+    chipSelectState[chain] = state;
+}
+
+/**
+ * @brief   Gets how long the isoSPI link of a chain has been busy since BSP_SPI_Init.
+ *          Every byte is counted at the bit rate the chain was set to when it was sent.
+ * @param   chain   daisy chain to check
+ * @return  bus time in microseconds
+ */
+uint32_t BSP_SPI_GetBusTimeUs(SPI_Chain chain) {
+    return (uint32_t)(busTimeNs[chain] / 1000);
+}
+
+/**
+ * @brief   Sets the fastest rate the simulated isoSPI cable of a chain carries cleanly.
+ *          Reads at higher rates get PEC errors, more often the further past the limit they are.
+ *          Every chain is clean at all rates until this is called.
+ * @param   chain   daisy chain to change
+ * @param   fastest fastest error free bit rate
+ * @return  None
+ */
+void BSP_SPI_SetLinkLimit(SPI_Chain chain, SPI_Speed fastest) {
+    linkLimit[chain] = fastest;
+}
+
+/**
+ * @brief   Puts a fault on a simulated temperature sensor. A stuck sensor keeps the reading
+ *          it had when the fault was set. Faults are cleared by BSP_SPI_Init.
+ * @param   board   index of board (0-indexed)
+ * @param   channel board channel, mux * 8 + mux channel (0-indexed)
+ * @param   fault   fault to inject, SIM_SENSOR_OK to repair the sensor
+ * @return  None
+ */
+void BSP_SPI_SetSensorFault(uint8_t board, uint8_t channel, SimSensorFault fault) {
+    simulationData[board].stuck_mv[channel] = SensorMilliVolts(&simulationData[board], channel);
+    simulationData[board].sensor_fault[channel] = fault;
 }
 
 
@@ -222,16 +353,16 @@ void BSP_SPI_SetStateCS(uint8_t state) {
 static void WRCommandHandler(uint8_t *buf, uint32_t len) {
 
     const uint8_t BYTES_PER_REG = 6;
-    uint8_t data[NUM_MINIONS * BYTES_PER_REG];
+    uint8_t data[NUM_MINIONS_PER_CHAIN * BYTES_PER_REG];
 
-    switch(currCmd) {
+    switch(currCmd[currChain]) {
         // LTC6811 Configuration
         case SIM_LTC6811_WRCFGA: {
             ExtractDataFromBuff(data, buf, len);
             int dataIdx = 0;
-            for(int i = NUM_MINIONS - 1; i >= 0; i--) {
+            for(int i = NUM_MINIONS_PER_CHAIN - 1; i >= 0; i--) {
                 // Copy data to config register
-                memcpy(simulationData[i].config, &data[dataIdx*BYTES_PER_REG], BYTES_PER_REG);
+                memcpy(chainData[i].config, &data[dataIdx*BYTES_PER_REG], BYTES_PER_REG);
                 dataIdx++;
             }
             break;
@@ -241,17 +372,17 @@ static void WRCommandHandler(uint8_t *buf, uint32_t len) {
         case SIM_LTC6811_ADCV:
         case SIM_LTC6811_ADAX:
             UpdateSimulationData();
-            openWireOpFlag = false;
+            openWireOpFlag[currChain] = false;
             break;
 
         case SIM_LTC6811_ADOWPU:
         case SIM_LTC6811_ADOWPD:
-            openWirePUFlag = false;
-            if(currCmd == SIM_LTC6811_ADOWPU) {
-                openWirePUFlag = true;
+            openWirePUFlag[currChain] = false;
+            if(currCmd[currChain] == SIM_LTC6811_ADOWPU) {
+                openWirePUFlag[currChain] = true;
             }
             UpdateSimulationData();
-            openWireOpFlag = true;
+            openWireOpFlag[currChain] = true;
             break;
 
         case SIM_LTC6811_WRCOMM:
@@ -273,18 +404,18 @@ static void WRCommandHandler(uint8_t *buf, uint32_t len) {
 static void RDCommandHandler(uint8_t *buf, uint32_t len) {
 
     const uint8_t BYTES_PER_REG = 6;
-    uint8_t data[NUM_MINIONS * BYTES_PER_REG];
+    uint8_t data[NUM_MINIONS_PER_CHAIN * BYTES_PER_REG];
 
-    switch(currCmd) {
+    switch(currCmd[currChain]) {
         // LTC6811 Configuration
         case SIM_LTC6811_RDCFGA: {
             // store config registers of all LTC6811s into one continuous array
             int dataIdx = 0;
-            for(int i = NUM_MINIONS - 1; i >= 0; i--) {
-                memcpy(&data[dataIdx * BYTES_PER_REG], simulationData[i].config, BYTES_PER_REG);
+            for(int i = NUM_MINIONS_PER_CHAIN - 1; i >= 0; i--) {
+                memcpy(&data[dataIdx * BYTES_PER_REG], chainData[i].config, BYTES_PER_REG);
                 dataIdx++;
             }
-            CreateReadPacket(buf, data, NUM_MINIONS * BYTES_PER_REG);
+            CreateReadPacket(buf, data, NUM_MINIONS_PER_CHAIN * BYTES_PER_REG);
             break;
         }
 
@@ -295,20 +426,29 @@ static void RDCommandHandler(uint8_t *buf, uint32_t len) {
         case SIM_LTC6811_RDCVD:
         case SIM_LTC6811_RDCVE:
         case SIM_LTC6811_RDCVF: {
-            Group grp = DetermineGroupLetter(currCmd);
-            if(openWireOpFlag) {
-                CopyOpenWireVoltageToByteArray(data, grp, openWirePUFlag);
+            Group grp = DetermineGroupLetter(currCmd[currChain]);
+            if(openWireOpFlag[currChain]) {
+                CopyOpenWireVoltageToByteArray(data, grp, openWirePUFlag[currChain]);
             } else {
                 CopyVoltageToByteArray(data, grp);
             }
-            CreateReadPacket(buf, data, NUM_MINIONS * BYTES_PER_REG);
+            CreateReadPacket(buf, data, NUM_MINIONS_PER_CHAIN * BYTES_PER_REG);
             break;
         }
 
         case SIM_LTC6811_RDAUXA: {
-            Group grp = DetermineGroupLetter(currCmd);
+            Group grp = DetermineGroupLetter(currCmd[currChain]);
             CopyTemperatureToByteArray(data, grp);
-            CreateReadPacket(buf, data, NUM_MINIONS * BYTES_PER_REG);
+            CreateReadPacket(buf, data, NUM_MINIONS_PER_CHAIN * BYTES_PER_REG);
+            break;
+        }
+
+        // Read Status
+        case SIM_LTC6811_RDSTATA:
+        case SIM_LTC6811_RDSTATB: {
+            Group grp = DetermineGroupLetter(currCmd[currChain]);
+            CopyStatusToByteArray(data, grp);
+            CreateReadPacket(buf, data, NUM_MINIONS_PER_CHAIN * BYTES_PER_REG);
             break;
         }
 
@@ -328,11 +468,13 @@ static Group DetermineGroupLetter(uint16_t cmd) {
     switch(cmd) {
         case SIM_LTC6811_RDCVA:
         case SIM_LTC6811_RDAUXA:
+        case SIM_LTC6811_RDSTATA:
             grp = GroupA;
             break;
 
         case SIM_LTC6811_RDCVB:
         case SIM_LTC6811_RDAUXB:
+        case SIM_LTC6811_RDSTATB:
             grp = GroupB;
             break;
 
@@ -371,9 +513,6 @@ static Group DetermineGroupLetter(uint16_t cmd) {
  */
 static bool UpdateSimulationData(void) {
     int lineIdx = 0;
-    int temperatureIdx = 0;
-    int voltageIdx = 0;
-    int openWireIdx = 0;
 
     // Open File and get file descriptor
     FILE* fp = fopen(file, "r");
@@ -400,25 +539,27 @@ static bool UpdateSimulationData(void) {
         char *temperature1 = __strtok_r(NULL, ",", &saveDataPtr);
         char *temperature2 = __strtok_r(NULL, ",", &saveDataPtr);
 
+        // Each line is one battery module, Topology.h knows where it is wired
+        if(lineIdx >= NUM_BATTERY_MODULES) {
+            break;
+        }
+        const ModuleTap *module = &ModuleMap[lineIdx];
+        const SensorTap *sensor1 = &SensorMap[ModuleSensors[lineIdx][0]];
+        const SensorTap *sensor2 = &SensorMap[ModuleSensors[lineIdx][1]];
+
         // Place into ltc6811_sim_t data struct
         // Voltage Data
-        simulationData[lineIdx / MAX_VOLT_SENSORS_PER_MINION_BOARD].voltage_data[voltageIdx] = atoi(voltage);
-        
-        voltageIdx = (voltageIdx + 1) % MAX_VOLT_SENSORS_PER_MINION_BOARD;
+        simulationData[module->board].voltage_data[module->cell] = atoi(voltage);
 
         // Temperature Data
-        simulationData[lineIdx / MAX_VOLT_SENSORS_PER_MINION_BOARD].temperature_data[temperatureIdx] = atoi(temperature1);
+        simulationData[sensor1->board].temperature_data[sensor1->mux * (MAX_TEMP_SENSORS_PER_MINION_BOARD / 2) + sensor1->channel] = atoi(temperature1);
 
-        simulationData[lineIdx / MAX_VOLT_SENSORS_PER_MINION_BOARD].temperature_data[temperatureIdx + MAX_TEMP_SENSORS_PER_MINION_BOARD / NUM_TEMP_SENSORS_PER_MOD] = atoi(temperature2);
-        
-        temperatureIdx = (temperatureIdx + 1) % (MAX_TEMP_SENSORS_PER_MINION_BOARD / NUM_TEMP_SENSORS_PER_MOD);
+        simulationData[sensor2->board].temperature_data[sensor2->mux * (MAX_TEMP_SENSORS_PER_MINION_BOARD / 2) + sensor2->channel] = atoi(temperature2);
 
         // Open Wire Data
         // Open wires are indicated as a bitmap instead of an array
         // 1 is open wire, 0 means closed wired
-        simulationData[lineIdx / MAX_VOLT_SENSORS_PER_MINION_BOARD].open_wire |= (~atoi(openWire) & 0x01) << openWireIdx;
-        
-        openWireIdx = (openWireIdx + 1) % MAX_VOLT_SENSORS_PER_MINION_BOARD;
+        simulationData[module->board].open_wire |= (~atoi(openWire) & 0x01) << module->cell;
 
         lineIdx++;
     }
@@ -460,7 +601,7 @@ static void ExtractDataFromBuff(uint8_t *data, uint8_t *buf, uint32_t len) {
     const uint8_t BYTES_PER_IC = 8;     // Register size (6B) + PEC (2B)
 
     // Extract only the data so ignore PEC and command code
-    for(int i = 0; i < NUM_MINIONS; i++) {
+    for(int i = 0; i < NUM_MINIONS_PER_CHAIN; i++) {
         // The +4 is because bytes [0:1] holds the command code and [2:3] holds
         //  the PEC for the command code.
         memcpy(&data[i*BYTES_PER_REG], &buf[i*BYTES_PER_IC+4], BYTES_PER_REG);
@@ -483,8 +624,8 @@ static void ExtractMUXAddrFromBuff(uint8_t *buf) {
     buf = buf + 4;
 
     int minionIdx = 0;
-    for(int i = NUM_MINIONS-1; i >= 0; i--) {
-        simulationData[minionIdx].temperature_mux = ((buf[i*BYTES_PER_REG] << 4) & 0xF0)
+    for(int i = NUM_MINIONS_PER_CHAIN-1; i >= 0; i--) {
+        chainData[minionIdx].temperature_mux = ((buf[i*BYTES_PER_REG] << 4) & 0xF0)
                                                     | ((buf[i*BYTES_PER_REG+1] >> 4) & 0x0F);
         minionIdx++;
     }
@@ -501,9 +642,9 @@ static void ExtractMUXSelFromBuff(uint8_t *buf) {
     buf = buf + 4;
 
     int minionIdx = 0;
-    for(int i = NUM_MINIONS-1; i >= 0; i--) {
+    for(int i = NUM_MINIONS_PER_CHAIN-1; i >= 0; i--) {
         uint8_t sel = ((buf[i*BYTES_PER_REG+3] >> 4) & 0x000F) - 8;     // Check LTC1380 as to why there is an 8
-        simulationData[minionIdx].temperature_sel = sel;
+        chainData[minionIdx].temperature_sel = sel;
         minionIdx++;
     }
 }
@@ -518,7 +659,7 @@ static void CreateReadPacket(uint8_t *pkt, uint8_t *data, uint32_t dataSize) {
     const uint8_t BYTES_PER_REG = 6;
 
     uint32_t pktIdx = 0;
-    for (uint8_t currIC = NUM_MINIONS; currIC > 0; currIC--) {
+    for (uint8_t currIC = NUM_MINIONS_PER_CHAIN; currIC > 0; currIC--) {
         // executes for each LTC681x in daisy chain, this loops starts with
         // the last IC on the stack. The first configuration written is
         // received by the last IC in the daisy chain
@@ -532,9 +673,37 @@ static void CreateReadPacket(uint8_t *pkt, uint8_t *data, uint32_t dataSize) {
         pkt[pktIdx] = (dataPEC >> 8) & 0x00FF;
         pkt[pktIdx + 1] = dataPEC & 0x00FF;
         pktIdx = pktIdx + 2;
+
+        // Corrupt the register on its way over the cable, the driver sees it as a PEC mismatch
+        if(LinkNoise()) {
+            pkt[pktIdx - 8] ^= 0x10;
+        }
     }
 }
 
+/**
+ * @brief   Decides if the register that is being read gets hit by noise on the isoSPI cable.
+ *          Uses its own pseudo random sequence so runs are repeatable.
+ * @return  true if the register should be corrupted
+ */
+static bool LinkNoise(void) {
+    if(chainSpeed[currChain] <= linkLimit[currChain]) {
+        return false;
+    }
+
+    linkNoiseState = linkNoiseState * 1103515245 + 12345;
+    return ((linkNoiseState >> 16) & 0x7FFF) < LinkErrorOdds[chainSpeed[currChain] - linkLimit[currChain]];
+}
+
+/**
+ * @brief   Adds the time it takes to clock bytes over the isoSPI link of a chain.
+ * @param   chain   daisy chain the bytes were sent on
+ * @param   bytes   number of bytes
+ */
+static void CountBusTime(SPI_Chain chain, uint32_t bytes) {
+    busTimeNs[chain] += ((uint64_t)bytes * 8 * 1000000000) / SpeedBitrate[chainSpeed[chain]];
+}
+
 /**
  * @brief   Copies the voltage data in each array into one continuous array
  * @param   data      array that will be filled
@@ -548,8 +717,8 @@ static void CopyVoltageToByteArray(uint8_t *data, Group group) {
     int voltageStartIdx = group * 3;
 
     int dataIdx = 0;
-    for(int i = NUM_MINIONS-1; i >= 0; i--) {
-        memcpy(&data[dataIdx * BYTES_PER_REG], (uint8_t *)&(simulationData[i].voltage_data[voltageStartIdx]), BYTES_PER_REG);
+    for(int i = NUM_MINIONS_PER_CHAIN-1; i >= 0; i--) {
+        memcpy(&data[dataIdx * BYTES_PER_REG], (uint8_t *)&(chainData[i].voltage_data[voltageStartIdx]), BYTES_PER_REG);
         dataIdx++;
     }
 }
@@ -563,8 +732,8 @@ static void CopyVoltageToByteArray(uint8_t *data, Group group) {
 static void CopyOpenWireVoltageToByteArray(uint8_t *data, Group group, bool pullup) {
     const uint8_t BYTES_PER_REG = 6;
     const int MAX_PINS_PER_LTC6811 = 12;         // LTC6811 can only support 12 voltage modules
-    uint16_t pullupVoltages[NUM_MINIONS][MAX_PINS_PER_LTC6811];
-    uint16_t pulldownVoltages[NUM_MINIONS][MAX_PINS_PER_LTC6811];
+    uint16_t pullupVoltages[NUM_MINIONS_PER_CHAIN][MAX_PINS_PER_LTC6811];
+    uint16_t pulldownVoltages[NUM_MINIONS_PER_CHAIN][MAX_PINS_PER_LTC6811];
 
     // The LTC6811 returns only 3 voltage values at a time depending on the group,
     // i.e. group A will only send the voltage values [0,2], group B will send [3,5], and so on
@@ -576,9 +745,9 @@ static void CopyOpenWireVoltageToByteArray(uint8_t *data, Group group, bool pull
     // If pullupVolt[1] = 0, then pin C0 is open.
     // If pulldownVolt[12] = 0, then pin C12 is open.
     // TODO: Simulator currently does not support open wire indication of pin C0 (ground pin)
-    for(int i = 0; i < NUM_MINIONS; i++) {
+    for(int i = 0; i < NUM_MINIONS_PER_CHAIN; i++) {
         for(int j = 0; j < MAX_PINS_PER_LTC6811; j++) {
-            if(simulationData[i].open_wire & (1 << j)) {
+            if(chainData[i].open_wire & (1 << j)) {
                 pullupVoltages[i][j] = 40000;       // These are just dummy values. As long as
                                                     // pullup-pulldown > 4000 (-400mV)
                 pulldownVoltages[i][j] = 30000;
@@ -591,7 +760,7 @@ static void CopyOpenWireVoltageToByteArray(uint8_t *data, Group group, bool pull
     }
 
     int dataIdx = 0;
-    for(int i = NUM_MINIONS-1; i >= 0; i--) {
+    for(int i = NUM_MINIONS_PER_CHAIN-1; i >= 0; i--) {
 
         if(pullup) {
             memcpy(&data[dataIdx * BYTES_PER_REG], (uint8_t *)&(pullupVoltages[i][voltageStartIdx]), BYTES_PER_REG);
@@ -618,15 +787,15 @@ static void CopyTemperatureToByteArray(uint8_t *data, Group group) {
     // location that is updated.
     if(group == GroupA) {
         int dataIdx = 0;
-        for(int i = NUM_MINIONS-1; i >= 0; i--) {
+        for(int i = NUM_MINIONS_PER_CHAIN-1; i >= 0; i--) {
 
-            uint8_t temperatureIdx = simulationData[i].temperature_sel;
+            uint8_t temperatureIdx = chainData[i].temperature_sel;
 
-            if(simulationData[i].temperature_mux == SIM_LTC1380_MUX2) {
+            if(chainData[i].temperature_mux == SIM_LTC1380_MUX2) {
                 temperatureIdx += 8;
             }
 
-            uint16_t mVData = ConvertTemperatureToMilliVolts(simulationData[i].temperature_data[temperatureIdx]) * 10;   // multiply by 10 because the Temperature library is expecting 0.0001 resolution
+            uint16_t mVData = SensorMilliVolts(&chainData[i], temperatureIdx) * 10;   // multiply by 10 because the Temperature library is expecting 0.0001 resolution
 
             memcpy(&data[dataIdx * BYTES_PER_REG], (uint8_t *)&(mVData), 2);
             dataIdx++;
@@ -634,6 +803,77 @@ static void CopyTemperatureToByteArray(uint8_t *data, Group group) {
     }
 }
 
+/**
+ * @brief   Gets what a temperature sensor outputs, including any injected fault
+ * @param   board   simulated LTC6811 the sensor is wired to
+ * @param   channel board channel, mux * 8 + mux channel
+ * @return  mV on GPIO1
+ */
+static uint16_t SensorMilliVolts(ltc6811_sim_t *board, uint8_t channel) {
+    switch(board->sensor_fault[channel]) {
+        case SIM_SENSOR_SHORTED:
+            return SIM_SHORTED_MV;
+        case SIM_SENSOR_OPEN:
+            return SIM_OPEN_MV;
+        case SIM_SENSOR_STUCK:
+            return board->stuck_mv[channel];
+        case SIM_SENSOR_DETACHED:
+            return ConvertTemperatureToMilliVolts(SIM_AMBIENT_TEMPERATURE);
+        default:
+            return ConvertTemperatureToMilliVolts(board->temperature_data[channel]);
+    }
+}
+
+/**
+ * @brief   Copies the status registers of every LTC6811 into one continuous array.
+ *          Group A holds the sum of cells, the die temperature and the analog supply,
+ *          group B the digital supply. The simulator never sets any of the flags.
+ * @param   data      array that will be filled
+ * @param   group     GroupA or GroupB
+ */
+static void CopyStatusToByteArray(uint8_t *data, Group group) {
+    const uint8_t BYTES_PER_REG = 6;
+
+    int dataIdx = 0;
+    for(int i = NUM_MINIONS_PER_CHAIN-1; i >= 0; i--) {
+        uint16_t status[3] = {0};
+
+        if(group == GroupA) {
+            uint32_t sum = 0;
+            for(int cell = 0; cell < 12; cell++) {
+                sum += chainData[i].voltage_data[cell];
+            }
+            status[0] = sum / 20;       // Sum of cells is in 2mV steps
+            // ITMP is 7.5mV per Kelvin in 100uV steps
+            status[1] = ((DieTemperature(currChain * NUM_MINIONS_PER_CHAIN + i) + 273000) * 3) / 40;
+            status[2] = SIM_VA_CODE;
+        } else {
+            status[0] = SIM_VD_CODE;
+        }
+
+        memcpy(&data[dataIdx * BYTES_PER_REG], (uint8_t *)status, BYTES_PER_REG);
+        dataIdx++;
+    }
+}
+
+/**
+ * @brief   Models the die temperature of an LTC6811 as the average of the modules
+ *          its temperature sensors are on. Injected sensor faults do not change it.
+ * @param   board   index of board (0-indexed)
+ * @return  die temperature in mC
+ */
+static int32_t DieTemperature(uint8_t board) {
+    int32_t total = 0;
+    int32_t count = 0;
+    for(int channel = 0; channel < MAX_TEMP_SENSORS_PER_MINION_BOARD; channel++) {
+        if(Topology_GetChannelSensor(board, channel) != TOPOLOGY_UNUSED) {
+            total += simulationData[board].temperature_data[channel];
+            count++;
+        }
+    }
+    return count > 0 ? total / count : SIM_AMBIENT_TEMPERATURE;
+}
+
 /**
  * @brief   Converts the temperature data in celcius to millivolts that the
  *          Temperature.c library will be expecting.
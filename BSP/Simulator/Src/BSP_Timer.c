@@ -4,6 +4,8 @@
 #include <sys/file.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <time.h>
+#include <errno.h>
 #include "simulator_conf.h"
 
 static const char* file = GET_CSV_PATH(TIMER_CSV_FILE);
@@ -15,6 +17,8 @@ static uint32_t ticks;
 
 static char init = 's';
 
+static uint64_t tickStart;      // ms on CLOCK_MONOTONIC when the tick started
+
 
 /**
  * @brief   Initialize the timer for time measurements.
@@ -121,3 +125,52 @@ uint32_t BSP_Timer_GetRunFreq(void) {
     }
      
 }
+
+/**
+ * @brief   Gets a free running count of CPU cycles for measuring how long code takes.
+ *          The simulator counts nanoseconds instead. Wraps around, subtract two counts.
+ * @param   None
+ * @return  cycle count
+ */
+uint32_t BSP_Timer_GetCycleCount(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+/**
+ * @brief   Starts the 1ms system tick the scheduler runs on.
+ *          The simulator counts milliseconds of CLOCK_MONOTONIC.
+ * @param   None
+ * @return  None
+ */
+void BSP_Timer_StartTick(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    tickStart = ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @brief   Gets the number of 1ms system ticks since BSP_Timer_StartTick.
+ *          Wraps around after 49 days, subtract two counts.
+ * @param   None
+ * @return  milliseconds
+ */
+uint32_t BSP_Timer_GetTick(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000 - tickStart);
+}
+
+/**
+ * @brief   Sleeps until the next interrupt. Over more than one tick the tick interrupt is
+ *          held off, every other interrupt stays armed and wakes the CPU early. Call with
+ *          interrupts disabled. The simulator has no interrupts and just waits the ticks.
+ * @param   ticks until the next thread is due
+ * @return  ticks that went by without a tick interrupt, the caller has to catch up on them
+ */
+uint32_t BSP_Timer_Sleep(uint32_t ticks) {
+    struct timespec ts = {.tv_sec = ticks / 1000, .tv_nsec = (long)(ticks % 1000) * 1000000L};
+    while(nanosleep(&ts, &ts) != 0 && errno == EINTR);
+    return 0;
+}
@@ -1,6 +1,7 @@
 #include "BSP_UART.h"
 #include <stdint.h>
 #include <pthread.h>
+#include "Counters.h"
 
 #define RX_SIZE     64
 
@@ -92,6 +93,11 @@ void *ScanThread(void *arg) {
     do {
         int data = fgetc(stdin);
 
+        // Nothing more will come, spinning on EOF would keep a host CPU busy
+        if(data == EOF) {
+            break;
+        }
+
         if(data == '\r' || data == '\n') {
             lineReceived = true;
         }
@@ -106,14 +112,16 @@ void *ScanThread(void *arg) {
             // Sweet, just a "regular" key. Put it into the fifo
             // Doesn't matter if it fails. If it fails, then the data gets thrown away
             // and the easiest solution for this is to increase RX_SIZE
-            RxFifo_Put((uint8_t)data);
+            if(!RxFifo_Put((uint8_t)data)) {
+                COUNTER_INC(COUNTER_UART_RX_DROPS);
+            }
 
             pthread_mutex_unlock(&rx_mutex);
         }
 
     } while (1);
 
-    // Should not get here
+    // Only gets here once stdin is closed
     int retval = 1;
     pthread_exit(&retval);
 }
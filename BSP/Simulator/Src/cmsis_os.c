@@ -0,0 +1,395 @@
+/* The CMSIS-RTOS API of cmsis_os.h on POSIX threads.
+ * Threads run SCHED_FIFO at 10 + their osPriority when the process is allowed to, so a
+ * higher priority thread preempts a lower one like on the target. Without the permission
+ * they fall back to the normal Linux scheduler and priorities only become hints.
+ * Mutexes are recursive and inherit priority, queues hold 32-bit messages.
+ * Waits block on the Linux clocks, the time the process does not spend on a CPU is idle.
+ */
+
+#define _XOPEN_SOURCE 700           // Recursive mutexes
+
+#include "cmsis_os.h"
+#include "BSP_Timer.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+
+#define MAX_THREADS         16
+#define FIFO_PRIORITY_BASE  10      // SCHED_FIFO priority of osPriorityNormal
+
+struct os_thread_cb {
+    pthread_t thread;
+    os_pthread function;
+    void *argument;
+    osPriority priority;
+};
+
+struct os_mutex_cb {
+    pthread_mutex_t mutex;
+};
+
+struct os_messageQ_cb {
+    pthread_mutex_t mutex;
+    pthread_cond_t notEmpty;
+    uint32_t *buffer;
+    uint32_t size;
+    uint32_t head;
+    uint32_t count;
+};
+
+static struct os_thread_cb Threads[MAX_THREADS];
+static uint32_t NumThreads;
+static pthread_mutex_t ThreadsMutex = PTHREAD_MUTEX_INITIALIZER;
+static bool Running = false;
+static bool RealTime = true;        // Cleared once SCHED_FIFO turns out to be denied
+static uint64_t StartWall;          // us on CLOCK_MONOTONIC at osKernelStart
+static uint64_t StartBusy;          // us on CLOCK_PROCESS_CPUTIME_ID at osKernelStart
+
+/**
+ * @brief   Turns a timeout in ms into an absolute time on CLOCK_REALTIME for the timed waits
+ * @param   millisec timeout
+ * @return  absolute time
+ */
+static struct timespec Deadline(uint32_t millisec) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += millisec / 1000;
+    ts.tv_nsec += (long)(millisec % 1000) * 1000000L;
+    if(ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return ts;
+}
+
+/**
+ * @brief   Reads a clock in microseconds
+ * @param   clock to read
+ * @return  microseconds
+ */
+static uint64_t Microseconds(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static void *ThreadEntry(void *cb) {
+    struct os_thread_cb *thread = cb;
+    thread->function(thread->argument);
+    return NULL;
+}
+
+/**
+ * @brief   Initialize the RTOS Kernel for creating objects. Makes main a thread.
+ * @param   None
+ * @return  osOK
+ */
+osStatus osKernelInitialize(void) {
+    pthread_mutex_lock(&ThreadsMutex);
+    Threads[0].thread = pthread_self();
+    Threads[0].priority = osPriorityNormal;
+    NumThreads = 1;
+    pthread_mutex_unlock(&ThreadsMutex);
+    return osOK;
+}
+
+/**
+ * @brief   Start the RTOS Kernel. Starts the system tick and raises main to osPriorityNormal.
+ * @param   None
+ * @return  osOK
+ */
+osStatus osKernelStart(void) {
+    struct sched_param param = {.sched_priority = FIFO_PRIORITY_BASE + osPriorityNormal};
+    if(pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0) {
+        RealTime = false;
+    }
+    BSP_Timer_StartTick();
+    StartWall = Microseconds(CLOCK_MONOTONIC);
+    StartBusy = Microseconds(CLOCK_PROCESS_CPUTIME_ID);
+    Running = true;
+    return osOK;
+}
+
+/**
+ * @brief   Check if the RTOS kernel is already started.
+ * @param   None
+ * @return  0 RTOS is not started, 1 RTOS is started.
+ */
+int32_t osKernelRunning(void) {
+    return Running;
+}
+
+/**
+ * @brief   The simulator has no tick interrupt, waits run on the Linux clocks
+ * @param   None
+ * @return  None
+ */
+void osSystickHandler(void) {
+}
+
+/**
+ * @brief   Time the CPU had nothing to run since osKernelStart. Threads of the simulator can
+ *          run on several host CPUs at once, busy time is capped at the wall time.
+ * @param   total microseconds since osKernelStart, may be NULL
+ * @return  microseconds spent idle since osKernelStart
+ */
+uint64_t osKernelIdleTime(uint64_t *total) {
+    uint64_t wall = Running ? Microseconds(CLOCK_MONOTONIC) - StartWall : 0;
+    uint64_t busy = Running ? Microseconds(CLOCK_PROCESS_CPUTIME_ID) - StartBusy : 0;
+    if(total != NULL) {
+        *total = wall;
+    }
+    return busy < wall ? wall - busy : 0;
+}
+
+/**
+ * @brief   Create a thread and start it
+ * @param   thread_def thread function and priority, the stack size is left to Linux
+ * @param   argument passed to the thread function
+ * @return  thread ID or NULL in case of error
+ */
+osThreadId osThreadCreate(const osThreadDef_t *thread_def, void *argument) {
+    if(thread_def == NULL || thread_def->pthread == NULL) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&ThreadsMutex);
+    if(NumThreads >= MAX_THREADS) {
+        pthread_mutex_unlock(&ThreadsMutex);
+        return NULL;
+    }
+    struct os_thread_cb *thread = &Threads[NumThreads];
+    thread->function = thread_def->pthread;
+    thread->argument = argument;
+    thread->priority = thread_def->tpriority;
+
+    int result = EPERM;
+    if(RealTime) {
+        pthread_attr_t attr;
+        struct sched_param param = {.sched_priority = FIFO_PRIORITY_BASE + thread_def->tpriority};
+        pthread_attr_init(&attr);
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        pthread_attr_setschedparam(&attr, &param);
+        result = pthread_create(&thread->thread, &attr, ThreadEntry, thread);
+        pthread_attr_destroy(&attr);
+        RealTime = result != EPERM;
+    }
+    if(result != 0) {
+        result = pthread_create(&thread->thread, NULL, ThreadEntry, thread);
+    }
+    if(result != 0) {
+        pthread_mutex_unlock(&ThreadsMutex);
+        return NULL;
+    }
+    NumThreads++;
+    pthread_mutex_unlock(&ThreadsMutex);
+    return thread;
+}
+
+/**
+ * @brief   Return the thread ID of the current running thread.
+ * @param   None
+ * @return  thread ID or NULL for a thread the kernel did not create
+ */
+osThreadId osThreadGetId(void) {
+    osThreadId id = NULL;
+    pthread_mutex_lock(&ThreadsMutex);
+    for(uint32_t i = 0; i < NumThreads; i++) {
+        if(pthread_equal(Threads[i].thread, pthread_self())) {
+            id = &Threads[i];
+        }
+    }
+    pthread_mutex_unlock(&ThreadsMutex);
+    return id;
+}
+
+/**
+ * @brief   Terminate execution of a thread. Its slot is not reused.
+ * @param   thread_id thread ID obtained by osThreadCreate or osThreadGetId
+ * @return  status code that indicates the execution status of the function.
+ */
+osStatus osThreadTerminate(osThreadId thread_id) {
+    if(thread_id == NULL) {
+        return osErrorParameter;
+    }
+    if(pthread_equal(thread_id->thread, pthread_self())) {
+        pthread_exit(NULL);
+    }
+    return pthread_cancel(thread_id->thread) == 0 ? osOK : osErrorResource;
+}
+
+/**
+ * @brief   Pass control to next thread that is in state READY.
+ * @param   None
+ * @return  osOK
+ */
+osStatus osThreadYield(void) {
+    sched_yield();
+    return osOK;
+}
+
+/**
+ * @brief   Wait for Timeout (Time Delay).
+ * @param   millisec time delay value
+ * @return  osEventTimeout
+ */
+osStatus osDelay(uint32_t millisec) {
+    struct timespec ts = {.tv_sec = millisec / 1000, .tv_nsec = (long)(millisec % 1000) * 1000000L};
+    while(nanosleep(&ts, &ts) != 0 && errno == EINTR);
+    return osEventTimeout;
+}
+
+/**
+ * @brief   Create and Initialize a recursive Mutex object with priority inheritance.
+ * @param   mutex_def mutex definition referenced with osMutex
+ * @return  mutex ID or NULL in case of error
+ */
+osMutexId osMutexCreate(const osMutexDef_t *mutex_def) {
+    struct os_mutex_cb *mutex = malloc(sizeof(struct os_mutex_cb));
+    if(mutex_def == NULL || mutex == NULL) {
+        free(mutex);
+        return NULL;
+    }
+
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+    int result = pthread_mutex_init(&mutex->mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+    if(result != 0) {
+        free(mutex);
+        return NULL;
+    }
+    return mutex;
+}
+
+/**
+ * @brief   Wait until a Mutex becomes available
+ * @param   mutex_id mutex ID obtained by osMutexCreate
+ * @param   millisec timeout value or 0 in case of no time-out
+ * @return  osOK, osErrorResource or osErrorTimeoutResource when not available
+ */
+osStatus osMutexWait(osMutexId mutex_id, uint32_t millisec) {
+    if(mutex_id == NULL) {
+        return osErrorParameter;
+    }
+
+    int result;
+    if(millisec == 0) {
+        result = pthread_mutex_trylock(&mutex_id->mutex);
+        return result == 0 ? osOK : osErrorResource;
+    }else if(millisec == osWaitForever) {
+        result = pthread_mutex_lock(&mutex_id->mutex);
+    }else {
+        struct timespec deadline = Deadline(millisec);
+        result = pthread_mutex_timedlock(&mutex_id->mutex, &deadline);
+    }
+    return result == 0 ? osOK : osErrorTimeoutResource;
+}
+
+/**
+ * @brief   Release a Mutex that was obtained by osMutexWait.
+ * @param   mutex_id mutex ID obtained by osMutexCreate
+ * @return  osOK, osErrorResource if the calling thread does not own it
+ */
+osStatus osMutexRelease(osMutexId mutex_id) {
+    if(mutex_id == NULL) {
+        return osErrorParameter;
+    }
+    return pthread_mutex_unlock(&mutex_id->mutex) == 0 ? osOK : osErrorResource;
+}
+
+/**
+ * @brief   Create and Initialize a Message Queue.
+ * @param   queue_def queue definition referenced with osMessageQ
+ * @param   thread_id not used
+ * @return  message queue ID or NULL in case of error
+ */
+osMessageQId osMessageCreate(const osMessageQDef_t *queue_def, osThreadId thread_id) {
+    if(queue_def == NULL || queue_def->queue_sz == 0) {
+        return NULL;
+    }
+
+    struct os_messageQ_cb *queue = malloc(sizeof(struct os_messageQ_cb));
+    uint32_t *buffer = malloc(queue_def->queue_sz * sizeof(uint32_t));
+    if(queue == NULL || buffer == NULL) {
+        free(queue);
+        free(buffer);
+        return NULL;
+    }
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_REALTIME);
+    pthread_mutex_init(&queue->mutex, NULL);
+    pthread_cond_init(&queue->notEmpty, &attr);
+    pthread_condattr_destroy(&attr);
+    queue->buffer = buffer;
+    queue->size = queue_def->queue_sz;
+    queue->head = 0;
+    queue->count = 0;
+    return queue;
+}
+
+/**
+ * @brief   Put a Message to a Queue
+ * @param   queue_id message queue ID obtained with osMessageCreate
+ * @param   info message information
+ * @param   millisec ignored, does not wait for room
+ * @return  osOK, osErrorResource if the queue is full
+ */
+osStatus osMessagePut(osMessageQId queue_id, uint32_t info, uint32_t millisec) {
+    if(queue_id == NULL) {
+        return osErrorParameter;
+    }
+
+    pthread_mutex_lock(&queue_id->mutex);
+    if(queue_id->count == queue_id->size) {
+        pthread_mutex_unlock(&queue_id->mutex);
+        return osErrorResource;
+    }
+    queue_id->buffer[(queue_id->head + queue_id->count) % queue_id->size] = info;
+    queue_id->count++;
+    pthread_cond_signal(&queue_id->notEmpty);
+    pthread_mutex_unlock(&queue_id->mutex);
+    return osOK;
+}
+
+/**
+ * @brief   Get a Message or Wait for a Message from a Queue.
+ * @param   queue_id message queue ID obtained with osMessageCreate
+ * @param   millisec timeout value or 0 in case of no time-out
+ * @return  osEventMessage with the message, osEventTimeout or osOK if the queue stayed empty
+ */
+osEvent osMessageGet(osMessageQId queue_id, uint32_t millisec) {
+    osEvent event = {.status = osErrorParameter, .def.message_id = queue_id};
+    if(queue_id == NULL) {
+        return event;
+    }
+
+    struct timespec deadline = Deadline(millisec);
+    pthread_mutex_lock(&queue_id->mutex);
+    while(queue_id->count == 0 && millisec != 0) {
+        if(millisec == osWaitForever) {
+            pthread_cond_wait(&queue_id->notEmpty, &queue_id->mutex);
+        }else if(pthread_cond_timedwait(&queue_id->notEmpty, &queue_id->mutex, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+
+    if(queue_id->count > 0) {
+        event.status = osEventMessage;
+        event.value.v = queue_id->buffer[queue_id->head];
+        queue_id->head = (queue_id->head + 1) % queue_id->size;
+        queue_id->count--;
+    }else {
+        event.status = millisec == 0 ? osOK : osEventTimeout;
+    }
+    pthread_mutex_unlock(&queue_id->mutex);
+    return event;
+}
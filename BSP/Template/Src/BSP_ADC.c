@@ -10,6 +10,36 @@ void BSP_ADC_Init(void) {
     // TODO: Initialize the ADC port here
 }
 
+/**
+ * @brief   Takes the readings that were averaged since the last call, oldest first.
+ *          If the queue filled up the newest readings were dropped, the timestamps show the gap.
+ * @param   samples array to store the readings in
+ * @param   max     size of the array
+ * @return  number of readings stored
+ */
+uint32_t BSP_ADC_ReadSamples(ADC_Sample *samples, uint32_t max) {
+
+    // TODO: Start conversions from a timer, average each half of the DMA buffer
+    // in its interrupt and queue the results here
+
+    return 0;
+}
+
+/**
+ * @brief   Gets the sum of every conversion of the low precision sensor since BSP_ADC_Init.
+ *          The DMA interrupt keeps the sum so no sample is lost however late the reader is.
+ * @param   count   where to store how many conversions were summed, same count as
+ *                  ADC_Sample.timestamp. Wraps around, subtract two counts.
+ * @return  sum of the 12 bit codes
+ */
+uint64_t BSP_ADC_GetLowSum(uint32_t *count) {
+
+    // TODO: Add up the low precision conversions in the DMA interrupt
+
+    *count = 0;
+    return 0;
+}
+
 /**
  * @brief   Gets converted ADC value in units of mV.
  * @param   None
@@ -43,3 +73,54 @@ uint16_t BSP_ADC_Low_GetMilliVoltage(void) {
 
     return 0;
 }
+
+/**
+ * @brief   Arms the analog watchdog on the low precision channel. A single conversion outside
+ *          the window opens the contactor right from the ADC interrupt and latches the trip,
+ *          without waiting for the block average or the main loop.
+ * @param   lowMilliVolts   conversions below this trip
+ * @param   highMilliVolts  conversions above this trip
+ * @return  None
+ */
+void BSP_ADC_Watchdog_Init(uint16_t lowMilliVolts, uint16_t highMilliVolts) {
+
+    // TODO: Set the watchdog thresholds in ADC codes and enable its interrupt.
+    // The interrupt should call BSP_Contactor_Off() before anything else.
+
+}
+
+/**
+ * @brief   Checks if the analog watchdog has tripped since it was armed. The trip stays
+ *          latched until BSP_ADC_Watchdog_Init is called again.
+ * @param   timestamp   where to store the sample the trip happened on, same count as
+ *                      ADC_Sample.timestamp. May be NULL.
+ * @return  true if it tripped
+ */
+bool BSP_ADC_Watchdog_Tripped(uint32_t *timestamp) {
+
+    // TODO: Return the flag latched by the ADC interrupt
+
+    return false;
+}
+
+/**
+ * @brief   Copies the next raw conversions of the high precision sensor into a buffer so
+ *          the waveform can be analysed. Whole blocks are copied as they are averaged.
+ * @param   buffer  where to store the 12 bit codes, in use until BSP_ADC_IsCaptureDone
+ * @param   count   number of conversions, a multiple of ADC_BLOCK_SIZE
+ * @return  None
+ */
+void BSP_ADC_StartCapture(uint16_t *buffer, uint32_t count) {
+
+    // TODO: Copy the raw conversions of every averaged block into buffer
+
+}
+
+/**
+ * @brief   Checks if the capture started by BSP_ADC_StartCapture is complete
+ * @param   None
+ * @return  true once the buffer holds all the conversions
+ */
+bool BSP_ADC_IsCaptureDone(void) {
+    return false;
+}
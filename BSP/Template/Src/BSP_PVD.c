@@ -0,0 +1,11 @@
+#include "BSP_PVD.h"
+
+/**
+ * @brief   Initializes the programmable voltage detector. The handler is called from an interrupt
+ *          as soon as the supply starts to drop, while there is still time for a short EEPROM write.
+ * @param   handler   function to call when the supply drops
+ * @return  None
+ */
+void BSP_PVD_Init(void (*handler)(void)) {
+    // TODO: Set the voltage threshold and call handler from the supply drop interrupt
+}
@@ -1,21 +1,32 @@
 #include "BSP_SPI.h"
 
 /**
- * @brief   Initializes the SPI port connected to the LTC6820.
+ * @brief   Initializes the SPI port connected to the LTC6820 of a daisy chain.
  *          This port communicates with the LTC6811 voltage and temperature
  *          monitoring IC. The LTC6820 converts the SPI pins to 2-wire isolated SPI.
  *          Look at analog devices website and LTC6811's or LTC6820's datasheets.
- * @param   None
+ * @param   chain   daisy chain to initialize
  * @return  None
  */
-void BSP_SPI_Init(void) {
-    // TODO: Initialize the SPI port and a digital output pin for the chip select
+void BSP_SPI_Init(SPI_Chain chain) {
+    // TODO: Initialize the SPI port and a digital output pin for the chip select of the chain.
+    //      Each chain has its own SPI peripheral.
     //      SPI configuration:
     //          speed : 125kbps
     //          CPOL : 1 (polarity of clock during idle is high)
     //          CPHA : 1 (tx recorded during 2nd edge)
 }
 
+/**
+ * @brief   Changes the bit rate of a daisy chain. Waits for a running transfer to finish first.
+ * @param   chain   daisy chain to change
+ * @param   speed   new bit rate
+ * @return  None
+ */
+void BSP_SPI_SetSpeed(SPI_Chain chain, SPI_Speed speed) {
+    // TODO: Wait until the chain is idle, then change the prescaler of its SPI port.
+}
+
 /**
  * @brief   Transmits data to through SPI.
  *          With the way the LTC6811 communication works, the LTC6811 will not send
@@ -23,11 +34,12 @@ void BSP_SPI_Init(void) {
  *          the SPI protocol expects where a transmit and receive happen
  *          simultaneously.
  * @note    Blocking statement
+ * @param   chain   daisy chain to send the data on
  * @param   txBuf   data array that contains the data to be sent.
  * @param   txLen   length of data array.
  * @return  None
  */
-void BSP_SPI_Write(uint8_t *txBuf, uint32_t txLen) {
+void BSP_SPI_Write(SPI_Chain chain, uint8_t *txBuf, uint32_t txLen) {
     // TODO: Transmit data through SPI.
     //      Any data the uC receives during this process should just be thrown away.
 }
@@ -38,23 +50,51 @@ void BSP_SPI_Write(uint8_t *txBuf, uint32_t txLen) {
  *          The SPI protocol requires the uC to transmit data in order to receive
  *          anything so the uC will send junk data.
  * @note    Blocking statement
+ * @param   chain   daisy chain to read the data from
  * @param   rxBuf   data array to store the data that is received.
  * @param   rxLen   length of data array.
  * @return  None
  */
-void BSP_SPI_Read(uint8_t *rxBuf, uint32_t rxLen) {
+void BSP_SPI_Read(SPI_Chain chain, uint8_t *rxBuf, uint32_t rxLen) {
     // TODO: Read data from SPI.
     //      Send 0x00 in order to get data
 }
 
+/**
+ * @brief   Starts a command + read transaction in the background.
+ *          txBuf is clocked out first and the following rxLen bytes are stored in rxBuf.
+ * @note    Non-blocking. Chip select is not touched.
+ * @param   chain   daisy chain to run the transaction on
+ * @param   txBuf   command bytes to send
+ * @param   txLen   number of command bytes
+ * @param   rxBuf   data array to store the data that is received
+ * @param   rxLen   number of bytes to receive after the command
+ * @return  None
+ */
+void BSP_SPI_StartWriteRead(SPI_Chain chain, uint8_t *txBuf, uint32_t txLen, uint8_t *rxBuf, uint32_t rxLen) {
+    // TODO: Start a DMA transfer of txLen + rxLen bytes. Copy the last rxLen bytes received into rxBuf
+    //      once it's done. A blocking BSP_SPI_Write + BSP_SPI_Read also works, the chains just won't overlap.
+}
+
+/**
+ * @brief   Checks if a transaction started by BSP_SPI_StartWriteRead is still running.
+ * @param   chain   daisy chain to check
+ * @return  true if the transfer is still in progress, false if rxBuf is ready
+ */
+bool BSP_SPI_IsBusy(SPI_Chain chain) {
+    // TODO: Return the state of the DMA transfer
+    return false;
+}
+
 /**
  * @brief   Sets the state of the chip select output pin.
  *          Set the state to low/0 to notify the LTC6811 that the data sent on the
  *          SPI lines are for it. Set the state to high/1 to make the LTC6811
  *          go to standby.
+ * @param   chain   daisy chain whose chip select pin is set
  * @param   state   0 for select, 1 to deselect
  * @return  None
  */
-void BSP_SPI_SetStateCS(uint8_t state) {
+void BSP_SPI_SetStateCS(SPI_Chain chain, uint8_t state) {
     // TODO: Set CS pin to high or low depending on state
 }
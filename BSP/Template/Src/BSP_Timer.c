@@ -36,3 +36,14 @@ uint32_t BSP_Timer_GetTicksElapsed(void) {
 uint32_t BSP_Timer_GetRunFreq(void) {
     return 16000000;
 }
+
+/**
+ * @brief   Gets a free running count of CPU cycles for measuring how long code takes.
+ *          The simulator counts nanoseconds instead. Wraps around, subtract two counts.
+ * @param   None
+ * @return  cycle count
+ */
+uint32_t BSP_Timer_GetCycleCount(void) {
+    // TODO: return a free running cycle counter
+    return 0;
+}
@@ -0,0 +1,20 @@
+// GENERATED FILE, DO NOT EDIT. Change Config/gen_thermistor.py and run it
+/** ThermistorLUT.h
+ * Temperature in millidegrees Celsius for LTC6811 GPIO1 readings (100uV per code), one entry
+ * every THERMISTOR_LUT_STEP codes. Interpolating between two entries stays within
+ * THERMISTOR_LUT_MAX_ERROR millidegrees of the sensor equation for every 16 bit code.
+ */
+
+#ifndef THERMISTOR_LUT_H__
+#define THERMISTOR_LUT_H__
+
+#include "common.h"
+
+#define THERMISTOR_LUT_SHIFT		9
+#define THERMISTOR_LUT_STEP			(1 << THERMISTOR_LUT_SHIFT)
+#define THERMISTOR_LUT_SIZE			129
+#define THERMISTOR_LUT_MAX_ERROR	4		// millidegrees Celsius
+
+extern const int32_t ThermistorLUT[THERMISTOR_LUT_SIZE];
+
+#endif
@@ -0,0 +1,85 @@
+// GENERATED FILE, DO NOT EDIT. Change Config/topology.csv and run Config/gen_topology.py
+/** Topology.h
+ * Wiring of the battery pack: which LTC6811 cell input measures each battery module and
+ * which mux channel each temperature sensor sits on, plus the inverse lookups.
+ * Every place that converts between module/sensor numbers and board positions uses these
+ * tables so any wiring can be described in Config/topology.csv.
+ */
+
+#ifndef TOPOLOGY_H__
+#define TOPOLOGY_H__
+
+#include "common.h"
+#include "config.h"
+
+#define TOPOLOGY_MODULES		31		// Battery modules described in topology.csv
+#define TOPOLOGY_SENSORS		62		// Temperature sensors described in topology.csv
+#define TOPOLOGY_SENSORS_PER_MOD	2
+#define TOPOLOGY_BOARDS			4		// Minion boards with at least one module or sensor
+#define TOPOLOGY_UNUSED			0xFF	// Inverse map entry of an input with nothing wired to it
+
+#if TOPOLOGY_MODULES != NUM_BATTERY_MODULES || TOPOLOGY_SENSORS != NUM_TEMPERATURE_SENSORS \
+	|| TOPOLOGY_SENSORS_PER_MOD != NUM_TEMP_SENSORS_PER_MOD
+#error "Config/topology.csv does not match the battery pack layout in config.h"
+#endif
+
+#if TOPOLOGY_BOARDS > NUM_MINIONS
+#error "Config/topology.csv uses more minion boards than NUM_MINIONS"
+#endif
+
+typedef struct {
+	uint8_t board;		// Minion board (0-indexed)
+	uint8_t cell;		// LTC6811 cell input (0-indexed)
+} ModuleTap;
+
+typedef struct {
+	uint8_t board;		// Minion board (0-indexed)
+	uint8_t mux;		// 0 for MUX1, 1 for MUX2
+	uint8_t channel;	// Channel on the mux (0-7)
+} SensorTap;
+
+// Where each battery module is measured
+extern const ModuleTap ModuleMap[NUM_BATTERY_MODULES];
+
+// Where each temperature sensor is measured
+extern const SensorTap SensorMap[NUM_TEMPERATURE_SENSORS];
+
+// Temperature sensors of each battery module
+extern const uint8_t ModuleSensors[NUM_BATTERY_MODULES][NUM_TEMP_SENSORS_PER_MOD];
+
+// Battery module each temperature sensor belongs to
+extern const uint8_t SensorModule[NUM_TEMPERATURE_SENSORS];
+
+// Battery module on each cell input, TOPOLOGY_UNUSED if nothing is connected
+extern const uint8_t CellModule[TOPOLOGY_BOARDS][MAX_VOLT_SENSORS_PER_MINION_BOARD];
+
+// Temperature sensor on each board channel (mux * 8 + channel), TOPOLOGY_UNUSED if nothing is connected
+extern const uint8_t ChannelSensor[TOPOLOGY_BOARDS][MAX_TEMP_SENSORS_PER_MINION_BOARD];
+
+/** Topology_GetCellModule
+ * Finds the battery module wired to a cell input
+ * @param board index of board (0-indexed)
+ * @param cell LTC6811 cell input (0-indexed)
+ * @return module index or TOPOLOGY_UNUSED
+ */
+static inline uint8_t Topology_GetCellModule(uint8_t board, uint8_t cell) {
+	if(board >= TOPOLOGY_BOARDS || cell >= MAX_VOLT_SENSORS_PER_MINION_BOARD) {
+		return TOPOLOGY_UNUSED;
+	}
+	return CellModule[board][cell];
+}
+
+/** Topology_GetChannelSensor
+ * Finds the temperature sensor wired to a board channel
+ * @param board index of board (0-indexed)
+ * @param channel board channel, mux * 8 + mux channel (0-indexed)
+ * @return sensor index or TOPOLOGY_UNUSED
+ */
+static inline uint8_t Topology_GetChannelSensor(uint8_t board, uint8_t channel) {
+	if(board >= TOPOLOGY_BOARDS || channel >= MAX_TEMP_SENSORS_PER_MINION_BOARD) {
+		return TOPOLOGY_UNUSED;
+	}
+	return ChannelSensor[board][channel];
+}
+
+#endif
@@ -18,8 +18,20 @@ typedef enum {SAFE = 0, DANGER = 1, OVERVOLTAGE = 2, UNDERVOLTAGE = 3, OPENWIRE
 
 //--------------------------------------------------------------------------------
 // Basic Parameters of BPS layout
+#ifndef NUM_MINIONS
 #define NUM_MINIONS	4					 // Number of minion boards
-												//
+#endif
+
+// The minion boards are split evenly across independent isoSPI daisy chains.
+// Each chain is driven by its own SPI peripheral so the chains can be read at the same time.
+#ifndef NUM_CHAINS
+#define NUM_CHAINS	1					// Number of daisy chains (1-4)
+#endif
+#define NUM_MINIONS_PER_CHAIN	(NUM_MINIONS / NUM_CHAINS)
+
+#if (NUM_CHAINS < 1) || (NUM_CHAINS > 4) || (NUM_MINIONS % NUM_CHAINS != 0)
+#error "NUM_MINIONS must be split evenly across 1 to 4 daisy chains"
+#endif
 
 //--------------------------------------------------------------------------------
 // Battery Pack layout
@@ -35,10 +47,154 @@ typedef enum {SAFE = 0, DANGER = 1, OVERVOLTAGE = 2, UNDERVOLTAGE = 3, OPENWIRE
 #define MAX_DISCHARGE_TEMPERATURE_LIMIT	73.00	// Max temperature limit (Celcius)	(actual max: 75C)
 #define MAX_CHARGE_TEMPERATURE_LIMIT	48.00	// Max temperature limit (Celcius)	(actual max: 50C)
 
+// Predictive over temperature trip. A sensor also trips when its dT/dt says it will reach the
+// temperature limit within TEMP_PREDICT_HORIZON_S. dT/dt is a least squares fit over the last
+// TEMP_SLOPE_WINDOW scans.
+#define TEMPERATURE_SCAN_PERIOD_MS		1000	// Nominal time between two scans of all temperature sensors
+#define TEMP_SLOPE_WINDOW				8		// Scans in the dT/dt window
+#define TEMP_PREDICT_HORIZON_S			60		// Seconds to look ahead, 0 turns the predictive trip off
+#define TEMP_PREDICT_MIN_SLOPE			50		// Slower rises (mC/s) are left to the regular limit
+
+// Temperature sensor plausibility. A sensor that fails a check is left out of the averages and
+// the limit checks. A module without a single plausible sensor left falls back to the
+// thermal model below.
+// The neighbour and die checks only look for sensors that read too cold, a sensor reading
+// hotter than everything around it might be the one module that is really in trouble.
+#define TEMP_SENSOR_MIN_MV				500		// Lower readings are a shorted sensor	(150C is 539mV)
+#define TEMP_SENSOR_MAX_MV				3300	// Higher readings are an open sensor	(-50C is 3290mV)
+#define TEMP_STUCK_SCANS				300		// Scans with the exact same reading before a sensor counts as stuck
+#define TEMP_NEIGHBOUR_MAX_DIFF			15		// Celsius a sensor may read below the sensors around it
+#define TEMP_DIE_MAX_DIFF				25		// Celsius a sensor may read below the die of its LTC6811
+
+// Thermal model that stands in for a module whose sensors are all implausible. Each module is a
+// first order RC network heated by I^2R and pulled toward the measured modules next to it.
+// The estimate is trusted less the longer the module goes without a sensor.
+#define TEMP_MODEL_RESISTANCE			2500	// Resistance of one module (micro Ohms)
+#define TEMP_MODEL_THERMAL_RESISTANCE	500		// Module to its neighbours (milli Kelvin per Watt)
+#define TEMP_MODEL_TAU_S				300		// Thermal time constant of a module (seconds)
+#define TEMP_MODEL_DRIFT				500		// Margin added to the estimate per minute without a sensor (mC)
+#define TEMP_MODEL_MAX_AGE_S			900		// Longest the estimate may stand in for a module (seconds)
+
 #define MAX_CURRENT_LIMIT				100000		// Max current limit (Milliamperes)		(Max continuous discharge is 15A per cell)
 #define MAX_HIGH_PRECISION_CURRENT 		50000		// Max current detectable by the high-precision current sensor (mA)
 #define MAX_CHARGING_CURRENT 			-20000		// Max current per cell is 1.5 Amps (Standard charge)
 
+#define PACK_CAPACITY_MAH				41300		// Capacity of the pack, 14 cells of 2950mAh in parallel per module
+
+// State of charge estimator in ChargeEKF.c. An extended Kalman filter corrects the coulomb count
+// with the module voltages through the open circuit voltage curve and a one RC pair model of a
+// module. The table holds the open circuit voltage every 10% from empty to full.
+#define CHARGE_OCV_TABLE				{3000, 3450, 3550, 3610, 3660, 3710, 3780, 3870, 3950, 4050, 4180}	// mV
+#define CHARGE_EKF_R0					1800		// Series resistance of a module (micro Ohms)
+#define CHARGE_EKF_R1					1100		// Resistance of the RC pair of a module (micro Ohms)
+#define CHARGE_EKF_TAU_S				30			// Time constant of the RC pair (seconds)
+#define CHARGE_EKF_VOLTAGE_NOISE		10			// How far the model may be off the measured voltage (mV)
+#define CHARGE_EKF_SOC_DRIFT			2			// How far the coulomb count may drift in an hour (%)
+#define CHARGE_EKF_INITIAL_ERROR		10			// How far a stored or set state of charge may be off (%)
+
+// Per module state of charge in ModuleCharge.c. Every module follows the pack current with its
+// own capacity. Once the pack has rested long enough for the RC pair to settle, each module
+// voltage gives its state of charge through CHARGE_OCV_TABLE. The charge moved between two
+// such rests over the change in state of charge gives the capacity of the module.
+#define MODULE_REST_CURRENT				1000		// Below this the pack is resting (mA)
+#define MODULE_REST_TIME_S				150			// Rest before the voltage is read as open circuit (seconds)
+#define MODULE_CAPACITY_MIN_SWING		1000		// Least change between two rests to learn capacity from (0.01%)
+#define MODULE_CAPACITY_MEMORY			8			// Roughly how many swings the capacity estimate averages over
+
+// State of charge checkpoints in ChargeJournal.c. Each checkpoint goes to the next of
+// CHARGE_JOURNAL_SLOTS EEPROM slots so the writes are spread over all of them.
+#define CHARGE_JOURNAL_SLOTS			64			// Number of 16 byte slots
+#define CHARGE_JOURNAL_PERIOD_S			60			// Checkpoint at least this often while the charge changes
+#define CHARGE_JOURNAL_DELTA			50			// Checkpoint right away after this much change (0.01%)
+
+// Fuse curves of the time-current protection in Fuse.c. Each point is {current (mA), time (ms)
+// that current may flow from cold}. At the rating the time is endless, currents between two
+// points are interpolated in I^2 so a single point makes a plain I^2t curve.
+// Charging currents are given as positive values. Currents past MAX_CURRENT_LIMIT and
+// MAX_CHARGING_CURRENT still trip right away.
+#define FUSE_DISCHARGE_RATING			45000		// Discharge current that may flow forever (mA)
+#define FUSE_DISCHARGE_CURVE			{{60000, 60000}, {80000, 10000}, {100000, 2000}}
+#define FUSE_CHARGE_RATING				12000		// Charge current that may flow forever (mA)
+#define FUSE_CHARGE_CURVE				{{16000, 60000}, {20000, 10000}}
+#define FUSE_COOL_TAU_S					60			// Cool down time constant below the rating (seconds)
+
+// Current ripple analysis in Ripple.c. Raw high precision samples are collected at
+// ADC_SAMPLE_RATE_HZ and go through a real FFT for the ripple RMS and its strongest frequency.
+#define RIPPLE_FFT_SIZE					256			// Samples per analysis, a power of 2 from 32 to 4096
+
+// State of power in PowerLimit.c. The charge and discharge current the motor controller and
+// charger may use, sent on CAN. Each limit tapers to 0 as its margin runs out.
+#define POWER_LIMIT_PERIOD_MS			100			// Time between two updates on CAN
+#define POWER_LIMIT_RESISTANCE			3200		// Resistance of a module over a few seconds, R0 + R1 and margin (micro Ohms)
+#define POWER_LIMIT_VOLTAGE_MARGIN		50			// Headroom kept to MIN/MAX_VOLTAGE_LIMIT (mV)
+#define POWER_LIMIT_TEMP_DERATE			10			// Taper below the temperature limits (Celsius)
+#define POWER_LIMIT_SOC_DERATE			500			// Taper near empty and full (0.01%)
+#define POWER_LIMIT_FUSE_MARGIN			20			// Below this margin (%) a fuse curve caps its limit at the rating
+#define POWER_LIMIT_RISE_RATE			20000		// Fastest a limit comes back up (mA per second)
+
+// Charge profile in ChargeControl.c. Precharge, constant current, constant voltage on the
+// highest module, then a top-off while the high modules bleed through the LTC6811.
+#define CHARGE_CONTROL_PERIOD_MS		100			// Time between two charger setpoints
+#define CHARGE_CONTROL_PRECHARGE_VOLTAGE	3000	// Lowest module below this gets the precharge current (mV)
+#define CHARGE_CONTROL_PRECHARGE_CURRENT	2000	// (mA)
+#define CHARGE_CONTROL_CC_CURRENT		12000		// Constant current, at most FUSE_CHARGE_RATING (mA)
+#define CHARGE_CONTROL_CV_VOLTAGE		3950		// Highest module is held here (mV)
+#define CHARGE_CONTROL_CV_GAIN			100			// Setpoint change per second for every mV off (mA)
+#define CHARGE_CONTROL_TAPER_CURRENT	1000		// Constant voltage ends below this (mA)
+#define CHARGE_CONTROL_BALANCE_VOLTAGE	10			// Modules this far over the lowest bleed (mV)
+#define CHARGE_CONTROL_TOPOFF_CURRENT	200			// Current while balancing (mA)
+#define CHARGE_CONTROL_BALANCE_TIME_S	1800		// Longest top-off (seconds)
+#define CHARGE_CONTROL_OVERCURRENT		2000		// Charger may push this much over its setpoint (mA)
+#define CHARGE_CONTROL_FOLLOW_MS		2000		// for this long before it is turned off
+
+// Time-triggered scheduler in Scheduler.c, the task table is in main.c. Every task runs in its
+// own CMSIS-RTOS thread, the safety task preempts the LTC6811 scans, the EEPROM and the CLI.
+// The temperature scan is still split into one mux channel per slice to bound how long the
+// LTC6811 bus is held.
+#define SCHED_MAX_TASKS					8
+#define SCHED_STACK_SIZE				4096		// Stack of one task thread (bytes)
+#define SCHED_SAFETY_PERIOD_MS			10			// Current, fuse curves and the safety checks
+#define SCHED_VOLTAGE_PERIOD_MS			100			// Module voltage scan, done by the acquisition task
+#define SCHED_TEMPERATURE_SLICES		20			// Slices in one temperature scan, more than the mux channels
+#define SCHED_ACQUISITION_PERIOD_MS		(TEMPERATURE_SCAN_PERIOD_MS / SCHED_TEMPERATURE_SLICES)
+#define SCHED_COMMS_PERIOD_MS			100			// Module charge, power limits, charge control and CAN
+#define SCHED_LOGGING_PERIOD_MS			100			// State of charge and its EEPROM journal
+#define SCHED_CLI_PERIOD_MS				20			// UART commands
+
+// Liveness supervision in Supervisor.c. A task that does not check in within its interval
+// stops the safety task feeding the watchdog, see WDTIMER_TIMEOUT_MS in BSP_WDTimer.h.
+#define SUPERVISOR_SAFETY_INTERVAL_MS		50
+#define SUPERVISOR_ACQUISITION_INTERVAL_MS	1000		// Only checks in on slices the LTC6811s answered
+#define SUPERVISOR_COMMS_INTERVAL_MS		1000
+#define SUPERVISOR_LOGGING_INTERVAL_MS		5000		// Waits for CLI commands to be done with the EEPROM
+#define SUPERVISOR_HEARTBEAT_INTERVAL_MS	2000
+#define SUPERVISOR_CLI_INTERVAL_MS			5000		// Longer than CLI_CRITICAL_TIMEOUT_MS
+#define SUPERVISOR_LOG_WAIT_MS				50			// Wait for the EEPROM before logging the offender regardless
+#define CLI_CRITICAL_TIMEOUT_MS				3000		// "critical" stops waiting for "shutdown"
+
+// Cycle count probes in Profiler.c. Build with -DPROFILER_ENABLED=0 to compile them out.
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED				1
+#endif
+#define PROFILER_BUCKETS				16			// Histogram buckets, each one twice as wide as the one before
+#define PROFILER_BUCKET_SHIFT			10			// The first bucket holds runs under 2^10 cycles
+
+// Event trace in Trace.c. Build with -DTRACE_ENABLED=0 to compile it out.
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED					1
+#endif
+#define TRACE_SIZE						1024		// Records in the ring, a power of 2 of 8 bytes each
+
+// Counters.h: the simulator appends every counter to Counters.csv this often
+#define COUNTERS_CSV_PERIOD_MS			1000
+
+// Budgets of "make faultlatency", the 99th percentile from a limit being crossed in the plant
+// to the contactor opening
+#define FAULT_LATENCY_CURRENT_BUDGET_MS		1			// Analog watchdog, one conversion, only the target can time it
+#define FAULT_LATENCY_POLLED_CURRENT_BUDGET_MS	80		// Without the watchdog, two ADC blocks and a safety pass
+#define FAULT_LATENCY_VOLTAGE_BUDGET_MS		200			// Voltage scan period, the scan and a safety pass
+#define FAULT_LATENCY_TEMPERATURE_BUDGET_MS	1200		// Temperature scan period, the last slice and a safety pass
+
 //--------------------------------------------------------------------------------
 // Helpers
 #define MILLI_SCALING_FACTOR			1000
@@ -55,8 +211,8 @@ typedef enum {SAFE = 0, DANGER = 1, OVERVOLTAGE = 2, UNDERVOLTAGE = 3, OPENWIRE
 #define MAX_TEMP_SENSORS_PER_MINION_BOARD	16
 
 //--------------------------------------------------------------------------------
-// HeartBeat Delay Ticks
-// Define heartbeatDelay as # of desired while(1) loops per toggle
-#define HEARTBEAT_DELAY 0x10
+// HeartBeat
+// Time between two toggles of the RUN light
+#define HEARTBEAT_PERIOD_MS 500
 
 #endif
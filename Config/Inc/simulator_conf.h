@@ -15,5 +15,7 @@
 #define SPI_CSV_FILE            "SPI.csv"
 #define TIMER_CSV_FILE          "Timer.csv"
 #define WDTIMER_CSV_FILE        "WDTimer.csv"
+#define SCENARIO_CSV_FILE       "Scenario.csv"
+#define COUNTERS_CSV_FILE       "Counters.csv"
 
 #endif
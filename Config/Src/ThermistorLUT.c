@@ -0,0 +1,26 @@
+// GENERATED FILE, DO NOT EDIT. Change Config/gen_thermistor.py and run it
+/** ThermistorLUT.c
+ * Temperature sensor lookup table, see ThermistorLUT.h
+ */
+
+#include "ThermistorLUT.h"
+
+const int32_t ThermistorLUT[THERMISTOR_LUT_SIZE] = {
+	186444, 183013, 179575, 176130, 172678, 169219, 165753, 162280,
+	158800, 155313, 151819, 148317, 144808, 141292, 137768, 134237,
+	130699, 127153, 123599, 120038, 116469, 112893, 109308, 105716,
+	102116, 98508, 94892, 91268, 87636, 83996, 80348, 76691,
+	73026, 69353, 65671, 61981, 58283, 54576, 50860, 47135,
+	43402, 39660, 35908, 32148, 28379, 24601, 20814, 17017,
+	13212, 9396, 5572, 1738, -2106, -5959, -9822, -13695,
+	-17578, -21470, -25373, -29286, -33209, -37142, -41085, -45039,
+	-49004, -52978, -56964, -60961, -64968, -68986, -73015, -77055,
+	-81107, -85170, -89244, -93329, -97427, -101536, -105656, -109789,
+	-113933, -118090, -122259, -126440, -130634, -134840, -139059, -143290,
+	-147535, -151792, -156063, -160346, -164643, -168954, -173278, -177616,
+	-181968, -186334, -190714, -195108, -199517, -203940, -208378, -212831,
+	-217298, -221781, -226280, -230794, -235323, -239868, -244429, -249007,
+	-253600, -258210, -262837, -267481, -272141, -276819, -281514, -286227,
+	-290958, -295707, -300474, -305259, -310063, -314886, -319728, -324589,
+	-329470
+};
@@ -0,0 +1,160 @@
+// GENERATED FILE, DO NOT EDIT. Change Config/topology.csv and run Config/gen_topology.py
+/** Topology.c
+ * Wiring tables of the battery pack, see Topology.h
+ */
+
+#include "Topology.h"
+
+const ModuleTap ModuleMap[NUM_BATTERY_MODULES] = {
+	{0, 0},
+	{0, 1},
+	{0, 2},
+	{0, 3},
+	{0, 4},
+	{0, 5},
+	{0, 6},
+	{0, 7},
+	{1, 0},
+	{1, 1},
+	{1, 2},
+	{1, 3},
+	{1, 4},
+	{1, 5},
+	{1, 6},
+	{1, 7},
+	{2, 0},
+	{2, 1},
+	{2, 2},
+	{2, 3},
+	{2, 4},
+	{2, 5},
+	{2, 6},
+	{2, 7},
+	{3, 0},
+	{3, 1},
+	{3, 2},
+	{3, 3},
+	{3, 4},
+	{3, 5},
+	{3, 6}
+};
+
+const SensorTap SensorMap[NUM_TEMPERATURE_SENSORS] = {
+	{0, 0, 0},
+	{0, 1, 0},
+	{0, 0, 1},
+	{0, 1, 1},
+	{0, 0, 2},
+	{0, 1, 2},
+	{0, 0, 3},
+	{0, 1, 3},
+	{0, 0, 4},
+	{0, 1, 4},
+	{0, 0, 5},
+	{0, 1, 5},
+	{0, 0, 6},
+	{0, 1, 6},
+	{0, 0, 7},
+	{0, 1, 7},
+	{1, 0, 0},
+	{1, 1, 0},
+	{1, 0, 1},
+	{1, 1, 1},
+	{1, 0, 2},
+	{1, 1, 2},
+	{1, 0, 3},
+	{1, 1, 3},
+	{1, 0, 4},
+	{1, 1, 4},
+	{1, 0, 5},
+	{1, 1, 5},
+	{1, 0, 6},
+	{1, 1, 6},
+	{1, 0, 7},
+	{1, 1, 7},
+	{2, 0, 0},
+	{2, 1, 0},
+	{2, 0, 1},
+	{2, 1, 1},
+	{2, 0, 2},
+	{2, 1, 2},
+	{2, 0, 3},
+	{2, 1, 3},
+	{2, 0, 4},
+	{2, 1, 4},
+	{2, 0, 5},
+	{2, 1, 5},
+	{2, 0, 6},
+	{2, 1, 6},
+	{2, 0, 7},
+	{2, 1, 7},
+	{3, 0, 0},
+	{3, 1, 0},
+	{3, 0, 1},
+	{3, 1, 1},
+	{3, 0, 2},
+	{3, 1, 2},
+	{3, 0, 3},
+	{3, 1, 3},
+	{3, 0, 4},
+	{3, 1, 4},
+	{3, 0, 5},
+	{3, 1, 5},
+	{3, 0, 6},
+	{3, 1, 6}
+};
+
+const uint8_t ModuleSensors[NUM_BATTERY_MODULES][NUM_TEMP_SENSORS_PER_MOD] = {
+	{0, 1},
+	{2, 3},
+	{4, 5},
+	{6, 7},
+	{8, 9},
+	{10, 11},
+	{12, 13},
+	{14, 15},
+	{16, 17},
+	{18, 19},
+	{20, 21},
+	{22, 23},
+	{24, 25},
+	{26, 27},
+	{28, 29},
+	{30, 31},
+	{32, 33},
+	{34, 35},
+	{36, 37},
+	{38, 39},
+	{40, 41},
+	{42, 43},
+	{44, 45},
+	{46, 47},
+	{48, 49},
+	{50, 51},
+	{52, 53},
+	{54, 55},
+	{56, 57},
+	{58, 59},
+	{60, 61}
+};
+
+const uint8_t SensorModule[NUM_TEMPERATURE_SENSORS] = {
+	0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7,
+	8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13, 14, 14, 15, 15,
+	16, 16, 17, 17, 18, 18, 19, 19, 20, 20, 21, 21, 22, 22, 23, 23,
+	24, 24, 25, 25, 26, 26, 27, 27, 28, 28, 29, 29, 30, 30
+};
+
+const uint8_t CellModule[TOPOLOGY_BOARDS][MAX_VOLT_SENSORS_PER_MINION_BOARD] = {
+	{0, 1, 2, 3, 4, 5, 6, 7},
+	{8, 9, 10, 11, 12, 13, 14, 15},
+	{16, 17, 18, 19, 20, 21, 22, 23},
+	{24, 25, 26, 27, 28, 29, 30, 0xFF}
+};
+
+const uint8_t ChannelSensor[TOPOLOGY_BOARDS][MAX_TEMP_SENSORS_PER_MINION_BOARD] = {
+	{0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15},
+	{16, 18, 20, 22, 24, 26, 28, 30, 17, 19, 21, 23, 25, 27, 29, 31},
+	{32, 34, 36, 38, 40, 42, 44, 46, 33, 35, 37, 39, 41, 43, 45, 47},
+	{48, 50, 52, 54, 56, 58, 60, 0xFF, 49, 51, 53, 55, 57, 59, 61, 0xFF}
+};
@@ -0,0 +1,89 @@
+"""
+Generates Config/Inc/ThermistorLUT.h and Config/Src/ThermistorLUT.c, the lookup table that turns
+LTC6811 GPIO1 readings into temperatures without floating point math.
+
+The temperature sensors follow
+    mV = 2230.8 - 13.582 * (T - 30) - 0.00433 * (T - 30)^2
+The table holds the temperature in millidegrees Celsius every 2^SHIFT ADC codes (100uV each)
+over the whole 16 bit range. Temperature.c interpolates linearly between the entries.
+
+Run from the top of the repo after changing the sensor curve:
+    python3 Config/gen_thermistor.py
+"""
+
+import math
+import os
+
+CONFIG_DIR = os.path.dirname(os.path.abspath(__file__))
+HEADER_FILE = os.path.join(CONFIG_DIR, "Inc", "ThermistorLUT.h")
+SOURCE_FILE = os.path.join(CONFIG_DIR, "Src", "ThermistorLUT.c")
+
+SHIFT = 9                   # 512 codes (51.2mV) between entries
+CODES = 1 << 16
+BANNER = "// GENERATED FILE, DO NOT EDIT. Change Config/gen_thermistor.py and run it\n"
+
+
+def millivolt_to_celsius(mv):
+    """
+    @brief   Inverse of the sensor curve, same equation the float conversion used
+    @param   mv millivolts on GPIO1
+    @return  temperature in Celsius
+    """
+    return ((13.582 - math.sqrt(13.582 * 13.582 + 4 * 0.00433 * (2230.8 - mv))) / (2.0 * -0.00433)) + 30
+
+
+def lookup(lut, code):
+    """
+    @brief   Same interpolation as Temperature.c, including the arithmetic shift
+    """
+    idx = code >> SHIFT
+    frac = code & ((1 << SHIFT) - 1)
+    return lut[idx] + (((lut[idx + 1] - lut[idx]) * frac) >> SHIFT)
+
+
+if __name__ == "__main__":
+    lut = [round(millivolt_to_celsius((i << SHIFT) / 10) * 1000) for i in range((CODES >> SHIFT) + 1)]
+
+    # Worst case difference to the exact curve over every possible ADC code
+    max_error = max(abs(lookup(lut, c) - millivolt_to_celsius(c / 10) * 1000) for c in range(CODES))
+    bound = math.ceil(max_error)
+
+    with open(HEADER_FILE, "w") as f:
+        f.write(BANNER)
+        f.write("""/** ThermistorLUT.h
+ * Temperature in millidegrees Celsius for LTC6811 GPIO1 readings (100uV per code), one entry
+ * every THERMISTOR_LUT_STEP codes. Interpolating between two entries stays within
+ * THERMISTOR_LUT_MAX_ERROR millidegrees of the sensor equation for every 16 bit code.
+ */
+
+#ifndef THERMISTOR_LUT_H__
+#define THERMISTOR_LUT_H__
+
+#include "common.h"
+
+""")
+        f.write("#define THERMISTOR_LUT_SHIFT\t\t%d\n" % SHIFT)
+        f.write("#define THERMISTOR_LUT_STEP\t\t\t(1 << THERMISTOR_LUT_SHIFT)\n")
+        f.write("#define THERMISTOR_LUT_SIZE\t\t\t%d\n" % len(lut))
+        f.write("#define THERMISTOR_LUT_MAX_ERROR\t%d\t\t// millidegrees Celsius\n" % bound)
+        f.write("""
+extern const int32_t ThermistorLUT[THERMISTOR_LUT_SIZE];
+
+#endif
+""")
+
+    with open(SOURCE_FILE, "w") as f:
+        f.write(BANNER)
+        f.write("""/** ThermistorLUT.c
+ * Temperature sensor lookup table, see ThermistorLUT.h
+ */
+
+#include "ThermistorLUT.h"
+
+const int32_t ThermistorLUT[THERMISTOR_LUT_SIZE] = {
+""")
+        rows = [", ".join(str(v) for v in lut[i:i + 8]) for i in range(0, len(lut), 8)]
+        f.write(",\n".join("\t" + r for r in rows) + "\n")
+        f.write("};\n")
+
+    print("%d entries, max error %.3f mC" % (len(lut), max_error))
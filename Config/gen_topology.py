@@ -0,0 +1,228 @@
+"""
+Generates Config/Inc/Topology.h and Config/Src/Topology.c from Config/topology.csv.
+
+topology.csv has one row per battery module:
+    module,board,cell,s0_board,s0_mux,s0_channel,s1_board,s1_mux,s1_channel
+board/cell is the LTC6811 cell input the module is wired to and every sN_* triple is the
+board, LTC1380 mux and mux channel of one of the module's temperature sensors.
+Sensor n of module m is temperature sensor m * NUM_TEMP_SENSORS_PER_MOD + n.
+
+Run from the top of the repo after changing the wiring:
+    python3 Config/gen_topology.py
+"""
+
+import csv
+import os
+import sys
+
+CONFIG_DIR = os.path.dirname(os.path.abspath(__file__))
+CSV_FILE = os.path.join(CONFIG_DIR, "topology.csv")
+HEADER_FILE = os.path.join(CONFIG_DIR, "Inc", "Topology.h")
+SOURCE_FILE = os.path.join(CONFIG_DIR, "Src", "Topology.c")
+
+CELLS_PER_BOARD = 8         # MAX_VOLT_SENSORS_PER_MINION_BOARD, the LTC6811 has 12 but only 8 are wired
+MUXES_PER_BOARD = 2         # LTC1380 muxes on GPIO1
+CHANNELS_PER_MUX = 8
+UNUSED = 0xFF
+
+BANNER = "// GENERATED FILE, DO NOT EDIT. Change Config/topology.csv and run Config/gen_topology.py\n"
+
+
+def fail(msg):
+    """
+    @brief   Stops the generator without touching the output files
+    """
+    sys.exit("gen_topology.py: " + msg)
+
+
+def load_topology():
+    """
+    @brief   Reads and validates topology.csv
+    @return  list of (board, cell) per module and list of (board, mux, channel) per sensor
+    """
+    modules = []
+    sensors = []
+    with open(CSV_FILE, newline="") as f:
+        reader = csv.reader(f)
+        next(reader)    # header
+        for row in reader:
+            if not row:
+                continue
+            values = [int(v) for v in row]
+            if values[0] != len(modules):
+                fail("modules must be listed in order, expected module %d" % len(modules))
+            board, cell = values[1], values[2]
+            if cell >= CELLS_PER_BOARD:
+                fail("module %d: cell %d out of range" % (values[0], cell))
+            modules.append((board, cell))
+
+            taps = values[3:]
+            if len(taps) % 3 != 0:
+                fail("module %d: sensors need a board, mux and channel" % values[0])
+            sensors_per_module = len(taps) // 3
+            if len(sensors) != (len(modules) - 1) * sensors_per_module:
+                fail("module %d: every module needs the same number of sensors" % values[0])
+            for i in range(0, len(taps), 3):
+                s_board, mux, channel = taps[i:i + 3]
+                if mux >= MUXES_PER_BOARD or channel >= CHANNELS_PER_MUX:
+                    fail("module %d: sensor mux %d channel %d out of range" % (values[0], mux, channel))
+                sensors.append((s_board, mux, channel))
+
+    if len(set(modules)) != len(modules):
+        fail("two modules are wired to the same cell input")
+    if len(set(sensors)) != len(sensors):
+        fail("two sensors are wired to the same mux channel")
+    return modules, sensors
+
+
+def c_rows(rows, indent="\t"):
+    """
+    @brief   Formats a list of C initializers, one per line
+    """
+    return ",\n".join(indent + r for r in rows) + "\n"
+
+
+def write_header(modules, sensors, boards):
+    per_module = len(sensors) // len(modules)
+    with open(HEADER_FILE, "w") as f:
+        f.write(BANNER)
+        f.write("""/** Topology.h
+ * Wiring of the battery pack: which LTC6811 cell input measures each battery module and
+ * which mux channel each temperature sensor sits on, plus the inverse lookups.
+ * Every place that converts between module/sensor numbers and board positions uses these
+ * tables so any wiring can be described in Config/topology.csv.
+ */
+
+#ifndef TOPOLOGY_H__
+#define TOPOLOGY_H__
+
+#include "common.h"
+#include "config.h"
+
+""")
+        f.write("#define TOPOLOGY_MODULES\t\t%d\t\t// Battery modules described in topology.csv\n" % len(modules))
+        f.write("#define TOPOLOGY_SENSORS\t\t%d\t\t// Temperature sensors described in topology.csv\n" % len(sensors))
+        f.write("#define TOPOLOGY_SENSORS_PER_MOD\t%d\n" % per_module)
+        f.write("#define TOPOLOGY_BOARDS\t\t\t%d\t\t// Minion boards with at least one module or sensor\n" % boards)
+        f.write("#define TOPOLOGY_UNUSED\t\t\t0x%02X\t// Inverse map entry of an input with nothing wired to it\n" % UNUSED)
+        f.write("""
+#if TOPOLOGY_MODULES != NUM_BATTERY_MODULES || TOPOLOGY_SENSORS != NUM_TEMPERATURE_SENSORS \\
+	|| TOPOLOGY_SENSORS_PER_MOD != NUM_TEMP_SENSORS_PER_MOD
+#error "Config/topology.csv does not match the battery pack layout in config.h"
+#endif
+
+#if TOPOLOGY_BOARDS > NUM_MINIONS
+#error "Config/topology.csv uses more minion boards than NUM_MINIONS"
+#endif
+
+typedef struct {
+	uint8_t board;		// Minion board (0-indexed)
+	uint8_t cell;		// LTC6811 cell input (0-indexed)
+} ModuleTap;
+
+typedef struct {
+	uint8_t board;		// Minion board (0-indexed)
+	uint8_t mux;		// 0 for MUX1, 1 for MUX2
+	uint8_t channel;	// Channel on the mux (0-7)
+} SensorTap;
+
+// Where each battery module is measured
+extern const ModuleTap ModuleMap[NUM_BATTERY_MODULES];
+
+// Where each temperature sensor is measured
+extern const SensorTap SensorMap[NUM_TEMPERATURE_SENSORS];
+
+// Temperature sensors of each battery module
+extern const uint8_t ModuleSensors[NUM_BATTERY_MODULES][NUM_TEMP_SENSORS_PER_MOD];
+
+// Battery module each temperature sensor belongs to
+extern const uint8_t SensorModule[NUM_TEMPERATURE_SENSORS];
+
+// Battery module on each cell input, TOPOLOGY_UNUSED if nothing is connected
+extern const uint8_t CellModule[TOPOLOGY_BOARDS][MAX_VOLT_SENSORS_PER_MINION_BOARD];
+
+// Temperature sensor on each board channel (mux * 8 + channel), TOPOLOGY_UNUSED if nothing is connected
+extern const uint8_t ChannelSensor[TOPOLOGY_BOARDS][MAX_TEMP_SENSORS_PER_MINION_BOARD];
+
+/** Topology_GetCellModule
+ * Finds the battery module wired to a cell input
+ * @param board index of board (0-indexed)
+ * @param cell LTC6811 cell input (0-indexed)
+ * @return module index or TOPOLOGY_UNUSED
+ */
+static inline uint8_t Topology_GetCellModule(uint8_t board, uint8_t cell) {
+	if(board >= TOPOLOGY_BOARDS || cell >= MAX_VOLT_SENSORS_PER_MINION_BOARD) {
+		return TOPOLOGY_UNUSED;
+	}
+	return CellModule[board][cell];
+}
+
+/** Topology_GetChannelSensor
+ * Finds the temperature sensor wired to a board channel
+ * @param board index of board (0-indexed)
+ * @param channel board channel, mux * 8 + mux channel (0-indexed)
+ * @return sensor index or TOPOLOGY_UNUSED
+ */
+static inline uint8_t Topology_GetChannelSensor(uint8_t board, uint8_t channel) {
+	if(board >= TOPOLOGY_BOARDS || channel >= MAX_TEMP_SENSORS_PER_MINION_BOARD) {
+		return TOPOLOGY_UNUSED;
+	}
+	return ChannelSensor[board][channel];
+}
+
+#endif
+""")
+
+
+def write_source(modules, sensors, boards):
+    per_module = len(sensors) // len(modules)
+    cell_module = [[UNUSED] * CELLS_PER_BOARD for _ in range(boards)]
+    channel_sensor = [[UNUSED] * (MUXES_PER_BOARD * CHANNELS_PER_MUX) for _ in range(boards)]
+    for m, (board, cell) in enumerate(modules):
+        cell_module[board][cell] = m
+    for s, (board, mux, channel) in enumerate(sensors):
+        channel_sensor[board][mux * CHANNELS_PER_MUX + channel] = s
+
+    def byte_row(values):
+        return "{" + ", ".join("0x%02X" % v if v == UNUSED else str(v) for v in values) + "}"
+
+    with open(SOURCE_FILE, "w") as f:
+        f.write(BANNER)
+        f.write("""/** Topology.c
+ * Wiring tables of the battery pack, see Topology.h
+ */
+
+#include "Topology.h"
+
+""")
+        f.write("const ModuleTap ModuleMap[NUM_BATTERY_MODULES] = {\n")
+        f.write(c_rows(["{%d, %d}" % m for m in modules]))
+        f.write("};\n\n")
+
+        f.write("const SensorTap SensorMap[NUM_TEMPERATURE_SENSORS] = {\n")
+        f.write(c_rows(["{%d, %d, %d}" % s for s in sensors]))
+        f.write("};\n\n")
+
+        f.write("const uint8_t ModuleSensors[NUM_BATTERY_MODULES][NUM_TEMP_SENSORS_PER_MOD] = {\n")
+        f.write(c_rows([byte_row(range(m * per_module, (m + 1) * per_module)) for m in range(len(modules))]))
+        f.write("};\n\n")
+
+        f.write("const uint8_t SensorModule[NUM_TEMPERATURE_SENSORS] = {\n")
+        f.write(c_rows([", ".join(str(s // per_module) for s in range(i, min(i + 16, len(sensors))))
+                        for i in range(0, len(sensors), 16)]))
+        f.write("};\n\n")
+
+        f.write("const uint8_t CellModule[TOPOLOGY_BOARDS][MAX_VOLT_SENSORS_PER_MINION_BOARD] = {\n")
+        f.write(c_rows([byte_row(r) for r in cell_module]))
+        f.write("};\n\n")
+
+        f.write("const uint8_t ChannelSensor[TOPOLOGY_BOARDS][MAX_TEMP_SENSORS_PER_MINION_BOARD] = {\n")
+        f.write(c_rows([byte_row(r) for r in channel_sensor]))
+        f.write("};\n")
+
+
+if __name__ == "__main__":
+    modules, sensors = load_topology()
+    boards = max([b for b, _ in modules] + [b for b, _, _ in sensors]) + 1
+    write_header(modules, sensors, boards)
+    write_source(modules, sensors, boards)
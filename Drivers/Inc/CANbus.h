@@ -12,7 +12,14 @@ typedef enum {
     TEMP_DATA = 0x105,
     SOC_DATA = 0x106,
     WDOG_TRIGGERED = 0x107,
-    CAN_ERROR = 0x108
+    CAN_ERROR = 0x108,
+    FUSE_MARGIN = 0x109,
+    RIPPLE_DATA = 0x10A,
+    MODULE_SOC = 0x10B,
+    POWER_LIMITS = 0x10C,
+    CHARGER_SETPOINT = 0x10D,
+    PERF_DATA = 0x10E,
+    COUNTER_DATA = 0x10F
 } CANId_t;
 
 typedef union {
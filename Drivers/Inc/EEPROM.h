@@ -32,6 +32,9 @@
 #define EEPROM_CAN_PTR_LOC		  0x100A
 #define EEPROM_SOC_PTR_LOC			0x100C
 
+#define EEPROM_SPI_SPEED_LOC		0x1010		// One byte per daisy chain, written by SPILink.c
+#define EEPROM_CHARGE_JOURNAL_LOC	0x2000		// State of charge checkpoints, written by ChargeJournal.c
+
 /** EEPROM_Init
  * Initializes I2C to communicate with EEPROM (M24128)
  */
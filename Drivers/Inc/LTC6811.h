@@ -90,6 +90,30 @@ Copyright 2017 Linear Technology Corp. (LTC)
  */
 void LTC6811_Init(cell_asic *battMod);
 
+/** LTC6811_SelectChain
+ * Selects which daisy chain the following LTC6811 commands are sent on.
+ * @param chain daisy chain handle
+ */
+void LTC6811_SelectChain(SPI_Chain chain);
+
+/** LTC6811_rdcv_chains
+ * Reads the cell voltage registers of every daisy chain at the same time.
+ * @param reg cell voltage register to read, 0 for all
+ * @param ics_per_chain number of ICs on each daisy chain
+ * @param ic cell_asic array of all the chains, chain 0's boards first
+ * @return number of PEC errors, one per IC and register read, saturates at UINT8_MAX
+ */
+uint8_t LTC6811_rdcv_chains(uint8_t reg, uint8_t ics_per_chain, cell_asic ic[]);
+
+/** LTC6811_rdaux_chains
+ * Reads the auxiliary registers of every daisy chain at the same time.
+ * @param reg auxiliary register to read, 0 for all
+ * @param ics_per_chain number of ICs on each daisy chain
+ * @param ic cell_asic array of all the chains, chain 0's boards first
+ * @return number of PEC errors, one per IC and register read, saturates at UINT8_MAX
+ */
+uint8_t LTC6811_rdaux_chains(uint8_t reg, uint8_t ics_per_chain, cell_asic ic[]);
+
 /********************************************************
 *********************************************************/
 
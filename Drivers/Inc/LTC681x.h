@@ -40,6 +40,7 @@ Copyright 2015 Linear Technology Corp. (LTC)
 #define LTC681X_H
 #include <stdint.h>
 #include <stdbool.h>
+#include "BSP_SPI.h"
 
 #define MD_422HZ_1KHZ 0
 #define MD_27KHZ_14KHZ 1
@@ -173,6 +174,15 @@ void wakeup_idle(uint8_t total_ic);//!< number of ICs in the daisy chain
 /*!  Wake the LTC6813 from the sleep state */
 void wakeup_sleep(uint8_t total_ic); //!< number of ICs in the daisy chain
 
+/*!  Selects the daisy chain that the single chain functions talk to */
+void LTC681x_select_chain(SPI_Chain chain); //!< daisy chain handle
+
+/*!  Wake isoSPI up from idle state on every daisy chain at the same time */
+void wakeup_idle_chains(uint8_t ics_per_chain); //!< number of ICs on each daisy chain
+
+/*!  Wake the LTC681x on every daisy chain from the sleep state at the same time */
+void wakeup_sleep_chains(uint8_t ics_per_chain); //!< number of ICs on each daisy chain
+
 /*! Sense a command to the bms IC. This code will calculate the PEC code for the transmitted command*/
 void cmd_68(uint8_t tx_cmd[2]); //!< 2 Byte array containing the BMS command to be sent
 
@@ -392,6 +402,28 @@ int8_t LTC681x_rdaux(uint8_t reg, //Determines which GPIO voltage register is re
                      cell_asic ic[]//!< Measurement Data Structure
                     );
 
+/*!  Reads and parses the cell voltage registers of every daisy chain.
+
+ The register read is started on all chains before waiting on any of them so the
+ transfers overlap. ic[] holds the ICs of chain 0 first, then chain 1 and so on.
+ @return uint8_t, number of PEC errors, one per IC and register read, saturates at UINT8_MAX.
+  0: No PEC error detected
+*/
+uint8_t LTC681x_rdcv_chains(uint8_t reg, //!< controls which cell voltage register is read back, 0 for all.
+                            uint8_t ics_per_chain, //!< the number of ICs on each daisy chain
+                            cell_asic ic[] //!< Measurement Data Structure of every IC on every chain
+                           );
+
+/*!  Reads and parses the auxiliary registers of every daisy chain.
+
+ Same as LTC681x_rdcv_chains but for the GPIO voltage registers.
+ @return uint8_t, number of PEC errors, one per IC and register read, saturates at UINT8_MAX.
+*/
+uint8_t LTC681x_rdaux_chains(uint8_t reg, //!< controls which GPIO voltage register is read back, 0 for all.
+                            uint8_t ics_per_chain, //!< the number of ICs on each daisy chain
+                            cell_asic ic[] //!< Measurement Data Structure of every IC on every chain
+                           );
+
 /*!  Reads and parses the LTC681x stat registers.
 
  The function is used to read the  parsed status codes of the LTC6811. This function will send the requested
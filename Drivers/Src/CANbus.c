@@ -1,5 +1,6 @@
 #include "CANbus.h"
 #include "BSP_CAN.h"
+#include "Counters.h"
 
 static void floatTo4Bytes(uint8_t f, uint8_t bytes[4]);
 
@@ -13,23 +14,26 @@ void CANbus_Init(void) {
 }
 
 /**
- * @brief   Transmits data onto the CANbus
+ * @brief   Packs the payload of a message and hands it to the CAN peripheral
  * @param   id : CAN id of the message
  * @param   payload : the data that will be sent.
  * @return  0 if data wasn't sent, otherwise it was sent.
  */
-int CANbus_Send(CANId_t id, CANPayload_t payload) {
-    uint8_t txdata[5];
+static int CANbus_Write(CANId_t id, CANPayload_t payload) {
+    uint8_t txdata[8];		// BSP_CAN_Write takes a whole frame
 	
 	switch (id) {
 		case TRIP:
-			return BSP_CAN_Write(id, &payload.data.b, 1);
+			txdata[0] = payload.data.b;
+			return BSP_CAN_Write(id, txdata, 1);
 
 		case ALL_CLEAR:
-			return BSP_CAN_Write(id, &payload.data.b, 1);
+			txdata[0] = payload.data.b;
+			return BSP_CAN_Write(id, txdata, 1);
 
 		case CONTACTOR_STATE:
-			return BSP_CAN_Write(id, &payload.data.b, 1);
+			txdata[0] = payload.data.b;
+			return BSP_CAN_Write(id, txdata, 1);
 
 		case CURRENT_DATA:
 			floatTo4Bytes(payload.data.f, &txdata[0]);
@@ -46,10 +50,52 @@ int CANbus_Send(CANId_t id, CANPayload_t payload) {
 			return BSP_CAN_Write(id, txdata, 4);
 
 		case WDOG_TRIGGERED:
-			return BSP_CAN_Write(id, &payload.data.b, 1);
+			txdata[0] = payload.data.b;
+			return BSP_CAN_Write(id, txdata, 1);
 
 		case CAN_ERROR:
-			return BSP_CAN_Write(id, &payload.data.b, 1);
+			txdata[0] = payload.data.b;
+			return BSP_CAN_Write(id, txdata, 1);
+
+		case FUSE_MARGIN:
+			// idx is the curve, 0 for discharge and 1 for charge. data is the percent left.
+			txdata[0] = payload.idx;
+			txdata[1] = payload.data.b;
+			return BSP_CAN_Write(id, txdata, 2);
+
+		case RIPPLE_DATA:
+			// Ripple RMS (mA) in the low half of w, its strongest frequency (Hz) in the high half
+			txdata[0] = payload.data.w >> 24;
+			txdata[1] = payload.data.w >> 16;
+			txdata[2] = payload.data.w >> 8;
+			txdata[3] = payload.data.w;
+			return BSP_CAN_Write(id, txdata, 4);
+
+		case MODULE_SOC:
+			// idx 0 is the lowest module and 1 the highest, with the module in the high half of w
+			// and its state of charge (0.01%) in the low half. idx 2 is the spread (0.01%).
+		case CHARGER_SETPOINT:
+			// idx is 1 to turn the charger on and 0 to turn it off. The pack voltage (0.1V) is in
+			// the high half of w and the current (0.1A) in the low half.
+		case PERF_DATA:
+			// idx is the profiler probe, its max (us) is in the high half of w and its mean (us)
+			// in the low half, both capped at 0xFFFF.
+		case COUNTER_DATA:
+			// idx is the CounterId of Counters.h, w its value
+			txdata[0] = payload.idx;
+			txdata[1] = payload.data.w >> 24;
+			txdata[2] = payload.data.w >> 16;
+			txdata[3] = payload.data.w >> 8;
+			txdata[4] = payload.data.w;
+			return BSP_CAN_Write(id, txdata, 5);
+
+		case POWER_LIMITS:
+			// Discharge limit (0.1A) in the high half of w, charge limit (0.1A) in the low half
+			txdata[0] = payload.data.w >> 24;
+			txdata[1] = payload.data.w >> 16;
+			txdata[2] = payload.data.w >> 8;
+			txdata[3] = payload.data.w;
+			return BSP_CAN_Write(id, txdata, 4);
 	}
 	return 0;
 }
@@ -73,3 +119,17 @@ static void floatTo4Bytes(uint8_t val, uint8_t bytes_array[4]) {
 	bytes_array[2] = bytes_array[1];
 	bytes_array[1] = temp;	
 }
+
+/**
+ * @brief   Transmits data onto the CANbus. Messages that could not be sent are counted.
+ * @param   id : CAN id of the message
+ * @param   payload : the data that will be sent.
+ * @return  0 if data wasn't sent, otherwise it was sent.
+ */
+int CANbus_Send(CANId_t id, CANPayload_t payload) {
+    int sent = CANbus_Write(id, payload);
+    if(!sent) {
+        COUNTER_INC(COUNTER_CAN_TX_FAILURES);
+    }
+    return sent;
+}
@@ -9,6 +9,7 @@
 #include "Voltage.h"
 #include "Temperature.h"
 #include "BSP_UART.h"
+#include "cmsis_os.h"
 
 //starting addresses for errors
 const uint16_t EEPROM_FAULT_CODE_ADDR   = 0x0000;
@@ -32,6 +33,11 @@ static uint16_t faultCodePtr,
  * @param input is number of milliseconds to delay
  */
 void DelayMs(uint32_t ms) {
+    // Other threads run while the EEPROM finishes a write
+    if(osKernelRunning()) {
+        osDelay(ms + 1);
+        return;
+    }
     for(int i = 0; i < ms; i++) {
         for(int j = 0; j < 50000; j++);
     }
@@ -75,13 +75,29 @@ Copyright 2017 Linear Technology Corp. (LTC)
 /*** Code that was added by UTSVT. ***/
 /*********************************************************/
 void LTC6811_Init(cell_asic *battMod){	
-	BSP_SPI_Init();				// Initialize SPI1 for voltage board	
+	// Initialize the SPI port of every daisy chain
+	for(int chain = 0; chain < NUM_CHAINS; chain++) {
+		BSP_SPI_Init(chain);
+	}
+	LTC681x_select_chain(SPI_CHAIN_0);
 	
 	LTC681x_init_cfg(NUM_MINIONS, battMod);
 	LTC6811_reset_crc_count(NUM_MINIONS, battMod);
 	LTC6811_init_reg_limits(NUM_MINIONS, battMod);
 }
 
+void LTC6811_SelectChain(SPI_Chain chain){
+	LTC681x_select_chain(chain);
+}
+
+uint8_t LTC6811_rdcv_chains(uint8_t reg, uint8_t ics_per_chain, cell_asic ic[]){
+	return LTC681x_rdcv_chains(reg, ics_per_chain, ic);
+}
+
+uint8_t LTC6811_rdaux_chains(uint8_t reg, uint8_t ics_per_chain, cell_asic ic[]){
+	return LTC681x_rdaux_chains(reg, ics_per_chain, ic);
+}
+
 /********************************************************
 *********************************************************/
 
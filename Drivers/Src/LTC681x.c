@@ -45,24 +45,35 @@ Copyright 2017 Linear Technology Corp. (LTC)
 #include "LTC6811.h"
 #include "BSP_SPI.h"
 #include "BSP_PLL.h"
+#include "cmsis_os.h"
+#include "config.h"
+#include "Counters.h"
+
+static SPI_Chain active_chain = SPI_CHAIN_0;     // Daisy chain the single chain functions talk to
 
 static uint8_t spi_read8(void){
     uint8_t data = 0;
-    BSP_SPI_Read(&data, 1);
+    BSP_SPI_Read(active_chain, &data, 1);
 	return data;
 }
 
 static void spi_write_multi8(uint8_t *txBuf, uint32_t txSize){
-	BSP_SPI_Write(txBuf, txSize);
+	BSP_SPI_Write(active_chain, txBuf, txSize);
 }
 
 static void spi_write_read_multi8(uint8_t *txBuf, uint32_t txSize, uint8_t *rxBuf, uint32_t rxSize){
-    BSP_SPI_Write(txBuf, txSize);
-    BSP_SPI_Read(rxBuf, rxSize);
+    BSP_SPI_Write(active_chain, txBuf, txSize);
+    BSP_SPI_Read(active_chain, rxBuf, rxSize);
 }
 
 static void cs_set(uint8_t state){
-	BSP_SPI_SetStateCS(state);
+	BSP_SPI_SetStateCS(active_chain, state);
+}
+
+//Selects the daisy chain that the following commands are sent on
+void LTC681x_select_chain(SPI_Chain chain)
+{
+  active_chain = chain;
 }
 
 void delay_u(uint16_t micro)
@@ -76,6 +87,12 @@ void delay_u(uint16_t micro)
 
 void delay_m(uint16_t milli)
 {
+  // Let other threads run instead of spinning, one tick more since the current one is partly over
+  if (osKernelRunning())
+  {
+    osDelay(milli + 1);
+    return;
+  }
   uint32_t delay = BSP_PLL_GetSystemClock() / 1000;
 	for(uint32_t i = 0; i < milli; i++)
 	{
@@ -106,6 +123,44 @@ void wakeup_sleep(uint8_t total_ic)
   }
 }
 
+//Wakes the isoSPI port of every daisy chain. The chains are woken together so they share
+//the wakeup delay instead of paying it once per chain.
+void wakeup_idle_chains(uint8_t ics_per_chain)
+{
+  uint8_t data;
+  for (int i =0; i<ics_per_chain; i++)
+  {
+    for (int chain = 0; chain < NUM_CHAINS; chain++)
+    {
+      BSP_SPI_SetStateCS(chain, 0);
+    }
+    delay_m(5); //Guarantees the isoSPI will be in ready mode
+    for (int chain = 0; chain < NUM_CHAINS; chain++)
+    {
+      BSP_SPI_Read(chain, &data, 1);
+      BSP_SPI_SetStateCS(chain, 1);
+    }
+  }
+}
+
+//Wakes the LTC681x on every daisy chain from sleep, sharing the delay between the chains
+void wakeup_sleep_chains(uint8_t ics_per_chain)
+{
+  for (int i =0; i<ics_per_chain; i++)
+  {
+    for (int chain = 0; chain < NUM_CHAINS; chain++)
+    {
+      BSP_SPI_SetStateCS(chain, 0);
+    }
+    delay_u(500); // Guarantees the LTC6813 will be in standby
+    for (int chain = 0; chain < NUM_CHAINS; chain++)
+    {
+      BSP_SPI_SetStateCS(chain, 1);
+    }
+    delay_u(150);
+  }
+}
+
 //Generic function to write 68xx commands. Function calculated PEC for tx_cmd data
 void cmd_68(uint8_t tx_cmd[2])
 {
@@ -200,6 +255,7 @@ int8_t read_68( uint8_t total_ic, uint8_t tx_cmd[2], uint8_t *rx_data)
     if (received_pec != data_pec)
     {
       pec_error = -1;
+      COUNTER_INC(COUNTER_PEC_ERRORS);
     }
   }
 
@@ -391,6 +447,10 @@ uint32_t LTC681x_pollAdc()
     else
     {
       counter = counter + 10;
+      if (osKernelRunning())
+      {
+        osDelay(1);   // The conversion takes ms, poll once a tick
+      }
     }
   }
 
@@ -485,51 +545,52 @@ void LTC681x_adow(uint8_t MD, //ADC Mode
 	cmd_68(cmd);
 }
 
-// Reads the raw cell voltage register data
-void LTC681x_rdcv_reg(uint8_t reg, //Determines which cell voltage register is read back
-                      uint8_t total_ic, //the number of ICs in the
-                      uint8_t *data //An array of the unparsed cell codes
-                     )
+//Fills in the read command of a cell voltage register
+static void rdcv_cmd(uint8_t reg, uint8_t cmd[4])
 {
-  const uint8_t REG_LEN = 8; //number of bytes in each ICs register + 2 bytes for the PEC
-  uint8_t cmd[4];
   uint16_t cmd_pec;
 
+  cmd[0] = 0x00;
   if (reg == 1)     //1: RDCVA
   {
     cmd[1] = 0x04;
-    cmd[0] = 0x00;
   }
   else if (reg == 2) //2: RDCVB
   {
     cmd[1] = 0x06;
-    cmd[0] = 0x00;
   }
   else if (reg == 3) //3: RDCVC
   {
     cmd[1] = 0x08;
-    cmd[0] = 0x00;
   }
   else if (reg == 4) //4: RDCVD
   {
     cmd[1] = 0x0A;
-    cmd[0] = 0x00;
   }
   else if (reg == 5) //4: RDCVE
   {
     cmd[1] = 0x09;
-    cmd[0] = 0x00;
   }
   else if (reg == 6) //4: RDCVF
   {
     cmd[1] = 0x0B;
-    cmd[0] = 0x00;
   }
 
-
   cmd_pec = pec15_calc(2, cmd);
   cmd[2] = (uint8_t)(cmd_pec >> 8);
   cmd[3] = (uint8_t)(cmd_pec & 0x00FF);
+}
+
+// Reads the raw cell voltage register data
+void LTC681x_rdcv_reg(uint8_t reg, //Determines which cell voltage register is read back
+                      uint8_t total_ic, //the number of ICs in the
+                      uint8_t *data //An array of the unparsed cell codes
+                     )
+{
+  const uint8_t REG_LEN = 8; //number of bytes in each ICs register + 2 bytes for the PEC
+  uint8_t cmd[4];
+
+  rdcv_cmd(reg, cmd);
 
   cs_set(0);
   spi_write_read_multi8(cmd, 4, data, (REG_LEN*total_ic));
@@ -568,6 +629,7 @@ int8_t parse_cells(uint8_t current_ic, uint8_t cell_reg, uint8_t cell_data[], ui
   {
     pec_error = 1;                             //The pec_error variable is simply set negative if any PEC errors
     ic_pec[cell_reg-1]=1;
+    COUNTER_INC(COUNTER_PEC_ERRORS);
   }
   else
   {
@@ -577,50 +639,52 @@ int8_t parse_cells(uint8_t current_ic, uint8_t cell_reg, uint8_t cell_data[], ui
   return(pec_error);
 }
 
-/*
-The function reads a single GPIO voltage register and stores thre read data
-in the *data point as a byte array. This function is rarely used outside of
-the LTC6811_rdaux() command.
-*/
-void LTC681x_rdaux_reg(uint8_t reg, //Determines which GPIO voltage register is read back
-                       uint8_t total_ic, //The number of ICs in the system
-                       uint8_t *data //Array of the unparsed auxiliary codes
-                      )
+//Fills in the read command of an auxiliary register
+static void rdaux_cmd(uint8_t reg, uint8_t cmd[4])
 {
-  const uint8_t REG_LEN = 8; // number of bytes in the register + 2 bytes for the PEC
-  uint8_t cmd[4];
   uint16_t cmd_pec;
 
-
+  cmd[0] = 0x00;
   if (reg == 1)     //Read back auxiliary group A
   {
     cmd[1] = 0x0C;
-    cmd[0] = 0x00;
   }
   else if (reg == 2)  //Read back auxiliary group B
   {
     cmd[1] = 0x0e;
-    cmd[0] = 0x00;
   }
   else if (reg == 3)  //Read back auxiliary group C
   {
     cmd[1] = 0x0D;
-    cmd[0] = 0x00;
   }
   else if (reg == 4)  //Read back auxiliary group D
   {
     cmd[1] = 0x0F;
-    cmd[0] = 0x00;
   }
   else          //Read back auxiliary group A
   {
     cmd[1] = 0x0C;
-    cmd[0] = 0x00;
   }
 
   cmd_pec = pec15_calc(2, cmd);
   cmd[2] = (uint8_t)(cmd_pec >> 8);
   cmd[3] = (uint8_t)(cmd_pec & 0x00FF);
+}
+
+/*
+The function reads a single GPIO voltage register and stores thre read data
+in the *data point as a byte array. This function is rarely used outside of
+the LTC6811_rdaux() command.
+*/
+void LTC681x_rdaux_reg(uint8_t reg, //Determines which GPIO voltage register is read back
+                       uint8_t total_ic, //The number of ICs in the system
+                       uint8_t *data //Array of the unparsed auxiliary codes
+                      )
+{
+  const uint8_t REG_LEN = 8; // number of bytes in the register + 2 bytes for the PEC
+  uint8_t cmd[4];
+
+  rdaux_cmd(reg, cmd);
 
   cs_set(0);
   spi_write_read_multi8(cmd, 4, data, (REG_LEN*total_ic));
@@ -839,6 +903,124 @@ int8_t LTC681x_rdaux(uint8_t reg, //Determines which GPIO voltage register is re
   return (pec_error);
 }
 
+//Issues a read command on every daisy chain and waits for all of them to answer.
+//The transfers are started back to back so the chains are clocked out at the same time.
+static void read_68_chains(uint8_t ics_per_chain, uint8_t cmd[4], uint8_t *data)
+{
+  const uint32_t RX_LEN = LTC681X_NUM_RX_BYT*ics_per_chain;
+
+  for (int chain = 0; chain < NUM_CHAINS; chain++)
+  {
+    BSP_SPI_SetStateCS(chain, 0);
+    BSP_SPI_StartWriteRead(chain, cmd, 4, &data[chain*RX_LEN], RX_LEN);
+  }
+
+  for (int chain = 0; chain < NUM_CHAINS; chain++)
+  {
+    while (BSP_SPI_IsBusy(chain));
+    BSP_SPI_SetStateCS(chain, 1);
+  }
+}
+
+//Adds PEC error counts, stops at UINT8_MAX instead of wrapping around to no errors
+static uint8_t add_pec_errors(uint8_t count, uint8_t errors)
+{
+  return (errors > UINT8_MAX - count) ? UINT8_MAX : (uint8_t)(count + errors);
+}
+
+//Parses one register read of every daisy chain into the merged ic array.
+//ic[] holds the boards of chain 0 first, then chain 1 and so on.
+//Returns the number of ICs whose PEC did not match.
+static uint8_t parse_chains(uint8_t ics_per_chain, uint8_t reg, uint8_t *data, cell_asic ic[], uint8_t type)
+{
+  uint8_t pec_error = 0;
+  uint8_t c_ic = 0;
+
+  for (int chain = 0; chain < NUM_CHAINS; chain++)
+  {
+    cell_asic *chain_ic = &ic[chain*ics_per_chain];
+    uint8_t *chain_data = &data[chain*LTC681X_NUM_RX_BYT*ics_per_chain];
+
+    for (int current_ic = 0; current_ic<ics_per_chain; current_ic++)
+    {
+      if (chain_ic->isospi_reverse == false)
+      {
+        c_ic = current_ic;
+      }
+      else
+      {
+        c_ic = ics_per_chain - current_ic - 1;
+      }
+
+      if (type == LTC681X_CELL)
+      {
+        pec_error = add_pec_errors(pec_error, parse_cells(current_ic, reg, chain_data,
+                                                          &chain_ic[c_ic].cells.c_codes[0],
+                                                          &chain_ic[c_ic].cells.pec_match[0]));
+      }
+      else
+      {
+        pec_error = add_pec_errors(pec_error, parse_cells(current_ic, reg, chain_data,
+                                                          &chain_ic[c_ic].aux.a_codes[0],
+                                                          &chain_ic[c_ic].aux.pec_match[0]));
+      }
+    }
+  }
+  return(pec_error);
+}
+
+//Reads the cell voltage registers of every daisy chain into the merged ic array
+uint8_t LTC681x_rdcv_chains(uint8_t reg, // Controls which cell voltage register is read back, 0 for all.
+                            uint8_t ics_per_chain, // the number of ICs on each daisy chain
+                            cell_asic ic[] // Array of every IC on every chain
+                           )
+{
+  uint8_t cmd[4];
+  uint8_t cell_data[NUM_CHAINS*LTC681X_NUM_RX_BYT*ics_per_chain];
+  uint8_t pec_error = 0;
+  uint8_t first_reg = (reg == 0) ? 1 : reg;
+  uint8_t last_reg = (reg == 0) ? ic[0].ic_reg.num_cv_reg : reg;
+
+  for (uint8_t cell_reg = first_reg; cell_reg <= last_reg; cell_reg++)
+  {
+    rdcv_cmd(cell_reg, cmd);
+    read_68_chains(ics_per_chain, cmd, cell_data);
+    pec_error = add_pec_errors(pec_error, parse_chains(ics_per_chain, cell_reg, cell_data, ic, LTC681X_CELL));
+  }
+
+  for (int chain = 0; chain < NUM_CHAINS; chain++)
+  {
+    LTC681x_check_pec(ics_per_chain, LTC681X_CELL, &ic[chain*ics_per_chain]);
+  }
+  return(pec_error);
+}
+
+//Reads the auxiliary registers of every daisy chain into the merged ic array
+uint8_t LTC681x_rdaux_chains(uint8_t reg, // Controls which GPIO voltage register is read back, 0 for all.
+                            uint8_t ics_per_chain, // the number of ICs on each daisy chain
+                            cell_asic ic[] // Array of every IC on every chain
+                           )
+{
+  uint8_t cmd[4];
+  uint8_t aux_data[NUM_CHAINS*LTC681X_NUM_RX_BYT*ics_per_chain];
+  uint8_t pec_error = 0;
+  uint8_t first_reg = (reg == 0) ? 1 : reg;
+  uint8_t last_reg = (reg == 0) ? ic[0].ic_reg.num_gpio_reg : reg;
+
+  for (uint8_t gpio_reg = first_reg; gpio_reg <= last_reg; gpio_reg++)
+  {
+    rdaux_cmd(gpio_reg, cmd);
+    read_68_chains(ics_per_chain, cmd, aux_data);
+    pec_error = add_pec_errors(pec_error, parse_chains(ics_per_chain, gpio_reg, aux_data, ic, LTC681X_AUX));
+  }
+
+  for (int chain = 0; chain < NUM_CHAINS; chain++)
+  {
+    LTC681x_check_pec(ics_per_chain, LTC681X_AUX, &ic[chain*ics_per_chain]);
+  }
+  return(pec_error);
+}
+
 // Reads and parses the LTC681x stat registers.
 int8_t LTC681x_rdstat(uint8_t reg, //Determines which Stat  register is read back.
                       uint8_t total_ic,//the number of ICs in the system
@@ -975,6 +1157,10 @@ int8_t LTC681x_rdstat(uint8_t reg, //Determines which Stat  register is read bac
         ic[c_ic].stat.pec_match[reg-1]=1;
 
       }
+      else
+      {
+        ic[c_ic].stat.pec_match[reg-1]=0;
+      }
 
       data_counter=data_counter+2;
     }
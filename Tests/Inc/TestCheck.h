@@ -0,0 +1,38 @@
+#ifndef __TEST_CHECK_H
+#define __TEST_CHECK_H
+
+#include "common.h"
+
+/**
+ * Pass and fail bookkeeping of the tests. Every failed Check prints its message and counts,
+ * TestCheck_Exit prints PASS if nothing failed and ends the test with the result as exit code.
+ */
+
+static int TestFailures = 0;
+
+/**
+ * @brief   Counts a failure if the condition does not hold
+ * @param   condition   what the test expects
+ * @param   msg         printed when it does not hold
+ * @return  None
+ */
+static inline void Check(bool condition, const char *msg) {
+    if(!condition) {
+        printf("FAIL: %s\r\n", msg);
+        TestFailures++;
+    }
+}
+
+/**
+ * @brief   Ends the test, prints PASS and exits with 0 if no Check failed, exits with 1 otherwise
+ * @param   None
+ * @return  None
+ */
+static inline void TestCheck_Exit(void) {
+    if(TestFailures == 0) {
+        printf("PASS\r\n");
+    }
+    exit(TestFailures == 0 ? 0 : 1);
+}
+
+#endif
@@ -0,0 +1,109 @@
+#include "common.h"
+#include "config.h"
+#include "Current.h"
+#include "BSP_ADC.h"
+#include "BSP_UART.h"
+#include "simulator_conf.h"
+#include "TestCheck.h"
+
+/**
+ * Simulator only test of the sampled current path. Feeds known conversions through the
+ * ADC double buffer with BSP_ADC_SimulateSamples and checks the block averages, the
+ * timestamps, the queue and the currents Current.c makes out of them.
+ */
+
+#define NUM_BLOCKS  4
+
+/**
+ * Feeds one block of conversions where every sample is code plus a repeating noise pattern
+ */
+static void FeedBlock(uint16_t high, uint16_t low, int noise) {
+    uint16_t highCodes[ADC_BLOCK_SIZE];
+    uint16_t lowCodes[ADC_BLOCK_SIZE];
+    for(int i = 0; i < ADC_BLOCK_SIZE; i++) {
+        int n = (i % 4 - 1.5) * 2 * noise / 3;     // -noise, -noise/3, noise/3, noise, zero mean
+        highCodes[i] = high + n;
+        lowCodes[i] = low + n;
+    }
+    BSP_ADC_SimulateSamples(highCodes, lowCodes, ADC_BLOCK_SIZE);
+}
+
+static uint16_t CodeToMilliVolts(uint16_t code) {
+    return (code * 3300) >> 12;
+}
+
+int main() {
+
+    BSP_UART_Init();    // Initialize printf
+
+    // BSP_ADC_Init wants ADC.csv to be there even though it is not read
+    FILE *fp = fopen(GET_CSV_PATH(ADC_CSV_FILE), "w");
+    if(!fp) {
+        perror(ADC_CSV_FILE);
+        exit(EXIT_FAILURE);
+    }
+    fprintf(fp, "2048,2048\r\n");
+    fclose(fp);
+
+    Current_Init();
+    printf("%dHz sampling, %d samples per reading, queue of %d\r\n", ADC_SAMPLE_RATE_HZ, ADC_BLOCK_SIZE, ADC_QUEUE_SIZE);
+
+    // Noise averages out of every block, both halves of the double buffer
+    const uint16_t highCodes[NUM_BLOCKS] = {2048, 2500, 3000, 1500};
+    const uint16_t lowCodes[NUM_BLOCKS] = {2048, 1800, 1000, 3500};
+    for(int b = 0; b < NUM_BLOCKS; b++) {
+        FeedBlock(highCodes[b], lowCodes[b], 300);
+    }
+
+    ADC_Sample samples[ADC_QUEUE_SIZE];
+    uint32_t count = BSP_ADC_ReadSamples(samples, ADC_QUEUE_SIZE);
+    Check(count == NUM_BLOCKS, "one reading per block");
+    for(uint32_t i = 0; i < count; i++) {
+        printf("\t%6dus: high %4dmV (expected %4d), low %4dmV (expected %4d)\r\n",
+            (int)((uint64_t)samples[i].timestamp * 1000000 / ADC_SAMPLE_RATE_HZ),
+            samples[i].highMilliVolts, CodeToMilliVolts(highCodes[i]),
+            samples[i].lowMilliVolts, CodeToMilliVolts(lowCodes[i]));
+        Check(abs(samples[i].highMilliVolts - CodeToMilliVolts(highCodes[i])) <= 1, "high precision average");
+        Check(abs(samples[i].lowMilliVolts - CodeToMilliVolts(lowCodes[i])) <= 1, "low precision average");
+        Check(samples[i].timestamp == (i + 1) * ADC_BLOCK_SIZE, "timestamp should count samples");
+    }
+    Check(BSP_ADC_ReadSamples(samples, ADC_QUEUE_SIZE) == 0, "queue should be empty after reading");
+
+    // Averaging gains resolution: half a code of offset shows up in the reading
+    uint16_t highHalf[ADC_BLOCK_SIZE];
+    uint16_t lowHalf[ADC_BLOCK_SIZE];
+    for(int i = 0; i < ADC_BLOCK_SIZE; i++) {
+        highHalf[i] = 4000 + (i & 1);
+        lowHalf[i] = 4000;
+    }
+    BSP_ADC_SimulateSamples(highHalf, lowHalf, ADC_BLOCK_SIZE);
+    BSP_ADC_ReadSamples(samples, 1);
+    printf("4000.5 codes average to %dmV, 4000 to %dmV\r\n", samples[0].highMilliVolts, samples[0].lowMilliVolts);
+    Check(samples[0].highMilliVolts >= samples[0].lowMilliVolts, "averaging should keep sub code resolution");
+
+    // A main loop that falls behind loses the newest readings, not the ones it has not read yet
+    for(int b = 0; b < ADC_QUEUE_SIZE + 8; b++) {
+        FeedBlock(2048, 2048, 0);
+    }
+    count = BSP_ADC_ReadSamples(samples, ADC_QUEUE_SIZE);
+    printf("%d blocks while the main loop was busy, %d readings kept\r\n", ADC_QUEUE_SIZE + 8, count);
+    Check(count == ADC_QUEUE_SIZE, "full queue should keep ADC_QUEUE_SIZE readings");
+    Check(samples[count - 1].timestamp - samples[0].timestamp == (ADC_QUEUE_SIZE - 1) * ADC_BLOCK_SIZE, "kept readings should be back to back");
+
+    // Current picks up the newest reading and its time. 0A is 4096mV / 3 on both sensors.
+    uint16_t zeroAmps = (1365 * 4096) / 3300 + 1;
+    uint16_t highZero[ADC_BLOCK_SIZE];
+    uint16_t lowZero[ADC_BLOCK_SIZE];
+    for(int i = 0; i < ADC_BLOCK_SIZE; i++) {
+        highZero[i] = zeroAmps;
+        lowZero[i] = zeroAmps;
+    }
+    BSP_ADC_SimulateSamples(highZero, lowZero, ADC_BLOCK_SIZE);
+    Current_UpdateMeasurements();
+    printf("Current: %dmA at %dms\r\n", Current_GetLowPrecReading(), Current_GetSampleTime());
+    Check(abs(Current_GetLowPrecReading()) < 1000, "current of the newest reading");
+    Check(Current_GetSampleTime() == (uint32_t)(((uint64_t)(NUM_BLOCKS + 1 + ADC_QUEUE_SIZE + 8 + 1) * ADC_BLOCK_SIZE * 1000) / ADC_SAMPLE_RATE_HZ),
+        "sample time should follow the timestamps");
+
+    TestCheck_Exit();
+}
@@ -7,12 +7,12 @@ int main() {
 
     BSP_UART_Init();    // Initialize UART to use printf
 
-    BSP_SPI_Init();
+    BSP_SPI_Init(SPI_CHAIN_0);
 
-    uint8_t data[4+NUM_MINIONS*8] = {0x00, 0x01, 0x00, 0x02};
+    uint8_t data[4+NUM_MINIONS_PER_CHAIN*8] = {0x00, 0x01, 0x00, 0x02};
 
-    BSP_SPI_Write(data, 4);
-    BSP_SPI_Read(data, 4+NUM_MINIONS*8);
+    BSP_SPI_Write(SPI_CHAIN_0, data, 4);
+    BSP_SPI_Read(SPI_CHAIN_0, data, 4+NUM_MINIONS_PER_CHAIN*8);
 
     while(1) {
         
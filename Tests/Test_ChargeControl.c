@@ -0,0 +1,333 @@
+#include <unistd.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include "common.h"
+#include "config.h"
+#include "Current.h"
+#include "Charge.h"
+#include "ModuleCharge.h"
+#include "PowerLimit.h"
+#include "ChargeControl.h"
+#include "Voltage.h"
+#include "Temperature.h"
+#include "EEPROM.h"
+#include "BSP_ADC.h"
+#include "BSP_UART.h"
+#include "BSP_PLL.h"
+#include "simulator_conf.h"
+#include "TestCheck.h"
+
+/**
+ * Simulator only test of the charge controller. Charges the mismatched pack of
+ * "scenario.py charge" through the charger model in closed loop, three ways:
+ *  - the charger on its own, set to MAX_VOLTAGE_LIMIT on every module. The highest
+ *    module gets over MAX_VOLTAGE_LIMIT and the BPS trips, which is what happens today.
+ *  - the charger on its own, set low enough that the highest module stays under the limit
+ *  - the charger following ChargeControl
+ * Prints the time to full, the peak module voltage and where the modules end up for each.
+ * Then checks that the setpoint drops within one control period when a module gets too hot.
+ */
+
+#define BLOCK_SAMPLES       (ADC_SAMPLE_RATE_HZ / 10)   // Main loop passes of 100ms
+#define TEMP_SCAN_SECONDS   5                           // Temperature scans are slow on the simulator
+#define SAFE_VOLTAGE        3880    // Highest module with the charger set this low stays under the limit (mV)
+
+cell_asic minions[NUM_MINIONS];
+
+typedef enum {
+    CHARGER_ALONE,
+    CHARGER_SAFE,
+    CONTROLLED
+} ChargeMode;
+
+typedef struct {
+    bool tripped;
+    bool done;
+    int fullSecond;         // Current tapered off, -1 if it never did
+    int seconds;
+    int32_t peakVoltage;    // mV
+    double charged;         // Ah
+    int32_t lowest;         // Module voltages at the end (mV)
+    int32_t highest;
+} ChargeResult;
+
+/**
+ * Starts scenario.py with pipes both ways
+ * @param toPlant gets the stream the setpoints go to
+ * @return stream the rows of the plant come from
+ */
+static FILE *StartPlant(FILE **toPlant, pid_t *pid) {
+    int down[2], up[2];
+    if(pipe(down) != 0 || pipe(up) != 0) {
+        perror("pipe");
+        exit(EXIT_FAILURE);
+    }
+    *pid = fork();
+    if(*pid == 0) {
+        dup2(down[0], STDIN_FILENO);
+        dup2(up[1], STDOUT_FILENO);
+        close(down[1]);
+        close(up[0]);
+        execlp("python3", "python3", "BSP/Simulator/DataGeneration/scenario.py", "charge", (char *)NULL);
+        perror("python3");
+        exit(EXIT_FAILURE);
+    }
+    close(down[0]);
+    close(up[1]);
+    *toPlant = fdopen(down[1], "w");
+    return fdopen(up[0], "r");
+}
+
+static bool ReadPlant(FILE *fp, int32_t *current, int32_t *voltages, int32_t *temperatures) {
+    if(fscanf(fp, "%d", current) != 1) {
+        return false;
+    }
+    for(int i = 0; i < NUM_BATTERY_MODULES; i++) {
+        fscanf(fp, ",%d", &voltages[i]);
+    }
+    for(int i = 0; i < NUM_BATTERY_MODULES; i++) {
+        fscanf(fp, ",%d", &temperatures[i]);
+    }
+    return true;
+}
+
+/**
+ * Writes a scan, every module at the temperature of the plant except hotModule
+ */
+static void WriteScan(int32_t *milliVolts, int32_t *temperatures, int hotModule, int32_t hotTemp) {
+    FILE *fp = fopen(GET_CSV_PATH(SPI_CSV_FILE), "w");
+    if(!fp) {
+        perror(SPI_CSV_FILE);
+        exit(EXIT_FAILURE);
+    }
+    for(int module = 0; module < NUM_BATTERY_MODULES; module++) {
+        int32_t temp = module == hotModule ? hotTemp : temperatures[module];
+        fprintf(fp, "1,%d,%d,%d\n", milliVolts[module] * 10 + rand() % 25 - 12,
+            temp + rand() % 101 - 50, temp + rand() % 101 - 50);
+    }
+    fclose(fp);
+}
+
+static double LowCode(int32_t milliAmps) {
+    double milliVolts = (milliAmps / 25.0 + 4096) / 3;
+    return milliVolts * 4096 / 3300;
+}
+
+static double HighCode(int32_t milliAmps) {
+    double code = ((milliAmps / 12.5 + 4096) / 3) * 4096 / 3300;
+    return code > 4095 ? 4095 : code;
+}
+
+/**
+ * Feeds one second of current and runs the main loop passes in it
+ * @param dither rounding carried over from the last second
+ */
+static void RunSecond(int32_t milliAmps, double *dither) {
+    double low = LowCode(milliAmps);
+    double high = HighCode(milliAmps);
+    for(int block = 0; block < ADC_SAMPLE_RATE_HZ / BLOCK_SAMPLES; block++) {
+        uint16_t lowCodes[BLOCK_SAMPLES], highCodes[BLOCK_SAMPLES];
+        for(int i = 0; i < BLOCK_SAMPLES; i++) {
+            lowCodes[i] = (uint16_t)(low + dither[0]);
+            highCodes[i] = (uint16_t)(high + dither[1]);
+            dither[0] += low - lowCodes[i];
+            dither[1] += high - highCodes[i];
+        }
+        BSP_ADC_SimulateSamples(highCodes, lowCodes, BLOCK_SAMPLES);
+        Current_UpdateMeasurements();
+        Charge_Calculate();
+        ModuleCharge_Update();
+        PowerLimit_Update();
+        ChargeControl_Update();
+    }
+}
+
+static void InitBPS(int32_t *voltages, int32_t *temperatures) {
+    WriteScan(voltages, temperatures, -1, 0);
+    Voltage_Init(minions);
+    Temperature_Init(minions);
+    Voltage_UpdateMeasurements();
+    for(int i = 0; i < TEMP_SLOPE_WINDOW; i++) {
+        Temperature_UpdateAllMeasurements();
+    }
+    EEPROM_Init();
+    Current_Init();
+    Charge_Init();
+    Charge_SetAccum(6100);
+    ModuleCharge_Init();
+    PowerLimit_Init();
+    ChargeControl_Init();
+}
+
+/**
+ * Charges until the charge is done, the BPS trips or the scenario ends
+ */
+static ChargeResult RunCharge(ChargeMode mode) {
+    ChargeResult result = {.fullSecond = -1};
+    int32_t current;
+    int32_t voltages[NUM_BATTERY_MODULES];
+    int32_t temperatures[NUM_BATTERY_MODULES];
+    double dither[2] = {0, 0};
+    FILE *toPlant;
+    pid_t pid;
+    FILE *fromPlant = StartPlant(&toPlant, &pid);
+
+    if(!ReadPlant(fromPlant, &current, voltages, temperatures)) {
+        printf("FAIL: scenario.py did not run\r\n");
+        exit(1);
+    }
+    InitBPS(voltages, temperatures);
+    if(mode == CONTROLLED) {
+        ChargeControl_Start();
+    }
+
+    for(int second = 0; ; second++) {
+        RunSecond(current, dither);
+
+        if(mode == CONTROLLED) {
+            int32_t setpoint = ChargeControl_GetCurrent();
+            fprintf(toPlant, "%d,%d,%d,%d\n", ChargeControl_GetVoltage() != 0 && setpoint != 0,
+                ChargeControl_GetVoltage(), setpoint, Voltage_GetBalancing());
+        } else {
+            int32_t moduleVoltage = mode == CHARGER_ALONE ? MAX_VOLTAGE_LIMIT * MILLI_SCALING_FACTOR : SAFE_VOLTAGE;
+            fprintf(toPlant, "1,%d,%d,0\n", moduleVoltage * NUM_BATTERY_MODULES, CHARGE_CONTROL_CC_CURRENT);
+        }
+        fflush(toPlant);
+        if(!ReadPlant(fromPlant, &current, voltages, temperatures)) {
+            break;
+        }
+        result.seconds = second + 1;
+        result.charged -= current / 3600000.0;
+
+        WriteScan(voltages, temperatures, -1, 0);
+        Voltage_UpdateMeasurements();
+        if(second % TEMP_SCAN_SECONDS == 0) {
+            Temperature_UpdateAllMeasurements();
+        }
+        for(int i = 0; i < NUM_BATTERY_MODULES; i++) {
+            result.peakVoltage = voltages[i] > result.peakVoltage ? voltages[i] : result.peakVoltage;
+        }
+        if(result.fullSecond < 0 && second > 60 && -current <= CHARGE_CONTROL_TAPER_CURRENT) {
+            result.fullSecond = second + 1;
+        }
+
+        // The BPS trips like main.c does and opens the contactor
+        if(Voltage_CheckStatus() != SAFE || Temperature_CheckStatus(Current_IsCharging()) != SAFE
+            || Current_CheckStatus(false) != SAFE) {
+            result.tripped = true;
+            break;
+        }
+        if(ChargeControl_GetState() == CHARGE_DONE || ChargeControl_GetState() == CHARGE_FAULT) {
+            result.done = ChargeControl_GetState() == CHARGE_DONE;
+            break;
+        }
+        // On its own the charger holds its voltage until it is unplugged
+        if(mode != CONTROLLED && result.fullSecond >= 0) {
+            break;
+        }
+    }
+
+    result.lowest = INT32_MAX;
+    for(int i = 0; i < NUM_BATTERY_MODULES; i++) {
+        result.lowest = voltages[i] < result.lowest ? voltages[i] : result.lowest;
+        result.highest = voltages[i] > result.highest ? voltages[i] : result.highest;
+    }
+
+    fclose(toPlant);
+    fclose(fromPlant);
+    waitpid(pid, NULL, 0);
+    return result;
+}
+
+static void Print(const char *name, ChargeResult r) {
+    printf("%-16s %s after %5ds, full at %5ds, peak %dmV, %.2fAh in, modules end at %d to %dmV\r\n", name,
+        r.tripped ? "tripped" : r.done ? "done   " : "stopped", r.seconds, r.fullSecond, r.peakVoltage,
+        r.charged, r.lowest, r.highest);
+}
+
+/**
+ * A module heats up past the charge limit in the middle of constant current. The setpoint
+ * has to drop in the next control period.
+ */
+static void CheckTemperature(void) {
+    int32_t current;
+    int32_t voltages[NUM_BATTERY_MODULES];
+    int32_t temperatures[NUM_BATTERY_MODULES];
+    double dither[2] = {0, 0};
+    FILE *toPlant;
+    pid_t pid;
+    FILE *fromPlant = StartPlant(&toPlant, &pid);
+
+    ReadPlant(fromPlant, &current, voltages, temperatures);
+    InitBPS(voltages, temperatures);
+    ChargeControl_Start();
+    for(int second = 0; second < 20; second++) {
+        RunSecond(current, dither);
+        fprintf(toPlant, "1,%d,%d,0\n", ChargeControl_GetVoltage(), ChargeControl_GetCurrent());
+        fflush(toPlant);
+        ReadPlant(fromPlant, &current, voltages, temperatures);
+        WriteScan(voltages, temperatures, -1, 0);
+        Voltage_UpdateMeasurements();
+    }
+    int32_t before = ChargeControl_GetCurrent();
+
+    // One scan with a module at the charge limit, then one control period
+    WriteScan(voltages, temperatures, 7, MAX_CHARGE_TEMPERATURE_LIMIT * MILLI_SCALING_FACTOR);
+    Temperature_UpdateAllMeasurements();
+    uint16_t lowCode = LowCode(current), highCode = HighCode(current);
+    uint32_t start = Current_GetSampleTime();
+    bool updated = false;
+    while(!updated) {
+        for(int i = 0; i < ADC_BLOCK_SIZE; i++) {
+            BSP_ADC_SimulateSamples(&highCode, &lowCode, 1);
+        }
+        Current_UpdateMeasurements();
+        PowerLimit_Update();
+        updated = ChargeControl_Update();
+    }
+    uint32_t took = Current_GetSampleTime() - start;
+    int32_t after = ChargeControl_GetCurrent();
+    printf("Module at %dC: setpoint %dmA -> %dmA after %dms\r\n", (int)MAX_CHARGE_TEMPERATURE_LIMIT, before, after, took);
+    Check(took <= CHARGE_CONTROL_PERIOD_MS + ADC_BLOCK_SIZE * 1000 / ADC_SAMPLE_RATE_HZ, "the setpoint should be updated within one period");
+    Check(before == CHARGE_CONTROL_CC_CURRENT, "the charge should be in constant current");
+    Check(after == 0, "the setpoint should drop within one period of a module getting too hot");
+
+    fclose(toPlant);
+    fclose(fromPlant);
+    waitpid(pid, NULL, 0);
+}
+
+int main() {
+
+    BSP_UART_Init();    // Initialize printf
+    BSP_PLL_Init();     // The LTC6811 driver times its delays with the clock
+    srand(42);
+    signal(SIGPIPE, SIG_IGN);   // scenario.py stops on its own at the end
+
+    // BSP_ADC_Init wants ADC.csv to be there even though it is not read
+    FILE *fp = fopen(GET_CSV_PATH(ADC_CSV_FILE), "w");
+    if(!fp) {
+        perror(ADC_CSV_FILE);
+        exit(EXIT_FAILURE);
+    }
+    fprintf(fp, "2048,2048\r\n");
+    fclose(fp);
+
+    ChargeResult alone = RunCharge(CHARGER_ALONE);
+    ChargeResult safe = RunCharge(CHARGER_SAFE);
+    ChargeResult controlled = RunCharge(CONTROLLED);
+    Print("Charger alone:", alone);
+    Print("Charger lowered:", safe);
+    Print("ChargeControl:", controlled);
+
+    Check(alone.tripped, "the charger on its own should trip the BPS");
+    Check(!safe.tripped && !controlled.tripped, "the lowered charger and ChargeControl should not trip");
+    Check(controlled.done, "ChargeControl should finish the charge");
+    Check(controlled.peakVoltage < MAX_VOLTAGE_LIMIT * MILLI_SCALING_FACTOR, "no module should get to the limit");
+    Check(controlled.charged > safe.charged, "ChargeControl should fill the pack further");
+    Check(controlled.fullSecond >= 0 && safe.fullSecond >= 0, "both should get to full");
+
+    CheckTemperature();
+
+    TestCheck_Exit();
+}
@@ -0,0 +1,177 @@
+#include "common.h"
+#include "config.h"
+#include "Current.h"
+#include "Charge.h"
+#include "Voltage.h"
+#include "EEPROM.h"
+#include "BSP_ADC.h"
+#include "BSP_UART.h"
+#include "BSP_PLL.h"
+#include "simulator_conf.h"
+
+/**
+ * Simulator only test of the state of charge estimator. Runs the hour long drive of scenario.py
+ * with a state of charge from EEPROM that is far off and a current sensor with an offset, the
+ * two things plain coulomb counting never recovers from. The module voltages battery.py gives
+ * go through SPI.csv once a second. Prints the error of the estimate and of the plain count
+ * against battery.py, and how long an update takes.
+ */
+
+#define MAX_SECONDS         7200
+#define START_PERCENT       6000    // What the pack thinks it has, 0.01%
+#define SENSOR_OFFSET       400     // Current sensor reads this much high (mA)
+#define SETTLE_SECONDS      900     // Time the estimate gets to find the real state of charge
+#define MAX_ERROR           300     // Allowed error after that, 0.01%
+
+static int32_t scenarioCurrent[MAX_SECONDS];    // mA
+static double scenarioCharge[MAX_SECONDS + 1];  // mAh at the end of each second
+static int32_t scenarioVoltage[MAX_SECONDS + 1];    // mV at the end of each second
+
+cell_asic minions[NUM_MINIONS];
+
+/**
+ * Runs scenario.py and reads what it wrote
+ * @return seconds in the scenario
+ */
+static int LoadScenario(void) {
+    if(system("python3 BSP/Simulator/DataGeneration/scenario.py") != 0) {
+        printf("FAIL: scenario.py did not run\r\n");
+        exit(1);
+    }
+    FILE *fp = fopen(GET_CSV_PATH(SCENARIO_CSV_FILE), "r");
+    if(!fp) {
+        perror(SCENARIO_CSV_FILE);
+        exit(EXIT_FAILURE);
+    }
+    int32_t current;
+    int seconds = 0;
+    fscanf(fp, "%d,%lf,%d", &current, &scenarioCharge[0], &scenarioVoltage[0]);
+    while(seconds < MAX_SECONDS && fscanf(fp, "%d,%lf,%d", &scenarioCurrent[seconds], &scenarioCharge[seconds + 1], &scenarioVoltage[seconds + 1]) == 3) {
+        seconds++;
+    }
+    fclose(fp);
+    return seconds;
+}
+
+/**
+ * Writes every module at the same voltage with a little noise like SPI.py adds
+ */
+static void WriteScan(int32_t milliVolts) {
+    FILE *fp = fopen(GET_CSV_PATH(SPI_CSV_FILE), "w");
+    if(!fp) {
+        perror(SPI_CSV_FILE);
+        exit(EXIT_FAILURE);
+    }
+    for(int module = 0; module < NUM_BATTERY_MODULES; module++) {
+        fprintf(fp, "1,%d,25000,25000\n", milliVolts * 10 + rand() % 25 - 12);
+    }
+    fclose(fp);
+}
+
+/**
+ * ADC code of the low precision sensor for a current, the inverse of Current_Conversion
+ * without rounding
+ */
+static double LowCode(int32_t milliAmps) {
+    double milliVolts = (milliAmps / 25.0 + 4096) / 3;
+    return milliVolts * 4096 / 3300;
+}
+
+static double HighCode(int32_t milliAmps) {
+    double code = ((milliAmps / 12.5 + 4096) / 3) * 4096 / 3300;
+    return code > 4095 ? 4095 : code;
+}
+
+int main() {
+
+    BSP_UART_Init();    // Initialize printf
+    BSP_PLL_Init();     // The LTC6811 driver times its delays with the clock
+    srand(38);
+
+    // BSP_ADC_Init wants ADC.csv to be there even though it is not read
+    FILE *fp = fopen(GET_CSV_PATH(ADC_CSV_FILE), "w");
+    if(!fp) {
+        perror(ADC_CSV_FILE);
+        exit(EXIT_FAILURE);
+    }
+    fprintf(fp, "2048,2048\r\n");
+    fclose(fp);
+
+    int seconds = LoadScenario();
+    printf("%d second drive, starting at %.2f%% thought to be %.2f%%, current sensor %dmA high\r\n",
+        seconds, scenarioCharge[0] * 100 / PACK_CAPACITY_MAH, START_PERCENT / 100.0, SENSOR_OFFSET);
+
+    WriteScan(scenarioVoltage[0]);
+    Voltage_Init(minions);
+    Voltage_UpdateMeasurements();
+    EEPROM_Init();
+    Current_Init();
+    Charge_Init();
+    Charge_SetAccum(START_PERCENT);
+
+    uint32_t nextCall = 0;
+    uint32_t sampleNum = 0;
+    double dither[2] = {0, 0};
+    double ekfSquares = 0;
+    double countSquares = 0;
+    double ekfWorst = 0;
+    double countWorst = 0;
+    int settledSeconds = 0;
+    uint64_t totalCycles = 0;
+    uint32_t calls = 0;
+
+    for(int second = 0; second < seconds; second++) {
+        double low = LowCode(scenarioCurrent[second] + SENSOR_OFFSET);
+        double high = HighCode(scenarioCurrent[second] + SENSOR_OFFSET);
+
+        for(int i = 0; i < ADC_SAMPLE_RATE_HZ; i++) {
+            uint16_t lowCode = (uint16_t)(low + dither[0]);
+            uint16_t highCode = (uint16_t)(high + dither[1]);
+            dither[0] += low - lowCode;
+            dither[1] += high - highCode;
+            BSP_ADC_SimulateSamples(&highCode, &lowCode, 1);
+            sampleNum++;
+
+            // Main loop passes of 20 to 220ms
+            if(sampleNum >= nextCall) {
+                Current_UpdateMeasurements();
+                Charge_Calculate();
+                totalCycles += Charge_GetCycles();
+                calls++;
+                nextCall = sampleNum + 40 + rand() % 400;
+            }
+        }
+
+        // One voltage scan a second
+        WriteScan(scenarioVoltage[second + 1]);
+        Voltage_UpdateMeasurements();
+
+        double truth = scenarioCharge[second + 1] * 10000 / PACK_CAPACITY_MAH;
+        double counted = START_PERCENT - (double)Current_GetChargeMoved() / 3600000 * 10000 / PACK_CAPACITY_MAH;
+        double ekfError = fabs(Charge_GetPercent() - truth);
+        double countError = fabs(counted - truth);
+        if(second >= SETTLE_SECONDS) {
+            ekfSquares += ekfError * ekfError;
+            countSquares += countError * countError;
+            ekfWorst = ekfError > ekfWorst ? ekfError : ekfWorst;
+            countWorst = countError > countWorst ? countError : countWorst;
+            settledSeconds++;
+        }
+        if(second % 600 == 599) {
+            printf("%4ds: battery.py %6.2f%%, estimate %6.2f%%, coulomb count %6.2f%%\r\n",
+                second + 1, truth / 100, Charge_GetPercent() / 100.0, counted / 100);
+        }
+    }
+
+    printf("After %ds:\r\n", SETTLE_SECONDS);
+    printf("estimate:      %.2f%% rms, %.2f%% worst\r\n", sqrt(ekfSquares / settledSeconds) / 100, ekfWorst / 100);
+    printf("coulomb count: %.2f%% rms, %.2f%% worst\r\n", sqrt(countSquares / settledSeconds) / 100, countWorst / 100);
+    printf("Update: %dns on average, %dns worst\r\n", (uint32_t)(totalCycles / calls), Charge_GetMaxCycles());
+
+    if(ekfWorst > MAX_ERROR) {
+        printf("FAIL\r\n");
+        exit(1);
+    }
+    printf("PASS\r\n");
+    exit(0);
+}
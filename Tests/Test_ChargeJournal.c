@@ -0,0 +1,170 @@
+#include <stddef.h>
+#include "common.h"
+#include "config.h"
+#include "ChargeJournal.h"
+#include "EEPROM.h"
+#include "BSP_I2C.h"
+#include "BSP_PVD.h"
+#include "BSP_UART.h"
+#include "TestCheck.h"
+
+/**
+ * Simulator only test of the state of charge journal. Checks that checkpoints rotate through
+ * every slot, that the cadence holds, and that the newest good checkpoint comes back after a
+ * reset at a random point, including power lost in the middle of a checkpoint, the final
+ * checkpoint on a supply drop and sequence numbers wrapping around. The test stands in for
+ * the thread that writes the final checkpoint.
+ */
+
+#define NUM_RESETS          300
+#define DELTA               ((int64_t)PACK_CAPACITY_MAH * 3600 * 1000 * CHARGE_JOURNAL_DELTA / 10000)
+
+// Same layout as ChargeJournal.c
+typedef struct {
+    int64_t charge;
+    uint32_t sequence;
+    uint32_t crc;
+} JournalRecord;
+
+/**
+ * CRC-32 the same way ChargeJournal.c does it, for records written by the test
+ */
+static uint32_t CRC(const JournalRecord *record) {
+    const uint8_t *bytes = (const uint8_t *)record;
+    uint32_t crc = 0xFFFFFFFF;
+    for(uint32_t i = 0; i < offsetof(JournalRecord, crc); i++) {
+        crc ^= bytes[i];
+        for(int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+static void EraseJournal(void) {
+    uint8_t blank[CHARGE_JOURNAL_SLOTS * sizeof(JournalRecord)] = {0};
+    EEPROM_WriteMultipleBytes(EEPROM_CHARGE_JOURNAL_LOC, sizeof(blank), blank);
+}
+
+/**
+ * Reset, then recover
+ * @return recovered charge, -1 if there was none
+ */
+static int64_t Reset(void) {
+    int64_t charge = -1;
+    ChargeJournal_Init(&charge);
+    return charge;
+}
+
+int main() {
+
+    BSP_UART_Init();    // Initialize printf
+    srand(39);
+    EEPROM_Init();
+
+    // Blank EEPROM
+    EraseJournal();
+    Check(Reset() == -1, "a blank journal should have nothing to recover");
+
+    // Every checkpoint goes to the next slot
+    int64_t charge = (int64_t)PACK_CAPACITY_MAH * 3600 * 1000;
+    uint32_t time = 0;
+    const uint32_t rounds = 5;
+    for(uint32_t i = 0; i < rounds * CHARGE_JOURNAL_SLOTS; i++) {
+        charge -= DELTA;
+        time += 1000;
+        ChargeJournal_Update(charge, time);
+    }
+    Check(ChargeJournal_GetWrites() == rounds * CHARGE_JOURNAL_SLOTS, "every change of CHARGE_JOURNAL_DELTA should be written");
+    uint32_t lowest = UINT32_MAX, highest = 0;
+    for(uint32_t slot = 0; slot < CHARGE_JOURNAL_SLOTS; slot++) {
+        JournalRecord record;
+        EEPROM_ReadMultipleBytes(EEPROM_CHARGE_JOURNAL_LOC + slot * sizeof(record), sizeof(record), (uint8_t *)&record);
+        lowest = record.sequence < lowest ? record.sequence : lowest;
+        highest = record.sequence > highest ? record.sequence : highest;
+    }
+    printf("%d checkpoints, slots hold sequence %d to %d\r\n", rounds * CHARGE_JOURNAL_SLOTS, lowest, highest);
+    Check(highest - lowest == CHARGE_JOURNAL_SLOTS - 1, "the writes should rotate through every slot");
+    Check(Reset() == charge, "the newest checkpoint should come back");
+
+    // Cadence: a small change waits for CHARGE_JOURNAL_PERIOD_S
+    time = 0;
+    ChargeJournal_Update(charge - 1000, time + CHARGE_JOURNAL_PERIOD_S * 1000 - 1);
+    Check(ChargeJournal_GetWrites() == 0, "a small change should wait for the period");
+    ChargeJournal_Update(charge - 1000, time + CHARGE_JOURNAL_PERIOD_S * 1000);
+    Check(ChargeJournal_GetWrites() == 1, "a small change should be written after the period");
+    ChargeJournal_Update(charge - 1000, time + 3 * CHARGE_JOURNAL_PERIOD_S * 1000);
+    Check(ChargeJournal_GetWrites() == 1, "no change should not be written");
+    charge -= 1000;
+
+    // Final checkpoint on a supply drop
+    ChargeJournal_Update(charge - 5, time + CHARGE_JOURNAL_PERIOD_S * 1000 + 1);
+    BSP_PVD_SimulateDrop();
+    Check(ChargeJournal_GetWrites() == 1, "the supply drop interrupt should not write itself");
+    Check(ChargeJournal_WaitPowerFail(0), "the supply drop should wake the final checkpoint");
+    ChargeJournal_WriteFinal();
+    ChargeJournal_WriteFinal();
+    ChargeJournal_Update(charge - 10 * DELTA, time + 4 * CHARGE_JOURNAL_PERIOD_S * 1000);
+    Check(ChargeJournal_GetWrites() == 2, "nothing should be written after the supply dropped");
+    charge -= 5;
+    Check(Reset() == charge, "the supply drop checkpoint should come back");
+
+    // Resets at random points, some in the middle of a checkpoint
+    int torn = 0, clean = 0, drops = 0;
+    for(int i = 0; i < NUM_RESETS; i++) {
+        int64_t saved = charge;
+        int steps = rand() % 5;
+        for(int step = 0; step < steps; step++) {
+            charge -= DELTA + rand() % 1000;
+            time += 100;
+            ChargeJournal_Update(charge, time);
+            saved = charge;
+        }
+
+        int64_t recovered;
+        switch(rand() % 3) {
+            case 0:
+                // Power goes in the middle of the next checkpoint
+                BSP_I2C_SimulatePowerLoss(rand() % sizeof(JournalRecord));
+                charge -= DELTA;
+                ChargeJournal_Update(charge, time);
+                recovered = Reset();
+                Check(recovered == saved || recovered == charge, "a torn checkpoint should leave the one before it");
+                torn++;
+                break;
+            case 1:
+                // Supply drop with a change that was not written yet
+                charge -= DELTA / 2;
+                ChargeJournal_Update(charge, time);
+                BSP_PVD_SimulateDrop();
+                ChargeJournal_WaitPowerFail(0);
+                ChargeJournal_WriteFinal();
+                recovered = Reset();
+                Check(recovered == charge, "the supply drop checkpoint should come back");
+                drops++;
+                break;
+            default:
+                recovered = Reset();
+                Check(recovered == saved, "the last checkpoint should come back");
+                clean++;
+                break;
+        }
+        charge = recovered;
+    }
+    printf("%d resets: %d torn checkpoints, %d supply drops, %d plain resets\r\n", NUM_RESETS, torn, drops, clean);
+
+    // Sequence numbers wrapping around, the newest record sits in the middle of the slots
+    const uint32_t newestSlot = CHARGE_JOURNAL_SLOTS / 2 - 1;
+    for(uint32_t slot = 0; slot < CHARGE_JOURNAL_SLOTS; slot++) {
+        uint32_t age = (slot + CHARGE_JOURNAL_SLOTS - newestSlot - 1) % CHARGE_JOURNAL_SLOTS;  // 0 is the oldest
+        JournalRecord record = {age, UINT32_MAX - CHARGE_JOURNAL_SLOTS / 2 + age, 0};
+        record.crc = CRC(&record);
+        EEPROM_WriteMultipleBytes(EEPROM_CHARGE_JOURNAL_LOC + slot * sizeof(record), sizeof(record), (uint8_t *)&record);
+    }
+    Check(Reset() == CHARGE_JOURNAL_SLOTS - 1, "the newest record should win across the wrap");
+    JournalRecord bad = {-1, 0, 0};
+    EEPROM_WriteMultipleBytes(EEPROM_CHARGE_JOURNAL_LOC + newestSlot * sizeof(bad), sizeof(bad), (uint8_t *)&bad);
+    Check(Reset() == CHARGE_JOURNAL_SLOTS - 2, "a record with a bad CRC should be ignored");
+
+    TestCheck_Exit();
+}
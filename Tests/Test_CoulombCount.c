@@ -0,0 +1,150 @@
+#include "common.h"
+#include "config.h"
+#include "Current.h"
+#include "Charge.h"
+#include "EEPROM.h"
+#include "BSP_ADC.h"
+#include "BSP_UART.h"
+#include "simulator_conf.h"
+
+/**
+ * Simulator only test of the coulomb counter. Runs the hour long drive of scenario.py through
+ * the ADC at the full sample rate, as fast as the simulator goes, and compares the charge left
+ * against battery.py. The main loop is called at random intervals with stalls long enough to
+ * overflow the reading queue, the count must not care.
+ * Also prints how far the old way (newest reading times loop time) drifts on the same run.
+ */
+
+#define MAX_SECONDS         7200
+#define MAX_ERROR_MAH       (PACK_CAPACITY_MAH / 1000)  // 0.1% of the pack
+#define STALL_SAMPLES       (3 * ADC_SAMPLE_RATE_HZ)   // Longer than the reading queue holds
+
+static int32_t scenarioCurrent[MAX_SECONDS];    // mA
+static double scenarioCharge[MAX_SECONDS + 1];  // mAh at the end of each second
+
+/**
+ * Runs scenario.py and reads what it wrote
+ * @return seconds in the scenario
+ */
+static int LoadScenario(void) {
+    if(system("python3 BSP/Simulator/DataGeneration/scenario.py") != 0) {
+        printf("FAIL: scenario.py did not run\r\n");
+        exit(1);
+    }
+    FILE *fp = fopen(GET_CSV_PATH(SCENARIO_CSV_FILE), "r");
+    if(!fp) {
+        perror(SCENARIO_CSV_FILE);
+        exit(EXIT_FAILURE);
+    }
+    int32_t current, voltage;
+    int seconds = 0;
+    fscanf(fp, "%d,%lf,%d", &current, &scenarioCharge[0], &voltage);
+    while(seconds < MAX_SECONDS && fscanf(fp, "%d,%lf,%d", &scenarioCurrent[seconds], &scenarioCharge[seconds + 1], &voltage) == 3) {
+        seconds++;
+    }
+    fclose(fp);
+    return seconds;
+}
+
+/**
+ * ADC code of the low precision sensor for a current, the inverse of Current_Conversion
+ * without rounding
+ */
+static double LowCode(int32_t milliAmps) {
+    double milliVolts = (milliAmps / 25.0 + 4096) / 3;
+    return milliVolts * 4096 / 3300;
+}
+
+static double HighCode(int32_t milliAmps) {
+    double code = ((milliAmps / 12.5 + 4096) / 3) * 4096 / 3300;
+    return code > 4095 ? 4095 : code;
+}
+
+int main() {
+
+    BSP_UART_Init();    // Initialize printf
+    srand(37);
+
+    // BSP_ADC_Init wants ADC.csv to be there even though it is not read
+    FILE *fp = fopen(GET_CSV_PATH(ADC_CSV_FILE), "w");
+    if(!fp) {
+        perror(ADC_CSV_FILE);
+        exit(EXIT_FAILURE);
+    }
+    fprintf(fp, "2048,2048\r\n");
+    fclose(fp);
+
+    int seconds = LoadScenario();
+    printf("%d second drive, %dHz sampling, tolerance %dmAh\r\n", seconds, ADC_SAMPLE_RATE_HZ, MAX_ERROR_MAH);
+
+    EEPROM_Init();
+    Current_Init();
+    Charge_Init();
+    Charge_SetAccum(scenarioCharge[0] * 10000 / PACK_CAPACITY_MAH);
+    const double startCharge = scenarioCharge[0];  // Charge_GetPercent rounds to 0.01%
+
+    double oldCharge = startCharge;     // Integrated the way Charge_Calculate used to
+    uint32_t lastCall = 0;
+    uint32_t nextCall = 0;
+    uint32_t sampleNum = 0;
+    double dither[2] = {0, 0};
+    double maxError = 0;
+    int stalls = 0;
+
+    for(int second = 0; second < seconds; second++) {
+        double low = LowCode(scenarioCurrent[second]);
+        double high = HighCode(scenarioCurrent[second]);
+
+        for(int i = 0; i < ADC_SAMPLE_RATE_HZ; i++) {
+            // Sensor noise dithers the fraction of a code like on the real sensor
+            uint16_t lowCode = (uint16_t)(low + dither[0]);
+            uint16_t highCode = (uint16_t)(high + dither[1]);
+            dither[0] += low - lowCode;
+            dither[1] += high - highCode;
+            BSP_ADC_SimulateSamples(&highCode, &lowCode, 1);
+            sampleNum++;
+
+            // One pass of the main loop, anywhere from 1ms to a stall of seconds
+            if(sampleNum >= nextCall) {
+                Current_UpdateMeasurements();
+                Charge_Calculate();
+                oldCharge -= (double)Current_GetLowPrecReading() * (sampleNum - lastCall) / ADC_SAMPLE_RATE_HZ / 3600;
+                lastCall = sampleNum;
+
+                if(rand() % 200 == 0) {
+                    nextCall = sampleNum + STALL_SAMPLES + rand() % ADC_SAMPLE_RATE_HZ;
+                    stalls++;
+                } else {
+                    nextCall = sampleNum + 2 + rand() % 400;
+                }
+            }
+        }
+
+        // The counter may be read at any time, Charge_Calculate picks up from wherever it is
+        double counted = startCharge - (double)Current_GetChargeMoved() / 3600000;
+        double error = fabs(counted - scenarioCharge[second + 1]);
+        if(error > maxError) {
+            maxError = error;
+        }
+    }
+
+    Current_UpdateMeasurements();
+    Charge_Calculate();
+    // What the other tasks see, published by Charge_Calculate
+    double endCharge = startCharge - (double)Charge_GetChargeMoved() / 3600000;
+    double truth = scenarioCharge[seconds];
+    printf("%d stalls of over %ds\r\n", stalls, STALL_SAMPLES / ADC_SAMPLE_RATE_HZ);
+    printf("battery.py:      %8.1f mAh left\r\n", truth);
+    printf("coulomb counter: %8.1f mAh left, off by %.2f mAh at the end, %.2f mAh at worst\r\n",
+        endCharge, endCharge - truth, maxError);
+    double percentError = fabs(Charge_GetPercent() - truth * 10000 / PACK_CAPACITY_MAH);
+    printf("state of charge: %8.2f%%, battery.py %.2f%%\r\n", Charge_GetPercent() / 100.0, truth * 100 / PACK_CAPACITY_MAH);
+    printf("newest reading times loop time: %8.1f mAh left, off by %.1f mAh\r\n", oldCharge, oldCharge - truth);
+
+    if(maxError > MAX_ERROR_MAH || fabs(endCharge - truth) > MAX_ERROR_MAH || percentError > 2 + MAX_ERROR_MAH * 10000.0 / PACK_CAPACITY_MAH) {
+        printf("FAIL\r\n");
+        exit(1);
+    }
+    printf("PASS\r\n");
+    exit(0);
+}
@@ -0,0 +1,86 @@
+#include "common.h"
+#include "config.h"
+#include "Counters.h"
+#include "CANbus.h"
+#include "BSP_UART.h"
+#include "TestCheck.h"
+
+/**
+ * Checks the counters registry: counters and gauges keep their values, an export hands over
+ * every entry once and wraps around for the CAN dump, a reset clears everything and the CSV
+ * dump writes its header once. A CAN message that cannot be sent has to be counted.
+ */
+
+#define CSV_PATH    "Counters_Test.csv"
+
+static uint32_t seen[NUM_COUNTERS];
+static uint32_t emitted;
+
+static void Collect(CounterId id, const char *name, bool gauge, uint32_t value, void *context) {
+    seen[id] = value;
+    emitted++;
+    Check(name != NULL && name[0] != '\0', "every entry should have a name");
+    Check(gauge == (id >= GAUGE_IDLE_PERCENT), "gauges should be marked as gauges");
+}
+
+int main() {
+
+    BSP_UART_Init();    // Initialize printf
+
+    Counters_Reset();
+    COUNTER_INC(COUNTER_PEC_ERRORS);
+    COUNTER_INC(COUNTER_PEC_ERRORS);
+    COUNTER_ADD(COUNTER_UART_RX_DROPS, 5);
+    GAUGE_SET(GAUGE_IDLE_PERCENT, 80);
+    GAUGE_SET(GAUGE_IDLE_PERCENT, 75);
+
+    // The whole table
+    CounterId next = Counters_Export(0, NUM_COUNTERS, Collect, NULL);
+    Check(emitted == NUM_COUNTERS && next == 0, "an export of the whole table should hand over every entry");
+    Check(seen[COUNTER_PEC_ERRORS] == 2 && seen[COUNTER_UART_RX_DROPS] == 5, "counters should add up");
+    Check(seen[GAUGE_IDLE_PERCENT] == 75, "a gauge should hold the last value");
+
+    // One at a time like the CAN dump
+    emitted = 0;
+    next = NUM_COUNTERS - 1;
+    next = Counters_Export(next, 1, Collect, NULL);
+    Check(emitted == 1 && next == 0, "an export should wrap around the end of the table");
+
+    // A message with no way to send it
+    uint32_t before = Counters[COUNTER_CAN_TX_FAILURES];
+    CANPayload_t payload = {.idx = 0, .data.w = 0};
+    Check(CANbus_Send((CANId_t)0x7FF, payload) == 0, "an unknown message should not be sent");
+    Check(Counters[COUNTER_CAN_TX_FAILURES] == before + 1, "a message that was not sent should be counted");
+
+    // CSV with one header and a row per dump
+    remove(CSV_PATH);
+    Counters_DumpCSV(CSV_PATH, 1000);
+    Counters_DumpCSV(CSV_PATH, 2000);
+    FILE *file = fopen(CSV_PATH, "r");
+    Check(file != NULL, "the CSV file should be created");
+    if(file != NULL) {
+        char line[512];
+        int lines = 0;
+        bool header = false;
+        while(fgets(line, sizeof(line), file) != NULL) {
+            if(lines == 0) {
+                header = strncmp(line, "time,pec errors,", 16) == 0;
+            }
+            lines++;
+        }
+        fclose(file);
+        Check(header, "the first line should name the columns");
+        Check(lines == 3, "every dump should add one row");
+    }
+    remove(CSV_PATH);
+
+    Counters_Reset();
+    Counters_Export(0, NUM_COUNTERS, Collect, NULL);
+    bool cleared = true;
+    for(CounterId id = 0; id < NUM_COUNTERS; id++) {
+        cleared &= seen[id] == 0;
+    }
+    Check(cleared, "a reset should clear every entry");
+
+    TestCheck_Exit();
+}
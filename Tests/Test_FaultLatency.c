@@ -0,0 +1,332 @@
+#include <unistd.h>
+#include <sys/wait.h>
+#include "common.h"
+#include "config.h"
+#include "Current.h"
+#include "Voltage.h"
+#include "Temperature.h"
+#include "ThermalModel.h"
+#include "Scheduler.h"
+#include "Profiler.h"
+#include "BSP_ADC.h"
+#include "BSP_Contactor.h"
+#include "BSP_Timer.h"
+#include "BSP_UART.h"
+#include "BSP_PLL.h"
+#include "cmsis_os.h"
+#include "simulator_conf.h"
+#include "TestCheck.h"
+
+/**
+ * Simulator only measurement of the fault response: the time from the plant crossing a limit
+ * to BSP_Contactor_Off. Every trial boots the BPS in its own process, runs the safety and
+ * acquisition tasks of main.c on the scheduler and steps one fault into the plant data at a
+ * random point of the scans: overvoltage on one module, overcurrent or overtemperature on one
+ * module. Fails if the 99th percentile of a fault goes over its FAULT_LATENCY_*_BUDGET_MS.
+ * The analog watchdog opens the contactor in the interrupt of the first conversion past the
+ * limit. The simulator hands the conversions over a tick at a time in the thread feeding them,
+ * so it cannot time that path and the watchdog row only says what the budget assumes. The
+ * overcurrent trials open the watchdog up and time the polled path of Current_CheckStatus
+ * through the safety task instead.
+ * Run it with "make faultlatency".
+ */
+
+#define TRIALS              50          // Per fault
+#define SETTLE_MS           200         // Runs with a safe plant before the fault
+#define GIVE_UP_MS          (4 * TEMPERATURE_SCAN_PERIOD_MS)
+#define NOMINAL_CURRENT     20000       // Discharge before an overcurrent (mA)
+#define NOMINAL_TEMPERATURE 25000       // mC
+
+typedef enum {OVERVOLTAGE_FAULT = 0, OVERCURRENT_FAULT, OVERTEMPERATURE_FAULT, NUM_FAULTS} Fault;
+
+static const char *FaultNames[NUM_FAULTS] = {"overvoltage", "current polled", "overtemperature"};
+static const uint32_t Budgets[NUM_FAULTS] = {
+    FAULT_LATENCY_VOLTAGE_BUDGET_MS,
+    FAULT_LATENCY_POLLED_CURRENT_BUDGET_MS,
+    FAULT_LATENCY_TEMPERATURE_BUDGET_MS,
+};
+
+// How far apart the scans that see each fault are, the fault steps in anywhere within one
+static const uint32_t Phases[NUM_FAULTS] = {
+    SCHED_VOLTAGE_PERIOD_MS,
+    ADC_BLOCK_SIZE * 1000 / ADC_SAMPLE_RATE_HZ,
+    TEMPERATURE_SCAN_PERIOD_MS,
+};
+
+cell_asic minions[NUM_MINIONS];
+
+static Fault fault;
+static int32_t milliVolts[NUM_BATTERY_MODULES];
+static int32_t temperatures[NUM_BATTERY_MODULES];
+static volatile int32_t milliAmps;
+static volatile bool giveUp;
+static volatile bool stepped;
+static uint32_t stepCycles;
+
+osMutexDef(LtcMutex);
+osMutexDef(ScanMutex);
+static osMutexId LtcMutex;
+static osMutexId ScanMutex;
+
+static void WriteScan(void) {
+    FILE *fp = fopen(GET_CSV_PATH(SPI_CSV_FILE), "w");
+    if(!fp) {
+        perror(SPI_CSV_FILE);
+        exit(EXIT_FAILURE);
+    }
+    for(int module = 0; module < NUM_BATTERY_MODULES; module++) {
+        fprintf(fp, "1,%d,%d,%d\n", milliVolts[module] * 10, temperatures[module], temperatures[module]);
+    }
+    fclose(fp);
+}
+
+static uint16_t LowCode(int32_t mA) {
+    double code = ((mA / 25.0 + 4096) / 3) * 4096 / 3300;
+    return code > 4095 ? 4095 : (uint16_t)code;
+}
+
+static uint16_t HighCode(int32_t mA) {
+    double code = ((mA / 12.0 + 4096) / 3) * 4096 / 3300;     // 50 / 4 in Current_Conversion
+    return code > 4095 ? 4095 : (uint16_t)code;
+}
+
+/**
+ * Copy of the safety task of main.c, ends the run without a trip once the plant gives up
+ */
+static bool SafetyTask(void) {
+    Current_UpdateMeasurements();
+
+    osMutexWait(ScanMutex, osWaitForever);
+    SafetyStatus temp = Temperature_CheckStatus(Current_IsCharging());
+    SafetyStatus voltage = Voltage_CheckStatus();
+    osMutexRelease(ScanMutex);
+    SafetyStatus current = Current_CheckStatus(false);
+
+    if((current == SAFE) && (temp == SAFE) && (voltage == SAFE)) {
+        BSP_Contactor_On();
+    } else {
+        BSP_Contactor_Off();
+        return false;
+    }
+    return !giveUp;
+}
+
+/**
+ * Copy of the acquisition task of main.c without the isoSPI rate control
+ */
+static bool AcquisitionTask(void) {
+    static uint8_t slice;
+    osMutexWait(LtcMutex, osWaitForever);
+    if(slice % (SCHED_VOLTAGE_PERIOD_MS / SCHED_ACQUISITION_PERIOD_MS) == 0) {
+        Voltage_UpdateMeasurements();
+    }
+
+    if(slice < MAX_TEMP_SENSORS_PER_MINION_BOARD) {
+        Temperature_UpdateSingleChannel(slice);
+    } else if(slice == MAX_TEMP_SENSORS_PER_MINION_BOARD) {
+        osMutexWait(ScanMutex, osWaitForever);
+        Temperature_FinishScan();
+        ThermalModel_Update(Current_GetLowPrecReading());
+        osMutexRelease(ScanMutex);
+    }
+    osMutexRelease(LtcMutex);
+
+    slice = (slice + 1) % SCHED_TEMPERATURE_SLICES;
+    return true;
+}
+
+static const SchedulerTask Tasks[] = {
+    {"safety",      SafetyTask,         SCHED_SAFETY_PERIOD_MS,         0,  SCHED_SAFETY_PERIOD_MS},
+    {"acquisition", AcquisitionTask,    SCHED_ACQUISITION_PERIOD_MS,    1,  SCHED_ACQUISITION_PERIOD_MS},
+};
+
+/**
+ * Feeds the ADC in real time and steps the fault in after a random phase. Runs above the BPS
+ * tasks, the pack does not wait for them.
+ */
+static void PlantThread(void const *argument) {
+    uint32_t stepTick = BSP_Timer_GetTick() + SETTLE_MS + rand() % Phases[fault];
+    uint32_t tick = BSP_Timer_GetTick();
+
+    bool crossed = false;
+
+    while(BSP_Contactor_GetOpenings(NULL) == 0) {
+        osDelay(1);
+
+        // The ADC samples ADC_SAMPLE_RATE_HZ whatever the tasks are doing, the conversions
+        // of the ticks since the last pass go in now. An overcurrent step counts from the
+        // first conversion that carries it.
+        while(tick != BSP_Timer_GetTick()) {
+            uint16_t low[ADC_SAMPLE_RATE_HZ / 1000];
+            uint16_t high[ADC_SAMPLE_RATE_HZ / 1000];
+            for(int i = 0; i < ADC_SAMPLE_RATE_HZ / 1000; i++) {
+                low[i] = LowCode(milliAmps);
+                high[i] = HighCode(milliAmps);
+            }
+            if(stepped && !crossed) {
+                stepCycles = BSP_Timer_GetCycleCount();
+                crossed = true;
+            }
+            BSP_ADC_SimulateSamples(high, low, ADC_SAMPLE_RATE_HZ / 1000);
+            tick++;
+        }
+
+        if(!stepped && (int32_t)(BSP_Timer_GetTick() - stepTick) >= 0) {
+            stepCycles = BSP_Timer_GetCycleCount();
+            stepped = true;
+            crossed = fault != OVERCURRENT_FAULT;
+            int module = rand() % NUM_BATTERY_MODULES;
+            switch(fault) {
+                case OVERVOLTAGE_FAULT:
+                    milliVolts[module] = MAX_VOLTAGE_LIMIT * MILLI_SCALING_FACTOR + 20 + rand() % 180;
+                    WriteScan();
+                    break;
+                case OVERCURRENT_FAULT:
+                    milliAmps = MAX_CURRENT_LIMIT + 5000 + rand() % 50000;
+                    break;
+                case OVERTEMPERATURE_FAULT:
+                    temperatures[module] = MAX_DISCHARGE_TEMPERATURE_LIMIT * MILLI_SCALING_FACTOR + 1000 + rand() % 15000;
+                    WriteScan();
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        if(stepped && BSP_Timer_GetTick() - stepTick > GIVE_UP_MS) {
+            giveUp = true;
+            break;
+        }
+    }
+    osThreadTerminate(osThreadGetId());
+}
+osThreadDef(PlantThread, osPriorityRealtime, 1, 4096);
+
+/**
+ * Boots the BPS on a safe plant and steps one fault in
+ * @param openings where to store how many times the contactor was opened, 1 unless it was closed again
+ * @return microseconds until the contactor opened, UINT32_MAX if it never did or opened early
+ */
+static uint32_t RunTrial(uint32_t *openings) {
+    for(int module = 0; module < NUM_BATTERY_MODULES; module++) {
+        milliVolts[module] = 3600 + rand() % 200;
+        temperatures[module] = NOMINAL_TEMPERATURE + rand() % 5000;
+    }
+    milliAmps = NOMINAL_CURRENT;
+    WriteScan();
+
+    // Boot like main.c
+    osKernelInitialize();
+    LtcMutex = osMutexCreate(osMutex(LtcMutex));
+    ScanMutex = osMutexCreate(osMutex(ScanMutex));
+    BSP_Contactor_Init();
+    Current_Init();
+    if(fault == OVERCURRENT_FAULT) {
+        BSP_ADC_Watchdog_Init(0, 3300);     // Past every 12 bit code, leaves the polled path
+    }
+    Voltage_Init(minions);
+    Temperature_Init(minions);
+    ThermalModel_Init();
+    Voltage_UpdateMeasurements();
+    Temperature_UpdateAllMeasurements();
+    ThermalModel_Update(NOMINAL_CURRENT);
+
+    osKernelStart();
+    Scheduler_Init(Tasks, sizeof(Tasks) / sizeof(Tasks[0]));
+    Scheduler_Start();
+    osThreadCreate(osThread(PlantThread), NULL);
+    Scheduler_Run();
+
+    uint32_t openedAt;
+    *openings = BSP_Contactor_GetOpenings(&openedAt);
+    if(giveUp || !stepped || *openings == 0) {
+        return UINT32_MAX;
+    }
+    return Profiler_ToMicroseconds(openedAt - stepCycles);
+}
+
+static int CompareLatency(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Nearest rank percentile
+ * @param sorted latencies, lowest first
+ * @param percent 1 to 100
+ */
+static uint32_t Percentile(const uint32_t *sorted, uint32_t count, uint32_t percent) {
+    uint32_t rank = (count * percent + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+int main() {
+
+    BSP_UART_Init();    // Initialize printf
+    BSP_PLL_Init();     // The LTC6811 driver times its delays with the clock
+
+    // BSP_ADC_Init wants ADC.csv to be there even though it is not read
+    FILE *fp = fopen(GET_CSV_PATH(ADC_CSV_FILE), "w");
+    if(!fp) {
+        perror(ADC_CSV_FILE);
+        exit(EXIT_FAILURE);
+    }
+    fprintf(fp, "2048,2048\r\n");
+    fclose(fp);
+
+    printf("Fault latency over %d trials each (ms)\r\n", TRIALS);
+    printf("%-16s %8s %8s %8s %8s %8s\r\n", "fault", "min", "p50", "p99", "max", "budget");
+
+    // Only the target can time the watchdog interrupt, see above
+    printf("%-16s not measured, nominally one conversion (%.2f) %8u\r\n", "current awd",
+        1000.0 / ADC_SAMPLE_RATE_HZ, (unsigned)FAULT_LATENCY_CURRENT_BUDGET_MS);
+    for(fault = 0; fault < NUM_FAULTS; fault++) {
+        uint32_t latencies[TRIALS];
+        uint32_t reclosed = 0;
+        for(int trial = 0; trial < TRIALS; trial++) {
+            // A process per trial boots the BPS from scratch and starts its own threads
+            int result[2];
+            if(pipe(result) != 0) {
+                perror("pipe");
+                exit(EXIT_FAILURE);
+            }
+            fflush(stdout);
+            pid_t pid = fork();
+            if(pid == 0) {
+                close(result[0]);
+                srand(fault * TRIALS + trial + 1);
+                uint32_t trip[2];
+                trip[0] = RunTrial(&trip[1]);
+                write(result[1], trip, sizeof(trip));
+                exit(EXIT_SUCCESS);
+            }
+            close(result[1]);
+            uint32_t trip[2];
+            if(pid < 0 || read(result[0], trip, sizeof(trip)) != sizeof(trip)) {
+                trip[0] = UINT32_MAX;
+                trip[1] = 0;
+            }
+            latencies[trial] = trip[0];
+            reclosed += trip[1] > 1;
+            close(result[0]);
+            waitpid(pid, NULL, 0);
+        }
+
+        qsort(latencies, TRIALS, sizeof(latencies[0]), CompareLatency);
+        uint32_t p99 = Percentile(latencies, TRIALS, 99);
+        printf("%-16s %8.1f %8.1f %8.1f %8.1f %8u\r\n", FaultNames[fault],
+            latencies[0] / 1000.0, Percentile(latencies, TRIALS, 50) / 1000.0,
+            p99 / 1000.0, latencies[TRIALS - 1] / 1000.0, (unsigned)Budgets[fault]);
+
+        char msg[64];
+        snprintf(msg, sizeof(msg), "every %s should open the contactor", FaultNames[fault]);
+        Check(latencies[TRIALS - 1] != UINT32_MAX, msg);
+        snprintf(msg, sizeof(msg), "p99 %s latency should be within its budget", FaultNames[fault]);
+        Check(p99 <= Budgets[fault] * 1000, msg);
+        snprintf(msg, sizeof(msg), "the contactor should stay open after %u %s trips", (unsigned)reclosed, FaultNames[fault]);
+        Check(reclosed == 0, msg);
+    }
+
+    TestCheck_Exit();
+}
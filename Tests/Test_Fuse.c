@@ -0,0 +1,138 @@
+#include "common.h"
+#include "config.h"
+#include "Fuse.h"
+#include "BSP_ADC.h"
+#include "BSP_UART.h"
+#include "TestCheck.h"
+
+/**
+ * Checks the time-current protection against its fuse curves. Runs constant currents from
+ * cold and compares the trip time with the curve, checks that short peaks and currents at
+ * the rating do not trip, and that the counters cool down.
+ */
+
+#define READING_MS      ((ADC_BLOCK_SIZE * 1000.0) / ADC_SAMPLE_RATE_HZ)
+#define MAX_READINGS    (3600 * 1000 / (ADC_BLOCK_SIZE * 1000 / ADC_SAMPLE_RATE_HZ))    // An hour
+
+typedef struct {
+    int32_t current;
+    uint32_t time;
+} Point;
+
+static const Point DischargeCurve[] = FUSE_DISCHARGE_CURVE;
+static const Point ChargeCurve[] = FUSE_CHARGE_CURVE;
+
+/**
+ * Time to trip from cold straight from the curve, rates interpolated in I^2
+ * @return ms, 0 if the current never trips
+ */
+static double ExpectedTime(int32_t rating, const Point *curve, int numPoints, int32_t current) {
+    double currents[8] = {rating};
+    double rates[8] = {0};
+    for(int i = 0; i < numPoints; i++) {
+        currents[i + 1] = curve[i].current;
+        rates[i + 1] = 1.0 / curve[i].time;
+    }
+    if(current <= rating) {
+        return 0;
+    }
+    int k = 0;
+    while(k + 2 < numPoints + 1 && current >= currents[k + 1]) {
+        k++;
+    }
+    double sq = (double)current * current;
+    double rate = rates[k] + (rates[k + 1] - rates[k]) * (sq - currents[k] * currents[k])
+        / (currents[k + 1] * currents[k + 1] - currents[k] * currents[k]);
+    return 1.0 / rate;
+}
+
+/**
+ * Runs a constant current from cold until the trip
+ * @return ms to the trip, 0 if it did not trip within an hour
+ */
+static double RunUntilTrip(int32_t current) {
+    Fuse_Init();
+    for(int i = 1; i <= MAX_READINGS; i++) {
+        Fuse_Update(current);
+        if(Fuse_CheckStatus() != SAFE) {
+            return i * READING_MS;
+        }
+    }
+    return 0;
+}
+
+static void CheckCurve(const char *name, int32_t sign, int32_t rating, const Point *curve, int numPoints) {
+    printf("%s curve, rating %.1fA\r\n", name, rating / 1000.0);
+    Check(RunUntilTrip(sign * rating) == 0, "tripped at the rating");
+
+    for(int i = 0; i < numPoints; i++) {
+        // Every point, and halfway to the next one (or 10% past the last)
+        int32_t between = (i + 1 < numPoints) ? (curve[i].current + curve[i + 1].current) / 2 : curve[i].current * 11 / 10;
+        int32_t currents[2] = {curve[i].current, between};
+        for(int j = 0; j < 2; j++) {
+            double expected = ExpectedTime(rating, curve, numPoints, currents[j]);
+            double actual = RunUntilTrip(sign * currents[j]);
+            double error = actual - expected;
+            printf("\t%6.1fA: trip after %8.0fms, curve %8.0fms\r\n", currents[j] / 1000.0, actual, expected);
+
+            // Readings come in steps, and one more may be needed to fill the last bit
+            Check(actual > 0 && error >= -0.01 * expected && error <= 0.01 * expected + 2 * READING_MS,
+                "trip time off the curve");
+        }
+    }
+}
+
+int main() {
+
+    BSP_UART_Init();    // Initialize printf
+
+    printf("One reading every %.0fms\r\n", READING_MS);
+
+    CheckCurve("Discharge", 1, FUSE_DISCHARGE_RATING, DischargeCurve, sizeof(DischargeCurve) / sizeof(Point));
+    CheckCurve("Charge", -1, FUSE_CHARGE_RATING, ChargeCurve, sizeof(ChargeCurve) / sizeof(Point));
+
+    // The curves are separate, a charge current never fills the discharge curve
+    Fuse_Init();
+    for(int i = 0; i < MAX_READINGS / 10; i++) {
+        Fuse_Update(-(FUSE_CHARGE_RATING - 1000));
+    }
+    Check(Fuse_GetMargin(FUSE_DISCHARGE) == 100 && Fuse_GetMargin(FUSE_CHARGE) == 100, "current below the rating used up margin");
+
+    // A short peak uses some margin but does not trip
+    const Point *last = &DischargeCurve[sizeof(DischargeCurve) / sizeof(Point) - 1];
+    int peakReadings = (last->time / 2) / READING_MS;
+    for(int i = 0; i < peakReadings; i++) {
+        Fuse_Update(last->current);
+    }
+    uint8_t afterPeak = Fuse_GetMargin(FUSE_DISCHARGE);
+    printf("%.1fA for %.0fms: %d%% margin left\r\n", last->current / 1000.0, peakReadings * READING_MS, afterPeak);
+    Check(Fuse_CheckStatus() == SAFE, "short peak tripped");
+    Check(afterPeak >= 45 && afterPeak <= 55, "short peak should use about half the margin");
+
+    // Cool down at the rating, one time constant brings back 1 - 1/e of what was used
+    int tauReadings = (FUSE_COOL_TAU_S * 1000) / READING_MS;
+    for(int i = 0; i < tauReadings; i++) {
+        Fuse_Update(FUSE_DISCHARGE_RATING);
+    }
+    uint8_t cooled = Fuse_GetMargin(FUSE_DISCHARGE);
+    double expectedCooled = 100 - (100 - afterPeak) * exp(-1);
+    printf("After %ds at the rating: %d%% margin left, expected %.0f%%\r\n", FUSE_COOL_TAU_S, cooled, expectedCooled);
+    Check(fabs(cooled - expectedCooled) <= 3, "cool down off its time constant");
+
+    // A warm curve trips sooner than a cold one
+    int readings = 0;
+    while(Fuse_CheckStatus() == SAFE && readings < MAX_READINGS) {
+        Fuse_Update(last->current);
+        readings++;
+    }
+    printf("Second peak trips after %.0fms, cold it takes %dms\r\n", readings * READING_MS, last->time);
+    Check(readings * READING_MS < last->time, "warm curve should trip sooner");
+
+    // Trips stay
+    for(int i = 0; i < tauReadings; i++) {
+        Fuse_Update(0);
+    }
+    Check(Fuse_CheckStatus() == DANGER, "trip should stay latched");
+
+    TestCheck_Exit();
+}
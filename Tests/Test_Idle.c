@@ -0,0 +1,57 @@
+#include "common.h"
+#include "config.h"
+#include "BSP_Timer.h"
+#include "BSP_UART.h"
+#include "cmsis_os.h"
+#include "TestCheck.h"
+
+/**
+ * Checks the idle statistic: a thread that waits most of the time leaves the CPU idle, one that
+ * spins keeps it busy. Sleeping through ticks has to wait the ticks out.
+ */
+
+#define WINDOW_MS       300
+
+/**
+ * @brief   Measures the idle share over a window
+ * @param   busy true to spin through the window, false to wait in 10ms delays
+ * @return  idle percent
+ */
+static float IdlePercent(bool busy) {
+    uint64_t startTotal;
+    uint64_t startIdle = osKernelIdleTime(&startTotal);
+    uint32_t start = BSP_Timer_GetTick();
+    while(BSP_Timer_GetTick() - start < WINDOW_MS) {
+        if(!busy) {
+            osDelay(10);
+        }
+    }
+    uint64_t total;
+    uint64_t idle = osKernelIdleTime(&total);
+    return 100.0f * (idle - startIdle) / (total - startTotal);
+}
+
+int main() {
+
+    BSP_UART_Init();    // Initialize printf
+    osKernelInitialize();
+
+    uint64_t total = 1;
+    Check(osKernelIdleTime(&total) == 0 && total == 0, "nothing should be idle before the kernel starts");
+    osKernelStart();
+
+    float waiting = IdlePercent(false);
+    float spinning = IdlePercent(true);
+    printf("Idle waiting: %.1f%%, spinning: %.1f%%\r\n", waiting, spinning);
+    Check(waiting > 80, "a thread waiting on delays should leave the CPU idle");
+    Check(spinning < 20, "a spinning thread should keep the CPU busy");
+
+    uint64_t idle = osKernelIdleTime(&total);
+    Check(idle <= total && total >= 2 * WINDOW_MS * 1000ULL, "idle time should stay within the time since start");
+
+    uint32_t start = BSP_Timer_GetTick();
+    BSP_Timer_Sleep(20);
+    Check(BSP_Timer_GetTick() - start >= 20, "sleeping should wait the ticks out");
+
+    TestCheck_Exit();
+}
@@ -0,0 +1,195 @@
+#include "common.h"
+#include "config.h"
+#include "Current.h"
+#include "Charge.h"
+#include "ModuleCharge.h"
+#include "Voltage.h"
+#include "EEPROM.h"
+#include "BSP_ADC.h"
+#include "BSP_UART.h"
+#include "BSP_PLL.h"
+#include "simulator_conf.h"
+#include "TestCheck.h"
+
+/**
+ * Simulator only test of the per module state of charge. Runs "scenario.py modules", an hour
+ * long drive with a long stop every ten minutes on a pack whose modules differ by up to 12% in
+ * capacity and by 10% in state of charge. Checks the learned capacities, the state of charge
+ * of every module while driving and the lowest, highest and spread against battery.py.
+ */
+
+#define MAX_SECONDS         3600
+#define MODULES_CSV_FILE    "ScenarioModules.csv"
+#define LEARN_SECONDS       1800    // Time to learn the capacities before they are checked
+#define MAX_CAPACITY_ERROR  3       // %
+#define MAX_SOC_ERROR       150     // 0.01%
+
+static int32_t scenarioCurrent[MAX_SECONDS];                            // mA
+static int32_t scenarioVoltage[MAX_SECONDS + 1][NUM_BATTERY_MODULES];   // mV at the end of each second
+static int32_t scenarioSoc[MAX_SECONDS + 1][NUM_BATTERY_MODULES];       // 0.01% at the end of each second
+static double capacity[NUM_BATTERY_MODULES];                            // mAh
+
+cell_asic minions[NUM_MINIONS];
+
+/**
+ * Reads one row of module values
+ */
+static bool ReadRow(FILE *fp, int32_t *current, int32_t *voltages, int32_t *socs) {
+    if(fscanf(fp, "%d", current) != 1) {
+        return false;
+    }
+    for(int i = 0; i < NUM_BATTERY_MODULES; i++) {
+        fscanf(fp, ",%d", &voltages[i]);
+    }
+    for(int i = 0; i < NUM_BATTERY_MODULES; i++) {
+        fscanf(fp, ",%d", &socs[i]);
+    }
+    return true;
+}
+
+/**
+ * Runs scenario.py and reads what it wrote
+ * @return seconds in the scenario
+ */
+static int LoadScenario(void) {
+    if(system("python3 BSP/Simulator/DataGeneration/scenario.py modules") != 0) {
+        printf("FAIL: scenario.py did not run\r\n");
+        exit(1);
+    }
+    FILE *fp = fopen(GET_CSV_PATH(MODULES_CSV_FILE), "r");
+    if(!fp) {
+        perror(MODULES_CSV_FILE);
+        exit(EXIT_FAILURE);
+    }
+    for(int i = 0; i < NUM_BATTERY_MODULES; i++) {
+        fscanf(fp, i == 0 ? "%lf" : ",%lf", &capacity[i]);
+    }
+    int32_t current;
+    int seconds = 0;
+    ReadRow(fp, &current, scenarioVoltage[0], scenarioSoc[0]);
+    while(seconds < MAX_SECONDS && ReadRow(fp, &scenarioCurrent[seconds], scenarioVoltage[seconds + 1], scenarioSoc[seconds + 1])) {
+        seconds++;
+    }
+    fclose(fp);
+    return seconds;
+}
+
+static void WriteScan(int32_t *milliVolts) {
+    FILE *fp = fopen(GET_CSV_PATH(SPI_CSV_FILE), "w");
+    if(!fp) {
+        perror(SPI_CSV_FILE);
+        exit(EXIT_FAILURE);
+    }
+    for(int module = 0; module < NUM_BATTERY_MODULES; module++) {
+        fprintf(fp, "1,%d,25000,25000\n", milliVolts[module] * 10 + rand() % 25 - 12);
+    }
+    fclose(fp);
+}
+
+static double LowCode(int32_t milliAmps) {
+    double milliVolts = (milliAmps / 25.0 + 4096) / 3;
+    return milliVolts * 4096 / 3300;
+}
+
+static double HighCode(int32_t milliAmps) {
+    double code = ((milliAmps / 12.5 + 4096) / 3) * 4096 / 3300;
+    return code > 4095 ? 4095 : code;
+}
+
+int main() {
+
+    BSP_UART_Init();    // Initialize printf
+    BSP_PLL_Init();     // The LTC6811 driver times its delays with the clock
+    srand(40);
+
+    // BSP_ADC_Init wants ADC.csv to be there even though it is not read
+    FILE *fp = fopen(GET_CSV_PATH(ADC_CSV_FILE), "w");
+    if(!fp) {
+        perror(ADC_CSV_FILE);
+        exit(EXIT_FAILURE);
+    }
+    fprintf(fp, "2048,2048\r\n");
+    fclose(fp);
+
+    int seconds = LoadScenario();
+
+    WriteScan(scenarioVoltage[0]);
+    Voltage_Init(minions);
+    Voltage_UpdateMeasurements();
+    EEPROM_Init();
+    Current_Init();
+    Charge_Init();
+    Charge_SetAccum(8700);
+    ModuleCharge_Init();
+
+    uint32_t nextCall = 0;
+    uint32_t sampleNum = 0;
+    double dither[2] = {0, 0};
+    int32_t worstSoc = 0;
+    int32_t worstSpread = 0;
+    int wrongLowest = 0;
+
+    for(int second = 0; second < seconds; second++) {
+        double low = LowCode(scenarioCurrent[second]);
+        double high = HighCode(scenarioCurrent[second]);
+
+        for(int i = 0; i < ADC_SAMPLE_RATE_HZ; i++) {
+            uint16_t lowCode = (uint16_t)(low + dither[0]);
+            uint16_t highCode = (uint16_t)(high + dither[1]);
+            dither[0] += low - lowCode;
+            dither[1] += high - highCode;
+            BSP_ADC_SimulateSamples(&highCode, &lowCode, 1);
+            sampleNum++;
+
+            if(sampleNum >= nextCall) {
+                Current_UpdateMeasurements();
+                Charge_Calculate();
+                ModuleCharge_Update();
+                nextCall = sampleNum + 40 + rand() % 400;
+            }
+        }
+
+        WriteScan(scenarioVoltage[second + 1]);
+        Voltage_UpdateMeasurements();
+
+        if(second < LEARN_SECONDS) {
+            continue;
+        }
+        int32_t *truth = scenarioSoc[second + 1];
+        int lowest = 0, highest = 0;
+        for(int i = 0; i < NUM_BATTERY_MODULES; i++) {
+            int32_t error = abs((int32_t)ModuleCharge_GetPercent(i) - truth[i]);
+            worstSoc = error > worstSoc ? error : worstSoc;
+            lowest = truth[i] < truth[lowest] ? i : lowest;
+            highest = truth[i] > truth[highest] ? i : highest;
+        }
+        int32_t spreadError = abs((int32_t)ModuleCharge_GetSpread() - (truth[highest] - truth[lowest]));
+        worstSpread = spreadError > worstSpread ? spreadError : worstSpread;
+        // Modules within the allowed error of each other may swap places
+        if(truth[ModuleCharge_GetLowest()] - truth[lowest] > MAX_SOC_ERROR) {
+            wrongLowest++;
+        }
+    }
+
+    double worstCapacity = 0;
+    double nominalError = 0;
+    for(int i = 0; i < NUM_BATTERY_MODULES; i++) {
+        double error = fabs(ModuleCharge_GetCapacity(i) - capacity[i]) * 100 / capacity[i];
+        worstCapacity = error > worstCapacity ? error : worstCapacity;
+        error = fabs(PACK_CAPACITY_MAH - capacity[i]) * 100 / capacity[i];
+        nominalError = error > nominalError ? error : nominalError;
+    }
+    int32_t *truth = scenarioSoc[seconds];
+    int lowest = ModuleCharge_GetLowest();
+    printf("Capacity: worst module %.1f%% off, %.1f%% with the nominal capacity\r\n", worstCapacity, nominalError);
+    printf("After %ds: state of charge worst %.2f%% off, spread worst %.2f%% off\r\n", LEARN_SECONDS, worstSoc / 100.0, worstSpread / 100.0);
+    printf("End: lowest module %d at %.2f%% (battery.py %.2f%%), spread %.2f%%\r\n",
+        lowest, ModuleCharge_GetPercent(lowest) / 100.0, truth[lowest] / 100.0, ModuleCharge_GetSpread() / 100.0);
+
+    Check(worstCapacity < MAX_CAPACITY_ERROR, "capacities should be learned");
+    Check(worstSoc < MAX_SOC_ERROR, "every module should follow battery.py");
+    Check(worstSpread < MAX_SOC_ERROR, "the spread should follow battery.py");
+    Check(wrongLowest == 0, "the lowest module should be found");
+
+    TestCheck_Exit();
+}
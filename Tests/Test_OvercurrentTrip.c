@@ -0,0 +1,127 @@
+#include "common.h"
+#include "config.h"
+#include "Current.h"
+#include "BSP_ADC.h"
+#include "BSP_Contactor.h"
+#include "BSP_UART.h"
+#include "simulator_conf.h"
+#include "TestCheck.h"
+
+/**
+ * Simulator only test of the analog watchdog overcurrent trip. Feeds the ADC a short circuit
+ * in the middle of a main loop pass and compares how long the watchdog takes to open the
+ * contactor with how long Current_CheckStatus takes to see it at the end of the pass.
+ */
+
+#define LOOP_PERIOD_MS      100     // One pass of the main loop, LTC scan and temperatures included
+#define LOOP_SAMPLES        (LOOP_PERIOD_MS * ADC_SAMPLE_RATE_HZ / 1000)
+#define FAULT_PASS          3       // Pass the short circuit happens in
+#define FAULT_OFFSET        37      // Samples into that pass
+
+/**
+ * ADC code the low precision sensor gives for a current, the inverse of Current_Conversion
+ */
+static uint16_t LowCode(int32_t milliAmps) {
+    double milliVolts = (milliAmps / 25.0 + 4096) / 3;
+    if(milliVolts > 3300) {
+        milliVolts = 3300;  // Past the ADC reference
+    }
+    return (uint16_t)(fmin(milliVolts * 4096 / 3300 + 0.5, 4095));
+}
+
+static uint16_t HighCode(int32_t milliAmps) {
+    double milliVolts = (milliAmps / 12.0 + 4096) / 3;
+    if(milliVolts > 3300) {
+        milliVolts = 3300;  // The high precision sensor saturates
+    }
+    return (uint16_t)(fmin(milliVolts * 4096 / 3300 + 0.5, 4095));
+}
+
+/**
+ * Feeds one main loop pass of samples, switching to faultAmps at sample faultAt
+ */
+static void FeedPass(int32_t milliAmps, int32_t faultAmps, int faultAt) {
+    uint16_t high[LOOP_SAMPLES];
+    uint16_t low[LOOP_SAMPLES];
+    for(int i = 0; i < LOOP_SAMPLES; i++) {
+        int32_t amps = (faultAt >= 0 && i >= faultAt) ? faultAmps : milliAmps;
+        high[i] = HighCode(amps);
+        low[i] = LowCode(amps);
+    }
+    BSP_ADC_SimulateSamples(high, low, LOOP_SAMPLES);
+}
+
+/**
+ * Runs the main loop with a current step from milliAmps to faultAmps
+ * @return true if the watchdog tripped
+ */
+static bool RunStep(int32_t milliAmps, int32_t faultAmps) {
+    Current_Init();
+    BSP_Contactor_On();
+
+    uint32_t faultSample = FAULT_PASS * LOOP_SAMPLES + FAULT_OFFSET + 1;
+    int32_t pollSample = -1;
+    for(int pass = 0; pass < FAULT_PASS + 3; pass++) {
+        FeedPass(milliAmps, faultAmps, pass == FAULT_PASS ? FAULT_OFFSET : (pass > FAULT_PASS ? 0 : -1));
+
+        // What the main loop sees at the end of the pass, without the watchdog latch
+        Current_UpdateMeasurements();
+        int32_t reading = Current_GetLowPrecReading();
+        if(pollSample < 0 && (reading <= MAX_CHARGING_CURRENT || reading >= MAX_CURRENT_LIMIT)) {
+            pollSample = (pass + 1) * LOOP_SAMPLES;
+        }
+    }
+
+    uint32_t tripSample = 0;
+    bool tripped = BSP_ADC_Watchdog_Tripped(&tripSample);
+    printf("%7.1fA -> %7.1fA: ", milliAmps / 1000.0, faultAmps / 1000.0);
+    if(tripped) {
+        printf("watchdog %5dus", (int)((tripSample - faultSample + 1) * 1000000 / ADC_SAMPLE_RATE_HZ));
+    } else {
+        printf("watchdog    --  ");
+    }
+    if(pollSample >= 0) {
+        printf(", polling %6dus\r\n", (int)((pollSample - faultSample + 1) * 1000000 / ADC_SAMPLE_RATE_HZ));
+    } else {
+        printf(", polling    --\r\n");
+    }
+
+    if(tripped) {
+        Check(tripSample == faultSample, "watchdog should trip on the first conversion past the limit");
+        Check(!BSP_Contactor_GetState(), "watchdog should open the contactor");
+        Check(Current_CheckStatus(false) == DANGER, "trip should stay latched");
+        Check(pollSample < 0 || (uint32_t)pollSample > tripSample, "watchdog should beat polling");
+    } else {
+        Check(BSP_Contactor_GetState(), "contactor should stay closed");
+    }
+    return tripped;
+}
+
+int main() {
+
+    BSP_UART_Init();    // Initialize printf
+
+    // BSP_ADC_Init wants ADC.csv to be there even though it is not read
+    FILE *fp = fopen(GET_CSV_PATH(ADC_CSV_FILE), "w");
+    if(!fp) {
+        perror(ADC_CSV_FILE);
+        exit(EXIT_FAILURE);
+    }
+    fprintf(fp, "2048,2048\r\n");
+    fclose(fp);
+    BSP_Contactor_Init();
+
+    printf("%dHz sampling, %dms main loop, fault %d samples into pass %d\r\n",
+        ADC_SAMPLE_RATE_HZ, LOOP_PERIOD_MS, FAULT_OFFSET, FAULT_PASS);
+
+    // Inside the limits, no trip
+    Check(!RunStep(20000, MAX_CURRENT_LIMIT - 500), "tripped just under the discharge limit");
+    Check(!RunStep(0, MAX_CHARGING_CURRENT + 500), "tripped just under the charging limit");
+
+    // Past the limits
+    Check(RunStep(20000, MAX_CURRENT_LIMIT + 1000), "no trip just over the discharge limit");
+    Check(RunStep(0, MAX_CHARGING_CURRENT - 1000), "no trip just over the charging limit");
+    Check(RunStep(20000, 250000), "no trip on a short circuit");
+
+    TestCheck_Exit();
+}
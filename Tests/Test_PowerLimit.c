@@ -0,0 +1,248 @@
+#include <unistd.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include "common.h"
+#include "config.h"
+#include "Current.h"
+#include "Charge.h"
+#include "ModuleCharge.h"
+#include "PowerLimit.h"
+#include "Fuse.h"
+#include "Voltage.h"
+#include "Temperature.h"
+#include "EEPROM.h"
+#include "BSP_ADC.h"
+#include "BSP_UART.h"
+#include "BSP_PLL.h"
+#include "BSP_Timer.h"
+#include "simulator_conf.h"
+#include "TestCheck.h"
+
+/**
+ * Simulator only test of the state of power. Drives "scenario.py plant", a hot and nearly full
+ * pack with mismatched modules, in closed loop: every second battery.py gives the current the
+ * driver wants with the module voltages and temperatures, and gets back the current that flowed.
+ * The drive runs once with the driver getting whatever they ask for and once with the current
+ * held to the limits. Counts the trips of both, a trip costs a minute of standing still.
+ */
+
+#define RESTART_SECONDS     60
+#define BLOCK_SAMPLES       (ADC_SAMPLE_RATE_HZ / 10)   // Main loop passes of 100ms
+#define AUX_CURRENT         300     // Electrical system, drawn past the motor controller (mA)
+
+cell_asic minions[NUM_MINIONS];
+
+typedef struct {
+    int overCurrent;
+    int overVoltage;
+    int underVoltage;
+    int overTemperature;
+    double delivered;       // Ah
+    uint64_t cost;          // ns spent in PowerLimit_Update
+    uint32_t updates;
+} DriveResult;
+
+/**
+ * Starts scenario.py with pipes both ways
+ * @param toPlant gets the stream the currents go to
+ * @return stream the rows of the plant come from
+ */
+static FILE *StartPlant(FILE **toPlant, pid_t *pid) {
+    int down[2], up[2];
+    if(pipe(down) != 0 || pipe(up) != 0) {
+        perror("pipe");
+        exit(EXIT_FAILURE);
+    }
+    *pid = fork();
+    if(*pid == 0) {
+        dup2(down[0], STDIN_FILENO);
+        dup2(up[1], STDOUT_FILENO);
+        close(down[1]);
+        close(up[0]);
+        execlp("python3", "python3", "BSP/Simulator/DataGeneration/scenario.py", "plant", (char *)NULL);
+        perror("python3");
+        exit(EXIT_FAILURE);
+    }
+    close(down[0]);
+    close(up[1]);
+    *toPlant = fdopen(down[1], "w");
+    return fdopen(up[0], "r");
+}
+
+static bool ReadPlant(FILE *fp, int32_t *demand, int32_t *voltages, int32_t *temperatures) {
+    if(fscanf(fp, "%d", demand) != 1) {
+        return false;
+    }
+    for(int i = 0; i < NUM_BATTERY_MODULES; i++) {
+        fscanf(fp, ",%d", &voltages[i]);
+    }
+    for(int i = 0; i < NUM_BATTERY_MODULES; i++) {
+        fscanf(fp, ",%d", &temperatures[i]);
+    }
+    return true;
+}
+
+static void WriteScan(int32_t *milliVolts, int32_t *temperatures) {
+    FILE *fp = fopen(GET_CSV_PATH(SPI_CSV_FILE), "w");
+    if(!fp) {
+        perror(SPI_CSV_FILE);
+        exit(EXIT_FAILURE);
+    }
+    for(int module = 0; module < NUM_BATTERY_MODULES; module++) {
+        fprintf(fp, "1,%d,%d,%d\n", milliVolts[module] * 10 + rand() % 25 - 12,
+            temperatures[module] + rand() % 101 - 50, temperatures[module] + rand() % 101 - 50);
+    }
+    fclose(fp);
+}
+
+static double LowCode(int32_t milliAmps) {
+    double milliVolts = (milliAmps / 25.0 + 4096) / 3;
+    return milliVolts * 4096 / 3300;
+}
+
+static double HighCode(int32_t milliAmps) {
+    double code = ((milliAmps / 12.5 + 4096) / 3) * 4096 / 3300;
+    return code > 4095 ? 4095 : code;
+}
+
+/**
+ * Drives the whole scenario
+ * @param limited true to hold the current to the limits
+ */
+static DriveResult Drive(bool limited) {
+    DriveResult result = {0};
+    int32_t demand;
+    int32_t voltages[NUM_BATTERY_MODULES];
+    int32_t temperatures[NUM_BATTERY_MODULES];
+    FILE *toPlant;
+    pid_t pid;
+    FILE *fromPlant = StartPlant(&toPlant, &pid);
+
+    if(!ReadPlant(fromPlant, &demand, voltages, temperatures)) {
+        printf("FAIL: scenario.py did not run\r\n");
+        exit(1);
+    }
+    WriteScan(voltages, temperatures);
+    Voltage_Init(minions);
+    Temperature_Init(minions);
+    Voltage_UpdateMeasurements();
+    for(int i = 0; i < TEMP_SLOPE_WINDOW; i++) {
+        Temperature_UpdateAllMeasurements();
+    }
+    EEPROM_Init();
+    Current_Init();
+    Charge_Init();
+    Charge_SetAccum(7800);
+    ModuleCharge_Init();
+    PowerLimit_Init();
+
+    double dither[2] = {0, 0};
+    int restart = 0;
+    bool tripped = false;
+
+    do {
+        int32_t milliAmps = restart > 0 ? 0 : demand;
+        if(limited && milliAmps > PowerLimit_GetDischarge()) {
+            milliAmps = PowerLimit_GetDischarge();
+        }
+        if(limited && milliAmps < -PowerLimit_GetCharge()) {
+            milliAmps = -PowerLimit_GetCharge();
+        }
+        milliAmps += AUX_CURRENT;
+        if(milliAmps > 0) {
+            result.delivered += milliAmps / 3600000.0;
+        }
+
+        double low = LowCode(milliAmps);
+        double high = HighCode(milliAmps);
+        for(int block = 0; block < ADC_SAMPLE_RATE_HZ / BLOCK_SAMPLES; block++) {
+            uint16_t lowCodes[BLOCK_SAMPLES], highCodes[BLOCK_SAMPLES];
+            for(int i = 0; i < BLOCK_SAMPLES; i++) {
+                lowCodes[i] = (uint16_t)(low + dither[0]);
+                highCodes[i] = (uint16_t)(high + dither[1]);
+                dither[0] += low - lowCodes[i];
+                dither[1] += high - highCodes[i];
+            }
+            BSP_ADC_SimulateSamples(highCodes, lowCodes, BLOCK_SAMPLES);
+            Current_UpdateMeasurements();
+            Charge_Calculate();
+            ModuleCharge_Update();
+
+            uint32_t start = BSP_Timer_GetCycleCount();
+            PowerLimit_Update();
+            result.cost += BSP_Timer_GetCycleCount() - start;
+            result.updates++;
+        }
+
+        fprintf(toPlant, "%d\n", milliAmps);
+        fflush(toPlant);
+        if(!ReadPlant(fromPlant, &demand, voltages, temperatures)) {
+            break;
+        }
+        WriteScan(voltages, temperatures);
+        Voltage_UpdateMeasurements();
+        Temperature_UpdateAllMeasurements();
+
+        // Check like main.c does, a trip opens the contactor until the driver restarts
+        SafetyStatus current = Current_CheckStatus(false);
+        SafetyStatus voltage = Voltage_CheckStatus();
+        SafetyStatus temperature = Temperature_CheckStatus(Current_IsCharging());
+        if(restart > 0) {
+            restart--;
+            if(restart == 0) {
+                Fuse_Init();
+                tripped = false;
+            }
+        }
+        else if(!tripped && (current != SAFE || voltage != SAFE || temperature != SAFE)) {
+            result.overCurrent += current != SAFE;
+            result.overVoltage += voltage == OVERVOLTAGE;
+            result.underVoltage += voltage == UNDERVOLTAGE;
+            result.overTemperature += temperature != SAFE;
+            tripped = true;
+            restart = RESTART_SECONDS;
+        }
+    } while(true);
+
+    fclose(toPlant);
+    fclose(fromPlant);
+    waitpid(pid, NULL, 0);
+    return result;
+}
+
+static int Trips(DriveResult r) {
+    return r.overCurrent + r.overVoltage + r.underVoltage + r.overTemperature;
+}
+
+static void Print(const char *name, DriveResult r) {
+    printf("%-8s %2d trips (%d current, %d overvoltage, %d undervoltage, %d temperature), %.1fAh delivered\r\n",
+        name, Trips(r), r.overCurrent, r.overVoltage, r.underVoltage, r.overTemperature, r.delivered);
+}
+
+int main() {
+
+    BSP_UART_Init();    // Initialize printf
+    BSP_PLL_Init();     // The LTC6811 driver times its delays with the clock
+    srand(41);
+    signal(SIGPIPE, SIG_IGN);   // scenario.py stops on its own at the end of the drive
+
+    // BSP_ADC_Init wants ADC.csv to be there even though it is not read
+    FILE *fp = fopen(GET_CSV_PATH(ADC_CSV_FILE), "w");
+    if(!fp) {
+        perror(ADC_CSV_FILE);
+        exit(EXIT_FAILURE);
+    }
+    fprintf(fp, "2048,2048\r\n");
+    fclose(fp);
+
+    DriveResult raw = Drive(false);
+    DriveResult limited = Drive(true);
+    Print("Raw:", raw);
+    Print("Limited:", limited);
+    printf("Update: %dns on average\r\n", (uint32_t)(limited.cost / limited.updates));
+
+    Check(Trips(raw) > 0, "the scenario should trip without limits");
+    Check(Trips(limited) == 0, "the limits should keep the pack from tripping");
+
+    TestCheck_Exit();
+}
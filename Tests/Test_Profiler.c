@@ -0,0 +1,65 @@
+#include "common.h"
+#include "config.h"
+#include "Profiler.h"
+#include "BSP_Timer.h"
+#include "BSP_UART.h"
+#include "TestCheck.h"
+
+/**
+ * Feeds the profiler known run times and checks the min, max, mean, histogram and percentiles
+ * it keeps. Then times a million empty PROFILE_BEGIN/PROFILE_END pairs to see what a probe costs.
+ */
+
+#define COST_RUNS       1000000
+
+int main() {
+
+    BSP_UART_Init();    // Initialize printf
+
+#if PROFILER_ENABLED
+    const uint32_t first = 1UL << PROFILER_BUCKET_SHIFT;    // Upper end of the first bucket
+
+    // 90 short runs in the first bucket, 9 in the second and one very long one
+    for(uint32_t i = 0; i < 90; i++) {
+        Profiler_Record(PROBE_VOLTAGE, 100 + i);
+    }
+    for(uint32_t i = 0; i < 9; i++) {
+        Profiler_Record(PROBE_VOLTAGE, first + 10 * i);
+    }
+    Profiler_Record(PROBE_VOLTAGE, UINT32_MAX);
+
+    const ProfilerStats *stats = Profiler_GetStats(PROBE_VOLTAGE);
+    Check(stats != NULL && stats->count == 100, "every run should be counted");
+    Check(stats->min == 100 && stats->max == UINT32_MAX, "min and max should be the shortest and longest run");
+    uint64_t sum = 0;
+    for(uint32_t i = 0; i < 90; i++) sum += 100 + i;
+    for(uint32_t i = 0; i < 9; i++) sum += first + 10 * i;
+    sum += UINT32_MAX;
+    Check(stats->sum == sum, "the sum should not overflow");
+    Check(stats->buckets[0] == 90 && stats->buckets[1] == 9 && stats->buckets[PROFILER_BUCKETS - 1] == 1,
+        "runs should land in the bucket of their power of two");
+    Check(Profiler_GetPercentile(PROBE_VOLTAGE, 50) == first, "half the runs should fit in the first bucket");
+    Check(Profiler_GetPercentile(PROBE_VOLTAGE, 99) == 2 * first, "99% of the runs should fit in the second bucket");
+    Check(Profiler_GetPercentile(PROBE_VOLTAGE, 100) == UINT32_MAX, "the longest run is in the last bucket");
+    Check(Profiler_GetPercentile(PROBE_CLI, 99) == 0, "a probe without runs has no percentile");
+
+    Profiler_Reset();
+    Check(Profiler_GetStats(PROBE_VOLTAGE)->count == 0, "a reset should forget every run");
+
+    // What a probe adds to the stage it measures
+    uint32_t start = BSP_Timer_GetCycleCount();
+    for(uint32_t i = 0; i < COST_RUNS; i++) {
+        PROFILE_BEGIN(PROBE_CHECKS);
+        PROFILE_END(PROBE_CHECKS);
+    }
+    uint32_t cost = (BSP_Timer_GetCycleCount() - start) / COST_RUNS;
+    printf("Probe cost: %lu cycles (ns on the simulator), empty stage %lu\r\n",
+        (unsigned long)cost, (unsigned long)Profiler_GetStats(PROBE_CHECKS)->min);
+    Check(Profiler_GetStats(PROBE_CHECKS)->count == COST_RUNS, "every probe should be recorded");
+    Check(cost < 1000, "a probe should cost well under a microsecond");
+#else
+    Check(Profiler_GetStats(PROBE_VOLTAGE) == NULL, "a compiled out profiler has no stats");
+#endif
+
+    TestCheck_Exit();
+}
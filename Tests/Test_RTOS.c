@@ -0,0 +1,124 @@
+#include "common.h"
+#include "config.h"
+#include "Scheduler.h"
+#include "BSP_Timer.h"
+#include "BSP_UART.h"
+#include "cmsis_os.h"
+#include "TestCheck.h"
+
+/**
+ * Checks the CMSIS-RTOS calls the BPS uses: queue order, full and empty queues, timeouts,
+ * recursive mutexes and a higher priority thread getting the CPU. Then measures the worst case
+ * fault response on the scheduler: a fault shows up at a random time and the safety task has
+ * to see it within its period, while a low priority task hogs the CPU like a long LTC6811 scan.
+ * Runs the same on the target and in the simulator.
+ */
+
+#define NUM_FAULTS      100
+#define INJECT_PERIOD   7           // Out of step with the safety task
+#define HOG_MS          50
+#define LATENCY_BUDGET  (SCHED_SAFETY_PERIOD_MS + 2)
+
+static volatile bool faultPending;
+static volatile uint32_t faultTick;
+static uint32_t faults;
+static uint32_t worstLatency;
+static uint32_t latencySum;
+static volatile bool highRan;
+
+osMessageQDef(TestQueue, 4, uint32_t);
+osMutexDef(TestMutex);
+
+static void Busy(uint32_t ms) {
+    uint32_t start = BSP_Timer_GetTick();
+    while(BSP_Timer_GetTick() - start < ms);
+}
+
+static void HighThread(void const *argument) {
+    osMutexId mutex = (osMutexId)argument;
+    Check(osMutexWait(mutex, 0) == osErrorResource, "a mutex someone else holds should not be taken");
+    Check(osMutexWait(mutex, 5) == osErrorTimeoutResource, "waiting for a held mutex should time out");
+    highRan = true;
+}
+osThreadDef(HighThread, osPriorityHigh, 1, 1024);
+
+static bool SafetyTask(void) {
+    if(faultPending) {
+        uint32_t latency = BSP_Timer_GetTick() - faultTick;
+        worstLatency = latency > worstLatency ? latency : worstLatency;
+        latencySum += latency;
+        faults++;
+        faultPending = false;
+    }
+    return faults < NUM_FAULTS;
+}
+
+static bool InjectTask(void) {
+    static uint32_t random = 12345;
+    random = random * 1103515245 + 12345;
+    if(!faultPending && (random >> 16) % 3 == 0) {
+        faultTick = BSP_Timer_GetTick();
+        faultPending = true;
+    }
+    return true;
+}
+
+static bool HogTask(void) {
+    Busy(HOG_MS);
+    return true;
+}
+
+static const SchedulerTask Tasks[] = {
+    {"safety",  SafetyTask, SCHED_SAFETY_PERIOD_MS, 0,  SCHED_SAFETY_PERIOD_MS},
+    {"inject",  InjectTask, INJECT_PERIOD,          3,  INJECT_PERIOD},
+    {"hog",     HogTask,    2 * HOG_MS,             1,  2 * HOG_MS},
+};
+
+int main() {
+
+    BSP_UART_Init();    // Initialize printf
+    osKernelInitialize();
+    osKernelStart();
+    Check(osKernelRunning(), "the kernel should be running");
+
+    // Queues hand messages over in order and do not wait when told not to
+    osMessageQId queue = osMessageCreate(osMessageQ(TestQueue), NULL);
+    Check(queue != NULL, "the queue should be created");
+    for(uint32_t i = 0; i < 4; i++) {
+        Check(osMessagePut(queue, i + 100, 0) == osOK, "a queue with room should take a message");
+    }
+    Check(osMessagePut(queue, 0, 0) == osErrorResource, "a full queue should turn a message away");
+    for(uint32_t i = 0; i < 4; i++) {
+        osEvent event = osMessageGet(queue, 0);
+        Check(event.status == osEventMessage && event.value.v == i + 100, "messages should come out in order");
+    }
+    Check(osMessageGet(queue, 0).status == osOK, "an empty queue should not wait without a timeout");
+    uint32_t start = BSP_Timer_GetTick();
+    Check(osMessageGet(queue, 20).status == osEventTimeout, "an empty queue should time out");
+    uint32_t waited = BSP_Timer_GetTick() - start;
+    Check(waited >= 19 && waited <= 25, "the queue should wait about as long as asked");
+
+    // Mutexes are recursive and keep other threads out
+    osMutexId mutex = osMutexCreate(osMutex(TestMutex));
+    Check(mutex != NULL, "the mutex should be created");
+    Check(osMutexWait(mutex, osWaitForever) == osOK, "a free mutex should be taken");
+    Check(osMutexWait(mutex, 0) == osOK, "the owner should take its mutex again");
+    Check(osThreadCreate(osThread(HighThread), mutex) != NULL, "the thread should be created");
+    osDelay(20);
+    Check(highRan, "a higher priority thread should run while main sleeps");
+    Check(osMutexRelease(mutex) == osOK && osMutexRelease(mutex) == osOK, "the owner should release its mutex");
+    Check(osMutexRelease(mutex) == osErrorResource, "a released mutex should not be released again");
+
+    // Fault response while a low priority task hogs the CPU
+    Scheduler_Init(Tasks, sizeof(Tasks) / sizeof(Tasks[0]));
+    Scheduler_Start();
+    Scheduler_Run();
+    printf("Fault response over %lu faults: worst %lums, mean %.1fms, hog %ums\r\n",
+        (unsigned long)faults, (unsigned long)worstLatency,
+        faults ? (double)latencySum / faults : 0.0, HOG_MS);
+    Check(faults == NUM_FAULTS, "the safety task should see every fault");
+    Check(worstLatency <= LATENCY_BUDGET, "the safety task should see a fault within its period");
+    Check(Scheduler_GetStats(0)->misses == 0, "the safety task should make every deadline");
+
+    TestCheck_Exit();
+}
@@ -0,0 +1,99 @@
+#include "common.h"
+#include "config.h"
+#include "Current.h"
+#include "Ripple.h"
+#include "BSP_ADC.h"
+#include "BSP_UART.h"
+#include "simulator_conf.h"
+#include "TestCheck.h"
+
+/**
+ * Simulator only test of the current ripple analysis. Feeds tones on top of a DC current
+ * through the ADC and checks the ripple RMS and strongest frequency. Prints how long an
+ * analysis takes on this machine.
+ */
+
+#define MA_PER_CODE     ((3300.0 / 4096) * 3 * (50 / 4))
+#define DC_CODE         2000
+#define NUM_TIMED       200
+#define MAX_ANALYSIS_NS 5000000     // Far more than it should ever need on a PC
+#define PI              3.14159265358979
+
+static uint32_t sampleIdx = 0;
+
+/**
+ * Feeds one analysis block of a DC current with up to two tones on top
+ */
+static void FeedBlock(double amplitude1, double frequency1, double amplitude2, double frequency2) {
+    uint16_t high[RIPPLE_FFT_SIZE];
+    uint16_t low[RIPPLE_FFT_SIZE];
+    for(int i = 0; i < RIPPLE_FFT_SIZE; i++) {
+        double t = (double)sampleIdx++ / ADC_SAMPLE_RATE_HZ;
+        double code = DC_CODE + amplitude1 * sin(2 * PI * frequency1 * t) + amplitude2 * sin(2 * PI * frequency2 * t);
+        high[i] = code < 0 ? 0 : (code > 4095 ? 4095 : (uint16_t)lround(code));
+        low[i] = DC_CODE;
+    }
+    BSP_ADC_SimulateSamples(high, low, RIPPLE_FFT_SIZE);
+}
+
+static void CheckTone(double amplitude1, double frequency1, double amplitude2, double frequency2) {
+    const double binWidth = (double)ADC_SAMPLE_RATE_HZ / RIPPLE_FFT_SIZE;
+    FeedBlock(amplitude1, frequency1, amplitude2, frequency2);
+    bool updated = Ripple_Update();
+
+    double expectedRMS = sqrt(amplitude1 * amplitude1 + amplitude2 * amplitude2) / sqrt(2) * MA_PER_CODE;
+    printf("%5.1fHz + %5.1fHz: %5dmA rms (expected %5.0f) at %3dHz\r\n",
+        frequency1, frequency2, Ripple_GetRMS(), expectedRMS, Ripple_GetFrequency());
+
+    Check(updated, "no results for a full block");
+    Check(fabs(Ripple_GetRMS() - expectedRMS) <= 0.02 * expectedRMS + MA_PER_CODE, "ripple RMS");
+    if(amplitude1 > 0) {
+        Check(fabs(Ripple_GetFrequency() - frequency1) <= binWidth, "strongest frequency");
+    }
+}
+
+int main() {
+
+    BSP_UART_Init();    // Initialize printf
+
+    // BSP_ADC_Init wants ADC.csv to be there even though it is not read
+    FILE *fp = fopen(GET_CSV_PATH(ADC_CSV_FILE), "w");
+    if(!fp) {
+        perror(ADC_CSV_FILE);
+        exit(EXIT_FAILURE);
+    }
+    fprintf(fp, "2048,2048\r\n");
+    fclose(fp);
+
+    Current_Init();
+    Ripple_Init();
+    printf("%d samples at %dHz, %.1fHz per bin\r\n", RIPPLE_FFT_SIZE, ADC_SAMPLE_RATE_HZ, (double)ADC_SAMPLE_RATE_HZ / RIPPLE_FFT_SIZE);
+
+    // Nothing before a block is complete
+    Check(!Ripple_Update(), "results before the block was complete");
+
+    // Plain DC has no ripple
+    CheckTone(0, 0, 0, 0);
+
+    // On a bin, between bins, and the stronger of two tones
+    CheckTone(100, 250, 0, 0);
+    CheckTone(60, 137, 0, 0);
+    CheckTone(80, 400, 30, 90);
+    CheckTone(40, 781, 20, 50);
+
+    // A saturated sensor gives no results
+    FeedBlock(2500, 100, 0, 0);
+    Check(!Ripple_Update(), "saturated block was analysed");
+
+    // Time the analysis
+    uint64_t total = 0;
+    for(int i = 0; i < NUM_TIMED; i++) {
+        FeedBlock(50, 300, 10, 60);
+        Ripple_Update();
+        total += Ripple_GetCycles();
+    }
+    printf("Analysis: %dns average, %dns worst over %d blocks\r\n", (int)(total / NUM_TIMED), Ripple_GetMaxCycles(), NUM_TIMED);
+    Check(Ripple_GetMaxCycles() < MAX_ANALYSIS_NS, "analysis took too long");
+
+    TestCheck_Exit();
+}
@@ -0,0 +1,102 @@
+#include "common.h"
+#include "config.h"
+#include "Voltage.h"
+#include "Temperature.h"
+#include "SPILink.h"
+#include "EEPROM.h"
+#include "BSP_SPI.h"
+#include "BSP_UART.h"
+#include "BSP_PLL.h"
+#include "simulator_conf.h"
+#include "TestCheck.h"
+
+/**
+ * Simulator only test of the isoSPI link rate manager. Chain 0 first gets a cable that is only
+ * clean up to 312kbps, the manager has to back off from the default rate and store 312kbps.
+ * After a "reboot" with a good cable it has to climb back to SPILINK_MAX_SPEED.
+ */
+
+#define NUM_SCANS   150
+
+static const char *SpeedNames[NUM_SPI_SPEEDS] = {"156k", "312k", "625k", "1250k"};
+
+cell_asic minions[NUM_MINIONS];
+
+static uint32_t tempErrors;     // Temperature scans that reported an error
+
+/**
+ * Runs scans and reports how long chain 0 spent at each rate
+ * @return rate the most scans ran at
+ */
+static SPI_Speed RunScans(void) {
+    uint32_t scans[NUM_SPI_SPEEDS] = {0};
+    uint32_t busTime[NUM_SPI_SPEEDS] = {0};
+
+    for(int i = 0; i < NUM_SCANS; i++) {
+        SPI_Speed speed = SPILink_GetSpeed(SPI_CHAIN_0);
+        uint32_t start = BSP_SPI_GetBusTimeUs(SPI_CHAIN_0);
+
+        Voltage_UpdateMeasurements();
+        if(Temperature_UpdateAllMeasurements() != SUCCESS) {
+            tempErrors++;
+        }
+        SPILink_Update();
+        SPILink_Save();
+
+        scans[speed]++;
+        busTime[speed] += BSP_SPI_GetBusTimeUs(SPI_CHAIN_0) - start;
+    }
+
+    SPI_Speed most = SPI_SPEED_156K;
+    for(int speed = 0; speed < NUM_SPI_SPEEDS; speed++) {
+        if(scans[speed] > 0) {
+            printf("\t%5sbps: %3d scans, %6dus per scan\r\n", SpeedNames[speed], scans[speed], busTime[speed] / scans[speed]);
+        }
+        if(scans[speed] > scans[most]) {
+            most = speed;
+        }
+    }
+    return most;
+}
+
+int main() {
+
+    BSP_UART_Init();    // Initialize printf
+    BSP_PLL_Init();     // The LTC6811 driver times its delays with the clock
+
+    // A pack at rest for the simulated LTC6811s to read back
+    FILE *fp = fopen(GET_CSV_PATH(SPI_CSV_FILE), "w");
+    if(!fp) {
+        perror(SPI_CSV_FILE);
+        exit(EXIT_FAILURE);
+    }
+    for(int module = 0; module < NUM_BATTERY_MODULES; module++) {
+        fprintf(fp, "1,37000,25000,25000\n");      // 3.7V and 25C
+    }
+    fclose(fp);
+
+    EEPROM_Init();
+    EEPROM_WriteByte(EEPROM_SPI_SPEED_LOC + SPI_CHAIN_0, EEPROM_TERMINATOR);   // Forget the stored rate
+
+    Voltage_Init(minions);
+    Temperature_Init(minions);
+
+    printf("Long cable, clean up to 312kbps:\r\n");
+    BSP_SPI_SetLinkLimit(SPI_CHAIN_0, SPI_SPEED_312K);
+    SPILink_Init(minions);
+    Check(SPILink_GetSpeed(SPI_CHAIN_0) == SPI_SPEED_DEFAULT, "blank EEPROM should start at the default rate");
+    Check(RunScans() == SPI_SPEED_312K, "should settle at 312kbps");
+    Check(tempErrors > 0, "temperature scans with PEC errors should report them");
+    Check(SPILink_GetStoredSpeed(SPI_CHAIN_0) == SPI_SPEED_312K, "312kbps should be stored");
+    Check(EEPROM_ReadByte(EEPROM_SPI_SPEED_LOC + SPI_CHAIN_0) != EEPROM_TERMINATOR, "EEPROM should be written");
+
+    printf("Reboot with a good cable:\r\n");
+    BSP_SPI_SetLinkLimit(SPI_CHAIN_0, SPI_SPEED_1250K);
+    SPILink_Init(minions);
+    Check(SPILink_GetSpeed(SPI_CHAIN_0) == SPI_SPEED_312K, "should start at the stored rate");
+    Check(RunScans() == SPILINK_MAX_SPEED, "should climb to SPILINK_MAX_SPEED");
+    Check(SPILink_GetStoredSpeed(SPI_CHAIN_0) == SPILINK_MAX_SPEED, "SPILINK_MAX_SPEED should be stored");
+    Check(Temperature_UpdateAllMeasurements() == SUCCESS, "a clean temperature scan should succeed");
+
+    TestCheck_Exit();
+}
@@ -0,0 +1,64 @@
+#include "common.h"
+#include "config.h"
+#include "Voltage.h"
+#include "Temperature.h"
+#include "BSP_SPI.h"
+#include "BSP_UART.h"
+#include "BSP_PLL.h"
+#include "simulator_conf.h"
+
+/**
+ * Simulator only benchmark of how long one full scan of the pack keeps the isoSPI links busy.
+ * The pack layout comes from the build, run "make scantime" to compare 4, 8 and 16 boards
+ * split over 1, 2 and 4 daisy chains.
+ */
+
+#define NUM_SCANS   10
+
+cell_asic minions[NUM_MINIONS];
+
+int main() {
+
+    BSP_UART_Init();    // Initialize printf
+    BSP_PLL_Init();
+
+    // A pack at rest for the simulated LTC6811s to read back, the values do not matter here
+    FILE *fp = fopen(GET_CSV_PATH(SPI_CSV_FILE), "w");
+    if(!fp) {
+        perror(SPI_CSV_FILE);
+        exit(EXIT_FAILURE);
+    }
+    for(int module = 0; module < NUM_BATTERY_MODULES; module++) {
+        fprintf(fp, "1,37000,25000,25000\n");      // 3.7V and 25C
+    }
+    fclose(fp);
+
+    Voltage_Init(minions);
+    Temperature_Init(minions);
+
+    uint32_t startTime[NUM_CHAINS];
+    for(int chain = 0; chain < NUM_CHAINS; chain++) {
+        startTime[chain] = BSP_SPI_GetBusTimeUs(chain);
+    }
+
+    for(int i = 0; i < NUM_SCANS; i++) {
+        Voltage_UpdateMeasurements();
+        Temperature_UpdateAllMeasurements();
+    }
+
+    // The chains are clocked at the same time so a scan takes as long as the busiest chain
+    uint32_t busiest = 0;
+    uint32_t total = 0;
+    for(int chain = 0; chain < NUM_CHAINS; chain++) {
+        uint32_t busTime = (BSP_SPI_GetBusTimeUs(chain) - startTime[chain]) / NUM_SCANS;
+        total += busTime;
+        if(busTime > busiest) {
+            busiest = busTime;
+        }
+    }
+
+    printf("boards: %2d  chains: %d  scan: %7dus  (sum over chains: %7dus)\r\n",
+        NUM_MINIONS, NUM_CHAINS, busiest, total);
+
+    exit(0);
+}
@@ -0,0 +1,115 @@
+#include "common.h"
+#include "config.h"
+#include "Scheduler.h"
+#include "BSP_Timer.h"
+#include "BSP_UART.h"
+#include "cmsis_os.h"
+#include "TestCheck.h"
+
+/**
+ * Runs the scheduler threads on the real 1ms tick with tasks that busy wait. A fast task shares
+ * the scheduler with a long task like the old full temperature scan, then with the same work
+ * in short slices. The fast task has the higher priority and preempts the long one, so it keeps
+ * its period either way. Checks the periods, the deadline misses, the skipped releases and the
+ * jitter, and that a task can stop the scheduler.
+ * Linux may take the CPU away at any time, on one CPU that costs the odd deadline. A stall
+ * costs a task one miss and a skip for every period it lasts, so the checks allow MAX_LATE
+ * misses and MAX_STALL_MS worth of skips per task. A fast task that had to wait for the long
+ * one would miss two or three deadlines on each of its 4 runs.
+ */
+
+#define RUN_MS          2000
+#define FAST_PERIOD     10
+#define SLICE_MS        3       // One slice of the work
+#define LONG_MS         30      // The long task at once
+#define MAX_LATE        4       // Runs Linux may hold up past their deadline
+#define MAX_STALL_MS    100     // Time Linux may take the CPU away for, all told
+#define MAX_MEAN_JITTER 2.5     // ms, a fraction of a ms is typical
+
+static uint32_t stopTick;
+
+static void Busy(uint32_t ms) {
+    uint32_t start = BSP_Timer_GetTick();
+    while(BSP_Timer_GetTick() - start < ms);
+}
+
+static bool FastTask(void) {
+    return true;
+}
+
+static bool SliceTask(void) {
+    Busy(SLICE_MS);
+    return true;
+}
+
+static bool LongTask(void) {
+    Busy(LONG_MS);
+    return true;
+}
+
+static bool StopTask(void) {
+    stopTick = BSP_Timer_GetTick();
+    return false;
+}
+
+static const SchedulerTask Blocking[] = {
+    {"fast",    FastTask,   FAST_PERIOD,    0,      FAST_PERIOD},
+    {"long",    LongTask,   500,            250,    20},
+    {"stop",    StopTask,   RUN_MS,         RUN_MS, RUN_MS},
+};
+
+static const SchedulerTask Sliced[] = {
+    {"fast",    FastTask,   FAST_PERIOD,    0,      FAST_PERIOD},
+    {"slice",   SliceTask,  50,             5,      20},
+    {"stop",    StopTask,   RUN_MS,         RUN_MS, RUN_MS},
+};
+
+static double MeanJitter(const SchedulerStats *stats) {
+    return stats->runs ? (double)stats->jitterSum / stats->runs : 0.0;
+}
+
+static void Print(const char *title) {
+    printf("%s\r\n", title);
+    const SchedulerTask *task;
+    for(uint8_t i = 0; (task = Scheduler_GetTask(i)) != NULL; i++) {
+        const SchedulerStats *stats = Scheduler_GetStats(i);
+        printf("  %-6s %4u runs, %2u missed, %3u skipped, jitter %.2f/%ums, run time %ums\r\n",
+            task->name, stats->runs, stats->misses, stats->skipped,
+            MeanJitter(stats), stats->maxJitter, stats->maxRuntime);
+    }
+}
+
+int main() {
+
+    BSP_UART_Init();    // Initialize printf
+    osKernelInitialize();
+    osKernelStart();
+
+    // The long task runs for LONG_MS at a time, the fast one preempts it
+    Scheduler_Init(Blocking, sizeof(Blocking) / sizeof(Blocking[0]));
+    Scheduler_Start();
+    Scheduler_Run();
+    Print("Long task:");
+    const SchedulerStats *fast = Scheduler_GetStats(0);
+    const SchedulerStats *slow = Scheduler_GetStats(1);
+    Check(stopTick >= RUN_MS && stopTick <= RUN_MS + LONG_MS + MAX_STALL_MS, "the stop task should end the run on time");
+    Check(slow->runs == 4 && slow->misses == slow->runs, "every run of the long task should miss its deadline");
+    Check(fast->runs + fast->skipped >= (RUN_MS - MAX_STALL_MS) / FAST_PERIOD && fast->runs + fast->skipped <= RUN_MS / FAST_PERIOD + 1,
+        "the fast task should be released every period");
+    Check(fast->skipped <= MAX_STALL_MS / FAST_PERIOD, "the fast task should run on nearly every release");
+    Check(MeanJitter(fast) < MAX_MEAN_JITTER, "the fast task should start close to its releases");
+    Check(fast->misses <= MAX_LATE, "the fast task should not wait for the long task");
+
+    // The same kind of work in short slices
+    Scheduler_Init(Sliced, sizeof(Sliced) / sizeof(Sliced[0]));
+    Scheduler_Start();
+    Scheduler_Run();
+    Print("Sliced task:");
+    Check(fast->runs + fast->skipped >= (RUN_MS - MAX_STALL_MS) / FAST_PERIOD && fast->skipped <= MAX_STALL_MS / FAST_PERIOD,
+        "the fast task should run on nearly every release");
+    Check(MeanJitter(fast) < MAX_MEAN_JITTER, "the fast task should start close to its releases");
+    Check(fast->misses <= MAX_LATE, "the fast task should make its deadlines");
+    Check(Scheduler_GetStats(1)->misses <= MAX_LATE, "the slices should make their deadlines");
+
+    TestCheck_Exit();
+}
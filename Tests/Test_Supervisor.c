@@ -0,0 +1,113 @@
+#include "common.h"
+#include "config.h"
+#include "Scheduler.h"
+#include "Supervisor.h"
+#include "BSP_Timer.h"
+#include "BSP_UART.h"
+#include "cmsis_os.h"
+#include "TestCheck.h"
+
+/**
+ * Checks the liveness supervision: tokens have to come in sequence, a task that stops checking
+ * in is caught once its interval runs out and tasks without an interval are left alone. Then
+ * runs it on the scheduler with a task that stops returning like a CLI command stuck in a loop.
+ * The safety task has to catch it within its interval while keeping its own period.
+ */
+
+#define SAFETY_INTERVAL     50
+#define STUCK_INTERVAL      200
+#define STUCK_AFTER         5       // Runs before the task hangs
+
+static const uint32_t Intervals[] = {SAFETY_INTERVAL, 0, STUCK_INTERVAL};
+static uint8_t offender = SUPERVISOR_HEALTHY;
+static uint32_t lastCheckIn;
+static uint32_t caughtAfter;
+static volatile bool release;
+
+static bool SafetyTask(void) {
+    static uint32_t token;
+    token = Supervisor_CheckIn(0, token);
+    offender = Supervisor_Check();
+    if(offender != SUPERVISOR_HEALTHY) {
+        caughtAfter = BSP_Timer_GetTick() - lastCheckIn;
+        release = true;
+        return false;
+    }
+    return true;
+}
+
+static bool IdleTask(void) {
+    return true;
+}
+
+static bool StuckTask(void) {
+    static uint32_t token;
+    static uint32_t runs;
+    if(++runs > STUCK_AFTER) {
+        // Never comes back until the test is over
+        while(!release) {
+            osDelay(1);
+        }
+        return true;
+    }
+    token = Supervisor_CheckIn(2, token);
+    lastCheckIn = BSP_Timer_GetTick();
+    return true;
+}
+
+static const SchedulerTask Tasks[] = {
+    {"safety",  SafetyTask, SCHED_SAFETY_PERIOD_MS, 0,  SCHED_SAFETY_PERIOD_MS},
+    {"idle",    IdleTask,   100,                    1,  100},
+    {"stuck",   StuckTask,  SCHED_CLI_PERIOD_MS,    2,  SCHED_CLI_PERIOD_MS},
+};
+
+int main() {
+
+    BSP_UART_Init();    // Initialize printf
+    osKernelInitialize();
+    osKernelStart();
+
+    // Tokens in sequence and on time
+    Supervisor_Init(Intervals, 3);
+    Check(Supervisor_Check() == SUPERVISOR_HEALTHY, "every task should start healthy");
+    uint32_t tokens[3] = {0, 0, 0};
+    for(int i = 0; i < 5; i++) {
+        tokens[0] = Supervisor_CheckIn(0, tokens[0]);
+        tokens[2] = Supervisor_CheckIn(2, tokens[2]);
+        osDelay(20);
+    }
+    Check(Supervisor_Check() == SUPERVISOR_HEALTHY, "tasks checking in on time should be healthy");
+    Check(tokens[0] != 0 && tokens[0] == tokens[2], "every task should get the same sequence");
+
+    // A task that stops checking in
+    for(int i = 0; i < 4; i++) {
+        tokens[2] = Supervisor_CheckIn(2, tokens[2]);
+        osDelay(20);
+    }
+    Check(Supervisor_Check() == 0, "a task past its interval should be caught");
+
+    // Wrong tokens, a task without an interval is never caught
+    Supervisor_Init(Intervals, 3);
+    tokens[0] = Supervisor_CheckIn(0, 0);
+    tokens[2] = Supervisor_CheckIn(2, 0);
+    Supervisor_CheckIn(1, 12345);
+    Check(Supervisor_Check() == SUPERVISOR_HEALTHY, "a task without an interval should be left alone");
+    Supervisor_CheckIn(2, 0);
+    Check(Supervisor_Check() == 2, "checking in twice with the same token should be caught");
+    Supervisor_CheckIn(0, tokens[0]);
+    Check(Supervisor_Check() == 2, "a wrong token should stay caught");
+
+    // A task that hangs on the scheduler
+    Supervisor_Init(Intervals, 3);
+    Scheduler_Init(Tasks, sizeof(Tasks) / sizeof(Tasks[0]));
+    Scheduler_Start();
+    Scheduler_Run();
+    printf("Stuck task caught %lums after its last check-in, interval %ums\r\n",
+        (unsigned long)caughtAfter, STUCK_INTERVAL);
+    Check(offender == 2, "the stuck task should be the offender");
+    Check(caughtAfter > STUCK_INTERVAL && caughtAfter <= STUCK_INTERVAL + 2 * SCHED_SAFETY_PERIOD_MS,
+        "the stuck task should be caught within a safety period of its interval");
+    Check(Scheduler_GetStats(0)->misses == 0, "the safety task should keep its deadlines");
+
+    TestCheck_Exit();
+}
@@ -0,0 +1,116 @@
+#include "common.h"
+#include "config.h"
+#include "Temperature.h"
+#include "BSP_SPI.h"
+#include "BSP_UART.h"
+#include "BSP_PLL.h"
+#include "simulator_conf.h"
+#include "TestCheck.h"
+
+/**
+ * Simulator only test of the temperature sensor plausibility checks. Writes SPI.csv itself
+ * and breaks sensors with BSP_SPI_SetSensorFault. Checks that every kind of fault is flagged,
+ * left out of the pack average, and that a module only trips once it has no good sensor left.
+ */
+
+#define PACK_TEMP       30000   // mC
+#define WARM_TEMP       60000   // mC
+
+cell_asic minions[NUM_MINIONS];
+
+static int32_t packTemp = PACK_TEMP;
+
+/**
+ * Writes every module at packTemp with a little noise
+ */
+static void WriteScan(void) {
+    static int32_t noise = 0;
+    FILE *fp = fopen(GET_CSV_PATH(SPI_CSV_FILE), "w");
+    if(!fp) {
+        perror(SPI_CSV_FILE);
+        exit(EXIT_FAILURE);
+    }
+    noise = 100 - noise;
+    for(int module = 0; module < NUM_BATTERY_MODULES; module++) {
+        fprintf(fp, "1,36000,%d,%d\r\n", packTemp + noise, packTemp + noise);
+    }
+    fclose(fp);
+}
+
+static void Scan(void) {
+    WriteScan();
+    Temperature_UpdateAllMeasurements();
+}
+
+static void SetFault(uint8_t sensor, SimSensorFault fault) {
+    const SensorTap *tap = &SensorMap[sensor];
+    BSP_SPI_SetSensorFault(tap->board, tap->mux * (MAX_TEMP_SENSORS_PER_MINION_BOARD / 2) + tap->channel, fault);
+}
+
+/**
+ * Checks a faulty sensor is flagged and the pack average still matches the good sensors
+ */
+static void CheckFlagged(uint8_t sensor, uint8_t expected, const char *name) {
+    uint8_t faults = Temperature_GetSensorFaults(sensor);
+    int32_t avg = Temperature_GetTotalPackAvgTemperature();
+
+    printf("%-9s sensor %2d: faults 0x%02x, reads %7.3fC, pack average %.3fC\r\n",
+        name, sensor, faults, Temperature_GetSensorTemperature(sensor) / 1000.0, avg / 1000.0);
+    Check((faults & expected) == expected, name);
+    Check(Temperature_GetNumImplausibleSensors() == 1, "only the faulty sensor should be flagged");
+    Check(abs(avg - packTemp) < 500, "pack average should ignore the faulty sensor");
+    Check(Temperature_CheckStatus(0) == SAFE, "one bad sensor on a module should not trip");
+}
+
+int main() {
+
+    BSP_UART_Init();    // Initialize printf
+    BSP_PLL_Init();     // The LTC6811 driver times its delays with the clock
+
+    WriteScan();
+    Temperature_Init(minions);
+    Scan();
+    Check(Temperature_GetNumImplausibleSensors() == 0, "healthy pack should be plausible");
+    Check(abs(Temperature_GetDieTemperature(0) - PACK_TEMP) < 1000, "die temperature should follow the pack");
+
+    SetFault(3, SIM_SENSOR_SHORTED);
+    Scan();
+    CheckFlagged(3, TEMP_FAULT_RANGE, "shorted");
+    SetFault(3, SIM_SENSOR_OK);
+
+    SetFault(20, SIM_SENSOR_OPEN);
+    Scan();
+    CheckFlagged(20, TEMP_FAULT_RANGE, "open");
+    SetFault(20, SIM_SENSOR_OK);
+
+    // A sensor that fell off reads like a cool pack, it only stands out once the pack warms up
+    packTemp = WARM_TEMP;
+    Scan();
+    SetFault(41, SIM_SENSOR_DETACHED);
+    Scan();
+    CheckFlagged(41, TEMP_FAULT_NEIGHBOUR | TEMP_FAULT_DIE, "detached");
+    SetFault(41, SIM_SENSOR_OK);
+
+    SetFault(10, SIM_SENSOR_STUCK);
+    for(int scan = 0; scan <= TEMP_STUCK_SCANS; scan++) {
+        Scan();
+    }
+    CheckFlagged(10, TEMP_FAULT_STUCK, "stuck");
+
+    // Losing the second sensor leaves the module unmonitored
+    uint8_t module = SensorModule[10];
+    uint8_t other = ModuleSensors[module][0] == 10 ? ModuleSensors[module][1] : ModuleSensors[module][0];
+    SetFault(other, SIM_SENSOR_SHORTED);
+    Scan();
+    printf("Both sensors of module %d broken: %s\r\n", module, Temperature_CheckStatus(0) == SAFE ? "SAFE" : "DANGER");
+    Check(Temperature_CheckStatus(0) == DANGER, "module without a good sensor should trip");
+    Check(Temperature_GetModulesInDanger()[module] == 1, "module without a good sensor should be in danger");
+
+    SetFault(10, SIM_SENSOR_OK);
+    SetFault(other, SIM_SENSOR_OK);
+    Scan();
+    Check(Temperature_GetNumImplausibleSensors() == 0, "repaired sensors should be plausible again");
+    Check(Temperature_CheckStatus(0) == SAFE, "repaired pack should be safe");
+
+    TestCheck_Exit();
+}
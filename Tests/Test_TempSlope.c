@@ -0,0 +1,98 @@
+#include "common.h"
+#include "config.h"
+#include "Temperature.h"
+#include "BSP_UART.h"
+#include "BSP_PLL.h"
+#include "simulator_conf.h"
+#include "TestCheck.h"
+
+/**
+ * Simulator only test of the predictive over temperature trip. Writes SPI.csv itself, one
+ * scan at a time, with the same heating ramp battery.py uses for a module in thermal trouble:
+ * one module rises at a fixed rate while the rest of the pack sits at 25C.
+ * Prints how many scans before the regular limit the predictive trip fires.
+ */
+
+#define HOT_MODULE      5
+#define START_TEMP      40000   // mC
+#define COOL_TEMP       25000   // mC
+#define MAX_SCANS       400
+
+cell_asic minions[NUM_MINIONS];
+
+static void WriteScan(int32_t hotTemp) {
+    static int32_t noise = 0;
+    FILE *fp = fopen(GET_CSV_PATH(SPI_CSV_FILE), "w");
+    if(!fp) {
+        perror(SPI_CSV_FILE);
+        exit(EXIT_FAILURE);
+    }
+    // A little noise like a real sensor has, or the sensors look stuck
+    noise = 100 - noise;
+    for(int module = 0; module < NUM_BATTERY_MODULES; module++) {
+        int32_t temp = (module == HOT_MODULE ? hotTemp : COOL_TEMP) + noise;
+        fprintf(fp, "1,36000,%d,%d\n", temp, temp);
+    }
+    fclose(fp);
+}
+
+/**
+ * Runs a ramp until the temperature passes the discharge limit
+ * @param rate heating rate in mC per scan, 0 for a module parked just under the limit
+ * @return scans between the predictive trip and the regular limit
+ */
+static int RunRamp(int32_t rate) {
+    const int32_t limit = MAX_DISCHARGE_TEMPERATURE_LIMIT * MILLI_SCALING_FACTOR;
+    int32_t temp = rate > 0 ? START_TEMP : limit - 500;
+    int predictiveScan = -1;
+    int limitScan = -1;
+
+    // Fill the slope window with the starting temperature
+    for(int i = 0; i < TEMP_SLOPE_WINDOW; i++) {
+        WriteScan(temp);
+        Temperature_UpdateAllMeasurements();
+    }
+
+    for(int scan = 0; scan < MAX_SCANS && limitScan < 0; scan++) {
+        temp += rate;
+        WriteScan(temp);
+        Temperature_UpdateAllMeasurements();
+
+        if(predictiveScan < 0 && Temperature_CheckStatus(0) != SAFE) {
+            predictiveScan = scan;
+        }
+        if(Temperature_GetModuleTemperature(HOT_MODULE) > limit) {
+            limitScan = scan;
+        }
+    }
+
+    if(rate == 0) {
+        printf("Steady at %dmC: %s\r\n", limit - 500, predictiveScan < 0 ? "no trip" : "tripped");
+        Check(predictiveScan < 0, "a steady temperature under the limit should not trip");
+        return 0;
+    }
+
+    printf("Ramp of %4dmC/scan: limit reached at scan %3d, predictive trip at scan %3d (%d scans earlier)\r\n",
+        rate, limitScan, predictiveScan, limitScan - predictiveScan);
+    Check(predictiveScan >= 0 && limitScan >= 0 && predictiveScan < limitScan,
+        "a ramp should trip before it reaches the limit");
+    return limitScan - predictiveScan;
+}
+
+int main() {
+
+    BSP_UART_Init();    // Initialize printf
+    BSP_PLL_Init();     // The LTC6811 driver times its delays with the clock
+
+    WriteScan(COOL_TEMP);
+    Temperature_Init(minions);
+
+    printf("Scan period %dms, horizon %ds, window %d scans\r\n",
+        TEMPERATURE_SCAN_PERIOD_MS, TEMP_PREDICT_HORIZON_S, TEMP_SLOPE_WINDOW);
+
+    RunRamp(0);
+    RunRamp(1000);
+    RunRamp(200);
+
+    TestCheck_Exit();
+}
@@ -0,0 +1,151 @@
+#include "common.h"
+#include "config.h"
+#include "Temperature.h"
+#include "ThermalModel.h"
+#include "BSP_SPI.h"
+#include "BSP_UART.h"
+#include "BSP_PLL.h"
+#include "simulator_conf.h"
+#include "TestCheck.h"
+
+/**
+ * Simulator only test of the thermal model. Drives the pack through a repeating drive cycle
+ * with a lumped thermal network of its own (every module heats by I^2R, conducts to the modules
+ * next to it and loses a little to the air) and writes the result to SPI.csv every scan.
+ * After the first lap both sensors of one module are shorted and the model has to stand in.
+ * Prints the estimate next to the true temperature and the error over the rest of the cycle.
+ */
+
+#define FAILED_MODULE       12
+#define FAIL_SCAN           120         // Scan the sensors of FAILED_MODULE short out
+#define NUM_SCANS           600         // 10 minutes at TEMPERATURE_SCAN_PERIOD_MS
+#define MAX_ERROR           2000        // mC
+
+// Thermal network of the simulated pack
+#define AMBIENT             25.0        // C
+#define HEAT_CAPACITY       600.0       // J/K of one module
+#define NEIGHBOUR_G         0.9         // W/K between two modules next to each other
+#define AMBIENT_G           0.2         // W/K from a module to the air
+#define RESISTANCE          0.0025      // Ohm, every module is a little different
+
+cell_asic minions[NUM_MINIONS];
+
+static double trueTemp[NUM_BATTERY_MODULES];
+
+/**
+ * Drive cycle current in amps: accelerate, cruise, regen, stop
+ */
+static double DriveCycle(int second) {
+    int t = second % 120;
+    if(t < 20) {
+        return 90.0;
+    } else if(t < 80) {
+        return 35.0;
+    } else if(t < 90) {
+        return -30.0;
+    }
+    return 0.0;
+}
+
+/**
+ * Moves the simulated pack one second forward
+ */
+static void StepPack(double amps) {
+    double next[NUM_BATTERY_MODULES];
+    for(int m = 0; m < NUM_BATTERY_MODULES; m++) {
+        double resistance = RESISTANCE * (1.0 + 0.15 * sin(m));
+        double flow = amps * amps * resistance - AMBIENT_G * (trueTemp[m] - AMBIENT);
+        if(m > 0) {
+            flow -= NEIGHBOUR_G * (trueTemp[m] - trueTemp[m - 1]);
+        }
+        if(m < NUM_BATTERY_MODULES - 1) {
+            flow -= NEIGHBOUR_G * (trueTemp[m] - trueTemp[m + 1]);
+        }
+        next[m] = trueTemp[m] + flow / HEAT_CAPACITY;
+    }
+    memcpy(trueTemp, next, sizeof(trueTemp));
+}
+
+static void WriteScan(void) {
+    static int32_t noise = 0;
+    FILE *fp = fopen(GET_CSV_PATH(SPI_CSV_FILE), "w");
+    if(!fp) {
+        perror(SPI_CSV_FILE);
+        exit(EXIT_FAILURE);
+    }
+    // A little noise like a real sensor has, or the sensors look stuck
+    noise = 100 - noise;
+    for(int m = 0; m < NUM_BATTERY_MODULES; m++) {
+        int32_t temp = (int32_t)(trueTemp[m] * 1000) + noise;
+        fprintf(fp, "1,36000,%d,%d\r\n", temp, temp);
+    }
+    fclose(fp);
+}
+
+static void SetModuleFault(uint8_t module, SimSensorFault fault) {
+    for(int i = 0; i < NUM_TEMP_SENSORS_PER_MOD; i++) {
+        const SensorTap *tap = &SensorMap[ModuleSensors[module][i]];
+        BSP_SPI_SetSensorFault(tap->board, tap->mux * (MAX_TEMP_SENSORS_PER_MINION_BOARD / 2) + tap->channel, fault);
+    }
+}
+
+int main() {
+
+    BSP_UART_Init();    // Initialize printf
+    BSP_PLL_Init();     // The LTC6811 driver times its delays with the clock
+
+    for(int m = 0; m < NUM_BATTERY_MODULES; m++) {
+        trueTemp[m] = AMBIENT;
+    }
+    WriteScan();
+    Temperature_Init(minions);
+    ThermalModel_Init();
+
+    double maxError = 0;
+    double sumSquares = 0;
+    int estimatedScans = 0;
+
+    printf("  time  current   true  estimate  bound\r\n");
+    for(int scan = 0; scan < NUM_SCANS; scan++) {
+        double amps = DriveCycle(scan);
+        StepPack(amps);
+        WriteScan();
+
+        if(scan == FAIL_SCAN) {
+            SetModuleFault(FAILED_MODULE, SIM_SENSOR_SHORTED);
+        }
+
+        Temperature_UpdateAllMeasurements();
+        ThermalModel_Update((int32_t)(amps * 1000));
+
+        if(scan < FAIL_SCAN) {
+            continue;
+        }
+
+        if(Temperature_IsModuleCovered(FAILED_MODULE)) {
+            Check(false, "shorted module should not be covered");
+            break;
+        }
+        if(Temperature_CheckStatus(0) != SAFE) {
+            printf("Tripped at scan %d\r\n", scan);
+            Check(false, "estimate should keep the module in service");
+            break;
+        }
+
+        double error = Temperature_GetModuleTemperature(FAILED_MODULE) / 1000.0 - trueTemp[FAILED_MODULE];
+        maxError = fmax(maxError, fabs(error));
+        sumSquares += error * error;
+        estimatedScans++;
+
+        if(scan % 60 == 0) {
+            printf("%5ds %6.1fA %6.2fC %8.2fC %6.2fC\r\n", scan, amps, trueTemp[FAILED_MODULE],
+                ThermalModel_GetEstimate(FAILED_MODULE) / 1000.0, ThermalModel_GetUpperBound(FAILED_MODULE) / 1000.0);
+        }
+    }
+
+    printf("Module %d estimated for %ds: max error %.3fC, rms error %.3fC, bound %.3fC\r\n", FAILED_MODULE,
+        estimatedScans, maxError, sqrt(sumSquares / (estimatedScans > 0 ? estimatedScans : 1)), MAX_ERROR / 1000.0);
+
+    Check(maxError <= MAX_ERROR / 1000.0, "the estimate should stay within its error bound");
+    TestCheck_Exit();
+}
@@ -0,0 +1,104 @@
+#include "common.h"
+#include "config.h"
+#include "Temperature.h"
+#include "ThermistorLUT.h"
+#include "BSP_UART.h"
+#ifdef SIMULATION
+#include <time.h>
+#else
+#include "stm32f4xx.h"
+#endif
+
+/**
+ * Compares the lookup table conversion against the sensor equation for every ADC code and
+ * times both. The simulator reports nanoseconds, the STM32 build reports CPU cycles.
+ */
+
+#define NUM_CODES   65536
+
+/**
+ * The float conversion the lookup table replaced
+ */
+static int FloatMilliVoltToCelsius(float milliVolt) {
+    float sumInRt = (float)(-13.582)*(float)(-13.582) + (float)4.0 * (float)0.00433 * ((float)2230.8 - milliVolt);
+    float rt = sqrt(sumInRt);
+    float numerator = (float)13.582 - rt;
+    float denom = (2.0 * - 0.00433);
+    float frac = numerator/denom;
+    float retVal = frac + 30;
+
+    return retVal * 1000;
+}
+
+/**
+ * Exact sensor equation, used as the reference
+ */
+static double ExactMilliCelsius(uint16_t code) {
+    double milliVolt = code * 0.1;
+    return (((13.582 - sqrt(13.582*13.582 + 4 * 0.00433 * (2230.8 - milliVolt))) / (2.0 * -0.00433)) + 30) * 1000;
+}
+
+static uint32_t Timestamp(void) {
+#ifdef SIMULATION
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000000 + ts.tv_nsec);
+#else
+    return DWT->CYCCNT;
+#endif
+}
+
+int main() {
+
+    BSP_UART_Init();    // Initialize printf
+
+#ifndef SIMULATION
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+
+    printf("Testing thermistor lookup table.\r\n");
+
+    // Accuracy over the full 16 bit range
+    double maxError = 0;
+    uint32_t worstCode = 0;
+    for(uint32_t code = 0; code < NUM_CODES; code++) {
+        double error = fabs(Temperature_CodeToMilliCelsius(code) - ExactMilliCelsius(code));
+        if(error > maxError) {
+            maxError = error;
+            worstCode = code;
+        }
+    }
+    printf("Max error: %.3f mC at code %d (%.1f mV), bound %d mC\r\n",
+        maxError, worstCode, worstCode * 0.1, THERMISTOR_LUT_MAX_ERROR);
+
+    // Speed
+    volatile int32_t sink = 0;
+    uint32_t start = Timestamp();
+    for(uint32_t code = 0; code < NUM_CODES; code++) {
+        sink += FloatMilliVoltToCelsius(code * 0.1);
+    }
+    uint32_t floatTime = Timestamp() - start;
+
+    start = Timestamp();
+    for(uint32_t code = 0; code < NUM_CODES; code++) {
+        sink += Temperature_CodeToMilliCelsius(code);
+    }
+    uint32_t lutTime = Timestamp() - start;
+
+#ifdef SIMULATION
+    const char *unit = "ns";
+#else
+    const char *unit = "cycles";
+#endif
+    printf("float + sqrt: %.1f %s per conversion\r\n", (float)floatTime / NUM_CODES, unit);
+    printf("lookup table: %.1f %s per conversion\r\n", (float)lutTime / NUM_CODES, unit);
+
+    if(maxError > THERMISTOR_LUT_MAX_ERROR) {
+        printf("FAIL\r\n");
+        exit(1);
+    }
+    printf("PASS\r\n");
+    exit(0);
+}
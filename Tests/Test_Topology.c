@@ -0,0 +1,84 @@
+#include "common.h"
+#include "config.h"
+#include "Topology.h"
+#include "BSP_UART.h"
+#include "TestCheck.h"
+
+/**
+ * Checks that Config/topology.csv describes the whole pack: every module and sensor is wired
+ * to exactly one input that exists, nothing shares an input and the inverse maps agree with
+ * the forward maps.
+ */
+
+static void check(bool condition, const char *msg, int idx) {
+    char indexed[96];
+    snprintf(indexed, sizeof(indexed), "%s (%d)", msg, idx);
+    Check(condition, indexed);
+}
+
+int main() {
+
+    BSP_UART_Init();    // Initialize printf
+
+    printf("Testing Topology tables.\r\n");
+
+    // Modules
+    uint8_t cellUsed[TOPOLOGY_BOARDS][MAX_VOLT_SENSORS_PER_MINION_BOARD] = {{0}};
+    for(int module = 0; module < NUM_BATTERY_MODULES; module++) {
+        ModuleTap tap = ModuleMap[module];
+        check(tap.board < TOPOLOGY_BOARDS && tap.board < NUM_MINIONS, "module on a board that does not exist", module);
+        check(tap.cell < MAX_VOLT_SENSORS_PER_MINION_BOARD, "module on a cell input that is not wired", module);
+        if(tap.board >= TOPOLOGY_BOARDS || tap.cell >= MAX_VOLT_SENSORS_PER_MINION_BOARD) {
+            continue;
+        }
+        check(cellUsed[tap.board][tap.cell]++ == 0, "two modules on one cell input", module);
+        check(Topology_GetCellModule(tap.board, tap.cell) == module, "cell input does not map back to module", module);
+    }
+
+    // Sensors
+    uint8_t channelUsed[TOPOLOGY_BOARDS][MAX_TEMP_SENSORS_PER_MINION_BOARD] = {{0}};
+    for(int sensor = 0; sensor < NUM_TEMPERATURE_SENSORS; sensor++) {
+        SensorTap tap = SensorMap[sensor];
+        check(tap.board < TOPOLOGY_BOARDS && tap.board < NUM_MINIONS, "sensor on a board that does not exist", sensor);
+        check(tap.mux < 2 && tap.channel < MAX_TEMP_SENSORS_PER_MINION_BOARD / 2, "sensor on a mux channel that does not exist", sensor);
+        if(tap.board >= TOPOLOGY_BOARDS || tap.mux >= 2 || tap.channel >= MAX_TEMP_SENSORS_PER_MINION_BOARD / 2) {
+            continue;
+        }
+        uint8_t channel = tap.mux * (MAX_TEMP_SENSORS_PER_MINION_BOARD / 2) + tap.channel;
+        check(channelUsed[tap.board][channel]++ == 0, "two sensors on one mux channel", sensor);
+        check(Topology_GetChannelSensor(tap.board, channel) == sensor, "mux channel does not map back to sensor", sensor);
+        check(SensorModule[sensor] < NUM_BATTERY_MODULES, "sensor not assigned to a module", sensor);
+    }
+
+    // Module <-> sensor
+    uint8_t sensorCount[NUM_TEMPERATURE_SENSORS] = {0};
+    for(int module = 0; module < NUM_BATTERY_MODULES; module++) {
+        for(int i = 0; i < NUM_TEMP_SENSORS_PER_MOD; i++) {
+            uint8_t sensor = ModuleSensors[module][i];
+            check(sensor < NUM_TEMPERATURE_SENSORS, "module has a sensor that does not exist", module);
+            if(sensor >= NUM_TEMPERATURE_SENSORS) {
+                continue;
+            }
+            sensorCount[sensor]++;
+            check(SensorModule[sensor] == module, "sensor does not map back to module", module);
+        }
+    }
+    for(int sensor = 0; sensor < NUM_TEMPERATURE_SENSORS; sensor++) {
+        check(sensorCount[sensor] == 1, "sensor not listed under exactly one module", sensor);
+    }
+
+    // Every cell input and mux channel without a module or sensor has to be marked unused
+    for(int board = 0; board < TOPOLOGY_BOARDS; board++) {
+        for(int cell = 0; cell < MAX_VOLT_SENSORS_PER_MINION_BOARD; cell++) {
+            check(cellUsed[board][cell] || CellModule[board][cell] == TOPOLOGY_UNUSED, "stray entry in CellModule", board);
+        }
+        for(int channel = 0; channel < MAX_TEMP_SENSORS_PER_MINION_BOARD; channel++) {
+            check(channelUsed[board][channel] || ChannelSensor[board][channel] == TOPOLOGY_UNUSED, "stray entry in ChannelSensor", board);
+        }
+    }
+    check(Topology_GetCellModule(TOPOLOGY_BOARDS, 0) == TOPOLOGY_UNUSED, "lookup past the last board", TOPOLOGY_BOARDS);
+    check(Topology_GetChannelSensor(TOPOLOGY_BOARDS, 0) == TOPOLOGY_UNUSED, "lookup past the last board", TOPOLOGY_BOARDS);
+
+    printf("%d modules and %d sensors mapped\r\n", NUM_BATTERY_MODULES, NUM_TEMPERATURE_SENSORS);
+    TestCheck_Exit();
+}
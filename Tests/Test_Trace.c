@@ -0,0 +1,129 @@
+#include "common.h"
+#include "config.h"
+#include "Trace.h"
+#include "Scheduler.h"
+#include "BSP_Timer.h"
+#include "BSP_UART.h"
+#include "cmsis_os.h"
+#include "TestCheck.h"
+
+/**
+ * Checks the event trace: records come back in order with their type and event packed, a full
+ * ring overwrites the oldest records and records during a dump are dropped and counted. Then
+ * runs a fast task that needs a mutex next to a slow one holding it, like an LTC scan stuck
+ * behind a CLI command, and dumps the trace. "make trace" turns the dump into trace.json.
+ */
+
+#define COST_RUNS       1000000
+#define HOLD_MS         15          // How long the slow task keeps the mutex
+#define RUN_MS          300
+
+static osMutexId Mutex;
+static uint32_t Start;
+
+osMutexDef(Mutex);
+
+static bool FastTask(void) {
+    TRACE_BEGIN(TRACE_LOCK, TRACE_LTC_LOCK);
+    osMutexWait(Mutex, osWaitForever);
+    TRACE_END(TRACE_LOCK, TRACE_LTC_LOCK);
+    osMutexRelease(Mutex);
+    return BSP_Timer_GetTick() - Start < RUN_MS;
+}
+
+static bool SlowTask(void) {
+    osMutexWait(Mutex, osWaitForever);
+    uint32_t start = BSP_Timer_GetTick();
+    while(BSP_Timer_GetTick() - start < HOLD_MS);
+    osMutexRelease(Mutex);
+    return true;
+}
+
+static const SchedulerTask Tasks[] = {
+    {"fast",    FastTask,   10,     0,  10},
+    {"slow",    SlowTask,   50,     5,  50},
+};
+
+int main() {
+
+    BSP_UART_Init();    // Initialize printf
+    osKernelInitialize();
+    osKernelStart();
+
+#if TRACE_ENABLED
+    // Order and packing
+    TRACE_BEGIN(TRACE_TASK, 1);
+    TRACE_INSTANT(TRACE_FAULT, 0);
+    TRACE_END(TRACE_TASK, 1);
+    const TraceRecord *begin = Trace_Get(0);
+    const TraceRecord *instant = Trace_Get(1);
+    const TraceRecord *end = Trace_Get(2);
+    Check(begin != NULL && instant != NULL && end != NULL && Trace_Get(3) == NULL,
+        "every record should be in the ring");
+    Check(begin->event == (TRACE_TYPE_BEGIN << TRACE_TYPE_SHIFT | TRACE_TASK) && begin->arg == 1,
+        "a begin should keep its event and argument");
+    Check(instant->event >> TRACE_TYPE_SHIFT == TRACE_TYPE_INSTANT, "an instant should keep its type");
+    Check(end->event >> TRACE_TYPE_SHIFT == TRACE_TYPE_END, "an end should keep its type");
+    Check((int32_t)(end->time - begin->time) >= 0, "records should be in time order");
+    Check(begin->thread == end->thread, "records of one thread should have the same thread");
+
+    // Records while paused are dropped
+    TRACE_INSTANT(TRACE_FAULT, 0);
+    uint32_t dropped;
+    Check(Trace_GetLost(&dropped) == 0 && dropped == 1, "a record while paused should be dropped");
+    Trace_Resume();
+
+    // A full ring keeps the newest records
+    Trace_Reset();
+    for(uint32_t i = 0; i < TRACE_SIZE + 10; i++) {
+        TRACE_INSTANT(TRACE_STAGE, i & 0xFF);
+    }
+    Check(Trace_GetLost(&dropped) == 10 && dropped == 0, "a full ring should overwrite the oldest records");
+    Check(Trace_Get(0)->arg == 10 && Trace_Get(TRACE_SIZE - 1)->arg == ((TRACE_SIZE + 9) & 0xFF),
+        "the oldest record left should come first");
+    Check(Trace_Get(TRACE_SIZE) == NULL, "the ring should hold TRACE_SIZE records");
+    Trace_Resume();
+
+    // What a record costs
+    Trace_Reset();
+    uint32_t start = BSP_Timer_GetCycleCount();
+    for(uint32_t i = 0; i < COST_RUNS; i++) {
+        TRACE_INSTANT(TRACE_STAGE, 0);
+    }
+    uint32_t cost = (BSP_Timer_GetCycleCount() - start) / COST_RUNS;
+    printf("Record cost: %lu cycles (ns on the simulator)\r\n", (unsigned long)cost);
+    Check(cost < 1000, "a record should cost well under a microsecond");
+
+    // A task waiting for a mutex another one holds
+    Trace_Reset();
+    Mutex = osMutexCreate(osMutex(Mutex));
+    Scheduler_Init(Tasks, sizeof(Tasks) / sizeof(Tasks[0]));
+    Start = BSP_Timer_GetTick();
+    Scheduler_Start();
+    Scheduler_Run();
+
+    uint32_t longest = 0;
+    uint32_t waitStart = 0;
+    const TraceRecord *record;
+    for(uint32_t i = 0; (record = Trace_Get(i)) != NULL; i++) {
+        if((record->event & ((1 << TRACE_TYPE_SHIFT) - 1)) != TRACE_LOCK) {
+            continue;
+        }
+        if(record->event >> TRACE_TYPE_SHIFT == TRACE_TYPE_BEGIN) {
+            waitStart = record->time;
+        } else if(record->time - waitStart > longest) {
+            longest = record->time - waitStart;
+        }
+    }
+    Trace_Resume();
+    Check(longest / 1000000 >= HOLD_MS / 2, "the trace should show the fast task waiting for the slow one");
+
+    Trace_Dump();
+    Check(Trace_Get(0) == NULL, "a dump should empty the ring");
+    Trace_Resume();
+#else
+    Check(Trace_Get(0) == NULL, "a compiled out trace has no records");
+#endif
+
+    TestCheck_Exit();
+}
@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+"""
+Turns the event trace the BPS prints ("trace" on the CLI) into Chrome trace JSON.
+Open the result in Perfetto (https://ui.perfetto.dev) or chrome://tracing.
+
+    python3 Tools/trace2json.py uart.log trace.json
+    ./bps-simulator.out | python3 Tools/trace2json.py - trace.json
+
+Everything outside "trace begin" ... "trace end" is skipped, so a whole UART log or
+simulator output works. With several dumps in the input they follow each other in time.
+Records lost to the ring running over can leave an end without its begin, those are
+dropped. A begin without its end is closed at the last record.
+"""
+
+import json
+import sys
+
+TYPE_SHIFT = 6
+TYPES = {0: 'B', 1: 'E', 2: 'i'}
+PID = 1
+
+
+def parse(lines):
+    """
+    Yields every dump in the input as (frequency, overwritten, dropped, kinds, names, records).
+    kinds maps an event to its kind, names maps (event, arg) to a name and records are
+    (time, thread, type, event, arg).
+    """
+    dump = None
+    for line in lines:
+        words = line.strip().split()
+        while words and words[0] == '>>':
+            words = words[1:]           # CLI prompt
+        if words[:2] == ['trace', 'begin'] and len(words) == 5:
+            dump = (int(words[2]), int(words[3]), int(words[4]), {}, {}, [])
+        elif dump is None or not words:
+            continue
+        elif words == ['trace', 'end']:
+            yield dump
+            dump = None
+        elif words[0] == 'kind' and len(words) == 3:
+            dump[3][int(words[1])] = words[2]
+        elif words[0] == 'name' and len(words) >= 4:
+            dump[4][(int(words[1]), int(words[2]))] = ' '.join(words[3:])
+        elif len(words) == 4:
+            event = int(words[2], 16)
+            dump[5].append((int(words[0], 16), int(words[1], 16), event >> TYPE_SHIFT,
+                            event & ((1 << TYPE_SHIFT) - 1), int(words[3], 16)))
+
+
+def convert(dumps):
+    """
+    Builds the Chrome trace events of all dumps
+    """
+    events = []
+    threads = {}
+    offset = 0.0        # us, later dumps carry on after earlier ones
+    for frequency, overwritten, dropped, kinds, names, records in dumps:
+        if overwritten or dropped:
+            print('%d records overwritten, %d dropped while dumping' % (overwritten, dropped),
+                  file=sys.stderr)
+
+        # 32-bit cycle counts wrap, records are close enough in time to unwrap them
+        time = 0
+        previous = None
+        stacks = {}
+        last = offset
+        for raw, thread, kind, event, arg in records:
+            if previous is not None:
+                delta = (raw - previous) & 0xFFFFFFFF
+                time += delta - (1 << 32) if delta >= 1 << 31 else delta
+            previous = raw
+            ts = offset + time * 1e6 / frequency
+            last = max(last, ts)
+
+            kindName = kinds.get(event, 'event %d' % event)
+            name = names.get((event, arg), '%s %d' % (kindName, arg))
+            if kindName == 'task' and kind == 0:
+                threads.setdefault(thread, name)
+
+            stack = stacks.setdefault(thread, [])
+            if kind == 0:
+                stack.append((event, arg, name, kindName))
+            elif kind == 1:
+                if (event, arg) not in [(e, a) for e, a, _, _ in stack]:
+                    continue        # Its begin was overwritten
+                while stack:
+                    e, a, n, k = stack.pop()
+                    if (e, a) == (event, arg):
+                        break
+                    events.append({'name': n, 'cat': k, 'ph': 'E', 'ts': ts, 'pid': PID, 'tid': thread})
+            elif kind not in TYPES:
+                continue
+
+            record = {'name': name, 'cat': kindName, 'ph': TYPES[kind], 'ts': ts, 'pid': PID, 'tid': thread}
+            if kind == 2:
+                record['s'] = 'p'       # Instants span the whole process
+            events.append(record)
+
+        for thread, stack in stacks.items():
+            while stack:
+                e, a, n, k = stack.pop()
+                events.append({'name': n, 'cat': k, 'ph': 'E', 'ts': last, 'pid': PID, 'tid': thread})
+        offset = last
+
+    events.append({'name': 'process_name', 'ph': 'M', 'pid': PID, 'args': {'name': 'BPS'}})
+    for thread in {event['tid'] for event in events if 'tid' in event}:
+        name = threads.get(thread, 'thread %04x' % thread)
+        events.append({'name': 'thread_name', 'ph': 'M', 'pid': PID, 'tid': thread, 'args': {'name': name}})
+    return events
+
+
+def main():
+    if len(sys.argv) != 3:
+        print(__doc__, file=sys.stderr)
+        sys.exit(2)
+
+    source = sys.stdin if sys.argv[1] == '-' else open(sys.argv[1], errors='replace')
+    dumps = list(parse(source))
+    if not dumps:
+        print('No trace found in %s' % sys.argv[1], file=sys.stderr)
+        sys.exit(1)
+
+    events = convert(dumps)
+    with open(sys.argv[2], 'w') as out:
+        json.dump({'traceEvents': events, 'displayTimeUnit': 'ms'}, out)
+    print('%d events from %d dumps written to %s' % (len(events), len(dumps), sys.argv[2]))
+
+
+if __name__ == '__main__':
+    main()